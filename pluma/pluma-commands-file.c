@@ -57,6 +57,10 @@
 #define PLUMA_IS_QUITTING "pluma-is-quitting"
 #define PLUMA_IS_CLOSING_TAB "pluma-is-closing-tab"
 #define PLUMA_IS_QUITTING_ALL "pluma-is-quitting-all"
+#define PLUMA_SAVE_BATCH "pluma-save-batch"
+
+/* how many documents of a window are saved at the same time */
+#define MAX_CONCURRENT_SAVES 4
 
 static void tab_state_changed_while_saving(PlumaTab *tab, GParamSpec *pspec,
                                            PlumaWindow *window);
@@ -103,10 +107,12 @@ static gboolean is_duplicated_file(GSList *files, GFile *file) {
   return FALSE;
 }
 
-/* File loading */
+/* File loading: range and range_size are only used for the files which are
+ * not open yet, see _pluma_document_set_load_range() */
 static gint load_file_list(PlumaWindow *window, GSList *files,
                            const PlumaEncoding *encoding, gint line_pos,
-                           gboolean create) {
+                           gboolean create, PlumaDocumentLoadRange range,
+                           goffset range_size) {
   PlumaTab *tab;
   gint loaded_files = 0;   /* Number of files to load */
   gboolean jump_to = TRUE; /* Whether to jump to the new tab */
@@ -167,6 +173,7 @@ static gint load_file_list(PlumaWindow *window, GSList *files,
 
       // FIXME: pass the GFile to tab when api is there
       uri = g_file_get_uri(l->data);
+      _pluma_document_set_load_range(doc, range, range_size);
       _pluma_tab_load(tab, uri, encoding, line_pos, create);
       g_free(uri);
 
@@ -184,8 +191,18 @@ static gint load_file_list(PlumaWindow *window, GSList *files,
 
     // FIXME: pass the GFile to tab when api is there
     uri = g_file_get_uri(l->data);
-    tab = pluma_window_create_tab_from_uri(window, uri, encoding, line_pos,
-                                           create, jump_to);
+
+    if (range == PLUMA_DOCUMENT_LOAD_RANGE_ALL) {
+      tab = pluma_window_create_tab_from_uri(window, uri, encoding, line_pos,
+                                             create, jump_to);
+    } else {
+      /* the range has to be set before the load starts */
+      tab = pluma_window_create_tab(window, jump_to);
+      _pluma_document_set_load_range(pluma_tab_get_document(tab), range,
+                                     range_size);
+      _pluma_tab_load(tab, uri, encoding, line_pos, create);
+    }
+
     g_free(uri);
 
     if (tab != NULL) {
@@ -247,7 +264,8 @@ static gint load_uri_list(PlumaWindow *window, const GSList *uris,
   }
   files = g_slist_reverse(files);
 
-  ret = load_file_list(window, files, encoding, line_pos, create);
+  ret = load_file_list(window, files, encoding, line_pos, create,
+                       PLUMA_DOCUMENT_LOAD_RANGE_ALL, 0);
 
   g_slist_free_full(files, g_object_unref);
 
@@ -306,13 +324,16 @@ gint pluma_commands_load_uris(PlumaWindow *window, const GSList *uris,
  */
 static gint pluma_commands_load_files(PlumaWindow *window, GSList *files,
                                       const PlumaEncoding *encoding,
-                                      gint line_pos) {
+                                      gint line_pos,
+                                      PlumaDocumentLoadRange range,
+                                      goffset range_size) {
   g_return_val_if_fail(PLUMA_IS_WINDOW(window), 0);
   g_return_val_if_fail((files != NULL) && (files->data != NULL), 0);
 
   pluma_debug(DEBUG_COMMANDS);
 
-  return load_file_list(window, files, encoding, line_pos, FALSE);
+  return load_file_list(window, files, encoding, line_pos, FALSE, range,
+                        range_size);
 }
 
 /*
@@ -322,10 +343,13 @@ static gint pluma_commands_load_files(PlumaWindow *window, GSList *files,
  */
 gint _pluma_cmd_load_files_from_prompt(PlumaWindow *window, GSList *files,
                                        const PlumaEncoding *encoding,
-                                       gint line_pos) {
+                                       gint line_pos,
+                                       PlumaDocumentLoadRange range,
+                                       goffset range_size) {
   pluma_debug(DEBUG_COMMANDS);
 
-  return load_file_list(window, files, encoding, line_pos, TRUE);
+  return load_file_list(window, files, encoding, line_pos, TRUE, range,
+                        range_size);
 }
 
 static void open_dialog_destroyed(PlumaWindow *window,
@@ -339,6 +363,8 @@ static void open_dialog_response_cb(PlumaFileChooserDialog *dialog,
                                     gint response_id, PlumaWindow *window) {
   GSList *files;
   const PlumaEncoding *encoding;
+  PlumaDocumentLoadRange range;
+  goffset range_size;
 
   pluma_debug(DEBUG_COMMANDS);
 
@@ -352,13 +378,14 @@ static void open_dialog_response_cb(PlumaFileChooserDialog *dialog,
   g_return_if_fail(files != NULL);
 
   encoding = pluma_file_chooser_dialog_get_encoding(dialog);
+  range = pluma_file_chooser_dialog_get_load_range(dialog, &range_size);
 
   gtk_widget_destroy(GTK_WIDGET(dialog));
 
   /* Remember the folder we navigated to */
   _pluma_window_set_default_location(window, files->data);
 
-  pluma_commands_load_files(window, files, encoding, 0);
+  pluma_commands_load_files(window, files, encoding, 0, range, range_size);
 
   g_slist_free_full(files, g_object_unref);
 }
@@ -757,12 +784,203 @@ static gboolean document_needs_saving(PlumaDocument *doc) {
   return FALSE;
 }
 
+/* The documents saved by Save All: a few at a time, the smallest first, with
+ * the progress shown on the statusbar of the window */
+typedef struct {
+  PlumaWindow *window;
+
+  GList *pending; /* PlumaTab, not saving yet */
+  GList *running; /* PlumaTab, saving */
+
+  guint n_total;
+  guint n_done;
+  guint n_failed;
+
+  GTimer *timer;
+
+  gboolean starting;
+} SaveBatch;
+
+static void batch_tab_state_changed(PlumaTab *tab, GParamSpec *pspec,
+                                    SaveBatch *batch);
+
+static void save_batch_free(SaveBatch *batch) {
+  GList *l;
+
+  for (l = batch->running; l != NULL; l = l->next) {
+    g_signal_handlers_disconnect_by_func(
+        l->data, G_CALLBACK(batch_tab_state_changed), batch);
+  }
+
+  g_list_free_full(batch->pending, g_object_unref);
+  g_list_free_full(batch->running, g_object_unref);
+  g_timer_destroy(batch->timer);
+
+  g_slice_free(SaveBatch, batch);
+}
+
+static gint compare_tabs_by_size(gconstpointer a, gconstpointer b) {
+  gint size_a;
+  gint size_b;
+
+  size_a = gtk_text_buffer_get_char_count(
+      GTK_TEXT_BUFFER(pluma_tab_get_document(PLUMA_TAB(a))));
+  size_b = gtk_text_buffer_get_char_count(
+      GTK_TEXT_BUFFER(pluma_tab_get_document(PLUMA_TAB(b))));
+
+  return (size_a > size_b) - (size_a < size_b);
+}
+
+static gboolean can_save_tab(PlumaTab *tab, PlumaWindow *window) {
+  PlumaTabState state;
+
+  /* it may have been closed or moved while waiting */
+  if (gtk_widget_get_toplevel(GTK_WIDGET(tab)) != GTK_WIDGET(window))
+    return FALSE;
+
+  state = pluma_tab_get_state(tab);
+
+  return (state == PLUMA_TAB_STATE_NORMAL) ||
+         (state == PLUMA_TAB_STATE_SHOWING_PRINT_PREVIEW);
+}
+
+static void save_batch_report(SaveBatch *batch) {
+  PlumaStatusbar *statusbar = PLUMA_STATUSBAR(batch->window->priv->statusbar);
+  guint cid = batch->window->priv->generic_message_cid;
+
+  if (batch->n_done < batch->n_total) {
+    pluma_statusbar_flash_message(
+        statusbar, cid,
+        ngettext("Saving %d of %d file\342\200\246",
+                 "Saving %d of %d files\342\200\246", batch->n_total),
+        batch->n_done + 1, batch->n_total);
+  } else if (batch->n_failed > 0) {
+    pluma_statusbar_flash_message(
+        statusbar, cid,
+        ngettext("%d of %d file could not be saved",
+                 "%d of %d files could not be saved", batch->n_total),
+        batch->n_failed, batch->n_total);
+  } else {
+    pluma_statusbar_flash_message(
+        statusbar, cid,
+        ngettext("Saved %d file", "Saved %d files", batch->n_total),
+        batch->n_total);
+  }
+}
+
+static void save_batch_start_saves(SaveBatch *batch) {
+  /* a save which completes right away ends up here again */
+  if (batch->starting) return;
+
+  batch->starting = TRUE;
+
+  while (batch->pending != NULL &&
+         g_list_length(batch->running) < MAX_CONCURRENT_SAVES) {
+    PlumaTab *tab = PLUMA_TAB(batch->pending->data);
+
+    batch->pending = g_list_delete_link(batch->pending, batch->pending);
+
+    if (!can_save_tab(tab, batch->window)) {
+      batch->n_done++;
+      batch->n_failed++;
+      g_object_unref(tab);
+      continue;
+    }
+
+    batch->running = g_list_prepend(batch->running, tab);
+
+    g_signal_connect(tab, "notify::state",
+                     G_CALLBACK(batch_tab_state_changed), batch);
+
+    _pluma_tab_save(tab);
+
+    /* it did not even start */
+    if (g_list_find(batch->running, tab) != NULL &&
+        pluma_tab_get_state(tab) != PLUMA_TAB_STATE_SAVING) {
+      g_signal_handlers_disconnect_by_func(
+          tab, G_CALLBACK(batch_tab_state_changed), batch);
+
+      batch->running = g_list_remove(batch->running, tab);
+      batch->n_done++;
+      batch->n_failed++;
+      g_object_unref(tab);
+    }
+  }
+
+  batch->starting = FALSE;
+
+  if (batch->running == NULL && batch->pending == NULL) {
+    pluma_debug_message(DEBUG_COMMANDS, "Saved %u documents in %g seconds",
+                        batch->n_total, g_timer_elapsed(batch->timer, NULL));
+
+    save_batch_report(batch);
+
+    /* frees the batch */
+    g_object_set_data(G_OBJECT(batch->window), PLUMA_SAVE_BATCH, NULL);
+  } else {
+    save_batch_report(batch);
+  }
+}
+
+static void batch_tab_state_changed(PlumaTab *tab, GParamSpec *pspec,
+                                    SaveBatch *batch) {
+  PlumaTabState state;
+
+  state = pluma_tab_get_state(tab);
+
+  if (state == PLUMA_TAB_STATE_SAVING) return;
+
+  g_signal_handlers_disconnect_by_func(
+      tab, G_CALLBACK(batch_tab_state_changed), batch);
+
+  batch->running = g_list_remove(batch->running, tab);
+  batch->n_done++;
+
+  /* the error is shown in the tab, the user is asked what to do there */
+  if (state == PLUMA_TAB_STATE_SAVING_ERROR) batch->n_failed++;
+
+  g_object_unref(tab);
+
+  save_batch_start_saves(batch);
+}
+
+static void save_tabs(PlumaWindow *window, GList *tabs) {
+  SaveBatch *batch;
+  GList *l;
+
+  batch = g_object_get_data(G_OBJECT(window), PLUMA_SAVE_BATCH);
+
+  if (batch == NULL) {
+    batch = g_slice_new0(SaveBatch);
+    batch->window = window;
+    batch->timer = g_timer_new();
+
+    g_object_set_data_full(G_OBJECT(window), PLUMA_SAVE_BATCH, batch,
+                           (GDestroyNotify)save_batch_free);
+  }
+
+  for (l = tabs; l != NULL; l = l->next) {
+    /* already in the batch */
+    if (g_list_find(batch->pending, l->data) != NULL ||
+        g_list_find(batch->running, l->data) != NULL)
+      continue;
+
+    batch->pending = g_list_prepend(batch->pending, g_object_ref(l->data));
+    batch->n_total++;
+  }
+
+  batch->pending = g_list_sort(batch->pending, compare_tabs_by_size);
+
+  save_batch_start_saves(batch);
+}
+
 /*
  * The docs in the list must belong to the same PlumaWindow.
  */
 void _pluma_cmd_file_save_documents_list(PlumaWindow *window, GList *docs) {
   GList *l;
   GSList *tabs_to_save_as = NULL;
+  GList *tabs_to_save = NULL;
 
   pluma_debug(DEBUG_COMMANDS);
 
@@ -796,7 +1014,7 @@ void _pluma_cmd_file_save_documents_list(PlumaWindow *window, GList *docs) {
           tabs_to_save_as = g_slist_prepend(tabs_to_save_as, t);
         }
       } else {
-        file_save(t, window);
+        tabs_to_save = g_list_prepend(tabs_to_save, t);
       }
     } else {
       /* If the state is:
@@ -835,6 +1053,11 @@ void _pluma_cmd_file_save_documents_list(PlumaWindow *window, GList *docs) {
     l = g_list_next(l);
   }
 
+  if (tabs_to_save != NULL) {
+    save_tabs(window, tabs_to_save);
+    g_list_free(tabs_to_save);
+  }
+
   if (tabs_to_save_as != NULL) {
     PlumaTab *tab;
 
@@ -106,6 +106,34 @@ static void text_found(PlumaWindow *window, gint occurrences) {
   }
 }
 
+/* the position of the selected match among all of them, when they are all
+ * known */
+static void match_found(PlumaWindow *window, PlumaView *view) {
+  PlumaDocument *doc;
+  GtkTextIter match_start;
+  gint position;
+  gint n_matches;
+
+  doc = PLUMA_DOCUMENT(gtk_text_view_get_buffer(GTK_TEXT_VIEW(view)));
+
+  gtk_text_buffer_get_selection_bounds(GTK_TEXT_BUFFER(doc), &match_start,
+                                       NULL);
+
+  if (_pluma_document_get_match_position(doc, &match_start, &position,
+                                         &n_matches)) {
+    pluma_statusbar_flash_message(PLUMA_STATUSBAR(window->priv->statusbar),
+                                  window->priv->generic_message_cid,
+                                  /* Translators: the first %d is the
+                                     position of the match found, the second
+                                     one the number of matches */
+                                  ngettext("Match %d of %d", "Match %d of %d",
+                                           n_matches),
+                                  position, n_matches);
+  } else {
+    text_found(window, 0);
+  }
+}
+
 #define MAX_MSG_LENGTH 40
 static void text_not_found(PlumaWindow *window, const gchar *text) {
   gchar *searched;
@@ -225,7 +253,7 @@ static void do_find(PlumaSearchDialog *dialog, PlumaWindow *window) {
   found = run_search(active_view, wrap_around, search_backwards);
 
   if (found)
-    text_found(window, 0);
+    match_found(window, active_view);
   else {
     if (!parse_escapes) {
       text_not_found(window, pluma_utils_unescape_search_text(entry_text));
@@ -619,7 +647,8 @@ static void do_find_again(PlumaWindow *window, gboolean backward) {
     wrap_around =
         pluma_search_dialog_get_wrap_around(PLUMA_SEARCH_DIALOG(data));
 
-  run_search(active_view, wrap_around, backward);
+  if (run_search(active_view, wrap_around, backward))
+    match_found(window, active_view);
 }
 
 void _pluma_cmd_search_find_next(GtkAction *action, PlumaWindow *window) {
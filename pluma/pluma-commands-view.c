@@ -127,3 +127,26 @@ void _pluma_cmd_view_leave_fullscreen_mode(GtkAction *action,
   g_signal_handlers_unblock_by_func(
       view_action, G_CALLBACK(_pluma_cmd_view_toggle_fullscreen_mode), window);
 }
+
+void _pluma_cmd_view_toggle_follow(GtkAction *action, PlumaWindow *window) {
+  PlumaTab *tab;
+  gboolean active;
+
+  pluma_debug(DEBUG_COMMANDS);
+
+  tab = pluma_window_get_active_tab(window);
+  if (tab == NULL) return;
+
+  active = gtk_toggle_action_get_active(GTK_TOGGLE_ACTION(action));
+
+  _pluma_tab_set_follow(tab, active);
+
+  /* the tab may refuse, e.g. when the document has unsaved changes */
+  if (_pluma_tab_get_follow(tab) != active) {
+    g_signal_handlers_block_by_func(
+        action, G_CALLBACK(_pluma_cmd_view_toggle_follow), window);
+    gtk_toggle_action_set_active(GTK_TOGGLE_ACTION(action), !active);
+    g_signal_handlers_unblock_by_func(
+        action, G_CALLBACK(_pluma_cmd_view_toggle_follow), window);
+  }
+}
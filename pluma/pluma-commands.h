@@ -59,7 +59,9 @@ void pluma_commands_save_all_documents(PlumaWindow *window);
 /* Create titled documens for non-existing URIs */
 gint _pluma_cmd_load_files_from_prompt(PlumaWindow *window, GSList *files,
                                        const PlumaEncoding *encoding,
-                                       gint line_pos);
+                                       gint line_pos,
+                                       PlumaDocumentLoadRange range,
+                                       goffset range_size);
 
 void _pluma_cmd_file_new(GtkAction *action, PlumaWindow *window);
 void _pluma_cmd_file_open(GtkAction *action, PlumaWindow *window);
@@ -95,6 +97,7 @@ void _pluma_cmd_view_toggle_fullscreen_mode(GtkAction *action,
                                             PlumaWindow *window);
 void _pluma_cmd_view_leave_fullscreen_mode(GtkAction *action,
                                            PlumaWindow *window);
+void _pluma_cmd_view_toggle_follow(GtkAction *action, PlumaWindow *window);
 
 void _pluma_cmd_search_find(GtkAction *action, PlumaWindow *window);
 void _pluma_cmd_search_find_next(GtkAction *action, PlumaWindow *window);
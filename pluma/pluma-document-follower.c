@@ -0,0 +1,482 @@
+/*
+ * pluma-document-follower.c
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "pluma-document-follower.h"
+
+#include <gio/gio.h>
+#include <glib/gi18n.h>
+
+#include "pluma-debug.h"
+#include "pluma-document-output-stream.h"
+#include "pluma-single-byte-converter.h"
+
+#define FOLLOW_CHUNK_SIZE 8192
+#define FOLLOW_QUERY_ATTRIBUTES                                   \
+  G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_TIME_MODIFIED \
+                                 "," G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC
+
+/* Signals */
+
+enum { APPENDED, STOPPED, LAST_SIGNAL };
+
+static guint signals[LAST_SIGNAL] = {0};
+
+struct _PlumaDocumentFollowerPrivate {
+  PlumaDocument *document;
+  GFile *location;
+
+  GCancellable *cancellable;
+  GFileMonitor *monitor;
+
+  /* the file is read from offset to its end each time it changes */
+  GInputStream *stream;
+  GOutputStream *output;
+  goffset offset;
+  gint64 mtime;
+
+  gchar buffer[FOLLOW_CHUNK_SIZE];
+
+  guint running : 1;
+  guint reading : 1;
+  guint changed_while_reading : 1;
+  guint appended : 1;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE(PlumaDocumentFollower, pluma_document_follower,
+                           G_TYPE_OBJECT)
+
+static void read_changes(PlumaDocumentFollower *follower);
+
+static void stop_following(PlumaDocumentFollower *follower) {
+  PlumaDocumentFollowerPrivate *priv = follower->priv;
+
+  priv->running = FALSE;
+  priv->reading = FALSE;
+  priv->changed_while_reading = FALSE;
+
+  g_cancellable_cancel(priv->cancellable);
+  g_clear_object(&priv->cancellable);
+
+  if (priv->monitor != NULL) {
+    g_file_monitor_cancel(priv->monitor);
+    g_clear_object(&priv->monitor);
+  }
+
+  g_clear_object(&priv->stream);
+
+  if (priv->output != NULL) {
+    /* an incomplete character at the end of the file is dropped */
+    g_output_stream_close(priv->output, NULL, NULL);
+    g_clear_object(&priv->output);
+  }
+}
+
+static void pluma_document_follower_dispose(GObject *object) {
+  PlumaDocumentFollower *follower = PLUMA_DOCUMENT_FOLLOWER(object);
+
+  if (follower->priv->running) stop_following(follower);
+
+  g_clear_object(&follower->priv->location);
+  g_clear_object(&follower->priv->document);
+
+  G_OBJECT_CLASS(pluma_document_follower_parent_class)->dispose(object);
+}
+
+static void pluma_document_follower_class_init(
+    PlumaDocumentFollowerClass *klass) {
+  GObjectClass *object_class = G_OBJECT_CLASS(klass);
+
+  object_class->dispose = pluma_document_follower_dispose;
+
+  signals[APPENDED] = g_signal_new(
+      "appended", G_OBJECT_CLASS_TYPE(object_class), G_SIGNAL_RUN_LAST,
+      G_STRUCT_OFFSET(PlumaDocumentFollowerClass, appended), NULL, NULL, NULL,
+      G_TYPE_NONE, 0);
+
+  signals[STOPPED] = g_signal_new(
+      "stopped", G_OBJECT_CLASS_TYPE(object_class), G_SIGNAL_RUN_LAST,
+      G_STRUCT_OFFSET(PlumaDocumentFollowerClass, stopped), NULL, NULL, NULL,
+      G_TYPE_NONE, 1, G_TYPE_POINTER);
+}
+
+static void pluma_document_follower_init(PlumaDocumentFollower *follower) {
+  follower->priv = pluma_document_follower_get_instance_private(follower);
+}
+
+PlumaDocumentFollower *pluma_document_follower_new(PlumaDocument *doc) {
+  PlumaDocumentFollower *follower;
+  gchar *uri;
+
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT(doc), NULL);
+
+  uri = pluma_document_get_uri(doc);
+  g_return_val_if_fail(uri != NULL, NULL);
+
+  follower = g_object_new(PLUMA_TYPE_DOCUMENT_FOLLOWER, NULL);
+  follower->priv->document = g_object_ref(doc);
+  follower->priv->location = g_file_new_for_uri(uri);
+
+  g_free(uri);
+
+  return follower;
+}
+
+static void stop_with_error(PlumaDocumentFollower *follower, GError *error) {
+  pluma_debug_message(DEBUG_LOADER, "Stop following: %s", error->message);
+
+  stop_following(follower);
+
+  g_signal_emit(follower, signals[STOPPED], 0, error);
+
+  g_error_free(error);
+}
+
+/* Returns TRUE if the follower was stopped while the operation was running,
+ * in which case the result of the operation is discarded */
+static gboolean operation_cancelled(PlumaDocumentFollower *follower,
+                                    GError *error) {
+  if (!follower->priv->running ||
+      (error != NULL &&
+       g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))) {
+    if (error != NULL) g_error_free(error);
+
+    g_object_unref(follower);
+
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+static void end_reading(PlumaDocumentFollower *follower) {
+  PlumaDocumentFollowerPrivate *priv = follower->priv;
+
+  if (priv->stream != NULL) {
+    g_input_stream_close(priv->stream, NULL, NULL);
+    g_clear_object(&priv->stream);
+  }
+
+  priv->reading = FALSE;
+
+  /* what we have is what is on disk, do not ask to reload it */
+  _pluma_document_set_mtime(priv->document, priv->mtime);
+
+  if (priv->appended) {
+    priv->appended = FALSE;
+    g_signal_emit(follower, signals[APPENDED], 0);
+  }
+
+  if (priv->running && priv->changed_while_reading) {
+    priv->changed_while_reading = FALSE;
+    read_changes(follower);
+  }
+}
+
+static void async_read_cb(GInputStream *stream, GAsyncResult *res,
+                          PlumaDocumentFollower *follower) {
+  PlumaDocumentFollowerPrivate *priv = follower->priv;
+  GError *error = NULL;
+  gssize bytes_read;
+
+  bytes_read = g_input_stream_read_finish(stream, res, &error);
+
+  if (operation_cancelled(follower, error)) return;
+
+  if (bytes_read == -1) {
+    stop_with_error(follower, error);
+    g_object_unref(follower);
+    return;
+  }
+
+  if (bytes_read == 0) {
+    end_reading(follower);
+    g_object_unref(follower);
+    return;
+  }
+
+  if (!g_output_stream_write_all(priv->output, priv->buffer, bytes_read, NULL,
+                                 priv->cancellable, &error)) {
+    stop_with_error(follower, error);
+    g_object_unref(follower);
+    return;
+  }
+
+  priv->offset += bytes_read;
+  priv->appended = TRUE;
+
+  /* keep the reference for the next read */
+  g_input_stream_read_async(priv->stream, priv->buffer, FOLLOW_CHUNK_SIZE,
+                            G_PRIORITY_DEFAULT, priv->cancellable,
+                            (GAsyncReadyCallback)async_read_cb, follower);
+}
+
+static void query_info_cb(GFileInputStream *stream, GAsyncResult *res,
+                          PlumaDocumentFollower *follower) {
+  PlumaDocumentFollowerPrivate *priv = follower->priv;
+  GError *error = NULL;
+  GFileInfo *info;
+  goffset size;
+
+  info = g_file_input_stream_query_info_finish(stream, res, &error);
+
+  if (operation_cancelled(follower, error)) {
+    if (info != NULL) g_object_unref(info);
+    return;
+  }
+
+  if (info == NULL) {
+    stop_with_error(follower, error);
+    g_object_unref(follower);
+    return;
+  }
+
+  size = g_file_info_get_size(info);
+
+  priv->mtime = g_file_info_get_attribute_uint64(
+                    info, G_FILE_ATTRIBUTE_TIME_MODIFIED) *
+                G_USEC_PER_SEC;
+  priv->mtime += g_file_info_get_attribute_uint32(
+      info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+
+  g_object_unref(info);
+
+  /* the file was rewritten, what we have is no longer a prefix of it */
+  if (size < priv->offset) {
+    g_set_error(&error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                _("The file was truncated."));
+    stop_with_error(follower, error);
+    g_object_unref(follower);
+    return;
+  }
+
+  if (size == priv->offset) {
+    end_reading(follower);
+    g_object_unref(follower);
+    return;
+  }
+
+  if (!g_seekable_seek(G_SEEKABLE(priv->stream), priv->offset, G_SEEK_SET,
+                       priv->cancellable, &error)) {
+    stop_with_error(follower, error);
+    g_object_unref(follower);
+    return;
+  }
+
+  pluma_debug_message(DEBUG_LOADER,
+                      "Reading from %" G_GOFFSET_FORMAT " to %" G_GOFFSET_FORMAT,
+                      priv->offset, size);
+
+  g_input_stream_read_async(priv->stream, priv->buffer, FOLLOW_CHUNK_SIZE,
+                            G_PRIORITY_DEFAULT, priv->cancellable,
+                            (GAsyncReadyCallback)async_read_cb, follower);
+}
+
+static void async_open_cb(GFile *location, GAsyncResult *res,
+                          PlumaDocumentFollower *follower) {
+  GError *error = NULL;
+  GFileInputStream *stream;
+
+  stream = g_file_read_finish(location, res, &error);
+
+  if (operation_cancelled(follower, error)) {
+    if (stream != NULL) g_object_unref(stream);
+    return;
+  }
+
+  if (stream == NULL) {
+    stop_with_error(follower, error);
+    g_object_unref(follower);
+    return;
+  }
+
+  follower->priv->stream = G_INPUT_STREAM(stream);
+
+  g_file_input_stream_query_info_async(
+      stream, FOLLOW_QUERY_ATTRIBUTES, G_PRIORITY_DEFAULT,
+      follower->priv->cancellable, (GAsyncReadyCallback)query_info_cb,
+      follower);
+}
+
+static void read_changes(PlumaDocumentFollower *follower) {
+  PlumaDocumentFollowerPrivate *priv = follower->priv;
+
+  /* read again when the current read is done */
+  if (priv->reading) {
+    priv->changed_while_reading = TRUE;
+    return;
+  }
+
+  priv->reading = TRUE;
+
+  g_file_read_async(priv->location, G_PRIORITY_DEFAULT, priv->cancellable,
+                    (GAsyncReadyCallback)async_open_cb,
+                    g_object_ref(follower));
+}
+
+static void monitor_changed(GFileMonitor *monitor, GFile *file,
+                            GFile *other_file, GFileMonitorEvent event_type,
+                            PlumaDocumentFollower *follower) {
+  GError *error = NULL;
+
+  switch (event_type) {
+    case G_FILE_MONITOR_EVENT_CHANGED:
+    case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+      read_changes(follower);
+      break;
+
+    case G_FILE_MONITOR_EVENT_DELETED:
+    case G_FILE_MONITOR_EVENT_MOVED:
+    case G_FILE_MONITOR_EVENT_MOVED_OUT:
+    case G_FILE_MONITOR_EVENT_RENAMED:
+    case G_FILE_MONITOR_EVENT_UNMOUNTED:
+      g_set_error(&error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+                  _("The file was moved or deleted."));
+      stop_with_error(follower, error);
+      break;
+
+    default:
+      break;
+  }
+}
+
+static GOutputStream *create_output_stream(PlumaDocumentFollower *follower,
+                                           GError **error) {
+  const PlumaEncoding *encoding;
+  GOutputStream *output;
+  GConverter *converter;
+  GOutputStream *converter_stream;
+
+  output = pluma_document_output_stream_new_for_append(
+      follower->priv->document);
+
+  encoding = pluma_document_get_encoding(follower->priv->document);
+
+  if (encoding == NULL || encoding == pluma_encoding_get_utf8()) return output;
+
+  converter =
+      pluma_single_byte_converter_new_with_fallback(encoding, TRUE, error);
+  if (converter == NULL) {
+    g_object_unref(output);
+    return NULL;
+  }
+
+  /* keeps an incomplete character until the rest of it is written */
+  converter_stream = g_converter_output_stream_new(output, converter);
+
+  g_object_unref(converter);
+  g_object_unref(output);
+
+  return converter_stream;
+}
+
+static void start_query_info_cb(GFile *location, GAsyncResult *res,
+                                PlumaDocumentFollower *follower) {
+  PlumaDocumentFollowerPrivate *priv = follower->priv;
+  GError *error = NULL;
+  GFileInfo *info;
+
+  info = g_file_query_info_finish(location, res, &error);
+
+  if (operation_cancelled(follower, error)) {
+    if (info != NULL) g_object_unref(info);
+    return;
+  }
+
+  if (info == NULL) {
+    stop_with_error(follower, error);
+    g_object_unref(follower);
+    return;
+  }
+
+  priv->offset = g_file_info_get_size(info);
+  g_object_unref(info);
+
+  priv->output = create_output_stream(follower, &error);
+  if (priv->output == NULL) {
+    stop_with_error(follower, error);
+    g_object_unref(follower);
+    return;
+  }
+
+  priv->monitor = g_file_monitor_file(location, G_FILE_MONITOR_WATCH_MOVES,
+                                      priv->cancellable, &error);
+  if (priv->monitor == NULL) {
+    stop_with_error(follower, error);
+    g_object_unref(follower);
+    return;
+  }
+
+  g_signal_connect(priv->monitor, "changed", G_CALLBACK(monitor_changed),
+                   follower);
+
+  pluma_debug_message(DEBUG_LOADER, "Following from %" G_GOFFSET_FORMAT,
+                      priv->offset);
+
+  g_object_unref(follower);
+}
+
+void pluma_document_follower_start(PlumaDocumentFollower *follower) {
+  PlumaDocumentFollowerPrivate *priv;
+
+  pluma_debug(DEBUG_LOADER);
+
+  g_return_if_fail(PLUMA_IS_DOCUMENT_FOLLOWER(follower));
+  g_return_if_fail(!follower->priv->running);
+
+  priv = follower->priv;
+
+  priv->running = TRUE;
+  priv->cancellable = g_cancellable_new();
+
+  g_file_query_info_async(priv->location, G_FILE_ATTRIBUTE_STANDARD_SIZE,
+                          G_FILE_QUERY_INFO_NONE, G_PRIORITY_DEFAULT,
+                          priv->cancellable,
+                          (GAsyncReadyCallback)start_query_info_cb,
+                          g_object_ref(follower));
+}
+
+void pluma_document_follower_stop(PlumaDocumentFollower *follower) {
+  pluma_debug(DEBUG_LOADER);
+
+  g_return_if_fail(PLUMA_IS_DOCUMENT_FOLLOWER(follower));
+
+  if (!follower->priv->running) return;
+
+  /* the handlers usually drop their reference */
+  g_object_ref(follower);
+
+  stop_following(follower);
+
+  g_signal_emit(follower, signals[STOPPED], 0, NULL);
+
+  g_object_unref(follower);
+}
+
+goffset pluma_document_follower_get_offset(PlumaDocumentFollower *follower) {
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT_FOLLOWER(follower), 0);
+
+  return follower->priv->offset;
+}
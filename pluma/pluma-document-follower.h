@@ -0,0 +1,93 @@
+/*
+ * pluma-document-follower.h
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __PLUMA_DOCUMENT_FOLLOWER_H__
+#define __PLUMA_DOCUMENT_FOLLOWER_H__
+
+#include <pluma/pluma-document.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Type checking and casting macros
+ */
+#define PLUMA_TYPE_DOCUMENT_FOLLOWER (pluma_document_follower_get_type())
+#define PLUMA_DOCUMENT_FOLLOWER(obj)                               \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), PLUMA_TYPE_DOCUMENT_FOLLOWER, \
+                              PlumaDocumentFollower))
+#define PLUMA_DOCUMENT_FOLLOWER_CLASS(klass)                      \
+  (G_TYPE_CHECK_CLASS_CAST((klass), PLUMA_TYPE_DOCUMENT_FOLLOWER, \
+                           PlumaDocumentFollowerClass))
+#define PLUMA_IS_DOCUMENT_FOLLOWER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), PLUMA_TYPE_DOCUMENT_FOLLOWER))
+#define PLUMA_IS_DOCUMENT_FOLLOWER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass), PLUMA_TYPE_DOCUMENT_FOLLOWER))
+#define PLUMA_DOCUMENT_FOLLOWER_GET_CLASS(obj)                    \
+  (G_TYPE_INSTANCE_GET_CLASS((obj), PLUMA_TYPE_DOCUMENT_FOLLOWER, \
+                             PlumaDocumentFollowerClass))
+
+/* Private structure type */
+typedef struct _PlumaDocumentFollowerPrivate PlumaDocumentFollowerPrivate;
+
+/*
+ * Main object structure
+ */
+typedef struct _PlumaDocumentFollower PlumaDocumentFollower;
+
+struct _PlumaDocumentFollower {
+  GObject object;
+  PlumaDocumentFollowerPrivate *priv;
+};
+
+/*
+ * Class definition
+ */
+typedef struct _PlumaDocumentFollowerClass PlumaDocumentFollowerClass;
+
+struct _PlumaDocumentFollowerClass {
+  GObjectClass parent_class;
+
+  /* Signals */
+  void (*appended)(PlumaDocumentFollower *follower);
+  void (*stopped)(PlumaDocumentFollower *follower, const GError *error);
+};
+
+/*
+ * Public methods
+ */
+GType pluma_document_follower_get_type(void) G_GNUC_CONST;
+
+/* Follows the file the document was loaded from, in the encoding it was
+   loaded with */
+PlumaDocumentFollower *pluma_document_follower_new(PlumaDocument *doc);
+
+/* Starts watching the file. Only what is written to the file from now on is
+   appended to the document */
+void pluma_document_follower_start(PlumaDocumentFollower *follower);
+
+void pluma_document_follower_stop(PlumaDocumentFollower *follower);
+
+goffset pluma_document_follower_get_offset(PlumaDocumentFollower *follower);
+
+G_END_DECLS
+
+#endif /* __PLUMA_DOCUMENT_FOLLOWER_H__ */
@@ -31,23 +31,49 @@
 #include <glib.h>
 #include <string.h>
 
+#include "pluma-document-snapshot.h"
 #include "pluma-enum-types.h"
+#include "pluma-utf8.h"
 
 /* NOTE: never use async methods on this stream, the stream is just
  * a wrapper around GtkTextBuffer api so that we can use GIO Stream
  * methods, but the undelying code operates on a GtkTextBuffer, so
  * there is no I/O involved and should be accessed only by the main
- * thread */
+ * thread. A stream reading a snapshot of the buffer can be read by
+ * another thread instead, see pluma_document_input_stream_new_for_snapshot()
+ */
+
+/* characters copied out of the buffer at once */
+#define SEGMENT_SIZE (256 * 1024)
 
 struct _PlumaDocumentInputStreamPrivate {
   GtkTextBuffer *buffer;
+
+  /* read instead of the buffer when set, with the cancellable of the read
+   * being done and the error it gets */
+  PlumaDocumentSnapshot *snapshot;
+  GCancellable *cancellable;
+  GError *error;
+
+  /* where the next segment starts */
   GtkTextMark *pos;
-  gint bytes_partial;
+
+  /* the text being read, segment_pos bytes of it have been read already */
+  gchar *segment;
+  gsize segment_len;
+  gsize segment_pos;
+  gint segment_offset;
+  gint segment_chars;
 
   PlumaDocumentNewlineType newline_type;
 
+  /* line terminators read so far, indexed by PlumaDocumentNewlineType */
+  guint newline_counts[3];
+
   guint newline_added : 1;
   guint is_initialized : 1;
+  guint read_all : 1;
+  guint normalize_newlines : 1;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE(PlumaDocumentInputStream,
@@ -63,6 +89,18 @@ static gboolean pluma_document_input_stream_close(GInputStream *stream,
                                                   GCancellable *cancellable,
                                                   GError **error);
 
+static void pluma_document_input_stream_finalize(GObject *object) {
+  PlumaDocumentInputStream *stream = PLUMA_DOCUMENT_INPUT_STREAM(object);
+
+  g_free(stream->priv->segment);
+  g_clear_error(&stream->priv->error);
+
+  if (stream->priv->snapshot != NULL)
+    pluma_document_snapshot_unref(stream->priv->snapshot);
+
+  G_OBJECT_CLASS(pluma_document_input_stream_parent_class)->finalize(object);
+}
+
 static void pluma_document_input_stream_set_property(GObject *object,
                                                      guint prop_id,
                                                      const GValue *value,
@@ -110,6 +148,7 @@ static void pluma_document_input_stream_class_init(
   GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
   GInputStreamClass *stream_class = G_INPUT_STREAM_CLASS(klass);
 
+  gobject_class->finalize = pluma_document_input_stream_finalize;
   gobject_class->get_property = pluma_document_input_stream_get_property;
   gobject_class->set_property = pluma_document_input_stream_set_property;
 
@@ -139,6 +178,8 @@ static void pluma_document_input_stream_class_init(
 
 static void pluma_document_input_stream_init(PlumaDocumentInputStream *stream) {
   stream->priv = pluma_document_input_stream_get_instance_private(stream);
+
+  stream->priv->normalize_newlines = TRUE;
 }
 
 static gsize get_new_line_size(PlumaDocumentInputStream *stream) {
@@ -183,28 +224,80 @@ GInputStream *pluma_document_input_stream_new(GtkTextBuffer *buffer,
   return G_INPUT_STREAM(stream);
 }
 
+/**
+ * pluma_document_input_stream_new_for_snapshot:
+ * @snapshot: a #PlumaDocumentSnapshot
+ *
+ * Reads the text of @snapshot, from any thread since the buffer itself is
+ * not used.
+ *
+ * Returns: a new #GInputStream to read @snapshot
+ */
+GInputStream *pluma_document_input_stream_new_for_snapshot(
+    PlumaDocumentSnapshot *snapshot, PlumaDocumentNewlineType type) {
+  PlumaDocumentInputStream *stream;
+
+  g_return_val_if_fail(snapshot != NULL, NULL);
+
+  stream = g_object_new(PLUMA_TYPE_DOCUMENT_INPUT_STREAM, "newline-type", type,
+                        NULL);
+  stream->priv->snapshot = pluma_document_snapshot_ref(snapshot);
+
+  return G_INPUT_STREAM(stream);
+}
+
 gsize pluma_document_input_stream_get_total_size(
     PlumaDocumentInputStream *stream) {
   g_return_val_if_fail(PLUMA_IS_DOCUMENT_INPUT_STREAM(stream), 0);
 
+  if (stream->priv->snapshot != NULL)
+    return pluma_document_snapshot_get_char_count(stream->priv->snapshot);
+
   return gtk_text_buffer_get_char_count(stream->priv->buffer);
 }
 
 gsize pluma_document_input_stream_tell(PlumaDocumentInputStream *stream) {
   g_return_val_if_fail(PLUMA_IS_DOCUMENT_INPUT_STREAM(stream), 0);
 
-  /* FIXME: is this potentially inefficient? If yes, we could keep
-     track of the offset internally, assuming the mark doesn't move
-     during the operation */
-  if (!stream->priv->is_initialized) {
+  if (stream->priv->segment == NULL) {
     return 0;
-  } else {
-    GtkTextIter iter;
-
-    gtk_text_buffer_get_iter_at_mark(stream->priv->buffer, &iter,
-                                     stream->priv->pos);
-    return gtk_text_iter_get_offset(&iter);
   }
+
+  return stream->priv->segment_offset +
+         g_utf8_pointer_to_offset(
+             stream->priv->segment,
+             stream->priv->segment + stream->priv->segment_pos);
+}
+
+/**
+ * pluma_document_input_stream_set_normalize_newlines:
+ * @stream: a #PlumaDocumentInputStream
+ * @normalize: whether to replace the line terminators
+ *
+ * By default every line terminator of the buffer is replaced with the one of
+ * the :newline-type property. When @normalize is %FALSE, the CR, LF and CRLF
+ * terminators are read as they are in the buffer instead.
+ */
+void pluma_document_input_stream_set_normalize_newlines(
+    PlumaDocumentInputStream *stream, gboolean normalize) {
+  g_return_if_fail(PLUMA_IS_DOCUMENT_INPUT_STREAM(stream));
+
+  stream->priv->normalize_newlines = normalize != FALSE;
+}
+
+/**
+ * pluma_document_input_stream_get_newline_count:
+ * @stream: a #PlumaDocumentInputStream
+ * @type: the line terminator to count
+ *
+ * Returns: how many @type line terminators have been read so far.
+ */
+guint pluma_document_input_stream_get_newline_count(
+    PlumaDocumentInputStream *stream, PlumaDocumentNewlineType type) {
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT_INPUT_STREAM(stream), 0);
+  g_return_val_if_fail(type <= PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF, 0);
+
+  return stream->priv->newline_counts[type];
 }
 
 static const gchar *get_new_line(PlumaDocumentInputStream *stream) {
@@ -232,161 +325,299 @@ static const gchar *get_new_line(PlumaDocumentInputStream *stream) {
   return ret;
 }
 
-static gsize read_line(PlumaDocumentInputStream *stream, gchar *outbuf,
-                       gsize space_left) {
-  GtkTextIter start, next, end;
-  gchar *buf;
-  gint bytes; /* int since it's what iter_get_offset returns */
-  gsize bytes_to_write, newline_size, read;
-  const gchar *newline;
-  gboolean is_last;
+/* Reading starts at offset */
+static void ensure_initialized(PlumaDocumentInputStream *stream, gint offset) {
+  GtkTextIter iter;
+
+  if (stream->priv->is_initialized || stream->priv->snapshot != NULL) return;
+
+  gtk_text_buffer_get_iter_at_offset(stream->priv->buffer, &iter, offset);
+  stream->priv->pos =
+      gtk_text_buffer_create_mark(stream->priv->buffer, NULL, &iter, FALSE);
+
+  stream->priv->is_initialized = TRUE;
+}
+
+static void set_segment(PlumaDocumentInputStream *stream, gchar *text,
+                        gint offset, gint n_chars) {
+  g_free(stream->priv->segment);
+
+  stream->priv->segment = text;
+  stream->priv->segment_len = strlen(text);
+  stream->priv->segment_pos = 0;
+  stream->priv->segment_offset = offset;
+  stream->priv->segment_chars = n_chars;
+}
+
+/* The blocks of the snapshot never split a \r\n terminator either */
+static gboolean fetch_snapshot_segment(PlumaDocumentInputStream *stream) {
+  gchar *text;
+  gint n_chars;
+
+  if (stream->priv->read_all || stream->priv->error != NULL) return FALSE;
+
+  if (!pluma_document_snapshot_read(stream->priv->snapshot, &text, &n_chars,
+                                    stream->priv->cancellable,
+                                    &stream->priv->error))
+    return FALSE;
+
+  if (text == NULL) {
+    stream->priv->read_all = TRUE;
+    return FALSE;
+  }
+
+  set_segment(stream, text,
+              stream->priv->segment_offset + stream->priv->segment_chars,
+              n_chars);
+
+  return TRUE;
+}
+
+/* Copies the next SEGMENT_SIZE characters of the buffer before the offset
+ * limit, returns FALSE when there are none */
+static gboolean fetch_segment(PlumaDocumentInputStream *stream, gint limit) {
+  GtkTextIter start, end, prev;
+  gint offset;
+
+  if (stream->priv->snapshot != NULL) return fetch_snapshot_segment(stream);
 
   gtk_text_buffer_get_iter_at_mark(stream->priv->buffer, &start,
                                    stream->priv->pos);
 
-  if (gtk_text_iter_is_end(&start)) return 0;
-
-  end = next = start;
-  newline = get_new_line(stream);
-
-  /* Check needed for empty lines */
-  if (!gtk_text_iter_ends_line(&end)) gtk_text_iter_forward_to_line_end(&end);
-
-  gtk_text_iter_forward_line(&next);
-
-  buf = gtk_text_iter_get_slice(&start, &end);
-
-  /* the bytes of a line includes also the newline, so with the
-     offsets we remove the newline and we add the new newline size */
-  bytes = gtk_text_iter_get_bytes_in_line(&start) - stream->priv->bytes_partial;
-
-  /* bytes_in_line includes the newlines, so we remove that assuming that
-     they are single byte characters */
-  bytes = bytes -
-          (gtk_text_iter_get_offset(&next) - gtk_text_iter_get_offset(&end));
-  is_last = gtk_text_iter_is_end(&end);
-
-  /* bytes_to_write contains the amount of bytes we would like to write.
-     This means its the amount of bytes in the line (without the newline
-     in the buffer) + the amount of bytes for the newline we want to
-     write (newline_size) */
-  bytes_to_write = bytes;
-
-  /* do not add the new newline_size for the last line */
-  newline_size = get_new_line_size(stream);
-  if (!is_last) bytes_to_write += newline_size;
-
-  if (bytes_to_write > space_left) {
-    gchar *ptr;
-    gint char_offset;
-    gint written;
-    gsize to_write;
-
-    /* Here the line does not fit in the buffer, we thus write
-       the amount of bytes we can still fit, storing the position
-       for the next read with the mark. Do not try to write the
-       new newline in this case, it will be handled in the next
-       iteration */
-    to_write = MIN(space_left, bytes);
-    ptr = buf;
-    written = 0;
-    char_offset = 0;
-
-    while (written < to_write) {
-      gint w;
-
-      ptr = g_utf8_next_char(ptr);
-      w = (ptr - buf);
-      if (w > to_write) {
-        break;
-      } else {
-        written = w;
-        ++char_offset;
-      }
-    }
+  offset = gtk_text_iter_get_offset(&start);
+
+  if (gtk_text_iter_is_end(&start) || offset >= limit) return FALSE;
+
+  end = start;
+  gtk_text_iter_forward_chars(&end, MIN(SEGMENT_SIZE, limit - offset));
+
+  /* do not split a \r\n terminator */
+  prev = end;
+  if (gtk_text_iter_get_char(&end) == '\n' &&
+      gtk_text_iter_backward_char(&prev) &&
+      gtk_text_iter_get_char(&prev) == '\r') {
+    gtk_text_iter_forward_char(&end);
+  }
+
+  set_segment(stream, gtk_text_iter_get_slice(&start, &end), offset,
+              gtk_text_iter_get_offset(&end) - offset);
+
+  gtk_text_buffer_move_mark(stream->priv->buffer, stream->priv->pos, &end);
+
+  return TRUE;
+}
 
-    memcpy(outbuf, buf, written);
+/* Copies as much of the segment as fits in outbuf, translating the line
+ * terminators, or only counts the bytes when outbuf is NULL. Characters and
+ * terminators are never cut. */
+static gsize read_segment(PlumaDocumentInputStream *stream, gchar *outbuf,
+                          gsize space_left) {
+  const gchar *p = stream->priv->segment + stream->priv->segment_pos;
+  const gchar *stop = stream->priv->segment + stream->priv->segment_len;
+  gsize n = 0;
+
+  while (p < stop) {
+    const gchar *brk;
+    const gchar *newline;
+    PlumaDocumentNewlineType newline_type;
+    gsize len, newline_size, terminator_size;
+
+    brk = pluma_utf8_find_line_break(p, stop);
+    len = brk - p;
+
+    if (len > space_left - n) {
+      len = space_left - n;
+
+      /* back to the start of the character */
+      while (len > 0 && (p[len] & 0xc0) == 0x80) len--;
+
+      if (outbuf != NULL) memcpy(outbuf + n, p, len);
+      n += len;
+      p += len;
+      break;
+    }
 
-    /* Note: offset is one past what we wrote */
-    gtk_text_iter_forward_chars(&start, char_offset);
-    stream->priv->bytes_partial += written;
-    read = written;
-  } else {
-    /* First just copy the bytes without the newline */
-    memcpy(outbuf, buf, bytes);
+    if (outbuf != NULL) memcpy(outbuf + n, p, len);
+    n += len;
+    p = brk;
+
+    if (p == stop) break;
+
+    if (*p == '\r' && p + 1 < stop && p[1] == '\n') {
+      newline_type = PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF;
+      terminator_size = 2;
+    } else if (*p == '\r') {
+      newline_type = PLUMA_DOCUMENT_NEWLINE_TYPE_CR;
+      terminator_size = 1;
+    } else if (*p == '\n') {
+      newline_type = PLUMA_DOCUMENT_NEWLINE_TYPE_LF;
+      terminator_size = 1;
+    } else {
+      /* U+2029 */
+      newline_type = stream->priv->newline_type;
+      terminator_size = 3;
+    }
 
-    /* Then add the newline, but not for the last line */
-    if (!is_last) {
-      memcpy(outbuf + bytes, newline, newline_size);
+    /* other paragraph separators are always replaced */
+    if (stream->priv->normalize_newlines || terminator_size == 3) {
+      newline_type = stream->priv->newline_type;
+      newline = get_new_line(stream);
+      newline_size = get_new_line_size(stream);
+    } else {
+      newline = p;
+      newline_size = terminator_size;
     }
 
-    start = next;
-    stream->priv->bytes_partial = 0;
-    read = bytes_to_write;
+    /* it will be read the next time */
+    if (newline_size > space_left - n) break;
+
+    if (outbuf != NULL) memcpy(outbuf + n, newline, newline_size);
+    n += newline_size;
+    p += terminator_size;
+
+    stream->priv->newline_counts[newline_type]++;
   }
 
-  gtk_text_buffer_move_mark(stream->priv->buffer, stream->priv->pos, &start);
+  stream->priv->segment_pos = p - stream->priv->segment;
 
-  g_free(buf);
-  return read;
+  return n;
 }
 
-static gssize pluma_document_input_stream_read(GInputStream *stream,
-                                               void *buffer, gsize count,
-                                               GCancellable *cancellable,
-                                               GError **error) {
-  PlumaDocumentInputStream *dstream;
+/* Whether everything before the offset limit has been read, and it is the
+ * whole text which is not empty */
+static gboolean is_at_end(PlumaDocumentInputStream *stream, gint limit) {
   GtkTextIter iter;
-  gssize space_left, read, n;
 
-  dstream = PLUMA_DOCUMENT_INPUT_STREAM(stream);
+  if (stream->priv->segment_pos != stream->priv->segment_len) return FALSE;
 
-  if (count < 6) {
-    g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_NO_SPACE,
-                        "Not enougth space in destination");
-    return -1;
+  if (stream->priv->snapshot != NULL) {
+    return stream->priv->read_all &&
+           pluma_document_snapshot_get_char_count(stream->priv->snapshot) > 0;
   }
 
-  if (g_cancellable_set_error_if_cancelled(cancellable, error)) return -1;
+  gtk_text_buffer_get_iter_at_mark(stream->priv->buffer, &iter,
+                                   stream->priv->pos);
 
-  /* Initialize the mark to the first char in the text buffer */
-  if (!dstream->priv->is_initialized) {
-    gtk_text_buffer_get_start_iter(dstream->priv->buffer, &iter);
-    dstream->priv->pos =
-        gtk_text_buffer_create_mark(dstream->priv->buffer, NULL, &iter, FALSE);
+  return gtk_text_iter_is_end(&iter) && !gtk_text_iter_is_start(&iter) &&
+         gtk_text_iter_get_offset(&iter) < limit;
+}
 
-    dstream->priv->is_initialized = TRUE;
-  }
+/* Reads the text before the offset limit like read_segment() */
+static gsize read_to(PlumaDocumentInputStream *stream, gchar *outbuf,
+                     gsize count, gint limit) {
+  gsize read, n;
 
-  space_left = count;
   read = 0;
 
   do {
-    n = read_line(dstream, (void *)((gsize)buffer + read), space_left);
+    if (stream->priv->segment_pos == stream->priv->segment_len &&
+        !fetch_segment(stream, limit)) {
+      break;
+    }
+
+    n = read_segment(stream, outbuf != NULL ? outbuf + read : NULL,
+                     count - read);
     read += n;
-    space_left -= n;
-  } while (space_left > 0 && n != 0 && dstream->priv->bytes_partial == 0);
+  } while (read < count && n != 0);
 
   /* Make sure that non-empty files are always terminated with \n (see bug
    * #95676). Note that we strip the trailing \n when loading the file */
-  gtk_text_buffer_get_iter_at_mark(dstream->priv->buffer, &iter,
-                                   dstream->priv->pos);
+  if (is_at_end(stream, limit)) {
+    gsize newline_size;
 
-  if (gtk_text_iter_is_end(&iter) && !gtk_text_iter_is_start(&iter)) {
-    gssize newline_size;
+    newline_size = get_new_line_size(stream);
 
-    newline_size = get_new_line_size(dstream);
+    if (count - read >= newline_size && !stream->priv->newline_added) {
+      if (outbuf != NULL)
+        memcpy(outbuf + read, get_new_line(stream), newline_size);
 
-    if (space_left >= newline_size && !dstream->priv->newline_added) {
-      const gchar *newline;
+      read += newline_size;
+      stream->priv->newline_counts[stream->priv->newline_type]++;
+      stream->priv->newline_added = TRUE;
+    }
+  }
 
-      newline = get_new_line(dstream);
+  return read;
+}
 
-      memcpy((void *)((gsize)buffer + read), newline, newline_size);
+/**
+ * pluma_document_input_stream_skip_to:
+ * @stream: a #PlumaDocumentInputStream
+ * @offset: a character offset in the buffer
+ *
+ * Skips the text before @offset as if it had been read: its line terminators
+ * are translated and counted the same way, but nothing is copied. @offset
+ * should be at the start of a line, the final line terminator added to the
+ * text is only skipped with %G_MAXINT.
+ *
+ * Returns: the number of bytes which have been skipped
+ */
+goffset pluma_document_input_stream_skip_to(PlumaDocumentInputStream *stream,
+                                            gint offset) {
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT_INPUT_STREAM(stream), 0);
+  g_return_val_if_fail(stream->priv->buffer != NULL, 0);
 
-      read += newline_size;
-      dstream->priv->newline_added = TRUE;
-    }
+  ensure_initialized(stream, 0);
+
+  return read_to(stream, NULL, G_MAXSIZE, offset);
+}
+
+/**
+ * pluma_document_input_stream_get_size_from:
+ * @stream: a #PlumaDocumentInputStream
+ * @offset: a character offset in the buffer
+ *
+ * Returns: how many bytes reading the buffer from @offset to its end would
+ * give, without reading @stream.
+ */
+goffset pluma_document_input_stream_get_size_from(
+    PlumaDocumentInputStream *stream, gint offset) {
+  PlumaDocumentInputStream *other;
+  goffset size;
+
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT_INPUT_STREAM(stream), 0);
+  g_return_val_if_fail(stream->priv->buffer != NULL, 0);
+
+  other = PLUMA_DOCUMENT_INPUT_STREAM(pluma_document_input_stream_new(
+      stream->priv->buffer, stream->priv->newline_type));
+  other->priv->normalize_newlines = stream->priv->normalize_newlines;
+
+  ensure_initialized(other, offset);
+  size = read_to(other, NULL, G_MAXSIZE, G_MAXINT);
+
+  g_input_stream_close(G_INPUT_STREAM(other), NULL, NULL);
+  g_object_unref(other);
+
+  return size;
+}
+
+static gssize pluma_document_input_stream_read(GInputStream *stream,
+                                               void *buffer, gsize count,
+                                               GCancellable *cancellable,
+                                               GError **error) {
+  PlumaDocumentInputStream *dstream;
+  gsize read;
+
+  dstream = PLUMA_DOCUMENT_INPUT_STREAM(stream);
+
+  if (count < 6) {
+    g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_NO_SPACE,
+                        "Not enougth space in destination");
+    return -1;
+  }
+
+  if (g_cancellable_set_error_if_cancelled(cancellable, error)) return -1;
+
+  ensure_initialized(dstream, 0);
+
+  dstream->priv->cancellable = cancellable;
+  read = read_to(dstream, buffer, count, G_MAXINT);
+  dstream->priv->cancellable = NULL;
+
+  if (dstream->priv->error != NULL) {
+    g_propagate_error(error, dstream->priv->error);
+    dstream->priv->error = NULL;
+    return -1;
   }
 
   return read;
@@ -399,6 +630,11 @@ static gboolean pluma_document_input_stream_close(GInputStream *stream,
 
   dstream->priv->newline_added = FALSE;
 
+  g_free(dstream->priv->segment);
+  dstream->priv->segment = NULL;
+  dstream->priv->segment_len = 0;
+  dstream->priv->segment_pos = 0;
+
   if (dstream->priv->is_initialized) {
     gtk_text_buffer_delete_mark(dstream->priv->buffer, dstream->priv->pos);
   }
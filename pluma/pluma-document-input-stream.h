@@ -27,6 +27,7 @@
 #include <gio/gio.h>
 #include <gtk/gtk.h>
 
+#include "pluma-document-snapshot.h"
 #include "pluma-document.h"
 
 G_BEGIN_DECLS
@@ -69,11 +70,26 @@ GType pluma_document_input_stream_get_type(void) G_GNUC_CONST;
 GInputStream *pluma_document_input_stream_new(GtkTextBuffer *buffer,
                                               PlumaDocumentNewlineType type);
 
+GInputStream *pluma_document_input_stream_new_for_snapshot(
+    PlumaDocumentSnapshot *snapshot, PlumaDocumentNewlineType type);
+
 gsize pluma_document_input_stream_get_total_size(
     PlumaDocumentInputStream *stream);
 
 gsize pluma_document_input_stream_tell(PlumaDocumentInputStream *stream);
 
+void pluma_document_input_stream_set_normalize_newlines(
+    PlumaDocumentInputStream *stream, gboolean normalize);
+
+guint pluma_document_input_stream_get_newline_count(
+    PlumaDocumentInputStream *stream, PlumaDocumentNewlineType type);
+
+goffset pluma_document_input_stream_skip_to(PlumaDocumentInputStream *stream,
+                                            gint offset);
+
+goffset pluma_document_input_stream_get_size_from(
+    PlumaDocumentInputStream *stream, gint offset);
+
 G_END_DECLS
 
 #endif /* __PLUMA_DOCUMENT_INPUT_STREAM_H__ */
@@ -0,0 +1,461 @@
+/*
+ * pluma-document-journal.c
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "pluma-document-journal.h"
+
+#include <errno.h>
+#include <gio/gfiledescriptorbased.h>
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pluma-debug.h"
+#include "pluma-dirs.h"
+
+/* The journal is a header with the hash of the text of the file, followed
+ * by one record per change:
+ *   "i <char offset> <byte length>\n<text>" for an insertion
+ *   "d <char offset> <char length>\n" for a deletion
+ * A crash may leave the last record cut, it is dropped. */
+#define JOURNAL_HEADER "PLUMA-JOURNAL 1 %016" G_GINT64_MODIFIER "x\n"
+#define JOURNAL_HEADER_LENGTH 33
+
+/* the text is hashed when the journal starts */
+#define JOURNAL_MAX_SIZE (16 * 1024 * 1024)
+
+struct _PlumaDocumentJournal {
+  PlumaDocument *document;
+  gchar *path;
+
+  GOutputStream *stream;
+
+  /* the records not written yet */
+  GString *pending;
+  guint flush_id;
+};
+
+typedef struct {
+  gboolean insert;
+  gint offset;
+  /* characters deleted, or bytes of text inserted */
+  gint length;
+  const gchar *text;
+} JournalRecord;
+
+gchar *pluma_document_journal_get_path(const gchar *uri) {
+  gchar *cache_dir;
+  gchar *name;
+  gchar *path;
+
+  g_return_val_if_fail(uri != NULL, NULL);
+
+  cache_dir = pluma_dirs_get_user_cache_dir();
+  name = g_compute_checksum_for_string(G_CHECKSUM_SHA1, uri, -1);
+
+  path = g_build_filename(cache_dir, "journal", name, NULL);
+
+  g_free(name);
+  g_free(cache_dir);
+
+  return path;
+}
+
+static gboolean flush_pending(PlumaDocumentJournal *journal) {
+  GError *error = NULL;
+
+  if (journal->flush_id != 0) {
+    g_source_remove(journal->flush_id);
+    journal->flush_id = 0;
+  }
+
+  if (journal->stream == NULL) return FALSE;
+
+  if (journal->pending->len == 0) return TRUE;
+
+  if (!g_output_stream_write_all(journal->stream, journal->pending->str,
+                                 journal->pending->len, NULL, NULL, &error)) {
+    pluma_debug_message(DEBUG_DOCUMENT, "Writing the journal failed: %s",
+                        error->message);
+    g_error_free(error);
+
+    /* a journal with holes cannot be replayed, stop writing it */
+    g_clear_object(&journal->stream);
+    g_unlink(journal->path);
+  }
+
+  g_string_truncate(journal->pending, 0);
+
+  return journal->stream != NULL;
+}
+
+static gboolean flush_idle(PlumaDocumentJournal *journal) {
+  journal->flush_id = 0;
+
+  flush_pending(journal);
+
+  return FALSE;
+}
+
+static void queue_flush(PlumaDocumentJournal *journal) {
+  if (journal->flush_id != 0) return;
+
+  journal->flush_id = g_idle_add_full(G_PRIORITY_LOW, (GSourceFunc)flush_idle,
+                                      journal, NULL);
+}
+
+static void insert_text_cb(PlumaDocument *doc, GtkTextIter *pos,
+                           const gchar *text, gint length,
+                           PlumaDocumentJournal *journal) {
+  if (journal->stream == NULL) return;
+
+  if (length < 0) length = strlen(text);
+
+  g_string_append_printf(journal->pending, "i %d %d\n",
+                         gtk_text_iter_get_offset(pos), length);
+  g_string_append_len(journal->pending, text, length);
+
+  queue_flush(journal);
+}
+
+static void delete_range_cb(PlumaDocument *doc, GtkTextIter *start,
+                            GtkTextIter *end, PlumaDocumentJournal *journal) {
+  gint start_offset;
+  gint end_offset;
+
+  if (journal->stream == NULL) return;
+
+  start_offset = gtk_text_iter_get_offset(start);
+  end_offset = gtk_text_iter_get_offset(end);
+
+  g_string_append_printf(journal->pending, "d %d %d\n",
+                         MIN(start_offset, end_offset),
+                         ABS(end_offset - start_offset));
+
+  queue_flush(journal);
+}
+
+/* Parses the records up to the first one which is cut or does not apply to
+ * a text of n_chars characters, returns the length of what was parsed */
+static gsize parse_records(const gchar *data, gsize length, gint n_chars,
+                           GArray *records) {
+  const gchar *p = data;
+  const gchar *end = data + length;
+  const gchar *parsed = data;
+
+  while (p < end) {
+    JournalRecord record;
+    const gchar *line_end;
+    gchar *next;
+    gint64 offset;
+    gint64 len;
+
+    line_end = memchr(p, '\n', end - p);
+    if (line_end == NULL || line_end - p < 5 || p[1] != ' ') break;
+
+    record.insert = (p[0] == 'i');
+    if (!record.insert && p[0] != 'd') break;
+
+    offset = g_ascii_strtoll(p + 2, &next, 10);
+    if (next == p + 2 || *next != ' ') break;
+
+    p = next + 1;
+    len = g_ascii_strtoll(p, &next, 10);
+    if (next == p || next != line_end) break;
+
+    if (offset < 0 || offset > n_chars || len < 0 || len > G_MAXINT) break;
+
+    p = line_end + 1;
+    record.offset = offset;
+    record.length = len;
+    record.text = p;
+
+    if (record.insert) {
+      if (len > end - p || !g_utf8_validate(p, len, NULL)) break;
+
+      n_chars += g_utf8_strlen(p, len);
+      p += len;
+    } else {
+      if (len > n_chars - offset) break;
+
+      n_chars -= len;
+    }
+
+    g_array_append_val(records, record);
+    parsed = p;
+  }
+
+  return parsed - data;
+}
+
+static void replay_records(PlumaDocument *doc, GArray *records) {
+  GtkTextBuffer *buffer = GTK_TEXT_BUFFER(doc);
+  guint i;
+
+  gtk_text_buffer_begin_user_action(buffer);
+
+  for (i = 0; i < records->len; i++) {
+    JournalRecord *record = &g_array_index(records, JournalRecord, i);
+    GtkTextIter start;
+    GtkTextIter end;
+
+    gtk_text_buffer_get_iter_at_offset(buffer, &start, record->offset);
+
+    if (record->insert) {
+      gtk_text_buffer_insert(buffer, &start, record->text, record->length);
+    } else {
+      gtk_text_buffer_get_iter_at_offset(buffer, &end,
+                                         record->offset + record->length);
+      gtk_text_buffer_delete(buffer, &start, &end);
+    }
+  }
+
+  gtk_text_buffer_end_user_action(buffer);
+}
+
+/* Replays the journal left at path if it was written over the current text
+ * of the document, returns how much of it is still good */
+static gsize recover(PlumaDocumentJournal *journal, guint64 hash) {
+  gchar *contents;
+  gsize length;
+  gchar *header;
+  GArray *records;
+  gsize valid;
+
+  if (!g_file_get_contents(journal->path, &contents, &length, NULL)) return 0;
+
+  header = g_strdup_printf(JOURNAL_HEADER, hash);
+
+  /* not a journal, or not one for this text */
+  if (length < JOURNAL_HEADER_LENGTH ||
+      memcmp(contents, header, JOURNAL_HEADER_LENGTH) != 0) {
+    g_free(header);
+    g_free(contents);
+    return 0;
+  }
+
+  records = g_array_new(FALSE, FALSE, sizeof(JournalRecord));
+
+  valid = JOURNAL_HEADER_LENGTH +
+          parse_records(contents + JOURNAL_HEADER_LENGTH,
+                        length - JOURNAL_HEADER_LENGTH,
+                        gtk_text_buffer_get_char_count(
+                            GTK_TEXT_BUFFER(journal->document)),
+                        records);
+
+  pluma_debug_message(DEBUG_DOCUMENT, "Replaying %u changes from %s",
+                      records->len, journal->path);
+
+  replay_records(journal->document, records);
+
+  /* appended to what is good */
+  if (valid < length &&
+      !g_file_set_contents(journal->path, contents, valid, NULL))
+    valid = 0;
+
+  g_array_free(records, TRUE);
+  g_free(header);
+  g_free(contents);
+
+  return valid;
+}
+
+static gboolean open_stream(PlumaDocumentJournal *journal, gboolean append,
+                            guint64 hash) {
+  GFile *file;
+  GFileOutputStream *stream;
+  GError *error = NULL;
+
+  file = g_file_new_for_path(journal->path);
+
+  if (append) {
+    stream = g_file_append_to(file, G_FILE_CREATE_PRIVATE, NULL, &error);
+  } else {
+    stream = g_file_replace(file, NULL, FALSE, G_FILE_CREATE_PRIVATE, NULL,
+                            NULL, &error);
+  }
+
+  g_object_unref(file);
+
+  if (stream == NULL) {
+    pluma_debug_message(DEBUG_DOCUMENT, "Cannot open the journal: %s",
+                        error->message);
+    g_error_free(error);
+    return FALSE;
+  }
+
+  journal->stream = G_OUTPUT_STREAM(stream);
+
+  if (!append) {
+    g_string_printf(journal->pending, JOURNAL_HEADER, hash);
+    return flush_pending(journal);
+  }
+
+  return TRUE;
+}
+
+static PlumaDocumentJournal *journal_new(PlumaDocument *doc, gchar *path) {
+  PlumaDocumentJournal *journal;
+  gchar *dir;
+
+  journal = g_slice_new0(PlumaDocumentJournal);
+  journal->document = g_object_ref(doc);
+  journal->path = path;
+  journal->pending = g_string_new(NULL);
+
+  dir = g_path_get_dirname(journal->path);
+  g_mkdir_with_parents(dir, 0700);
+  g_free(dir);
+
+  return journal;
+}
+
+static void journal_start(PlumaDocumentJournal *journal) {
+  g_signal_connect(journal->document, "insert-text",
+                   G_CALLBACK(insert_text_cb), journal);
+  g_signal_connect(journal->document, "delete-range",
+                   G_CALLBACK(delete_range_cb), journal);
+}
+
+PlumaDocumentJournal *pluma_document_journal_new(PlumaDocument *doc,
+                                                 gboolean *recovered) {
+  PlumaDocumentJournal *journal;
+  gchar *uri;
+  guint64 hash;
+  gsize valid;
+
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT(doc), NULL);
+
+  if (recovered != NULL) *recovered = FALSE;
+
+  if (gtk_text_buffer_get_char_count(GTK_TEXT_BUFFER(doc)) > JOURNAL_MAX_SIZE)
+    return NULL;
+
+  uri = pluma_document_get_uri(doc);
+  g_return_val_if_fail(uri != NULL, NULL);
+
+  journal = journal_new(doc, pluma_document_journal_get_path(uri));
+  g_free(uri);
+
+  hash = _pluma_document_hash_text(doc, 0);
+  valid = recover(journal, hash);
+
+  if (!open_stream(journal, valid > 0, hash)) {
+    pluma_document_journal_free(journal);
+    return NULL;
+  }
+
+  journal_start(journal);
+
+  if (recovered != NULL) *recovered = (valid > JOURNAL_HEADER_LENGTH);
+
+  return journal;
+}
+
+PlumaDocumentJournal *pluma_document_journal_new_for_save(PlumaDocument *doc,
+                                                          const gchar *uri) {
+  PlumaDocumentJournal *journal;
+  gchar *path;
+
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT(doc), NULL);
+  g_return_val_if_fail(uri != NULL, NULL);
+
+  if (gtk_text_buffer_get_char_count(GTK_TEXT_BUFFER(doc)) > JOURNAL_MAX_SIZE)
+    return NULL;
+
+  /* next to the journal it replaces, so the rename cannot cross devices */
+  path = pluma_document_journal_get_path(uri);
+  journal = journal_new(doc, g_strconcat(path, ".new", NULL));
+  g_free(path);
+
+  if (!open_stream(journal, FALSE, _pluma_document_hash_text(doc, 0))) {
+    pluma_document_journal_free(journal);
+    return NULL;
+  }
+
+  journal_start(journal);
+
+  return journal;
+}
+
+gboolean pluma_document_journal_commit(PlumaDocumentJournal *journal,
+                                       const gchar *uri) {
+  gchar *path;
+
+  g_return_val_if_fail(journal != NULL, FALSE);
+  g_return_val_if_fail(uri != NULL, FALSE);
+
+  if (!flush_pending(journal)) return FALSE;
+
+  path = pluma_document_journal_get_path(uri);
+
+  /* the stream keeps writing to the renamed file */
+  if (g_rename(journal->path, path) != 0) {
+    pluma_debug_message(DEBUG_DOCUMENT, "Cannot move the journal: %s",
+                        g_strerror(errno));
+    g_free(path);
+    return FALSE;
+  }
+
+  g_free(journal->path);
+  journal->path = path;
+
+  return TRUE;
+}
+
+void pluma_document_journal_free(PlumaDocumentJournal *journal) {
+  if (journal == NULL) return;
+
+  g_signal_handlers_disconnect_by_data(journal->document, journal);
+
+  if (journal->flush_id != 0) g_source_remove(journal->flush_id);
+
+  if (journal->stream != NULL) {
+    g_output_stream_close(journal->stream, NULL, NULL);
+    g_object_unref(journal->stream);
+  }
+
+  g_unlink(journal->path);
+
+  g_string_free(journal->pending, TRUE);
+  g_free(journal->path);
+  g_object_unref(journal->document);
+
+  g_slice_free(PlumaDocumentJournal, journal);
+}
+
+gboolean pluma_document_journal_sync(PlumaDocumentJournal *journal) {
+  g_return_val_if_fail(journal != NULL, FALSE);
+
+  if (!flush_pending(journal)) return FALSE;
+
+  if (G_IS_FILE_DESCRIPTOR_BASED(journal->stream)) {
+    return fsync(g_file_descriptor_based_get_fd(
+               G_FILE_DESCRIPTOR_BASED(journal->stream))) == 0;
+  }
+
+  return TRUE;
+}
@@ -0,0 +1,71 @@
+/*
+ * pluma-document-journal.h
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __PLUMA_DOCUMENT_JOURNAL_H__
+#define __PLUMA_DOCUMENT_JOURNAL_H__
+
+#include <glib.h>
+
+#include "pluma-document.h"
+
+G_BEGIN_DECLS
+
+/* Appends the text inserted in and the ranges deleted from a document to a
+ * file in the cache directory, from which they are replayed when the file
+ * of the document is opened again after a crash. */
+typedef struct _PlumaDocumentJournal PlumaDocumentJournal;
+
+/* Starts recording the changes made to the document, whose text must be the
+   one of its file. A journal left for the file over the same text is
+   replayed first, then recovered is set. Returns NULL if the document is
+   too big or the journal cannot be written. */
+PlumaDocumentJournal *pluma_document_journal_new(PlumaDocument *doc,
+                                                 gboolean *recovered);
+
+/* Starts recording, for the file at uri, the changes made to the document
+   after its text was taken to be saved there. The journal is kept aside
+   until pluma_document_journal_commit() is called once the save succeeded,
+   or dropped with pluma_document_journal_free() if it failed. Returns NULL
+   if the document is too big or the journal cannot be written. */
+PlumaDocumentJournal *pluma_document_journal_new_for_save(PlumaDocument *doc,
+                                                          const gchar *uri);
+
+/* Makes a journal started with pluma_document_journal_new_for_save() the
+   one of the file at uri, replacing any journal left there. Returns FALSE
+   if it could not be moved, the journal should then be freed. */
+gboolean pluma_document_journal_commit(PlumaDocumentJournal *journal,
+                                       const gchar *uri);
+
+/* Stops recording and deletes the journal, the changes are either saved or
+   dropped */
+void pluma_document_journal_free(PlumaDocumentJournal *journal);
+
+/* Writes the pending changes and waits for them to be on the disk, returns
+   FALSE if the journal could not be written */
+gboolean pluma_document_journal_sync(PlumaDocumentJournal *journal);
+
+/* Where the journal of the file at uri is kept */
+gchar *pluma_document_journal_get_path(const gchar *uri);
+
+G_END_DECLS
+
+#endif /* __PLUMA_DOCUMENT_JOURNAL_H__ */
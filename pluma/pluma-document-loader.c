@@ -37,14 +37,17 @@
 #include <gio/gio.h>
 #include <glib/gi18n.h>
 #include <glib/gstdio.h>
+#include <string.h>
 
 #include "pluma-debug.h"
 #include "pluma-document-loader.h"
 #include "pluma-document-output-stream.h"
+#include "pluma-document-pager.h"
 #include "pluma-enum-types.h"
 #include "pluma-metadata-manager.h"
 #include "pluma-settings.h"
 #include "pluma-smart-charset-converter.h"
+#include "pluma-utf8.h"
 #include "pluma-utils.h"
 
 #ifndef ENABLE_GVFS_METADATA
@@ -54,10 +57,44 @@
 typedef struct {
   PlumaDocumentLoader *loader;
   GCancellable *cancellable;
-  gssize read;
   gboolean tried_mount;
 } AsyncData;
 
+#define DECODE_QUEUE_LENGTH 8
+#define MAX_UNICHAR_LEN 6
+
+typedef struct {
+  /* block_size bytes of the pipeline, plus room for a carried character */
+  gchar *data;
+  gsize len;
+  gboolean eof;
+  GError *error;
+} DecodeBlock;
+
+/* Shared by the decode thread and the main thread. The number of blocks
+ * is fixed, so when the main thread falls behind the decode thread waits
+ * instead of buffering the whole file in memory. */
+typedef struct {
+  gint ref_count;
+  GMainContext *context;
+  GInputStream *stream;
+  GCancellable *cancellable;
+  GAsyncQueue *free_blocks;
+  GAsyncQueue *ready_blocks;
+  gsize block_size;
+
+  /* Partial loads, see pluma_document_loader_set_range(): the tail starts at
+   * tail_offset in base_stream, the head ends after max_len bytes of text */
+  GInputStream *base_stream;
+  goffset tail_offset;
+  gsize max_len;
+  gsize total_len;
+  gboolean truncated;
+
+  /* only accessed by the main thread */
+  AsyncData *async;
+} DecodePipeline;
+
 /* Signals */
 
 enum { LOADING, LAST_SIGNAL };
@@ -68,7 +105,9 @@ static guint signals[LAST_SIGNAL] = {0};
 
 enum { PROP_0, PROP_DOCUMENT, PROP_URI, PROP_ENCODING, PROP_NEWLINE_TYPE };
 
-#define READ_CHUNK_SIZE 8192
+#define CONTENTS_CHUNK_SIZE (1024 * 1024)
+#define TAIL_BUFFER_SIZE (64 * 1024)
+#define INDEX_CHUNK_SIZE (64 * 1024 * 1024)
 #define REMOTE_QUERY_ATTRIBUTES                                                \
   G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE                                       \
       "," G_FILE_ATTRIBUTE_STANDARD_TYPE "," G_FILE_ATTRIBUTE_TIME_MODIFIED    \
@@ -99,7 +138,18 @@ struct _PlumaDocumentLoaderPrivate {
   GOutputStream *output;
   PlumaSmartCharsetConverter *converter;
 
-  gchar buffer[READ_CHUNK_SIZE];
+  /* Fast path for local UTF-8 files */
+  gchar *contents;
+  gsize contents_length;
+  gsize contents_offset;
+
+  /* Files above the large file threshold */
+  PlumaDocumentPager *pager;
+
+  /* Only the head or the tail of the file is loaded */
+  PlumaDocumentLoadRange range;
+  goffset range_size;
+  gboolean partial;
 
   GError *error;
 };
@@ -192,6 +242,14 @@ static void pluma_document_loader_dispose(GObject *object) {
     priv->converter = NULL;
   }
 
+  g_free(priv->contents);
+  priv->contents = NULL;
+
+  if (priv->pager != NULL) {
+    pluma_document_pager_free(priv->pager);
+    priv->pager = NULL;
+  }
+
   if (priv->gfile != NULL) {
     g_object_unref(priv->gfile);
     priv->gfile = NULL;
@@ -378,41 +436,551 @@ static void write_complete(AsyncData *async) {
                                async);
 }
 
-/* prototype, because they call each other... isn't C lovely */
-static void read_file_chunk(AsyncData *async);
+static void end_of_file(AsyncData *async) {
+  PlumaDocumentLoader *loader;
+
+  loader = async->loader;
+
+  g_output_stream_flush(loader->priv->output, NULL, &loader->priv->error);
+
+  /* the direct fast path only ever loads UTF-8 and has no converter */
+  if (loader->priv->converter != NULL)
+    loader->priv->auto_detected_encoding =
+        pluma_smart_charset_converter_get_guessed(loader->priv->converter);
+  else
+    loader->priv->auto_detected_encoding = pluma_encoding_get_utf8();
+
+  loader->priv->auto_detected_newline_type =
+      pluma_document_output_stream_detect_newline_type(
+          PLUMA_DOCUMENT_OUTPUT_STREAM(loader->priv->output));
+
+  /* Check if we needed some fallback char, if so, check if there was
+     a previous error and if not set a fallback used error */
+  /* FIXME Uncomment this when we want to manage conversion fallback */
+  /*if ((pluma_smart_charset_converter_get_num_fallbacks
+  (loader->priv->converter) != 0) && loader->priv->error == NULL)
+  {
+      g_set_error_literal (&loader->priv->error,
+                   PLUMA_DOCUMENT_ERROR,
+                   PLUMA_DOCUMENT_ERROR_CONVERSION_FALLBACK,
+                   "There was a conversion error and it was "
+                   "needed to use a fallback char");
+  }*/
+
+  write_complete(async);
+}
+
+static DecodePipeline *decode_pipeline_ref(DecodePipeline *pipeline) {
+  g_atomic_int_inc(&pipeline->ref_count);
+
+  return pipeline;
+}
+
+static DecodeBlock *decode_block_new(gsize block_size) {
+  DecodeBlock *block;
+
+  block = g_new0(DecodeBlock, 1);
+  block->data = g_malloc(block_size + MAX_UNICHAR_LEN);
+
+  return block;
+}
+
+static void decode_block_free(DecodeBlock *block) {
+  g_clear_error(&block->error);
+  g_free(block->data);
+  g_free(block);
+}
+
+static void decode_pipeline_unref(DecodePipeline *pipeline) {
+  DecodeBlock *block;
+
+  if (!g_atomic_int_dec_and_test(&pipeline->ref_count)) return;
+
+  while ((block = g_async_queue_try_pop(pipeline->free_blocks)) != NULL)
+    decode_block_free(block);
+
+  while ((block = g_async_queue_try_pop(pipeline->ready_blocks)) != NULL)
+    decode_block_free(block);
 
-static void write_file_chunk(AsyncData *async) {
+  g_async_queue_unref(pipeline->free_blocks);
+  g_async_queue_unref(pipeline->ready_blocks);
+
+  g_object_unref(pipeline->stream);
+  g_object_unref(pipeline->base_stream);
+  g_object_unref(pipeline->cancellable);
+  g_main_context_unref(pipeline->context);
+
+  g_slice_free(DecodePipeline, pipeline);
+}
+
+/* Runs in the main thread: the blocks are already converted and validated,
+ * so all that is left to do is inserting them in the document. There is one
+ * call for each block, at idle priority, so the view keeps redrawing and
+ * scrolling the part of the document which is already loaded. */
+static gboolean insert_decoded_block(DecodePipeline *pipeline) {
   PlumaDocumentLoader *loader;
-  gssize bytes_written;
+  AsyncData *async;
+  DecodeBlock *block;
+  gboolean eof;
   GError *error = NULL;
 
+  async = pipeline->async;
+
+  /* the load already completed, failed or was cancelled, the decode thread
+   * must not wait for blocks which are never handed back */
+  if (async == NULL) {
+    g_cancellable_cancel(pipeline->cancellable);
+    return FALSE;
+  }
+
+  /* manually check cancelled state */
+  if (g_cancellable_is_cancelled(async->cancellable)) {
+    pipeline->async = NULL;
+    async_data_free(async);
+    return FALSE;
+  }
+
   loader = async->loader;
 
-  /* we use sync methods on doc stream since it is in memory. Using async
-     would be racy and we can endup with invalidated iters */
-  bytes_written = g_output_stream_write(G_OUTPUT_STREAM(loader->priv->output),
-                                        loader->priv->buffer, async->read,
-                                        async->cancellable, &error);
+  /* there is one call for each block pushed by the decode thread */
+  block = g_async_queue_try_pop(pipeline->ready_blocks);
+  if (block == NULL) return FALSE;
+
+  if (block->error != NULL) {
+    error = block->error;
+    block->error = NULL;
+  } else if (loader->priv->bytes_read + (goffset)block->len <
+             loader->priv->bytes_read) {
+    /* Check for the extremely unlikely case where the file size
+     * overflows. */
+    g_set_error(&error, PLUMA_DOCUMENT_ERROR, PLUMA_DOCUMENT_ERROR_TOO_BIG,
+                "File too big");
+  } else if (block->len > 0 &&
+             g_output_stream_write(loader->priv->output, block->data,
+                                   block->len, async->cancellable,
+                                   &error) == -1) {
+    pluma_debug_message(DEBUG_LOADER, "Write error: %s", error->message);
+  } else {
+    /* Bump the size. */
+    loader->priv->bytes_read += block->len;
+  }
+
+  eof = block->eof;
+
+  /* hand the block back to the decode thread */
+  g_async_queue_push(pipeline->free_blocks, block);
+
+  if (error != NULL) {
+    /* stops the decode thread, which waits for free blocks otherwise */
+    g_cancellable_cancel(pipeline->cancellable);
 
-  pluma_debug_message(DEBUG_SAVER, "Written: %" G_GSSIZE_FORMAT, bytes_written);
-  if (bytes_written == -1) {
-    pluma_debug_message(DEBUG_SAVER, "Write error: %s", error->message);
+    pipeline->async = NULL;
     async_failed(async, error);
-    return;
+    return FALSE;
+  }
+
+  /* end of the file, we are done! */
+  if (eof) {
+    if (pipeline->truncated || pipeline->tail_offset > 0)
+      loader->priv->partial = TRUE;
+
+    pipeline->async = NULL;
+    end_of_file(async);
+    return FALSE;
   }
 
-  /* note that this signal blocks the read... check if it isn't
-   * a performance problem
-   */
   pluma_document_loader_loading(loader, FALSE, NULL);
 
-  read_file_chunk(async);
+  return FALSE;
+}
+
+static void push_ready_block(DecodePipeline *pipeline, DecodeBlock *block) {
+  g_async_queue_push(pipeline->ready_blocks, block);
+
+  g_main_context_invoke_full(pipeline->context, G_PRIORITY_DEFAULT_IDLE,
+                             (GSourceFunc)insert_decoded_block,
+                             decode_pipeline_ref(pipeline),
+                             (GDestroyNotify)decode_pipeline_unref);
 }
 
-static void async_read_cb(GInputStream *stream, GAsyncResult *res,
-                          AsyncData *async) {
+/* Runs in the main thread after the decode thread is done: a load cancelled
+ * before the decode thread could hand over a block has nothing left to
+ * release its data */
+static gboolean release_cancelled_load(DecodePipeline *pipeline) {
+  if (pipeline->async != NULL &&
+      g_cancellable_is_cancelled(pipeline->cancellable)) {
+    async_data_free(pipeline->async);
+    pipeline->async = NULL;
+  }
+
+  return FALSE;
+}
+
+static void end_decoding(GTask *task, DecodePipeline *pipeline) {
+  /* after the blocks already handed over */
+  g_main_context_invoke_full(pipeline->context, G_PRIORITY_DEFAULT_IDLE,
+                             (GSourceFunc)release_cancelled_load,
+                             decode_pipeline_ref(pipeline),
+                             (GDestroyNotify)decode_pipeline_unref);
+
+  g_task_return_boolean(task, TRUE);
+}
+
+/* Blocks until the main thread returns a block, which is what keeps the
+ * decode thread from running too far ahead of the insertion */
+static DecodeBlock *pop_free_block(DecodePipeline *pipeline) {
+  DecodeBlock *block = NULL;
+
+  while (block == NULL && !g_cancellable_is_cancelled(pipeline->cancellable)) {
+    block = g_async_queue_timeout_pop(pipeline->free_blocks,
+                                      100 * G_TIME_SPAN_MILLISECOND);
+  }
+
+  return block;
+}
+
+/* NUL bytes or a byte order mark at the start of the file tell that it
+ * is in UTF-16 or UTF-32, no text in the other encodings has them */
+static gboolean is_wide_text(const guchar *data, gsize len) {
+  if (len >= 2 && ((data[0] == 0xff && data[1] == 0xfe) ||
+                   (data[0] == 0xfe && data[1] == 0xff)))
+    return TRUE;
+
+  return memchr(data, 0, len) != NULL;
+}
+
+/* Runs in the decode thread before anything is read from the converter:
+ * moves base_stream to the tail of the file, and then to the start of the
+ * next line since the first one is most likely cut. Files in UTF-16 or
+ * UTF-32 are loaded from the start instead, the newline of a wide encoding
+ * cannot be told from its bytes alone and the converter needs the byte
+ * order mark. */
+static gboolean seek_to_tail(DecodePipeline *pipeline, GError **error) {
+  GBufferedInputStream *buffered;
+  const guchar *data;
+  const guchar *newline;
+  goffset left;
+  gsize len;
+  gsize skip;
+
+  buffered = G_BUFFERED_INPUT_STREAM(pipeline->base_stream);
+
+  if (g_buffered_input_stream_fill(buffered, -1, pipeline->cancellable,
+                                   error) == -1)
+    return FALSE;
+
+  data = g_buffered_input_stream_peek_buffer(buffered, &len);
+
+  if (is_wide_text(data, len)) {
+    pluma_debug_message(DEBUG_LOADER, "Wide encoding, loading all the file");
+
+    pipeline->tail_offset = 0;
+    return TRUE;
+  }
+
+  left = pipeline->tail_offset;
+
+  if (g_seekable_can_seek(G_SEEKABLE(buffered))) {
+    if (!g_seekable_seek(G_SEEKABLE(buffered), left, G_SEEK_SET,
+                         pipeline->cancellable, error))
+      return FALSE;
+  } else {
+    /* still cheaper than converting and inserting the text */
+    while (left > 0) {
+      gssize n;
+
+      n = g_input_stream_skip(G_INPUT_STREAM(buffered), MIN(left, G_MAXSSIZE),
+                              pipeline->cancellable, error);
+      if (n == -1) return FALSE;
+      if (n == 0) break;
+
+      left -= n;
+    }
+  }
+
+  if (g_buffered_input_stream_fill(buffered, -1, pipeline->cancellable,
+                                   error) == -1)
+    return FALSE;
+
+  data = g_buffered_input_stream_peek_buffer(buffered, &len);
+  newline = memchr(data, '\n', len);
+
+  if (newline != NULL) {
+    skip = newline - data + 1;
+  } else {
+    /* a single line longer than the buffer, start it on a character */
+    skip = 0;
+    while (skip < len && (data[skip] & 0xc0) == 0x80) skip++;
+  }
+
+  if (skip > 0 && g_input_stream_skip(G_INPUT_STREAM(buffered), skip,
+                                      pipeline->cancellable, error) == -1)
+    return FALSE;
+
+  return TRUE;
+}
+
+/* Cuts the block after the last line which ends in the first max_len bytes
+ * of text, returns TRUE if it is the last block to load */
+static gboolean cut_block_at_head_end(DecodePipeline *pipeline,
+                                      DecodeBlock *block) {
+  gsize left;
+  gsize len;
+
+  left = pipeline->max_len - pipeline->total_len;
+
+  if (block->len < left) {
+    pipeline->total_len += block->len;
+    return FALSE;
+  }
+
+  len = left;
+  while (len > 0 && block->data[len - 1] != '\n') len--;
+
+  /* a single line longer than what is left, cut it between characters */
+  if (len == 0) {
+    len = left;
+    while (len > 0 && len < block->len &&
+           (block->data[len] & 0xc0) == 0x80)
+      len--;
+  }
+
+  block->len = len;
+  pipeline->total_len += len;
+  pipeline->truncated = TRUE;
+
+  return TRUE;
+}
+
+/* Runs in a worker thread: reads and converts the file and validates the
+ * result. Each block handed to the main thread ends on a complete UTF-8
+ * character and never splits a CRLF sequence, the remainder is carried
+ * over to the next block. */
+static void decode_thread(GTask *task, gpointer source_object,
+                          gpointer task_data, GCancellable *cancellable) {
+  DecodePipeline *pipeline = task_data;
+  DecodeBlock *block;
+  gchar carry[MAX_UNICHAR_LEN];
+  gsize carry_len = 0;
+  GError *error = NULL;
+
+  if (pipeline->tail_offset > 0 && !seek_to_tail(pipeline, &error)) {
+    block = pop_free_block(pipeline);
+
+    if (block != NULL) {
+      block->error = error;
+      push_ready_block(pipeline, block);
+    } else {
+      g_error_free(error);
+    }
+
+    end_decoding(task, pipeline);
+    return;
+  }
+
+  while ((block = pop_free_block(pipeline)) != NULL) {
+    const gchar *end;
+    gssize n;
+    gsize len;
+
+    memcpy(block->data, carry, carry_len);
+
+    n = g_input_stream_read(pipeline->stream, block->data + carry_len,
+                            pipeline->block_size, pipeline->cancellable,
+                            &block->error);
+
+    if (n == -1) {
+      push_ready_block(pipeline, block);
+      break;
+    }
+
+    len = carry_len + n;
+    carry_len = 0;
+
+    if (n == 0) {
+      if (!pluma_utf8_validate(block->data, len, NULL)) {
+        g_set_error(&block->error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                    _("Incomplete UTF-8 sequence in input"));
+      }
+
+      block->len = len;
+      block->eof = TRUE;
+      push_ready_block(pipeline, block);
+      break;
+    }
+
+    if (!pluma_utf8_validate(block->data, len, &end)) {
+      gsize remainder = len - (end - block->data);
+
+      if (remainder >= MAX_UNICHAR_LEN ||
+          g_utf8_get_char_validated(end, remainder) != (gunichar)-2) {
+        /* TODO: we could escape invalid text and tag it in red
+         * and make the doc readonly.
+         */
+        g_set_error(&block->error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                    _("Invalid UTF-8 sequence in input"));
+        push_ready_block(pipeline, block);
+        break;
+      }
+
+      carry_len = remainder;
+    } else if (block->data[len - 1] == '\r') {
+      /* Avoid keeping a CRLF across two buffers. */
+      carry_len = 1;
+    }
+
+    memcpy(carry, block->data + len - carry_len, carry_len);
+
+    block->len = len - carry_len;
+
+    if (pipeline->max_len > 0 && cut_block_at_head_end(pipeline, block)) {
+      block->eof = TRUE;
+      push_ready_block(pipeline, block);
+      break;
+    }
+
+    push_ready_block(pipeline, block);
+  }
+
+  end_decoding(task, pipeline);
+}
+
+static gboolean is_wide_encoding(const PlumaEncoding *enc) {
+  const gchar *charset;
+
+  if (enc == NULL) return FALSE;
+
+  charset = pluma_encoding_get_charset(enc);
+
+  return g_str_has_prefix(charset, "UTF-16") ||
+         g_str_has_prefix(charset, "UTF-32") ||
+         strcmp(charset, "UCS-2") == 0 || strcmp(charset, "UCS-4") == 0;
+}
+
+/* base_stream is the stream of the file, under the converter */
+static void start_decode_thread(AsyncData *async, GInputStream *base_stream) {
+  PlumaDocumentLoader *loader;
+  DecodePipeline *pipeline;
+  GTask *task;
+  goffset size = -1;
+  guint max_block_size;
+  gint i;
+
+  loader = async->loader;
+
+  /* the size is not known for some remote files */
+  if (loader->priv->info != NULL &&
+      g_file_info_has_attribute(loader->priv->info,
+                                G_FILE_ATTRIBUTE_STANDARD_SIZE))
+    size = g_file_info_get_size(loader->priv->info);
+
+  max_block_size = g_settings_get_uint(loader->priv->enc_settings,
+                                       PLUMA_SETTINGS_MAX_IO_BLOCK_SIZE);
+
+  pipeline = g_slice_new0(DecodePipeline);
+  pipeline->ref_count = 1;
+  pipeline->context = g_main_context_ref_thread_default();
+  pipeline->stream = g_object_ref(loader->priv->stream);
+  pipeline->cancellable = g_object_ref(async->cancellable);
+  pipeline->free_blocks = g_async_queue_new();
+  pipeline->ready_blocks = g_async_queue_new();
+  pipeline->block_size =
+      pluma_utils_get_io_block_size(size, (gsize)max_block_size * 1024);
+  pipeline->base_stream = g_object_ref(base_stream);
+  pipeline->async = async;
+
+  /* the tail can only be found when the size is known, see seek_to_tail()
+   * for the wide encodings */
+  if (loader->priv->range == PLUMA_DOCUMENT_LOAD_RANGE_TAIL && size >= 0 &&
+      size > loader->priv->range_size &&
+      !is_wide_encoding(loader->priv->encoding)) {
+    pipeline->tail_offset = size - loader->priv->range_size;
+  } else if (loader->priv->range == PLUMA_DOCUMENT_LOAD_RANGE_HEAD &&
+             (size < 0 || size > loader->priv->range_size)) {
+    pipeline->max_len = loader->priv->range_size;
+  }
+
+  pluma_debug_message(DEBUG_LOADER,
+                      "Tail offset: %" G_GOFFSET_FORMAT
+                      ", head length: %" G_GSIZE_FORMAT,
+                      pipeline->tail_offset, pipeline->max_len);
+
+  pluma_debug_message(DEBUG_LOADER, "Block size: %" G_GSIZE_FORMAT,
+                      pipeline->block_size);
+
+  for (i = 0; i < DECODE_QUEUE_LENGTH; i++) {
+    g_async_queue_push(pipeline->free_blocks,
+                       decode_block_new(pipeline->block_size));
+  }
+
+  pluma_document_output_stream_set_input_validated(
+      PLUMA_DOCUMENT_OUTPUT_STREAM(loader->priv->output), TRUE);
+
+  task = g_task_new(NULL, pipeline->cancellable, NULL, NULL);
+  g_task_set_task_data(task, pipeline, (GDestroyNotify)decode_pipeline_unref);
+  g_task_run_in_thread(task, decode_thread);
+  g_object_unref(task);
+}
+
+/* Inserts the file contents in big batches, one batch per idle iteration
+ * so that the view can draw and scroll the text loaded so far */
+static gboolean write_contents_chunk(AsyncData *async) {
+  PlumaDocumentLoader *loader;
+  gsize chunk;
+  gssize bytes_written;
+  GError *error = NULL;
+
   pluma_debug(DEBUG_LOADER);
+
+  /* manually check cancelled state */
+  if (g_cancellable_is_cancelled(async->cancellable)) {
+    async_data_free(async);
+    return FALSE;
+  }
+
+  loader = async->loader;
+
+  if (loader->priv->contents_offset < loader->priv->contents_length) {
+    chunk = MIN(CONTENTS_CHUNK_SIZE,
+                loader->priv->contents_length - loader->priv->contents_offset);
+
+    bytes_written = g_output_stream_write(
+        loader->priv->output,
+        loader->priv->contents + loader->priv->contents_offset, chunk,
+        async->cancellable, &error);
+
+    if (bytes_written == -1) {
+      async_failed(async, error);
+      return FALSE;
+    }
+
+    loader->priv->contents_offset += bytes_written;
+    loader->priv->bytes_read = loader->priv->contents_offset;
+
+    pluma_document_loader_loading(loader, FALSE, NULL);
+
+    return TRUE;
+  }
+
+  g_free(loader->priv->contents);
+  loader->priv->contents = NULL;
+
+  /* end of the file, we are done! */
+  end_of_file(async);
+
+  return FALSE;
+}
+
+static GSList *get_load_encodings(PlumaDocumentLoader *loader);
+static void start_stream_load(AsyncData *async, GSList *candidate_encodings);
+
+/* Scans a big file for lines and checks that it is UTF-8, one batch per idle
+ * iteration, then inserts the first window of it. Files in any other
+ * encoding are loaded whole by the converter. */
+static gboolean index_paged_chunk(AsyncData *async) {
   PlumaDocumentLoader *loader;
+  GSList *candidate_encodings;
+  gchar *text;
   GError *error = NULL;
 
   pluma_debug(DEBUG_LOADER);
@@ -420,72 +988,163 @@ static void async_read_cb(GInputStream *stream, GAsyncResult *res,
   /* manually check cancelled state */
   if (g_cancellable_is_cancelled(async->cancellable)) {
     async_data_free(async);
-    return;
+    return FALSE;
   }
 
   loader = async->loader;
 
-  async->read = g_input_stream_read_finish(stream, res, &error);
+  if (!pluma_document_pager_index(loader->priv->pager, INDEX_CHUNK_SIZE)) {
+    loader->priv->bytes_read =
+        pluma_document_pager_get_indexed(loader->priv->pager);
 
-  /* error occurred */
-  if (async->read == -1) {
-    async_failed(async, error);
-    return;
+    pluma_document_loader_loading(loader, FALSE, NULL);
+
+    return TRUE;
   }
 
-  /* Check for the extremely unlikely case where the file size overflows. */
-  if (loader->priv->bytes_read + async->read < loader->priv->bytes_read) {
-    g_set_error(&loader->priv->error, PLUMA_DOCUMENT_ERROR,
-                PLUMA_DOCUMENT_ERROR_TOO_BIG, "File too big");
+  if (!pluma_document_pager_is_valid(loader->priv->pager)) {
+    pluma_debug_message(DEBUG_LOADER, "Not valid UTF-8, using the converter");
 
-    async_failed(async, loader->priv->error);
-    return;
+    pluma_document_pager_free(loader->priv->pager);
+    loader->priv->pager = NULL;
+    loader->priv->bytes_read = 0;
+
+    candidate_encodings = get_load_encodings(loader);
+    start_stream_load(async, candidate_encodings);
+    g_slist_free(candidate_encodings);
+
+    return FALSE;
   }
 
-  /* Bump the size. */
-  loader->priv->bytes_read += async->read;
+  loader->priv->bytes_read =
+      pluma_document_pager_get_length(loader->priv->pager);
 
-  /* end of the file, we are done! */
-  if (async->read == 0) {
-    g_output_stream_flush(loader->priv->output, NULL, &loader->priv->error);
+  loader->priv->output =
+      pluma_document_output_stream_new(loader->priv->document);
 
-    loader->priv->auto_detected_encoding =
-        pluma_smart_charset_converter_get_guessed(loader->priv->converter);
+  text = pluma_document_pager_get_window(loader->priv->pager, 0);
 
-    loader->priv->auto_detected_newline_type =
-        pluma_document_output_stream_detect_newline_type(
-            PLUMA_DOCUMENT_OUTPUT_STREAM(loader->priv->output));
-
-    /* Check if we needed some fallback char, if so, check if there was
-       a previous error and if not set a fallback used error */
-    /* FIXME Uncomment this when we want to manage conversion fallback */
-    /*if ((pluma_smart_charset_converter_get_num_fallbacks
-    (loader->priv->converter) != 0) && loader->priv->error == NULL)
-    {
-        g_set_error_literal (&loader->priv->error,
-                     PLUMA_DOCUMENT_ERROR,
-                     PLUMA_DOCUMENT_ERROR_CONVERSION_FALLBACK,
-                     "There was a conversion error and it was "
-                     "needed to use a fallback char");
-    }*/
-
-    write_complete(async);
+  if (!g_output_stream_write_all(loader->priv->output, text, strlen(text),
+                                 NULL, async->cancellable, &error)) {
+    g_free(text);
+    async_failed(async, error);
+    return FALSE;
+  }
 
-    return;
+  g_free(text);
+
+  /* the document owns it from now on */
+  _pluma_document_set_pager(loader->priv->document, loader->priv->pager);
+  loader->priv->pager = NULL;
+
+  end_of_file(async);
+
+  return FALSE;
+}
+
+/* Above the large file threshold only a window of a local file is kept in
+ * the document, the rest is read from the file when the window moves. The
+ * file is checked to be UTF-8 while its lines are indexed. */
+static gboolean try_paged_load(AsyncData *async, GSList *candidate_encodings) {
+  PlumaDocumentLoader *loader;
+  GFileInfo *info;
+  guint threshold;
+  gchar *path;
+  GError *error = NULL;
+
+  loader = async->loader;
+  info = loader->priv->info;
+
+  if (candidate_encodings == NULL ||
+      candidate_encodings->data != (gpointer)pluma_encoding_get_utf8())
+    return FALSE;
+
+  threshold = g_settings_get_uint(loader->priv->enc_settings,
+                                  PLUMA_SETTINGS_LARGE_FILE_THRESHOLD);
+
+  if (threshold == 0 ||
+      !g_file_info_has_attribute(info, G_FILE_ATTRIBUTE_STANDARD_SIZE) ||
+      g_file_info_get_size(info) < (goffset)threshold * 1024 * 1024)
+    return FALSE;
+
+  if (!g_file_is_native(loader->priv->gfile)) return FALSE;
+
+  path = g_file_get_path(loader->priv->gfile);
+  if (path == NULL) return FALSE;
+
+  loader->priv->pager = pluma_document_pager_new(path, &error);
+  g_free(path);
+
+  if (loader->priv->pager == NULL) {
+    pluma_debug_message(DEBUG_LOADER, "Opening file failed: %s",
+                        error->message);
+    g_error_free(error);
+    return FALSE;
   }
 
-  write_file_chunk(async);
+  pluma_debug_message(DEBUG_LOADER, "Loading large file in windows");
+
+  g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, (GSourceFunc)index_paged_chunk,
+                  async, NULL);
+
+  return TRUE;
 }
 
-static void read_file_chunk(AsyncData *async) {
+/* For local regular files that may be UTF-8 we read the file and validate
+ * it all at once: if it turns out to be valid we can skip the charset
+ * converter and the 8 KiB read round trips through the main loop. Otherwise
+ * the caller falls back to the generic stream based path. The file is read
+ * rather than mapped, a mapping faults if the file is truncated meanwhile. */
+static gboolean try_contents_load(AsyncData *async,
+                                  GSList *candidate_encodings) {
   PlumaDocumentLoader *loader;
+  gchar *contents;
+  gsize length;
+  gchar *path;
+  GError *error = NULL;
 
   loader = async->loader;
 
-  g_input_stream_read_async(G_INPUT_STREAM(loader->priv->stream),
-                            loader->priv->buffer, READ_CHUNK_SIZE,
-                            G_PRIORITY_HIGH, async->cancellable,
-                            (GAsyncReadyCallback)async_read_cb, async);
+  /* if UTF-8 is not the preferred guess, the smart converter may pick
+   * another encoding even for valid UTF-8 input */
+  if (candidate_encodings == NULL ||
+      candidate_encodings->data != (gpointer)pluma_encoding_get_utf8())
+    return FALSE;
+
+  if (!g_file_is_native(loader->priv->gfile)) return FALSE;
+
+  path = g_file_get_path(loader->priv->gfile);
+  if (path == NULL) return FALSE;
+
+  if (!g_file_get_contents(path, &contents, &length, &error)) {
+    pluma_debug_message(DEBUG_LOADER, "Reading file failed: %s",
+                        error->message);
+    g_error_free(error);
+    g_free(path);
+    return FALSE;
+  }
+
+  g_free(path);
+
+  if (!pluma_utf8_validate(contents, length, NULL)) {
+    pluma_debug_message(DEBUG_LOADER, "Not valid UTF-8, using the converter");
+    g_free(contents);
+    return FALSE;
+  }
+
+  pluma_debug_message(DEBUG_LOADER, "Loading file contents");
+
+  loader->priv->contents = contents;
+  loader->priv->contents_length = length;
+  loader->priv->contents_offset = 0;
+
+  loader->priv->output =
+      pluma_document_output_stream_new(loader->priv->document);
+
+  g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, (GSourceFunc)write_contents_chunk,
+                  async, NULL);
+
+  return TRUE;
 }
 
 static GSList *get_candidate_encodings(PlumaDocumentLoader *loader) {
@@ -507,9 +1166,52 @@ static GSList *get_candidate_encodings(PlumaDocumentLoader *loader) {
   return encodings;
 }
 
-static void finish_query_info(AsyncData *async) {
+/* The encoding asked for, or the ones to guess from */
+static GSList *get_load_encodings(PlumaDocumentLoader *loader) {
+  if (loader->priv->encoding == NULL) return get_candidate_encodings(loader);
+
+  return g_slist_prepend(NULL, (gpointer)loader->priv->encoding);
+}
+
+/* Reads the file through the charset converter in the decode thread */
+static void start_stream_load(AsyncData *async, GSList *candidate_encodings) {
   PlumaDocumentLoader *loader;
+  GInputStream *base_stream;
   GInputStream *conv_stream;
+
+  loader = async->loader;
+
+  /* see seek_to_tail() */
+  if (loader->priv->range == PLUMA_DOCUMENT_LOAD_RANGE_TAIL) {
+    base_stream = g_buffered_input_stream_new_sized(loader->priv->stream,
+                                                    TAIL_BUFFER_SIZE);
+    g_object_unref(loader->priv->stream);
+    loader->priv->stream = base_stream;
+  }
+
+  base_stream = loader->priv->stream;
+
+  loader->priv->converter =
+      pluma_smart_charset_converter_new(candidate_encodings);
+
+  conv_stream = g_converter_input_stream_new(
+      base_stream, G_CONVERTER(loader->priv->converter));
+
+  /* the converter stream keeps its own reference */
+  loader->priv->stream = conv_stream;
+
+  /* Output stream */
+  loader->priv->output =
+      pluma_document_output_stream_new(loader->priv->document);
+
+  /* start reading */
+  start_decode_thread(async, base_stream);
+
+  g_object_unref(base_stream);
+}
+
+static void finish_query_info(AsyncData *async) {
+  PlumaDocumentLoader *loader;
   GFileInfo *info;
   GSList *candidate_encodings;
 
@@ -528,30 +1230,15 @@ static void finish_query_info(AsyncData *async) {
   }
 
   /* Get the candidate encodings */
-  if (loader->priv->encoding == NULL) {
-    candidate_encodings = get_candidate_encodings(loader);
-  } else {
-    candidate_encodings =
-        g_slist_prepend(NULL, (gpointer)loader->priv->encoding);
-  }
-
-  loader->priv->converter =
-      pluma_smart_charset_converter_new(candidate_encodings);
-  g_slist_free(candidate_encodings);
-
-  conv_stream = g_converter_input_stream_new(
-      loader->priv->stream, G_CONVERTER(loader->priv->converter));
-
-  g_object_unref(loader->priv->stream);
+  candidate_encodings = get_load_encodings(loader);
 
-  loader->priv->stream = conv_stream;
-
-  /* Output stream */
-  loader->priv->output =
-      pluma_document_output_stream_new(loader->priv->document);
+  /* both read the whole file */
+  if (loader->priv->range != PLUMA_DOCUMENT_LOAD_RANGE_ALL ||
+      (!try_paged_load(async, candidate_encodings) &&
+       !try_contents_load(async, candidate_encodings)))
+    start_stream_load(async, candidate_encodings);
 
-  /* start reading */
-  read_file_chunk(async);
+  g_slist_free(candidate_encodings);
 }
 
 static void query_info_cb(GFile *source, GAsyncResult *res, AsyncData *async) {
@@ -779,3 +1466,34 @@ GFileInfo *pluma_document_loader_get_info(PlumaDocumentLoader *loader) {
 
   return loader->priv->info;
 }
+
+/**
+ * pluma_document_loader_set_range:
+ * @loader: a #PlumaDocumentLoader which was not used yet
+ * @range: the part of the file to load
+ * @size: the number of bytes to load from the start or the end of the file
+ *
+ * Only loads the first or the last @size bytes of the file, cut at lines.
+ * The tail of the file is found by seeking the input stream before the
+ * first block is read, so the rest of the file is never read when the
+ * stream can seek. Files in UTF-16 or UTF-32 are loaded entirely when the
+ * tail is asked for.
+ */
+void pluma_document_loader_set_range(PlumaDocumentLoader *loader,
+                                     PlumaDocumentLoadRange range,
+                                     goffset size) {
+  g_return_if_fail(PLUMA_IS_DOCUMENT_LOADER(loader));
+  g_return_if_fail(loader->priv->used == FALSE);
+  g_return_if_fail(range == PLUMA_DOCUMENT_LOAD_RANGE_ALL || size > 0);
+
+  loader->priv->range = range;
+  loader->priv->range_size = size;
+}
+
+/* Whether only a part of the file was loaded, see
+ * pluma_document_loader_set_range() */
+gboolean pluma_document_loader_is_partial(PlumaDocumentLoader *loader) {
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT_LOADER(loader), FALSE);
+
+  return loader->priv->partial;
+}
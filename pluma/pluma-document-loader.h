@@ -118,6 +118,12 @@ goffset pluma_document_loader_get_bytes_read(PlumaDocumentLoader *loader);
    access_can_write and also the metadata*/
 GFileInfo *pluma_document_loader_get_info(PlumaDocumentLoader *loader);
 
+void pluma_document_loader_set_range(PlumaDocumentLoader *loader,
+                                     PlumaDocumentLoadRange range,
+                                     goffset size);
+
+gboolean pluma_document_loader_is_partial(PlumaDocumentLoader *loader);
+
 G_END_DECLS
 
 #endif /* __PLUMA_DOCUMENT_LOADER_H__  */
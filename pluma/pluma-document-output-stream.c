@@ -32,6 +32,8 @@
 #include <glib/gi18n.h>
 #include <string.h>
 
+#include "pluma-utf8.h"
+
 /* NOTE: never use async methods on this stream, the stream is just
  * a wrapper around GtkTextBuffer api so that we can use GIO Stream
  * methods, but the undelying code operates on a GtkTextBuffer, so
@@ -40,18 +42,36 @@
 
 #define MAX_UNICHAR_LEN 6
 
+/* word at a time search for line terminators */
+#define WORD_ONES G_GUINT64_CONSTANT(0x0101010101010101)
+#define WORD_HIGHS G_GUINT64_CONSTANT(0x8080808080808080)
+#define WORD_HAS_ZERO(w) (((w) - WORD_ONES) & ~(w) & WORD_HIGHS)
+#define WORD_HAS_BYTE(w, b) WORD_HAS_ZERO((w) ^ (WORD_ONES * (guchar)(b)))
+
 struct _PlumaDocumentOutputStreamPrivate {
   PlumaDocument *doc;
   GtkTextIter pos;
 
-  gchar *buffer;
-  gsize buflen;
+  /* bytes held back from the previous write: the start of a character, or
+   * a CR which may be followed by a LF */
+  gchar carry[MAX_UNICHAR_LEN];
+  gsize carry_len;
+
+  /* line terminator held back when appending */
+  gchar newline[3];
+  gsize newline_len;
+
+  /* line terminators written so far, indexed by PlumaDocumentNewlineType */
+  guint newline_counts[3];
 
   guint is_initialized : 1;
   guint is_closed : 1;
+  guint input_validated : 1;
+  guint append : 1;
+  guint pending_cr : 1;
 };
 
-enum { PROP_0, PROP_DOCUMENT };
+enum { PROP_0, PROP_DOCUMENT, PROP_APPEND };
 
 G_DEFINE_TYPE_WITH_PRIVATE(PlumaDocumentOutputStream,
                            pluma_document_output_stream, G_TYPE_OUTPUT_STREAM)
@@ -81,6 +101,10 @@ static void pluma_document_output_stream_set_property(GObject *object,
       stream->priv->doc = PLUMA_DOCUMENT(g_value_get_object(value));
       break;
 
+    case PROP_APPEND:
+      stream->priv->append = g_value_get_boolean(value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
       break;
@@ -98,20 +122,16 @@ static void pluma_document_output_stream_get_property(GObject *object,
       g_value_set_object(value, stream->priv->doc);
       break;
 
+    case PROP_APPEND:
+      g_value_set_boolean(value, stream->priv->append);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
       break;
   }
 }
 
-static void pluma_document_output_stream_finalize(GObject *object) {
-  PlumaDocumentOutputStream *stream = PLUMA_DOCUMENT_OUTPUT_STREAM(object);
-
-  g_free(stream->priv->buffer);
-
-  G_OBJECT_CLASS(pluma_document_output_stream_parent_class)->finalize(object);
-}
-
 static void pluma_document_output_stream_constructed(GObject *object) {
   PlumaDocumentOutputStream *stream = PLUMA_DOCUMENT_OUTPUT_STREAM(object);
 
@@ -122,6 +142,9 @@ static void pluma_document_output_stream_constructed(GObject *object) {
     return;
   }
 
+  /* keep what is already in the document */
+  if (stream->priv->append) return;
+
   /* Init the undoable action */
   gtk_source_buffer_begin_not_undoable_action(
       GTK_SOURCE_BUFFER(stream->priv->doc));
@@ -140,7 +163,6 @@ static void pluma_document_output_stream_class_init(
 
   object_class->get_property = pluma_document_output_stream_get_property;
   object_class->set_property = pluma_document_output_stream_set_property;
-  object_class->finalize = pluma_document_output_stream_finalize;
   object_class->constructed = pluma_document_output_stream_constructed;
 
   stream_class->write_fn = pluma_document_output_stream_write;
@@ -152,70 +174,153 @@ static void pluma_document_output_stream_class_init(
       g_param_spec_object("document", "Document",
                           "The document which is written", PLUMA_TYPE_DOCUMENT,
                           G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+  g_object_class_install_property(
+      object_class, PROP_APPEND,
+      g_param_spec_boolean("append", "Append",
+                           "Whether the text is appended to the document",
+                           FALSE, G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
 }
 
 static void pluma_document_output_stream_init(
     PlumaDocumentOutputStream *stream) {
   stream->priv = pluma_document_output_stream_get_instance_private(stream);
 
-  stream->priv->buffer = NULL;
-  stream->priv->buflen = 0;
+  stream->priv->carry_len = 0;
 
   stream->priv->is_initialized = FALSE;
   stream->priv->is_closed = FALSE;
+  stream->priv->input_validated = FALSE;
+  stream->priv->append = FALSE;
+  stream->priv->newline_len = 0;
+  stream->priv->pending_cr = FALSE;
 }
 
-static PlumaDocumentNewlineType get_newline_type(GtkTextIter *end) {
-  PlumaDocumentNewlineType res;
-  GtkTextIter copy;
-  gunichar c;
+GOutputStream *pluma_document_output_stream_new(PlumaDocument *doc) {
+  return G_OUTPUT_STREAM(
+      g_object_new(PLUMA_TYPE_DOCUMENT_OUTPUT_STREAM, "document", doc, NULL));
+}
 
-  copy = *end;
-  c = gtk_text_iter_get_char(&copy);
+/* Like pluma_document_output_stream_new() but the text is added at the end of
+ * the document instead of replacing it. The line terminator which was
+ * stripped from the end of the document when it was loaded is put back before
+ * the new text, and the last one of the new text is stripped in turn. */
+GOutputStream *pluma_document_output_stream_new_for_append(PlumaDocument *doc) {
+  return G_OUTPUT_STREAM(g_object_new(PLUMA_TYPE_DOCUMENT_OUTPUT_STREAM,
+                                      "document", doc, "append", TRUE, NULL));
+}
 
-  if (g_unichar_break_type(c) == G_UNICODE_BREAK_CARRIAGE_RETURN) {
-    if (gtk_text_iter_forward_char(&copy) &&
-        g_unichar_break_type(gtk_text_iter_get_char(&copy)) ==
-            G_UNICODE_BREAK_LINE_FEED) {
-      res = PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF;
+/* When set, the caller guarantees that every write is valid UTF-8 which
+ * neither ends with a partial character nor splits a CRLF sequence, so the
+ * text can be inserted without validating it again */
+void pluma_document_output_stream_set_input_validated(
+    PlumaDocumentOutputStream *stream, gboolean validated) {
+  g_return_if_fail(PLUMA_IS_DOCUMENT_OUTPUT_STREAM(stream));
+
+  stream->priv->input_validated = validated != FALSE;
+}
+
+/* Counts the line terminators of text, a CR at its end is only counted once
+ * the next write tells whether it starts a CRLF */
+static void count_newlines(PlumaDocumentOutputStream *stream,
+                           const gchar *text, gsize len) {
+  guint *counts = stream->priv->newline_counts;
+  gsize i = 0;
+
+  if (len == 0) return;
+
+  if (stream->priv->pending_cr) {
+    if (text[0] == '\n') {
+      counts[PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF]++;
+      i = 1;
     } else {
-      res = PLUMA_DOCUMENT_NEWLINE_TYPE_CR;
+      counts[PLUMA_DOCUMENT_NEWLINE_TYPE_CR]++;
     }
-  } else {
-    res = PLUMA_DOCUMENT_NEWLINE_TYPE_LF;
+
+    stream->priv->pending_cr = FALSE;
   }
 
-  return res;
+  while (i < len) {
+    /* skip the words without any terminator, most of them */
+    while (i + sizeof(guint64) <= len) {
+      guint64 word;
+
+      memcpy(&word, text + i, sizeof(guint64));
+
+      if (WORD_HAS_BYTE(word, '\n') || WORD_HAS_BYTE(word, '\r')) break;
+
+      i += sizeof(guint64);
+    }
+
+    if (i >= len) break;
+
+    if (text[i] == '\n') {
+      counts[PLUMA_DOCUMENT_NEWLINE_TYPE_LF]++;
+    } else if (text[i] == '\r') {
+      if (i + 1 == len) {
+        stream->priv->pending_cr = TRUE;
+      } else if (text[i + 1] == '\n') {
+        counts[PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF]++;
+        i++;
+      } else {
+        counts[PLUMA_DOCUMENT_NEWLINE_TYPE_CR]++;
+      }
+    }
+
+    i++;
+  }
 }
 
-GOutputStream *pluma_document_output_stream_new(PlumaDocument *doc) {
-  return G_OUTPUT_STREAM(
-      g_object_new(PLUMA_TYPE_DOCUMENT_OUTPUT_STREAM, "document", doc, NULL));
+static void flush_pending_cr(PlumaDocumentOutputStream *stream) {
+  if (stream->priv->pending_cr) {
+    stream->priv->newline_counts[PLUMA_DOCUMENT_NEWLINE_TYPE_CR]++;
+    stream->priv->pending_cr = FALSE;
+  }
 }
 
+/**
+ * pluma_document_output_stream_get_newline_count:
+ * @stream: a #PlumaDocumentOutputStream
+ * @type: the line terminator to count
+ *
+ * Returns: how many @type line terminators have been written so far.
+ */
+guint pluma_document_output_stream_get_newline_count(
+    PlumaDocumentOutputStream *stream, PlumaDocumentNewlineType type) {
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT_OUTPUT_STREAM(stream), 0);
+  g_return_val_if_fail(type <= PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF, 0);
+
+  flush_pending_cr(stream);
+
+  return stream->priv->newline_counts[type];
+}
+
+/* The most used line terminator of the text written so far */
 PlumaDocumentNewlineType pluma_document_output_stream_detect_newline_type(
     PlumaDocumentOutputStream *stream) {
+  const guint *counts;
   PlumaDocumentNewlineType type;
-  GtkTextIter iter;
 
   g_return_val_if_fail(PLUMA_IS_DOCUMENT_OUTPUT_STREAM(stream),
                        PLUMA_DOCUMENT_NEWLINE_TYPE_DEFAULT);
 
+  flush_pending_cr(stream);
+
+  counts = stream->priv->newline_counts;
   type = PLUMA_DOCUMENT_NEWLINE_TYPE_DEFAULT;
 
-  gtk_text_buffer_get_start_iter(GTK_TEXT_BUFFER(stream->priv->doc), &iter);
+  if (counts[PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF] > counts[type])
+    type = PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF;
 
-  if (gtk_text_iter_ends_line(&iter) ||
-      gtk_text_iter_forward_to_line_end(&iter)) {
-    type = get_newline_type(&iter);
-  }
+  if (counts[PLUMA_DOCUMENT_NEWLINE_TYPE_CR] > counts[type])
+    type = PLUMA_DOCUMENT_NEWLINE_TYPE_CR;
 
   return type;
 }
 
 /* If the last char is a newline, remove it from the buffer (otherwise
    GtkTextView shows it as an empty line). See bug #324942. */
-static void remove_ending_newline(PlumaDocumentOutputStream *stream) {
+static gboolean remove_ending_newline(PlumaDocumentOutputStream *stream) {
   GtkTextIter end;
   GtkTextIter start;
 
@@ -231,11 +336,29 @@ static void remove_ending_newline(PlumaDocumentOutputStream *stream) {
 
     /* Delete the empty line which is from 'start' to 'end' */
     gtk_text_buffer_delete(GTK_TEXT_BUFFER(stream->priv->doc), &start, &end);
+
+    return TRUE;
   }
+
+  return FALSE;
 }
 
 static void end_append_text_to_document(PlumaDocumentOutputStream *stream) {
-  remove_ending_newline(stream);
+  gboolean removed;
+
+  flush_pending_cr(stream);
+
+  /* when appending, the counts are kept up to date as text comes */
+  if (!stream->priv->append)
+    _pluma_document_set_newline_counts(stream->priv->doc,
+                                       stream->priv->newline_counts);
+
+  if (stream->priv->append)
+    removed = stream->priv->newline_len > 0;
+  else
+    removed = remove_ending_newline(stream);
+
+  _pluma_document_set_implicit_trailing_newline(stream->priv->doc, removed);
 
   gtk_text_buffer_set_modified(GTK_TEXT_BUFFER(stream->priv->doc), FALSE);
 
@@ -243,17 +366,118 @@ static void end_append_text_to_document(PlumaDocumentOutputStream *stream) {
       GTK_SOURCE_BUFFER(stream->priv->doc));
 }
 
+static const gchar *get_newline_string(PlumaDocumentNewlineType type) {
+  switch (type) {
+    case PLUMA_DOCUMENT_NEWLINE_TYPE_CR:
+      return "\r";
+    case PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF:
+      return "\r\n";
+    default:
+      return "\n";
+  }
+}
+
+static gsize get_ending_newline_len(const gchar *text, gsize len) {
+  if (len >= 2 && text[len - 2] == '\r' && text[len - 1] == '\n') return 2;
+
+  if (len >= 1 && (text[len - 1] == '\n' || text[len - 1] == '\r')) return 1;
+
+  return 0;
+}
+
+/* Inserts the text at the end of the document, holding back its last line
+ * terminator until more text comes */
+static void append_text(PlumaDocumentOutputStream *ostream, const gchar *text,
+                        gsize len) {
+  GtkTextBuffer *buffer = GTK_TEXT_BUFFER(ostream->priv->doc);
+  gsize newline_len;
+
+  if (len == 0) return;
+
+  /* the stream may live across main loop iterations, do not trust pos */
+  gtk_text_buffer_get_end_iter(buffer, &ostream->priv->pos);
+
+  if (ostream->priv->newline_len > 0) {
+    gtk_text_buffer_insert(buffer, &ostream->priv->pos, ostream->priv->newline,
+                           ostream->priv->newline_len);
+  }
+
+  newline_len = get_ending_newline_len(text, len);
+  memcpy(ostream->priv->newline, text + len - newline_len, newline_len);
+  ostream->priv->newline_len = newline_len;
+
+  gtk_text_buffer_insert(buffer, &ostream->priv->pos, text, len - newline_len);
+
+  /* the document still matches what is on disk */
+  gtk_text_buffer_set_modified(buffer, FALSE);
+}
+
+/* Inserts text, which is valid UTF-8 */
+static void insert_text(PlumaDocumentOutputStream *ostream, const gchar *text,
+                        gsize len) {
+  count_newlines(ostream, text, len);
+
+  if (ostream->priv->append) {
+    append_text(ostream, text, len);
+    _pluma_document_set_newline_counts(ostream->priv->doc,
+                                       ostream->priv->newline_counts);
+  } else {
+    gtk_text_buffer_insert(GTK_TEXT_BUFFER(ostream->priv->doc),
+                           &ostream->priv->pos, text, len);
+  }
+}
+
+/* Completes the bytes held back by the previous write with the start of
+ * text and inserts them. Returns how many bytes of text were used, or -1 if
+ * they are not valid. */
+static gssize write_carry(PlumaDocumentOutputStream *ostream,
+                          const gchar *text, gsize len, GError **error) {
+  PlumaDocumentOutputStreamPrivate *priv = ostream->priv;
+  gsize used;
+  gunichar ch;
+
+  if (priv->carry[0] == '\r') {
+    /* an empty write, from flush, means that there is no LF coming */
+    used = (len > 0 && text[0] == '\n') ? 1 : 0;
+    priv->carry[1] = '\n';
+    insert_text(ostream, priv->carry, 1 + used);
+    priv->carry_len = 0;
+
+    return used;
+  }
+
+  used = MIN((gsize)g_utf8_skip[(guchar)priv->carry[0]] - priv->carry_len, len);
+  memcpy(priv->carry + priv->carry_len, text, used);
+  priv->carry_len += used;
+
+  ch = g_utf8_get_char_validated(priv->carry, priv->carry_len);
+
+  /* the character is still not complete */
+  if (ch == (gunichar)-2) return used;
+
+  if (ch == (gunichar)-1) {
+    g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                _("Invalid UTF-8 sequence in input"));
+    return -1;
+  }
+
+  insert_text(ostream, priv->carry, priv->carry_len);
+  priv->carry_len = 0;
+
+  return used;
+}
+
 static gssize pluma_document_output_stream_write(GOutputStream *stream,
                                                  const void *buffer,
                                                  gsize count,
                                                  GCancellable *cancellable,
                                                  GError **error) {
   PlumaDocumentOutputStream *ostream;
-  gchar *text;
+  const gchar *text;
   gsize len;
-  gboolean freetext = FALSE;
   const gchar *end;
   gboolean valid;
+  PlumaDocumentNewlineType type;
 
   if (g_cancellable_set_error_if_cancelled(cancellable, error)) return -1;
 
@@ -264,31 +488,59 @@ static gssize pluma_document_output_stream_write(GOutputStream *stream,
     gtk_source_buffer_begin_not_undoable_action(
         GTK_SOURCE_BUFFER(ostream->priv->doc));
 
-    gtk_text_buffer_get_start_iter(GTK_TEXT_BUFFER(ostream->priv->doc),
+    if (ostream->priv->append) {
+      gtk_text_buffer_get_end_iter(GTK_TEXT_BUFFER(ostream->priv->doc),
                                    &ostream->priv->pos);
+
+      if (_pluma_document_get_implicit_trailing_newline(ostream->priv->doc)) {
+        const gchar *newline = get_newline_string(
+            pluma_document_get_newline_type(ostream->priv->doc));
+
+        ostream->priv->newline_len = strlen(newline);
+        memcpy(ostream->priv->newline, newline, ostream->priv->newline_len);
+      }
+
+      for (type = PLUMA_DOCUMENT_NEWLINE_TYPE_LF;
+           type <= PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF; type++) {
+        ostream->priv->newline_counts[type] =
+            pluma_document_get_newline_count(ostream->priv->doc, type);
+      }
+    } else {
+      gtk_text_buffer_get_start_iter(GTK_TEXT_BUFFER(ostream->priv->doc),
+                                     &ostream->priv->pos);
+    }
+
     ostream->priv->is_initialized = TRUE;
   }
 
-  if (ostream->priv->buflen > 0) {
-    len = ostream->priv->buflen + count;
-    text = g_new(gchar, len + 1);
-    memcpy(text, ostream->priv->buffer, ostream->priv->buflen);
-    memcpy(text + ostream->priv->buflen, buffer, count);
-    text[len] = '\0';
-    g_free(ostream->priv->buffer);
-    ostream->priv->buffer = NULL;
-    ostream->priv->buflen = 0;
-    freetext = TRUE;
-  } else {
-    text = (gchar *)buffer;
-    len = count;
+  text = buffer;
+  len = count;
+
+  if (ostream->priv->carry_len > 0) {
+    gssize used;
+
+    used = write_carry(ostream, text, len, error);
+
+    if (used == -1) return -1;
+
+    /* all of the text went to the carried character */
+    if (ostream->priv->carry_len > 0) return count;
+
+    text += used;
+    len -= used;
+  }
+
+  if (ostream->priv->input_validated && !ostream->priv->append) {
+    insert_text(ostream, text, len);
+
+    return count;
   }
 
   /* validate */
-  valid = g_utf8_validate(text, len, &end);
+  valid = pluma_utf8_validate(text, len, &end);
 
   /* Avoid keeping a CRLF across two buffers. */
-  if (valid && len > 1 && end[-1] == '\r') {
+  if (valid && len > 0 && end[-1] == '\r') {
     valid = FALSE;
     end--;
   }
@@ -299,12 +551,12 @@ static gssize pluma_document_output_stream_write(GOutputStream *stream,
     gunichar ch;
 
     if ((remainder < MAX_UNICHAR_LEN) &&
-        ((ch = g_utf8_get_char_validated(text + nvalid, remainder)) ==
-             (gunichar)-2 ||
+        ((ch = g_utf8_get_char_validated(end, remainder)) == (gunichar)-2 ||
          ch == (gunichar)'\r')) {
-      ostream->priv->buffer = g_strndup(end, remainder);
-      ostream->priv->buflen = remainder;
-      len -= remainder;
+      /* keep it for the next write */
+      memcpy(ostream->priv->carry, end, remainder);
+      ostream->priv->carry_len = remainder;
+      len = nvalid;
     } else {
       /* TODO: we could escape invalid text and tag it in red
        * and make the doc readonly.
@@ -312,16 +564,11 @@ static gssize pluma_document_output_stream_write(GOutputStream *stream,
       g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
                   _("Invalid UTF-8 sequence in input"));
 
-      if (freetext) g_free(text);
-
       return -1;
     }
   }
 
-  gtk_text_buffer_insert(GTK_TEXT_BUFFER(ostream->priv->doc),
-                         &ostream->priv->pos, text, len);
-
-  if (freetext) g_free(text);
+  insert_text(ostream, text, len);
 
   return count;
 }
@@ -333,7 +580,7 @@ static gboolean pluma_document_output_stream_flush(GOutputStream *stream,
 
   /* Flush deferred data if some. */
   if (!ostream->priv->is_closed && ostream->priv->is_initialized &&
-      ostream->priv->buflen > 0 &&
+      ostream->priv->carry_len > 0 &&
       pluma_document_output_stream_write(stream, "", 0, cancellable, error) ==
           -1)
     return FALSE;
@@ -351,7 +598,7 @@ static gboolean pluma_document_output_stream_close(GOutputStream *stream,
     ostream->priv->is_closed = TRUE;
   }
 
-  if (ostream->priv->buflen > 0) {
+  if (ostream->priv->carry_len > 0) {
     g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
                 _("Incomplete UTF-8 sequence in input"));
     return FALSE;
@@ -68,6 +68,14 @@ GType pluma_document_output_stream_get_type(void) G_GNUC_CONST;
 
 GOutputStream *pluma_document_output_stream_new(PlumaDocument *doc);
 
+GOutputStream *pluma_document_output_stream_new_for_append(PlumaDocument *doc);
+
+void pluma_document_output_stream_set_input_validated(
+    PlumaDocumentOutputStream *stream, gboolean validated);
+
+guint pluma_document_output_stream_get_newline_count(
+    PlumaDocumentOutputStream *stream, PlumaDocumentNewlineType type);
+
 PlumaDocumentNewlineType pluma_document_output_stream_detect_newline_type(
     PlumaDocumentOutputStream *stream);
 
@@ -0,0 +1,343 @@
+/*
+ * pluma-document-pager.c
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "pluma-document-pager.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pluma-utf8.h"
+
+/* Only the start of every LINES_PER_CHECKPOINT-th line is remembered, a
+ * window always starts on one of them */
+#define LINES_PER_CHECKPOINT 1024
+#define WINDOW_MAX_BYTES (4 * 1024 * 1024)
+#define READ_BLOCK_SIZE (1024 * 1024)
+#define MAX_UNICHAR_LEN 4
+
+struct _PlumaDocumentPager {
+  gint fd;
+  gsize length;
+
+  /* the file is read again for every window: another process may truncate
+   * it at any time, which would be fatal with a mapping */
+  gchar *block;
+  /* a character cut at the end of the last block indexed */
+  gsize carry_len;
+  gboolean valid;
+
+  /* byte offsets of the checkpoint lines, the first one is 0 */
+  GArray *checkpoints;
+  gsize indexed;
+  gint lines;
+  gint lines_since_checkpoint;
+
+  /* the window spans the checkpoints [first, last) */
+  guint first;
+  guint last;
+};
+
+PlumaDocumentPager *pluma_document_pager_new(const gchar *path,
+                                             GError **error) {
+  PlumaDocumentPager *pager;
+  struct stat st;
+  gsize zero = 0;
+  gint fd;
+
+  g_return_val_if_fail(path != NULL, NULL);
+
+  fd = g_open(path, O_RDONLY, 0);
+
+  if (fd == -1 || fstat(fd, &st) == -1) {
+    gint saved_errno = errno;
+
+    g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                "%s", g_strerror(saved_errno));
+
+    if (fd != -1) close(fd);
+    return NULL;
+  }
+
+  pager = g_slice_new0(PlumaDocumentPager);
+
+  pager->fd = fd;
+  pager->length = st.st_size;
+  pager->block = g_malloc(MAX_UNICHAR_LEN + READ_BLOCK_SIZE);
+  pager->valid = TRUE;
+
+  pager->checkpoints = g_array_new(FALSE, FALSE, sizeof(gsize));
+  g_array_append_val(pager->checkpoints, zero);
+
+  return pager;
+}
+
+void pluma_document_pager_free(PlumaDocumentPager *pager) {
+  if (pager == NULL) return;
+
+  close(pager->fd);
+
+  g_array_free(pager->checkpoints, TRUE);
+  g_free(pager->block);
+
+  g_slice_free(PlumaDocumentPager, pager);
+}
+
+/* Reads up to len bytes at offset, fewer if the file became shorter */
+static gsize read_at(PlumaDocumentPager *pager, gchar *buf, gsize len,
+                     gsize offset) {
+  gsize done = 0;
+
+  while (done < len) {
+    gssize n;
+
+    n = pread(pager->fd, buf + done, len - done, offset + done);
+
+    if (n == -1 && errno == EINTR) continue;
+    if (n <= 0) break;
+
+    done += n;
+  }
+
+  return done;
+}
+
+/* Checks the UTF-8 of block, a character cut at its end is carried over to
+ * the next one */
+static gboolean validate_block(PlumaDocumentPager *pager, gsize len,
+                               gboolean at_end) {
+  const gchar *end;
+  gsize remainder;
+
+  if (pluma_utf8_validate(pager->block, len, &end)) {
+    pager->carry_len = 0;
+    return TRUE;
+  }
+
+  remainder = len - (end - pager->block);
+
+  if (at_end || remainder >= MAX_UNICHAR_LEN ||
+      g_utf8_get_char_validated(end, remainder) != (gunichar)-2)
+    return FALSE;
+
+  memmove(pager->block, end, remainder);
+  pager->carry_len = remainder;
+
+  return TRUE;
+}
+
+static void index_lines(PlumaDocumentPager *pager, const gchar *start,
+                        const gchar *end, gsize offset) {
+  const gchar *p = start;
+
+  while (p < end && (p = memchr(p, '\n', end - p)) != NULL) {
+    p++;
+    pager->lines++;
+
+    if (++pager->lines_since_checkpoint == LINES_PER_CHECKPOINT &&
+        offset + (p - start) < pager->length) {
+      gsize checkpoint = offset + (p - start);
+
+      g_array_append_val(pager->checkpoints, checkpoint);
+      pager->lines_since_checkpoint = 0;
+    }
+  }
+}
+
+gboolean pluma_document_pager_index(PlumaDocumentPager *pager,
+                                    gsize max_bytes) {
+  gsize stop;
+
+  g_return_val_if_fail(pager != NULL, TRUE);
+
+  if (!pager->valid) return TRUE;
+
+  stop = MIN(pager->length, pager->indexed + max_bytes);
+
+  while (pager->indexed < stop) {
+    gchar *data = pager->block + pager->carry_len;
+    gsize n;
+
+    n = read_at(pager, data, MIN(stop - pager->indexed, READ_BLOCK_SIZE),
+                pager->indexed);
+
+    /* the file became shorter, what is left of it is shown */
+    if (n == 0) {
+      pager->length = pager->indexed;
+      break;
+    }
+
+    index_lines(pager, data, data + n, pager->indexed);
+    pager->indexed += n;
+
+    if (!validate_block(pager, pager->carry_len + n,
+                        pager->indexed == pager->length)) {
+      pager->valid = FALSE;
+      return TRUE;
+    }
+  }
+
+  if (pager->indexed == pager->length && pager->carry_len > 0)
+    pager->valid = FALSE;
+
+  return pager->indexed == pager->length;
+}
+
+gboolean pluma_document_pager_is_valid(PlumaDocumentPager *pager) {
+  g_return_val_if_fail(pager != NULL, FALSE);
+
+  return pager->valid;
+}
+
+gsize pluma_document_pager_get_indexed(PlumaDocumentPager *pager) {
+  g_return_val_if_fail(pager != NULL, 0);
+
+  return pager->indexed;
+}
+
+gsize pluma_document_pager_get_length(PlumaDocumentPager *pager) {
+  g_return_val_if_fail(pager != NULL, 0);
+
+  return pager->length;
+}
+
+gint pluma_document_pager_get_line_count(PlumaDocumentPager *pager) {
+  gchar last = '\0';
+
+  g_return_val_if_fail(pager != NULL, 0);
+  g_return_val_if_fail(pager->indexed == pager->length, 0);
+
+  /* the last line terminator is not shown, as when loading */
+  if (pager->length > 0 &&
+      read_at(pager, &last, 1, pager->length - 1) == 1 && last == '\n')
+    return pager->lines;
+
+  return pager->lines + 1;
+}
+
+static gsize checkpoint_offset(PlumaDocumentPager *pager, guint i) {
+  if (i >= pager->checkpoints->len) return pager->length;
+
+  return g_array_index(pager->checkpoints, gsize, i);
+}
+
+/* Makes the window start at checkpoint first and grows it while it stays
+ * under WINDOW_MAX_BYTES */
+static void set_window(PlumaDocumentPager *pager, guint first) {
+  guint last = first + 1;
+  gsize start = checkpoint_offset(pager, first);
+
+  while (last < pager->checkpoints->len &&
+         checkpoint_offset(pager, last + 1) - start <= WINDOW_MAX_BYTES) {
+    last++;
+  }
+
+  pager->first = first;
+  pager->last = last;
+}
+
+static gchar *get_window_text(PlumaDocumentPager *pager) {
+  gsize start;
+  gsize size;
+  gsize len;
+  gboolean cut = FALSE;
+  gchar *buf;
+  gchar *text;
+
+  start = checkpoint_offset(pager, pager->first);
+  size = checkpoint_offset(pager, pager->last) - start;
+
+  /* a single checkpoint can be arbitrarily long: only show its beginning,
+   * the byte after it tells whether a character is cut */
+  if (size > WINDOW_MAX_BYTES) {
+    size = WINDOW_MAX_BYTES + 1;
+    cut = TRUE;
+  }
+
+  buf = g_malloc(size);
+  len = read_at(pager, buf, size, start);
+
+  if (cut && len > WINDOW_MAX_BYTES) {
+    len = WINDOW_MAX_BYTES;
+    while (len > 0 && (buf[len] & 0xc0) == 0x80) len--;
+  }
+
+  if (len > 0 && buf[len - 1] == '\n') len--;
+  if (len > 0 && buf[len - 1] == '\r') len--;
+
+  /* the file may have changed since it was indexed */
+  text = g_utf8_make_valid(buf, len);
+  g_free(buf);
+
+  return text;
+}
+
+gchar *pluma_document_pager_get_window(PlumaDocumentPager *pager, gint line) {
+  guint checkpoint;
+
+  g_return_val_if_fail(pager != NULL, NULL);
+  g_return_val_if_fail(line >= 0, NULL);
+
+  checkpoint = MIN((guint)line / LINES_PER_CHECKPOINT,
+                   pager->checkpoints->len - 1);
+
+  /* keep some context above the line */
+  set_window(pager, checkpoint > 0 ? checkpoint - 1 : 0);
+
+  if (pager->last <= checkpoint) set_window(pager, checkpoint);
+
+  return get_window_text(pager);
+}
+
+gchar *pluma_document_pager_move_window(PlumaDocumentPager *pager,
+                                        gint direction) {
+  guint step;
+
+  g_return_val_if_fail(pager != NULL, NULL);
+
+  step = MAX(1, (pager->last - pager->first) / 2);
+
+  if (direction > 0) {
+    if (pager->last >= pager->checkpoints->len) return NULL;
+
+    set_window(pager, pager->first + step);
+  } else {
+    if (pager->first == 0) return NULL;
+
+    set_window(pager, pager->first > step ? pager->first - step : 0);
+  }
+
+  return get_window_text(pager);
+}
+
+gint pluma_document_pager_get_first_line(PlumaDocumentPager *pager) {
+  g_return_val_if_fail(pager != NULL, 0);
+
+  return pager->first * LINES_PER_CHECKPOINT;
+}
@@ -0,0 +1,69 @@
+/*
+ * pluma-document-pager.h
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __PLUMA_DOCUMENT_PAGER_H__
+#define __PLUMA_DOCUMENT_PAGER_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Keeps a big file open and hands out the part of it, the window, which
+ * is shown in the document. Lines are counted on '\n'. */
+typedef struct _PlumaDocumentPager PlumaDocumentPager;
+
+PlumaDocumentPager *pluma_document_pager_new(const gchar *path,
+                                             GError **error);
+void pluma_document_pager_free(PlumaDocumentPager *pager);
+
+/* Scans up to max_bytes more of the file for line starts and checks that it
+   is UTF-8, returns TRUE once the whole file has been scanned or it turned
+   out not to be UTF-8 */
+gboolean pluma_document_pager_index(PlumaDocumentPager *pager,
+                                    gsize max_bytes);
+
+/* FALSE if the part of the file scanned so far is not UTF-8 */
+gboolean pluma_document_pager_is_valid(PlumaDocumentPager *pager);
+
+gsize pluma_document_pager_get_indexed(PlumaDocumentPager *pager);
+
+gsize pluma_document_pager_get_length(PlumaDocumentPager *pager);
+
+/* The file must be fully indexed */
+gint pluma_document_pager_get_line_count(PlumaDocumentPager *pager);
+
+/* Moves the window so that it contains line and returns its text, without
+   the last line terminator. Invalid UTF-8 is replaced. */
+gchar *pluma_document_pager_get_window(PlumaDocumentPager *pager, gint line);
+
+/* Moves the window by about half its size, direction is 1 to move towards
+   the end of the file and -1 towards the start. Returns NULL when the
+   window cannot move. */
+gchar *pluma_document_pager_move_window(PlumaDocumentPager *pager,
+                                        gint direction);
+
+/* The line of the file shown at the top of the window */
+gint pluma_document_pager_get_first_line(PlumaDocumentPager *pager);
+
+G_END_DECLS
+
+#endif /* __PLUMA_DOCUMENT_PAGER_H__ */
@@ -32,19 +32,30 @@
 #include <config.h>
 #endif
 
+#include <errno.h>
+#include <fcntl.h>
 #include <gio/gio.h>
 #include <glib.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
 
 #include "pluma-debug.h"
 #include "pluma-document-input-stream.h"
 #include "pluma-document-saver.h"
+#include "pluma-document-snapshot.h"
 #include "pluma-enum-types.h"
 #include "pluma-settings.h"
+#include "pluma-single-byte-converter.h"
 #include "pluma-utils.h"
 
-#define WRITE_CHUNK_SIZE 8192
 
 /* Signals */
 
@@ -63,21 +74,53 @@ enum {
   PROP_FLAGS
 };
 
+/* blocks serialized ahead of the one being written, so that the next
+ * block is ready as soon as a write completes */
+#define WRITE_QUEUE_LENGTH 4
+
 typedef struct {
   PlumaDocumentSaver *saver;
-  gchar buffer[WRITE_CHUNK_SIZE];
   GCancellable *cancellable;
   gboolean tried_mount;
+
+  /* ring of blocks, n_ready of them are filled starting from head, which
+   * is being written */
+  gchar *buffers[WRITE_QUEUE_LENGTH];
+  gsize lengths[WRITE_QUEUE_LENGTH];
+  goffset offsets[WRITE_QUEUE_LENGTH];
+  gsize buffer_size;
+  guint head;
+  guint n_ready;
   gssize written;
-  gssize read;
+
+  gboolean read_done;
+  GError *read_error;
+
   GError *error;
 } AsyncData;
 
+/* smaller files are always replaced as a whole */
+#define INCREMENTAL_SAVE_MIN_SIZE (16 * 1024 * 1024)
+
 #define REMOTE_QUERY_ATTRIBUTES          \
   G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE \
       "," G_FILE_ATTRIBUTE_TIME_MODIFIED \
       "," G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC
 
+/* How the backup of the old file is made */
+typedef enum {
+  BACKUP_NONE,
+  /* the file is cloned, the copy shares its blocks until they change */
+  BACKUP_CLONE,
+  /* GIO writes a new file which replaces the old one, the old one is kept
+   * as the backup */
+  BACKUP_RENAME,
+  /* GIO copies the old file before writing over it */
+  BACKUP_COPY
+} BackupMode;
+
+static const gchar *backup_mode_names[] = {"none", "clone", "rename", "copy"};
+
 static void check_modified_async(AsyncData *async);
 
 struct _PlumaDocumentSaverPrivate {
@@ -94,9 +137,17 @@ struct _PlumaDocumentSaverPrivate {
   PlumaDocumentSaveFlags flags;
 
   gboolean keep_backup;
+  BackupMode backup_mode;
+  gint64 backup_start;
 
   gint64 old_mtime;
 
+  /* the file as it is before saving, from the modification check */
+  goffset old_size;
+  gboolean old_file_is_regular;
+  guint32 old_nlink;
+  guint32 old_uid;
+
   goffset size;
   goffset bytes_written;
 
@@ -104,6 +155,19 @@ struct _PlumaDocumentSaverPrivate {
   GCancellable *cancellable;
   GOutputStream *stream;
   GInputStream *input;
+  gboolean normalize_newlines;
+
+  /* Incremental saves: the file, or its temporary copy, is rewritten from
+   * write_offset */
+  GFileIOStream *iostream;
+  GFile *temp_file;
+  goffset write_offset;
+
+  /* Whole saves: a snapshot of the document is written by a thread, which
+   * reports its progress one block at a time */
+  PlumaDocumentSnapshot *snapshot;
+  gboolean writing_snapshot;
+  gint progress_pending;
 
   GError *error;
 };
@@ -199,6 +263,17 @@ static void pluma_document_saver_dispose(GObject *object) {
     priv->stream = NULL;
   }
 
+  g_clear_object(&priv->iostream);
+  g_clear_object(&priv->temp_file);
+
+  if (priv->snapshot != NULL) {
+    pluma_document_snapshot_close(priv->snapshot);
+    pluma_document_snapshot_unref(priv->snapshot);
+    priv->snapshot = NULL;
+  }
+
+  g_clear_object(&priv->input);
+
   if (priv->info != NULL) {
     g_object_unref(priv->info);
     priv->info = NULL;
@@ -216,9 +291,15 @@ static AsyncData *async_data_new(PlumaDocumentSaver *gvsaver) {
   async->saver = gvsaver;
   async->cancellable = g_object_ref(gvsaver->priv->cancellable);
 
+  memset(async->buffers, 0, sizeof(async->buffers));
+  async->buffer_size = 0;
   async->tried_mount = FALSE;
+  async->head = 0;
+  async->n_ready = 0;
   async->written = 0;
-  async->read = 0;
+
+  async->read_done = FALSE;
+  async->read_error = NULL;
 
   async->error = NULL;
 
@@ -226,8 +307,16 @@ static AsyncData *async_data_new(PlumaDocumentSaver *gvsaver) {
 }
 
 static void async_data_free(AsyncData *async) {
+  guint i;
+
   g_object_unref(async->cancellable);
 
+  for (i = 0; i < WRITE_QUEUE_LENGTH; i++) {
+    g_free(async->buffers[i]);
+  }
+
+  g_clear_error(&async->read_error);
+
   if (async->error) {
     g_error_free(async->error);
   }
@@ -291,6 +380,7 @@ static void pluma_document_saver_init(PlumaDocumentSaver *saver) {
   saver->priv->cancellable = g_cancellable_new();
   saver->priv->error = NULL;
   saver->priv->used = FALSE;
+  saver->priv->old_size = -1;
   saver->priv->editor_settings = g_settings_new(PLUMA_SCHEMA_ID);
 }
 
@@ -304,6 +394,10 @@ PlumaDocumentSaver *pluma_document_saver_new(
 
 static void remote_save_completed_or_failed(PlumaDocumentSaver *gvsaver,
                                             AsyncData *async) {
+  /* the document is not followed anymore */
+  if (gvsaver->priv->snapshot != NULL)
+    pluma_document_snapshot_close(gvsaver->priv->snapshot);
+
   pluma_document_saver_saving(PLUMA_DOCUMENT_SAVER(gvsaver), TRUE,
                               gvsaver->priv->error);
 
@@ -344,6 +438,11 @@ static void cancel_output_stream_ready_cb(GOutputStream *stream,
 
   g_output_stream_close_finish(stream, result, NULL);
 
+  /* the file itself is left alone */
+  if (async->saver->priv->temp_file != NULL) {
+    g_file_delete(async->saver->priv->temp_file, NULL, NULL);
+  }
+
   /* check cancelled state manually */
   if (g_cancellable_is_cancelled(async->cancellable) || async->error == NULL) {
     async_data_free(async);
@@ -413,6 +512,21 @@ static void remote_get_info_cb(GFile *source, GAsyncResult *res,
   remote_save_completed_or_failed(saver, async);
 }
 
+static void update_newline_counts(PlumaDocumentSaver *saver) {
+  PlumaDocumentInputStream *input;
+  guint counts[3];
+  PlumaDocumentNewlineType type;
+
+  input = PLUMA_DOCUMENT_INPUT_STREAM(saver->priv->input);
+
+  for (type = PLUMA_DOCUMENT_NEWLINE_TYPE_LF;
+       type <= PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF; type++) {
+    counts[type] = pluma_document_input_stream_get_newline_count(input, type);
+  }
+
+  _pluma_document_set_newline_counts(saver->priv->document, counts);
+}
+
 static void close_async_ready_get_info_cb(GOutputStream *stream,
                                           GAsyncResult *res, AsyncData *async) {
   GError *error = NULL;
@@ -435,6 +549,28 @@ static void close_async_ready_get_info_cb(GOutputStream *stream,
     return;
   }
 
+  /* the copy replaces the file */
+  if (async->saver->priv->temp_file != NULL &&
+      !g_file_move(async->saver->priv->temp_file, async->saver->priv->gfile,
+                   G_FILE_COPY_OVERWRITE, NULL, NULL, NULL, &error)) {
+    pluma_debug_message(DEBUG_SAVER, "Moving the copy failed: %s",
+                        error->message);
+
+    g_file_delete(async->saver->priv->temp_file, NULL, NULL);
+    async_failed(async, error);
+    return;
+  }
+
+  /* the line terminators which are now in the file */
+  update_newline_counts(async->saver);
+
+  /* the changes made since the snapshot are not in the file */
+  _pluma_document_set_file_in_sync(
+      async->saver->priv->document,
+      async->saver->priv->encoding == pluma_encoding_get_utf8() &&
+          !pluma_document_saver_get_document_changed(async->saver),
+      async->saver->priv->normalize_newlines);
+
   /* get the file info: note we cannot use
    * g_file_output_stream_query_info_async since it is not able to get the
    * content type etc, beside it is not supported by gvfs.
@@ -461,6 +597,17 @@ static void write_complete(AsyncData *async) {
     return;
   }
 
+  /* the rewritten end of the file can be shorter */
+  if (async->saver->priv->iostream != NULL) {
+    GSeekable *seekable = G_SEEKABLE(async->saver->priv->iostream);
+
+    if (!g_seekable_truncate(seekable, g_seekable_tell(seekable),
+                             async->cancellable, &error)) {
+      cancel_output_stream_and_fail(async, error);
+      return;
+    }
+  }
+
   /* now we close the output stream */
   pluma_debug_message(DEBUG_SAVER, "Close output stream");
   g_output_stream_close_async(
@@ -469,7 +616,7 @@ static void write_complete(AsyncData *async) {
 }
 
 /* prototype, because they call each other... isn't C lovely */
-static void read_file_chunk(AsyncData *async);
+static void write_next_chunk(AsyncData *async);
 static void write_file_chunk(AsyncData *async);
 
 static void async_write_cb(GOutputStream *stream, GAsyncResult *res,
@@ -500,17 +647,24 @@ static void async_write_cb(GOutputStream *stream, GAsyncResult *res,
   async->written += bytes_written;
 
   /* write again */
-  if (async->written != async->read) {
+  if (async->written != async->lengths[async->head]) {
     write_file_chunk(async);
     return;
   }
 
+  /* the chars of the block are now in the file */
+  saver->priv->bytes_written = async->offsets[async->head];
+
+  async->head = (async->head + 1) % WRITE_QUEUE_LENGTH;
+  async->n_ready--;
+  async->written = 0;
+
   /* note that this signal blocks the write... check if it isn't
    * a performance problem
    */
   pluma_document_saver_saving(saver, FALSE, NULL);
 
-  read_file_chunk(async);
+  write_next_chunk(async);
 }
 
 static void write_file_chunk(AsyncData *async) {
@@ -521,49 +675,223 @@ static void write_file_chunk(AsyncData *async) {
   saver = async->saver;
 
   g_output_stream_write_async(
-      G_OUTPUT_STREAM(saver->priv->stream), async->buffer + async->written,
-      async->read - async->written, G_PRIORITY_HIGH, async->cancellable,
-      (GAsyncReadyCallback)async_write_cb, async);
+      G_OUTPUT_STREAM(saver->priv->stream),
+      async->buffers[async->head] + async->written,
+      async->lengths[async->head] - async->written, G_PRIORITY_HIGH,
+      async->cancellable, (GAsyncReadyCallback)async_write_cb, async);
 }
 
-static void read_file_chunk(AsyncData *async) {
+/* Serializes the next block of the document at the tail of the queue,
+ * returns FALSE when there is nothing more to read */
+static gboolean read_file_chunk(AsyncData *async) {
   PlumaDocumentSaver *saver;
   PlumaDocumentInputStream *dstream;
-  GError *error = NULL;
+  guint tail;
+  gssize read;
 
   pluma_debug(DEBUG_SAVER);
 
+  if (async->read_done) return FALSE;
+
   saver = async->saver;
-  async->written = 0;
+  tail = (async->head + async->n_ready) % WRITE_QUEUE_LENGTH;
+
+  if (async->buffers[tail] == NULL) {
+    async->buffers[tail] = g_malloc(async->buffer_size);
+  }
 
   /* we use sync methods on doc stream since it is in memory. Using async
      would be racy and we can endup with invalidated iters */
-  async->read =
-      g_input_stream_read(saver->priv->input, async->buffer, WRITE_CHUNK_SIZE,
-                          async->cancellable, &error);
+  read = g_input_stream_read(saver->priv->input, async->buffers[tail],
+                             async->buffer_size, async->cancellable,
+                             &async->read_error);
 
-  if (error != NULL) {
+  if (read <= 0) {
+    async->read_done = TRUE;
+    return FALSE;
+  }
+
+  /* Get how many chars have been read */
+  dstream = PLUMA_DOCUMENT_INPUT_STREAM(saver->priv->input);
+
+  async->lengths[tail] = read;
+  async->offsets[tail] = pluma_document_input_stream_tell(dstream);
+  async->n_ready++;
+
+  return TRUE;
+}
+
+static void write_next_chunk(AsyncData *async) {
+  /* the queue is only empty when the writes caught up with the reads */
+  if (async->n_ready == 0) read_file_chunk(async);
+
+  if (async->read_error != NULL) {
+    GError *error = async->read_error;
+
+    async->read_error = NULL;
     cancel_output_stream_and_fail(async, error);
     return;
   }
 
   /* Check if we finished reading and writing */
-  if (async->read == 0) {
+  if (async->n_ready == 0) {
     write_complete(async);
     return;
   }
 
-  /* Get how many chars have been read */
+  write_file_chunk(async);
+
+  /* fill the queue while the block is being written */
+  while (async->n_ready < WRITE_QUEUE_LENGTH && read_file_chunk(async)) {
+  }
+}
+
+typedef struct {
+  PlumaDocumentSaver *saver;
+  goffset offset;
+} SnapshotProgress;
+
+static gboolean snapshot_progress(SnapshotProgress *progress) {
+  PlumaDocumentSaver *saver = progress->saver;
+
+  g_atomic_int_set(&saver->priv->progress_pending, FALSE);
+
+  /* the write may have completed meanwhile */
+  if (saver->priv->writing_snapshot) {
+    saver->priv->bytes_written = progress->offset;
+    pluma_document_saver_saving(saver, FALSE, NULL);
+  }
+
+  return FALSE;
+}
+
+static void snapshot_progress_free(SnapshotProgress *progress) {
+  g_object_unref(progress->saver);
+  g_slice_free(SnapshotProgress, progress);
+}
+
+/* Runs in the write thread, the main thread gets one report at a time */
+static void report_snapshot_progress(GTask *task, PlumaDocumentSaver *saver,
+                                     goffset offset) {
+  SnapshotProgress *progress;
+
+  if (!g_atomic_int_compare_and_exchange(&saver->priv->progress_pending, FALSE,
+                                         TRUE))
+    return;
+
+  progress = g_slice_new(SnapshotProgress);
+  progress->saver = g_object_ref(saver);
+  progress->offset = offset;
+
+  g_main_context_invoke_full(g_task_get_context(task), G_PRIORITY_DEFAULT,
+                             (GSourceFunc)snapshot_progress, progress,
+                             (GDestroyNotify)snapshot_progress_free);
+}
+
+/* Runs in a worker thread: serializes the snapshot, converts it and writes
+ * it with sync calls, the main thread only copies the text out of the
+ * document and the document can be edited meanwhile */
+static void write_snapshot_thread(GTask *task, gpointer source_object,
+                                  gpointer task_data,
+                                  GCancellable *cancellable) {
+  PlumaDocumentSaver *saver = source_object;
+  AsyncData *async = task_data;
+  PlumaDocumentInputStream *dstream;
+  gchar *buffer;
+  gssize read;
+  GError *error = NULL;
+
   dstream = PLUMA_DOCUMENT_INPUT_STREAM(saver->priv->input);
-  saver->priv->bytes_written = pluma_document_input_stream_tell(dstream);
+  buffer = g_malloc(async->buffer_size);
 
-  write_file_chunk(async);
+  while ((read = g_input_stream_read(saver->priv->input, buffer,
+                                     async->buffer_size, cancellable,
+                                     &error)) > 0) {
+    if (!g_output_stream_write_all(saver->priv->stream, buffer, read, NULL,
+                                   cancellable, &error))
+      break;
+
+    report_snapshot_progress(task, saver,
+                             pluma_document_input_stream_tell(dstream));
+  }
+
+  g_free(buffer);
+
+  if (error != NULL) {
+    g_task_return_error(task, error);
+  } else {
+    g_task_return_boolean(task, TRUE);
+  }
+}
+
+static void snapshot_written_cb(PlumaDocumentSaver *saver, GAsyncResult *res,
+                                AsyncData *async) {
+  GError *error = NULL;
+
+  pluma_debug(DEBUG_SAVER);
+
+  saver->priv->writing_snapshot = FALSE;
+
+  if (!g_task_propagate_boolean(G_TASK(res), &error)) {
+    /* Check cancelled state manually */
+    if (g_cancellable_is_cancelled(async->cancellable)) {
+      g_error_free(error);
+      cancel_output_stream(async);
+      return;
+    }
+
+    pluma_debug_message(DEBUG_SAVER, "Write error: %s", error->message);
+    cancel_output_stream_and_fail(async, error);
+    return;
+  }
+
+  saver->priv->bytes_written = saver->priv->size;
+  pluma_document_saver_saving(saver, FALSE, NULL);
+
+  write_complete(async);
+}
+
+static void write_snapshot(AsyncData *async) {
+  PlumaDocumentSaver *saver = async->saver;
+  GTask *task;
+
+  pluma_debug(DEBUG_SAVER);
+
+  saver->priv->writing_snapshot = TRUE;
+
+  task = g_task_new(saver, async->cancellable,
+                    (GAsyncReadyCallback)snapshot_written_cb, async);
+  g_task_set_task_data(task, async, NULL);
+  g_task_run_in_thread(task, write_snapshot_thread);
+  g_object_unref(task);
+}
+
+/* The whole text is written from a snapshot, so that the document can be
+ * edited while it is saved */
+static void take_snapshot(AsyncData *async) {
+  PlumaDocumentSaver *saver = async->saver;
+
+  g_input_stream_close(saver->priv->input, NULL, NULL);
+  g_object_unref(saver->priv->input);
+
+  saver->priv->snapshot =
+      pluma_document_snapshot_new(GTK_TEXT_BUFFER(saver->priv->document));
+
+  saver->priv->input = pluma_document_input_stream_new_for_snapshot(
+      saver->priv->snapshot, saver->priv->newline_type);
+
+  pluma_document_input_stream_set_normalize_newlines(
+      PLUMA_DOCUMENT_INPUT_STREAM(saver->priv->input),
+      saver->priv->normalize_newlines);
+
+  /* lets the document know that it can be edited */
+  pluma_document_saver_saving(saver, FALSE, NULL);
 }
 
 static void async_replace_ready_callback(GFile *source, GAsyncResult *res,
                                          AsyncData *async) {
   PlumaDocumentSaver *saver;
-  GCharsetConverter *converter;
+  GConverter *converter;
   GFileOutputStream *file_stream;
   GError *error = NULL;
 
@@ -585,15 +913,25 @@ static void async_replace_ready_callback(GFile *source, GAsyncResult *res,
     return;
   }
 
+  /* a copy is made before the file is opened */
+  if (saver->priv->backup_mode == BACKUP_COPY ||
+      saver->priv->backup_mode == BACKUP_RENAME) {
+    pluma_debug_message(
+        DEBUG_SAVER, "Backup by %s, opened in %g s",
+        backup_mode_names[saver->priv->backup_mode],
+        (g_get_monotonic_time() - saver->priv->backup_start) /
+            (gdouble)G_USEC_PER_SEC);
+  }
+
   /* FIXME: manage converter error? */
   pluma_debug_message(DEBUG_SAVER, "Encoding charset: %s",
                       pluma_encoding_get_charset(saver->priv->encoding));
 
   if (saver->priv->encoding != pluma_encoding_get_utf8()) {
-    converter = g_charset_converter_new(
-        pluma_encoding_get_charset(saver->priv->encoding), "UTF-8", NULL);
-    saver->priv->stream = g_converter_output_stream_new(
-        G_OUTPUT_STREAM(file_stream), G_CONVERTER(converter));
+    converter = pluma_single_byte_converter_new_with_fallback(
+        saver->priv->encoding, FALSE, NULL);
+    saver->priv->stream =
+        g_converter_output_stream_new(G_OUTPUT_STREAM(file_stream), converter);
 
     g_object_unref(file_stream);
     g_object_unref(converter);
@@ -601,13 +939,298 @@ static void async_replace_ready_callback(GFile *source, GAsyncResult *res,
     saver->priv->stream = G_OUTPUT_STREAM(file_stream);
   }
 
+  write_snapshot(async);
+}
+
+static void create_input_stream(AsyncData *async) {
+  PlumaDocumentSaver *saver;
+  guint max_block_size;
+
+  saver = async->saver;
+
+  /* starting again */
+  if (saver->priv->input != NULL) {
+    g_input_stream_close(saver->priv->input, NULL, NULL);
+    g_object_unref(saver->priv->input);
+  }
+
   saver->priv->input = pluma_document_input_stream_new(
       GTK_TEXT_BUFFER(saver->priv->document), saver->priv->newline_type);
 
+  saver->priv->normalize_newlines =
+      !pluma_document_has_mixed_newlines(saver->priv->document) ||
+      g_settings_get_boolean(saver->priv->editor_settings,
+                             PLUMA_SETTINGS_NORMALIZE_NEWLINES);
+
+  pluma_document_input_stream_set_normalize_newlines(
+      PLUMA_DOCUMENT_INPUT_STREAM(saver->priv->input),
+      saver->priv->normalize_newlines);
+
   saver->priv->size = pluma_document_input_stream_get_total_size(
       PLUMA_DOCUMENT_INPUT_STREAM(saver->priv->input));
 
-  read_file_chunk(async);
+  /* the size is in characters, close enough to the size of the file */
+  max_block_size = g_settings_get_uint(saver->priv->editor_settings,
+                                       PLUMA_SETTINGS_MAX_IO_BLOCK_SIZE);
+  async->buffer_size = pluma_utils_get_io_block_size(
+      saver->priv->size, (gsize)max_block_size * 1024);
+
+  pluma_debug_message(DEBUG_SAVER, "Block size: %" G_GSIZE_FORMAT,
+                      async->buffer_size);
+}
+
+static void open_readwrite_ready_callback(GFile *source, GAsyncResult *res,
+                                          AsyncData *async) {
+  PlumaDocumentSaver *saver;
+  GError *error = NULL;
+
+  pluma_debug(DEBUG_SAVER);
+
+  /* Check cancelled state manually */
+  if (g_cancellable_is_cancelled(async->cancellable)) {
+    async_data_free(async);
+    return;
+  }
+
+  saver = async->saver;
+  saver->priv->iostream = g_file_open_readwrite_finish(source, res, &error);
+
+  if (saver->priv->iostream == NULL) {
+    pluma_debug_message(DEBUG_SAVER, "Opening file failed: %s", error->message);
+
+    if (saver->priv->temp_file != NULL) {
+      g_file_delete(saver->priv->temp_file, NULL, NULL);
+    }
+
+    async_failed(async, error);
+    return;
+  }
+
+  saver->priv->stream = g_object_ref(
+      g_io_stream_get_output_stream(G_IO_STREAM(saver->priv->iostream)));
+
+  if (!g_seekable_seek(G_SEEKABLE(saver->priv->iostream),
+                       saver->priv->write_offset, G_SEEK_SET,
+                       async->cancellable, &error)) {
+    cancel_output_stream_and_fail(async, error);
+    return;
+  }
+
+  write_next_chunk(async);
+}
+
+static void copy_ready_callback(GFile *source, GAsyncResult *res,
+                                AsyncData *async) {
+  PlumaDocumentSaver *saver;
+  GError *error = NULL;
+
+  pluma_debug(DEBUG_SAVER);
+
+  saver = async->saver;
+
+  if (!g_file_copy_finish(source, res, &error)) {
+    g_file_delete(saver->priv->temp_file, NULL, NULL);
+
+    /* check cancelled state manually */
+    if (g_cancellable_is_cancelled(async->cancellable)) {
+      g_error_free(error);
+      async_data_free(async);
+      return;
+    }
+
+    pluma_debug_message(DEBUG_SAVER, "Copying file failed: %s",
+                        error->message);
+    async_failed(async, error);
+    return;
+  }
+
+  g_file_open_readwrite_async(
+      saver->priv->temp_file, G_PRIORITY_HIGH, async->cancellable,
+      (GAsyncReadyCallback)open_readwrite_ready_callback, async);
+}
+
+static GFile *get_temp_file(GFile *file) {
+  GFile *parent;
+  GFile *temp;
+  gchar *basename;
+  gchar *name;
+
+  parent = g_file_get_parent(file);
+  basename = g_file_get_basename(file);
+  name = g_strdup_printf(".%s.pluma-save-%08x", basename, g_random_int());
+
+  temp = g_file_get_child(parent, name);
+
+  g_free(name);
+  g_free(basename);
+  g_object_unref(parent);
+
+  return temp;
+}
+
+/* Saving a big local file which was loaded or saved with the same encoding
+ * and newline type only rewrites it from the first line which may have
+ * changed: in place when its size stays the same, otherwise in a copy of the
+ * file which then replaces it. Returns FALSE if the whole file has to be
+ * written. */
+static gboolean begin_incremental_write(AsyncData *async) {
+  PlumaDocumentSaver *saver;
+  PlumaDocumentInputStream *dstream;
+  gchar *uri;
+  gboolean same_file;
+  gint offset;
+  goffset new_size;
+
+  saver = async->saver;
+
+  /* a clone is done, the other backups are made by GIO */
+  if ((saver->priv->backup_mode != BACKUP_NONE &&
+       saver->priv->backup_mode != BACKUP_CLONE) ||
+      !saver->priv->old_file_is_regular ||
+      saver->priv->old_size < INCREMENTAL_SAVE_MIN_SIZE ||
+      (saver->priv->flags & PLUMA_DOCUMENT_SAVE_IGNORE_MTIME) != 0 ||
+      saver->priv->encoding != pluma_encoding_get_utf8() ||
+      pluma_document_get_encoding(saver->priv->document) !=
+          pluma_encoding_get_utf8() ||
+      !g_file_is_native(saver->priv->gfile)) {
+    return FALSE;
+  }
+
+  uri = pluma_document_get_uri(saver->priv->document);
+  same_file = g_strcmp0(uri, saver->priv->uri) == 0;
+  g_free(uri);
+
+  if (!same_file) return FALSE;
+
+  offset = _pluma_document_get_unsaved_offset(saver->priv->document,
+                                              saver->priv->normalize_newlines);
+  if (offset <= 0) return FALSE;
+
+  dstream = PLUMA_DOCUMENT_INPUT_STREAM(saver->priv->input);
+  saver->priv->write_offset =
+      pluma_document_input_stream_skip_to(dstream, offset);
+
+  /* not the file we think it is after all */
+  if (saver->priv->write_offset > saver->priv->old_size) {
+    create_input_stream(async);
+    return FALSE;
+  }
+
+  new_size = saver->priv->write_offset +
+             pluma_document_input_stream_get_size_from(dstream, offset);
+
+  pluma_debug_message(DEBUG_SAVER,
+                      "Rewriting from %" G_GINT64_FORMAT
+                      " of %" G_GINT64_FORMAT,
+                      saver->priv->write_offset, new_size);
+
+  if (new_size == saver->priv->old_size) {
+    pluma_debug_message(DEBUG_SAVER, "Calling open_readwrite_async");
+
+    /* the file is changed in place, a failure leaves it half written */
+    _pluma_document_set_file_in_sync(saver->priv->document, FALSE, FALSE);
+
+    g_file_open_readwrite_async(
+        saver->priv->gfile, G_PRIORITY_HIGH, async->cancellable,
+        (GAsyncReadyCallback)open_readwrite_ready_callback, async);
+  } else {
+    pluma_debug_message(DEBUG_SAVER, "Calling copy_async");
+
+    /* a filesystem which supports it clones the file instead */
+    saver->priv->temp_file = get_temp_file(saver->priv->gfile);
+
+    g_file_copy_async(saver->priv->gfile, saver->priv->temp_file,
+                      G_FILE_COPY_OVERWRITE | G_FILE_COPY_ALL_METADATA,
+                      G_PRIORITY_HIGH, async->cancellable, NULL, NULL,
+                      (GAsyncReadyCallback)copy_ready_callback, async);
+  }
+
+  return TRUE;
+}
+
+/* Clones the file into its backup, on the filesystems which can share
+ * blocks between files. Returns FALSE if it cannot be done. */
+static gboolean clone_backup(PlumaDocumentSaver *saver) {
+#ifdef FICLONE
+  gchar *path;
+  gchar *backup_path;
+  gchar *tmp_path;
+  struct stat statbuf;
+  gboolean cloned = FALSE;
+  int src;
+  int dest;
+
+  path = g_file_get_path(saver->priv->gfile);
+  if (path == NULL) return FALSE;
+
+  /* the name GIO gives its backups */
+  backup_path = g_strconcat(path, "~", NULL);
+
+  /* the previous backup is only replaced once the clone worked */
+  tmp_path = g_strconcat(backup_path, ".XXXXXX", NULL);
+
+  src = g_open(path, O_RDONLY, 0);
+
+  if (src != -1 && fstat(src, &statbuf) == 0) {
+    dest = g_mkstemp_full(tmp_path, O_WRONLY, statbuf.st_mode & 0777);
+
+    if (dest != -1) {
+      cloned = ioctl(dest, FICLONE, src) == 0;
+
+      if (!cloned) {
+        pluma_debug_message(DEBUG_SAVER, "Cannot clone the file: %s",
+                            g_strerror(errno));
+      }
+
+      close(dest);
+
+      if (cloned && g_rename(tmp_path, backup_path) != 0) {
+        pluma_debug_message(DEBUG_SAVER, "Cannot rename the clone: %s",
+                            g_strerror(errno));
+        cloned = FALSE;
+      }
+
+      if (!cloned) g_unlink(tmp_path);
+    }
+  }
+
+  if (src != -1) close(src);
+
+  g_free(tmp_path);
+  g_free(backup_path);
+  g_free(path);
+
+  return cloned;
+#else
+  return FALSE;
+#endif
+}
+
+/* Decides how the backup is made, and clones the file when it can */
+static void begin_backup(PlumaDocumentSaver *saver) {
+  saver->priv->backup_start = g_get_monotonic_time();
+
+  /* Do not make backups for remote files so they do not clutter remote
+   * systems, nor of files which do not exist yet */
+  if (!saver->priv->keep_backup ||
+      !pluma_document_is_local(saver->priv->document) ||
+      saver->priv->old_nlink == 0) {
+    saver->priv->backup_mode = BACKUP_NONE;
+  } else if (saver->priv->old_file_is_regular && clone_backup(saver)) {
+    saver->priv->backup_mode = BACKUP_CLONE;
+
+    pluma_debug_message(DEBUG_SAVER, "Backup by clone in %g s",
+                        (g_get_monotonic_time() - saver->priv->backup_start) /
+                            (gdouble)G_USEC_PER_SEC);
+  } else if (saver->priv->old_file_is_regular &&
+             saver->priv->old_nlink == 1 &&
+             saver->priv->old_uid == getuid()) {
+    /* GIO can give a new file the owner of the old one, and there are no
+     * other links to the old one to keep up to date */
+    saver->priv->backup_mode = BACKUP_RENAME;
+  } else {
+    saver->priv->backup_mode = BACKUP_COPY;
+  }
 }
 
 static void begin_write(AsyncData *async) {
@@ -621,15 +1244,21 @@ static void begin_write(AsyncData *async) {
    */
   saver = async->saver;
 
-  /* Do not make backups for remote files so they do not clutter remote systems
-   */
-  backup = (saver->priv->keep_backup &&
-            pluma_document_is_local(saver->priv->document));
+  create_input_stream(async);
+  begin_backup(saver);
+
+  if (begin_incremental_write(async)) return;
+
+  take_snapshot(async);
+
+  backup = saver->priv->backup_mode == BACKUP_RENAME ||
+           saver->priv->backup_mode == BACKUP_COPY;
 
   pluma_debug_message(DEBUG_SAVER, "File contents size: %" G_GINT64_FORMAT,
                       saver->priv->size);
   pluma_debug_message(DEBUG_SAVER, "Calling replace_async");
-  pluma_debug_message(DEBUG_SAVER, backup ? "Keep backup" : "Discard backup");
+  pluma_debug_message(DEBUG_SAVER, "Backup: %s",
+                      backup_mode_names[saver->priv->backup_mode]);
 
   g_file_replace_async(saver->priv->gfile, NULL, backup, G_FILE_CREATE_NONE,
                        G_PRIORITY_HIGH, async->cancellable,
@@ -742,7 +1371,28 @@ static void check_modification_callback(GFile *source, GAsyncResult *res,
     }
   }
 
-  if (info != NULL) g_object_unref(info);
+  if (info != NULL) {
+    if (g_file_info_has_attribute(info, G_FILE_ATTRIBUTE_STANDARD_SIZE))
+      saver->priv->old_size = g_file_info_get_size(info);
+
+    /* unknown, but there is a file */
+    saver->priv->old_nlink = 1;
+
+    if (g_file_info_has_attribute(info, G_FILE_ATTRIBUTE_UNIX_NLINK)) {
+      saver->priv->old_nlink =
+          g_file_info_get_attribute_uint32(info, G_FILE_ATTRIBUTE_UNIX_NLINK);
+      saver->priv->old_uid =
+          g_file_info_get_attribute_uint32(info, G_FILE_ATTRIBUTE_UNIX_UID);
+    }
+
+    saver->priv->old_file_is_regular =
+        g_file_info_has_attribute(info, G_FILE_ATTRIBUTE_STANDARD_TYPE) &&
+        g_file_info_has_attribute(info, G_FILE_ATTRIBUTE_STANDARD_IS_SYMLINK) &&
+        g_file_info_get_file_type(info) == G_FILE_TYPE_REGULAR &&
+        !g_file_info_get_is_symlink(info);
+
+    g_object_unref(info);
+  }
 
   /* modification check passed, start write */
   begin_write(async);
@@ -753,7 +1403,10 @@ static void check_modified_async(AsyncData *async) {
 
   g_file_query_info_async(
       async->saver->priv->gfile,
-      G_FILE_ATTRIBUTE_TIME_MODIFIED "," G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+      G_FILE_ATTRIBUTE_TIME_MODIFIED "," G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC
+      "," G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_STANDARD_TYPE
+      "," G_FILE_ATTRIBUTE_STANDARD_IS_SYMLINK "," G_FILE_ATTRIBUTE_UNIX_NLINK
+      "," G_FILE_ATTRIBUTE_UNIX_UID,
       G_FILE_QUERY_INFO_NONE, G_PRIORITY_HIGH, async->cancellable,
       (GAsyncReadyCallback)check_modification_callback, async);
 }
@@ -852,6 +1505,19 @@ goffset pluma_document_saver_get_bytes_written(PlumaDocumentSaver *saver) {
   return saver->priv->bytes_written;
 }
 
+gboolean pluma_document_saver_is_saving_snapshot(PlumaDocumentSaver *saver) {
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT_SAVER(saver), FALSE);
+
+  return saver->priv->snapshot != NULL;
+}
+
+gboolean pluma_document_saver_get_document_changed(PlumaDocumentSaver *saver) {
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT_SAVER(saver), FALSE);
+
+  return saver->priv->snapshot != NULL &&
+         pluma_document_snapshot_get_buffer_changed(saver->priv->snapshot);
+}
+
 GFileInfo *pluma_document_saver_get_info(PlumaDocumentSaver *saver) {
   g_return_val_if_fail(PLUMA_IS_DOCUMENT_SAVER(saver), NULL);
 
@@ -113,6 +113,14 @@ goffset pluma_document_saver_get_file_size(PlumaDocumentSaver *saver);
 
 goffset pluma_document_saver_get_bytes_written(PlumaDocumentSaver *saver);
 
+/* Whether the text is written from a snapshot, the document can then be
+   edited while it is saved */
+gboolean pluma_document_saver_is_saving_snapshot(PlumaDocumentSaver *saver);
+
+/* Whether the document was changed after its snapshot was taken, the file
+   does not hold its text then */
+gboolean pluma_document_saver_get_document_changed(PlumaDocumentSaver *saver);
+
 GFileInfo *pluma_document_saver_get_info(PlumaDocumentSaver *saver);
 
 G_END_DECLS
@@ -0,0 +1,459 @@
+/*
+ * pluma-document-snapshot.c
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "pluma-document-snapshot.h"
+
+#include <string.h>
+
+/* characters copied out of the buffer at once */
+#define SNAPSHOT_BLOCK_SIZE (256 * 1024)
+
+/* blocks copied ahead of the reading thread */
+#define SNAPSHOT_QUEUE_LENGTH 4
+
+/* A part of the text, either copied out of the buffer or still in it
+ * between two marks. The start mark has right gravity and the end mark
+ * left gravity, so the text inserted at either end is left out. */
+typedef struct {
+  gchar *text;
+  gint n_chars;
+  GtkTextMark *start;
+  GtkTextMark *end;
+} SnapshotPiece;
+
+typedef struct {
+  /* NULL for the last block */
+  gchar *text;
+  gint n_chars;
+  /* pushed when the snapshot is closed before its end */
+  gboolean closed;
+} SnapshotBlock;
+
+struct _PlumaDocumentSnapshot {
+  gint ref_count;
+  GMainContext *context;
+  GThread *thread;
+  gint n_chars;
+
+  /* the text in order, for the reading thread */
+  GAsyncQueue *blocks;
+
+  /* only accessed by the reading thread */
+  gboolean read_all;
+
+  /* only accessed by the main thread, buffer is NULL once closed */
+  GtkTextBuffer *buffer;
+  GQueue *pieces;
+  guint fill_id;
+  gboolean carry_cr;
+  gboolean done;
+  gboolean buffer_changed;
+};
+
+static SnapshotPiece *gap_new(PlumaDocumentSnapshot *snapshot,
+                              const GtkTextIter *start,
+                              const GtkTextIter *end) {
+  SnapshotPiece *piece;
+
+  piece = g_slice_new0(SnapshotPiece);
+  piece->start =
+      gtk_text_buffer_create_mark(snapshot->buffer, NULL, start, FALSE);
+  piece->end = gtk_text_buffer_create_mark(snapshot->buffer, NULL, end, TRUE);
+
+  return piece;
+}
+
+static void piece_free(PlumaDocumentSnapshot *snapshot, SnapshotPiece *piece) {
+  if (piece->start != NULL) {
+    gtk_text_buffer_delete_mark(snapshot->buffer, piece->start);
+    gtk_text_buffer_delete_mark(snapshot->buffer, piece->end);
+  }
+
+  g_free(piece->text);
+  g_slice_free(SnapshotPiece, piece);
+}
+
+/* Returns FALSE if the gap is empty. The marks cross when text is inserted
+ * in an empty gap. */
+static gboolean get_gap_bounds(PlumaDocumentSnapshot *snapshot,
+                               SnapshotPiece *piece, GtkTextIter *start,
+                               GtkTextIter *end) {
+  gtk_text_buffer_get_iter_at_mark(snapshot->buffer, start, piece->start);
+  gtk_text_buffer_get_iter_at_mark(snapshot->buffer, end, piece->end);
+
+  return gtk_text_iter_compare(start, end) < 0;
+}
+
+/* Splits the gap of link at iter, returns the link of the second part */
+static GList *split_gap(PlumaDocumentSnapshot *snapshot, GList *link,
+                        const GtkTextIter *iter) {
+  SnapshotPiece *piece = link->data;
+  SnapshotPiece *second;
+
+  second = g_slice_new0(SnapshotPiece);
+  second->start =
+      gtk_text_buffer_create_mark(snapshot->buffer, NULL, iter, FALSE);
+  second->end = piece->end;
+
+  piece->end = gtk_text_buffer_create_mark(snapshot->buffer, NULL, iter, TRUE);
+
+  g_queue_insert_after(snapshot->pieces, link, second);
+
+  return link->next;
+}
+
+static void insert_text_cb(GtkTextBuffer *buffer, GtkTextIter *pos,
+                           const gchar *text, gint length,
+                           PlumaDocumentSnapshot *snapshot) {
+  GList *l;
+
+  snapshot->buffer_changed = TRUE;
+
+  for (l = snapshot->pieces->head; l != NULL; l = l->next) {
+    SnapshotPiece *piece = l->data;
+    GtkTextIter start;
+    GtkTextIter end;
+
+    if (piece->text != NULL || !get_gap_bounds(snapshot, piece, &start, &end))
+      continue;
+
+    /* the gaps are in order */
+    if (gtk_text_iter_compare(pos, &start) <= 0) break;
+
+    if (gtk_text_iter_compare(pos, &end) < 0) {
+      split_gap(snapshot, l, pos);
+      break;
+    }
+  }
+}
+
+/* The part of the gaps which is deleted is copied first */
+static void delete_range_cb(GtkTextBuffer *buffer, GtkTextIter *start,
+                            GtkTextIter *end, PlumaDocumentSnapshot *snapshot) {
+  GtkTextIter del_start = *start;
+  GtkTextIter del_end = *end;
+  GList *l;
+
+  snapshot->buffer_changed = TRUE;
+
+  gtk_text_iter_order(&del_start, &del_end);
+
+  for (l = snapshot->pieces->head; l != NULL; l = l->next) {
+    SnapshotPiece *piece = l->data;
+    GtkTextIter gap_start;
+    GtkTextIter gap_end;
+
+    if (piece->text != NULL ||
+        !get_gap_bounds(snapshot, piece, &gap_start, &gap_end))
+      continue;
+
+    if (gtk_text_iter_compare(&gap_start, &del_end) >= 0) break;
+
+    if (gtk_text_iter_compare(&gap_end, &del_start) <= 0) continue;
+
+    if (gtk_text_iter_compare(&gap_start, &del_start) < 0) {
+      l = split_gap(snapshot, l, &del_start);
+      piece = l->data;
+    }
+
+    if (gtk_text_iter_compare(&del_end, &gap_end) < 0)
+      split_gap(snapshot, l, &del_end);
+
+    get_gap_bounds(snapshot, piece, &gap_start, &gap_end);
+
+    piece->text = gtk_text_iter_get_slice(&gap_start, &gap_end);
+    piece->n_chars = gtk_text_iter_get_offset(&gap_end) -
+                     gtk_text_iter_get_offset(&gap_start);
+
+    gtk_text_buffer_delete_mark(snapshot->buffer, piece->start);
+    gtk_text_buffer_delete_mark(snapshot->buffer, piece->end);
+    piece->start = NULL;
+    piece->end = NULL;
+  }
+}
+
+static void push_block(PlumaDocumentSnapshot *snapshot, gchar *text,
+                       gint n_chars, gboolean closed) {
+  SnapshotBlock *block;
+
+  block = g_slice_new(SnapshotBlock);
+  block->text = text;
+  block->n_chars = n_chars;
+  block->closed = closed;
+
+  g_async_queue_push(snapshot->blocks, block);
+}
+
+static void block_free(SnapshotBlock *block) {
+  g_free(block->text);
+  g_slice_free(SnapshotBlock, block);
+}
+
+/* A \r\n terminator is never split between two blocks */
+static void push_text(PlumaDocumentSnapshot *snapshot, gchar *text,
+                      gint n_chars) {
+  gsize len;
+
+  if (snapshot->carry_cr) {
+    gchar *tmp;
+
+    tmp = g_strconcat("\r", text, NULL);
+    g_free(text);
+    text = tmp;
+    n_chars++;
+
+    snapshot->carry_cr = FALSE;
+  }
+
+  len = strlen(text);
+
+  if (len > 0 && text[len - 1] == '\r') {
+    text[len - 1] = '\0';
+    n_chars--;
+
+    snapshot->carry_cr = TRUE;
+  }
+
+  if (n_chars > 0) {
+    push_block(snapshot, text, n_chars, FALSE);
+  } else {
+    g_free(text);
+  }
+}
+
+/* Copies the next block of text, or pushes the last block at the end */
+static void push_next_block(PlumaDocumentSnapshot *snapshot) {
+  SnapshotPiece *piece;
+
+  while ((piece = g_queue_peek_head(snapshot->pieces)) != NULL) {
+    GtkTextIter start;
+    GtkTextIter end;
+    GtkTextIter stop;
+
+    if (piece->text != NULL) {
+      push_text(snapshot, piece->text, piece->n_chars);
+      piece->text = NULL;
+
+      piece_free(snapshot, g_queue_pop_head(snapshot->pieces));
+      return;
+    }
+
+    if (get_gap_bounds(snapshot, piece, &start, &end)) {
+      stop = start;
+      gtk_text_iter_forward_chars(&stop, SNAPSHOT_BLOCK_SIZE);
+      if (gtk_text_iter_compare(&stop, &end) > 0) stop = end;
+
+      push_text(
+          snapshot, gtk_text_iter_get_slice(&start, &stop),
+          gtk_text_iter_get_offset(&stop) - gtk_text_iter_get_offset(&start));
+
+      gtk_text_buffer_move_mark(snapshot->buffer, piece->start, &stop);
+      return;
+    }
+
+    piece_free(snapshot, g_queue_pop_head(snapshot->pieces));
+  }
+
+  if (snapshot->carry_cr) push_block(snapshot, g_strdup("\r"), 1, FALSE);
+
+  push_block(snapshot, NULL, 0, FALSE);
+  snapshot->done = TRUE;
+}
+
+/* Runs in the main thread, one block per call so that the view keeps
+ * redrawing while the text is copied */
+static gboolean fill_blocks(PlumaDocumentSnapshot *snapshot) {
+  if (snapshot->done ||
+      g_async_queue_length(snapshot->blocks) >= SNAPSHOT_QUEUE_LENGTH) {
+    snapshot->fill_id = 0;
+    return FALSE;
+  }
+
+  push_next_block(snapshot);
+
+  return TRUE;
+}
+
+static gboolean schedule_fill(PlumaDocumentSnapshot *snapshot) {
+  if (snapshot->fill_id == 0 && !snapshot->done) {
+    snapshot->fill_id = g_idle_add_full(
+        G_PRIORITY_DEFAULT_IDLE, (GSourceFunc)fill_blocks,
+        pluma_document_snapshot_ref(snapshot),
+        (GDestroyNotify)pluma_document_snapshot_unref);
+  }
+
+  return FALSE;
+}
+
+PlumaDocumentSnapshot *pluma_document_snapshot_new(GtkTextBuffer *buffer) {
+  PlumaDocumentSnapshot *snapshot;
+  GtkTextIter start;
+  GtkTextIter end;
+
+  g_return_val_if_fail(GTK_IS_TEXT_BUFFER(buffer), NULL);
+
+  snapshot = g_slice_new0(PlumaDocumentSnapshot);
+  snapshot->ref_count = 1;
+  snapshot->context = g_main_context_ref_thread_default();
+  snapshot->thread = g_thread_self();
+  snapshot->blocks = g_async_queue_new();
+  snapshot->buffer = g_object_ref(buffer);
+  snapshot->pieces = g_queue_new();
+  snapshot->n_chars = gtk_text_buffer_get_char_count(buffer);
+
+  gtk_text_buffer_get_bounds(buffer, &start, &end);
+  g_queue_push_tail(snapshot->pieces, gap_new(snapshot, &start, &end));
+
+  g_signal_connect(buffer, "insert-text", G_CALLBACK(insert_text_cb),
+                   snapshot);
+  g_signal_connect(buffer, "delete-range", G_CALLBACK(delete_range_cb),
+                   snapshot);
+
+  schedule_fill(snapshot);
+
+  return snapshot;
+}
+
+PlumaDocumentSnapshot *pluma_document_snapshot_ref(
+    PlumaDocumentSnapshot *snapshot) {
+  g_return_val_if_fail(snapshot != NULL, NULL);
+
+  g_atomic_int_inc(&snapshot->ref_count);
+
+  return snapshot;
+}
+
+void pluma_document_snapshot_unref(PlumaDocumentSnapshot *snapshot) {
+  SnapshotBlock *block;
+
+  g_return_if_fail(snapshot != NULL);
+
+  if (!g_atomic_int_dec_and_test(&snapshot->ref_count)) return;
+
+  /* the buffer would still call back */
+  g_warn_if_fail(snapshot->buffer == NULL);
+
+  while ((block = g_async_queue_try_pop(snapshot->blocks)) != NULL)
+    block_free(block);
+
+  g_async_queue_unref(snapshot->blocks);
+  g_queue_free(snapshot->pieces);
+  g_main_context_unref(snapshot->context);
+
+  g_slice_free(PlumaDocumentSnapshot, snapshot);
+}
+
+void pluma_document_snapshot_close(PlumaDocumentSnapshot *snapshot) {
+  SnapshotPiece *piece;
+
+  g_return_if_fail(snapshot != NULL);
+
+  if (snapshot->buffer == NULL) return;
+
+  g_signal_handlers_disconnect_by_data(snapshot->buffer, snapshot);
+
+  if (snapshot->fill_id != 0) {
+    g_source_remove(snapshot->fill_id);
+    snapshot->fill_id = 0;
+  }
+
+  while ((piece = g_queue_pop_head(snapshot->pieces)) != NULL)
+    piece_free(snapshot, piece);
+
+  /* wakes up the reading thread */
+  if (!snapshot->done) {
+    push_block(snapshot, NULL, 0, TRUE);
+    snapshot->done = TRUE;
+  }
+
+  g_clear_object(&snapshot->buffer);
+}
+
+gboolean pluma_document_snapshot_read(PlumaDocumentSnapshot *snapshot,
+                                      gchar **text, gint *n_chars,
+                                      GCancellable *cancellable,
+                                      GError **error) {
+  SnapshotBlock *block = NULL;
+
+  g_return_val_if_fail(snapshot != NULL, FALSE);
+  g_return_val_if_fail(text != NULL, FALSE);
+
+  *text = NULL;
+  if (n_chars != NULL) *n_chars = 0;
+
+  if (snapshot->read_all) return TRUE;
+
+  /* the main thread would wait for itself */
+  while (g_thread_self() == snapshot->thread && !snapshot->done &&
+         g_async_queue_length(snapshot->blocks) <= 0)
+    push_next_block(snapshot);
+
+  while (block == NULL) {
+    if (g_cancellable_set_error_if_cancelled(cancellable, error)) return FALSE;
+
+    block = g_async_queue_timeout_pop(snapshot->blocks,
+                                      100 * G_TIME_SPAN_MILLISECOND);
+  }
+
+  if (block->closed) {
+    /* for the next reads too */
+    g_async_queue_push_front(snapshot->blocks, block);
+
+    g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_CLOSED,
+                        "The snapshot was closed before its end");
+    return FALSE;
+  }
+
+  *text = block->text;
+  if (n_chars != NULL) *n_chars = block->n_chars;
+
+  if (block->text == NULL) {
+    snapshot->read_all = TRUE;
+  } else {
+    /* make room for the next block */
+    g_main_context_invoke_full(snapshot->context, G_PRIORITY_DEFAULT_IDLE,
+                               (GSourceFunc)schedule_fill,
+                               pluma_document_snapshot_ref(snapshot),
+                               (GDestroyNotify)pluma_document_snapshot_unref);
+  }
+
+  g_slice_free(SnapshotBlock, block);
+
+  return TRUE;
+}
+
+gint pluma_document_snapshot_get_char_count(PlumaDocumentSnapshot *snapshot) {
+  g_return_val_if_fail(snapshot != NULL, 0);
+
+  return snapshot->n_chars;
+}
+
+gboolean pluma_document_snapshot_get_buffer_changed(
+    PlumaDocumentSnapshot *snapshot) {
+  g_return_val_if_fail(snapshot != NULL, FALSE);
+
+  return snapshot->buffer_changed;
+}
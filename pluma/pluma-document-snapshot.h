@@ -0,0 +1,69 @@
+/*
+ * pluma-document-snapshot.h
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __PLUMA_DOCUMENT_SNAPSHOT_H__
+#define __PLUMA_DOCUMENT_SNAPSHOT_H__
+
+#include <gio/gio.h>
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+/* The text a buffer had when the snapshot was taken, which another thread
+ * can read block by block while the buffer keeps being edited. Nothing is
+ * copied upfront: the text still in the buffer is copied by the main thread
+ * as it is read, and the text about to be deleted is copied before it goes
+ * away. */
+typedef struct _PlumaDocumentSnapshot PlumaDocumentSnapshot;
+
+/* Takes a snapshot of the text of buffer, in the main thread */
+PlumaDocumentSnapshot *pluma_document_snapshot_new(GtkTextBuffer *buffer);
+
+PlumaDocumentSnapshot *pluma_document_snapshot_ref(
+    PlumaDocumentSnapshot *snapshot);
+
+void pluma_document_snapshot_unref(PlumaDocumentSnapshot *snapshot);
+
+/* Stops following the buffer, in the main thread. What is left of the text
+   cannot be read anymore. */
+void pluma_document_snapshot_close(PlumaDocumentSnapshot *snapshot);
+
+/* Waits for the next block of text and returns it in text, NULL once the
+   whole text has been read. Can be called from any thread, by one thread
+   at a time. Returns FALSE if cancelled or if the snapshot was closed
+   first. */
+gboolean pluma_document_snapshot_read(PlumaDocumentSnapshot *snapshot,
+                                      gchar **text, gint *n_chars,
+                                      GCancellable *cancellable,
+                                      GError **error);
+
+/* The number of characters of the text */
+gint pluma_document_snapshot_get_char_count(PlumaDocumentSnapshot *snapshot);
+
+/* Whether the buffer has been changed since the snapshot was taken, until
+   it was closed */
+gboolean pluma_document_snapshot_get_buffer_changed(
+    PlumaDocumentSnapshot *snapshot);
+
+G_END_DECLS
+
+#endif /* __PLUMA_DOCUMENT_SNAPSHOT_H__ */
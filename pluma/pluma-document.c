@@ -42,10 +42,14 @@
 
 #include "pluma-debug.h"
 #include "pluma-document-loader.h"
+#include "pluma-document-pager.h"
 #include "pluma-document-saver.h"
 #include "pluma-document.h"
 #include "pluma-enum-types.h"
 #include "pluma-language-manager.h"
+#include "pluma-literal-search.h"
+#include "pluma-match-index.h"
+#include "pluma-regex-search.h"
 #include "pluma-settings.h"
 #include "pluma-style-scheme-manager.h"
 #include "pluma-utils.h"
@@ -57,6 +61,24 @@
 #define METADATA_QUERY "metadata::*"
 #endif
 
+/* bigger documents are always written when saved, hashing them before the
+ * first change would be noticed */
+#define FILE_HASH_MAX_SIZE (16 * 1024 * 1024)
+#define FILE_HASH_SEGMENT_SIZE (256 * 1024)
+
+/* replace all rewrites the text a block at a time: a match joins the block
+ * of the previous ones when it is this close to them and the block stays
+ * shorter than REPLACE_BLOCK_SIZE characters */
+#define REPLACE_MAX_GAP 1024
+#define REPLACE_BLOCK_SIZE (64 * 1024)
+
+/* search highlighting goes a chunk of about this many characters at a time,
+ * for up to SEARCH_HIGHLIGHT_FRAME_BUDGET microseconds when a view is drawn
+ * and SEARCH_HIGHLIGHT_IDLE_BUDGET in the idle time after */
+#define SEARCH_HIGHLIGHT_CHUNK_SIZE 4096
+#define SEARCH_HIGHLIGHT_FRAME_BUDGET 4000
+#define SEARCH_HIGHLIGHT_IDLE_BUDGET 5000
+
 #undef ENABLE_PROFILE
 
 #ifdef ENABLE_PROFILE
@@ -93,11 +115,20 @@ static void pluma_document_save_real(PlumaDocument *doc, const gchar *uri,
                                      PlumaDocumentSaveFlags flags);
 static void to_search_region_range(PlumaDocument *doc, GtkTextIter *start,
                                    GtkTextIter *end);
+static void schedule_search_highlighting(PlumaDocument *doc);
+static gboolean search_pending(PlumaDocument *doc, const GtkTextIter *start,
+                               const GtkTextIter *end, gint64 deadline);
 static void insert_text_cb(PlumaDocument *doc, GtkTextIter *pos,
                            const gchar *text, gint length);
 
 static void delete_range_cb(PlumaDocument *doc, GtkTextIter *start,
                             GtkTextIter *end);
+static void before_insert_text_cb(PlumaDocument *doc, GtkTextIter *pos,
+                                  const gchar *text, gint length);
+static void before_delete_range_cb(PlumaDocument *doc, GtkTextIter *start,
+                                   GtkTextIter *end);
+
+static gboolean goto_line_paged(PlumaDocument *doc, gint line);
 
 struct _PlumaDocumentPrivate {
   GSettings *editor_settings;
@@ -120,8 +151,30 @@ struct _PlumaDocumentPrivate {
   gchar *last_replace_text;
   gint num_of_lines_search_text;
 
+  /* The compiled pattern and the text of the regex searches, kept from one
+   * search to the next */
+  PlumaRegexSearch *regex_search;
+
+  /* The tables of the literal searches, kept for the next search of the
+   * same text */
+  PlumaLiteralSearch *literal_search;
+
   PlumaDocumentNewlineType newline_type;
 
+  /* line terminators in the file when it was last loaded or saved, indexed
+   * by PlumaDocumentNewlineType */
+  guint newline_counts[3];
+
+  /* The file holds the text of the buffer before this offset, see
+   * _pluma_document_get_unsaved_offset(), or -1 if it may not */
+  gint unsaved_offset;
+
+  /* Hash of the text of the file when it was last loaded or saved, taken
+   * just before the buffer first changes, see
+   * _pluma_document_is_file_unchanged() */
+  guint64 file_hash;
+  guint64 file_hash_seed;
+
   /* Temp data while loading */
   PlumaDocumentLoader *loader;
   gboolean create; /* Create file if uri points
@@ -132,10 +185,30 @@ struct _PlumaDocumentPrivate {
   /* Saving stuff */
   PlumaDocumentSaver *saver;
 
+  /* Large file mode: only a window of the file is in the buffer */
+  PlumaDocumentPager *pager;
+
+  /* Only the head or the tail of the file is loaded, also on revert */
+  PlumaDocumentLoadRange load_range;
+  goffset load_range_size;
+
   /* Search highlighting support variables */
   PlumaTextRegion *to_search_region;
   GtkTextTag *found_tag;
 
+  /* the highlighted matches, all of them once to_search_region is empty */
+  PlumaMatchIndex *match_index;
+
+  /* the rest of to_search_region is highlighted in the idle time, the lines
+   * the views last drew first */
+  guint search_highlight_id;
+  gint search_visible_start;
+  gint search_visible_end;
+
+  /* where the last search stopped at its deadline, -1 once the text or the
+   * search changed */
+  gint search_resume_offset;
+
   /* Mount operation factory */
   PlumaMountOperationFactory mount_operation_factory;
   gpointer mount_operation_userdata;
@@ -145,6 +218,16 @@ struct _PlumaDocumentPrivate {
   gint language_set_by_user : 1;
   gint stop_cursor_moved_emission : 1;
   gint dispose_has_run : 1;
+  gint implicit_trailing_newline : 1;
+  gint partial : 1;
+
+  /* how the line terminators of the buffer were written to the file */
+  gint file_newlines_normalized : 1;
+  gint file_newlines_unmixed : 1;
+
+  /* the buffer holds the text of the file, which is not hashed yet */
+  gint file_hash_pending : 1;
+  gint file_hash_valid : 1;
 };
 
 enum {
@@ -158,6 +241,7 @@ enum {
   PROP_ENCODING,
   PROP_CAN_SEARCH_AGAIN,
   PROP_ENABLE_SEARCH_HIGHLIGHTING,
+  PROP_SEARCH_HIGHLIGHT_PROGRESS,
   PROP_NEWLINE_TYPE
 };
 
@@ -224,8 +308,10 @@ static void pluma_document_dispose(GObject *object) {
   /* Metadata must be saved here and not in finalize
    * because the language is gone by the time finalize runs.
    * beside if some plugin prevents proper finalization by
-   * holding a ref to the doc, we still save the metadata */
-  if ((!doc->priv->dispose_has_run) && (doc->priv->uri != NULL)) {
+   * holding a ref to the doc, we still save the metadata.
+   * The position in a partially loaded file is not one in the file */
+  if ((!doc->priv->dispose_has_run) && (doc->priv->uri != NULL) &&
+      !doc->priv->partial) {
     GtkTextIter iter;
     gchar *position;
     const gchar *language = NULL;
@@ -269,6 +355,17 @@ static void pluma_document_dispose(GObject *object) {
 
   g_clear_object(&doc->priv->editor_settings);
 
+  if (doc->priv->search_highlight_id != 0) {
+    g_source_remove(doc->priv->search_highlight_id);
+    doc->priv->search_highlight_id = 0;
+  }
+
+  pluma_regex_search_free(doc->priv->regex_search);
+  doc->priv->regex_search = NULL;
+
+  pluma_literal_search_free(doc->priv->literal_search);
+  doc->priv->literal_search = NULL;
+
   doc->priv->dispose_has_run = TRUE;
 
   G_OBJECT_CLASS(pluma_document_parent_class)->dispose(object);
@@ -294,6 +391,10 @@ static void pluma_document_finalize(GObject *object) {
     pluma_text_region_destroy(doc->priv->to_search_region, FALSE);
   }
 
+  pluma_match_index_free(doc->priv->match_index);
+
+  pluma_document_pager_free(doc->priv->pager);
+
   G_OBJECT_CLASS(pluma_document_parent_class)->finalize(object);
 }
 
@@ -328,6 +429,10 @@ static void pluma_document_get_property(GObject *object, guint prop_id,
       g_value_set_boolean(value,
                           pluma_document_get_enable_search_highlighting(doc));
       break;
+    case PROP_SEARCH_HIGHLIGHT_PROGRESS:
+      g_value_set_double(value,
+                         _pluma_document_get_search_highlight_progress(doc));
+      break;
     case PROP_NEWLINE_TYPE:
       g_value_set_enum(value, doc->priv->newline_type);
       break;
@@ -453,6 +558,21 @@ static void pluma_document_class_init(PlumaDocumentClass *klass) {
                            "must be highlighted",
                            FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * PlumaDocument:search-highlight-progress:
+   *
+   * The part of the document in which the occurrences of the searched
+   * string are highlighted, from 0 to 1. It is 1 once all of them are.
+   */
+  g_object_class_install_property(
+      object_class, PROP_SEARCH_HIGHLIGHT_PROGRESS,
+      g_param_spec_double("search-highlight-progress",
+                          "Search Highlight Progress",
+                          "The part of the document where the occurrences of "
+                          "the searched string are highlighted",
+                          0.0, 1.0, 1.0,
+                          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   /**
    * PlumaDocument:newline-type:
    *
@@ -821,6 +941,8 @@ static void pluma_document_init(PlumaDocument *doc) {
 
   doc->priv->newline_type = PLUMA_DOCUMENT_NEWLINE_TYPE_DEFAULT;
 
+  doc->priv->unsaved_offset = -1;
+
   undo_actions = g_settings_get_uint(doc->priv->editor_settings,
                                      PLUMA_SETTINGS_MAX_UNDO_ACTIONS);
 
@@ -834,12 +956,19 @@ static void pluma_document_init(PlumaDocument *doc) {
   gtk_source_buffer_set_highlight_matching_brackets(GTK_SOURCE_BUFFER(doc),
                                                     bracket_matching);
 
+  doc->priv->search_resume_offset = -1;
   pluma_document_set_enable_search_highlighting(doc, search_hl);
 
   style_scheme = get_default_style_scheme(doc->priv->editor_settings);
   if (style_scheme != NULL)
     gtk_source_buffer_set_style_scheme(GTK_SOURCE_BUFFER(doc), style_scheme);
 
+  g_signal_connect(doc, "insert-text", G_CALLBACK(before_insert_text_cb),
+                   NULL);
+
+  g_signal_connect(doc, "delete-range", G_CALLBACK(before_delete_range_cb),
+                   NULL);
+
   g_signal_connect_after(doc, "insert-text", G_CALLBACK(insert_text_cb), NULL);
 
   g_signal_connect_after(doc, "delete-range", G_CALLBACK(delete_range_cb),
@@ -1135,8 +1264,32 @@ static void reset_temp_loading_data(PlumaDocument *doc) {
   doc->priv->requested_line_pos = 0;
 }
 
+/* The document is displayed while it is still loading, but highlighting
+ * the chunks as they are appended would only slow the load down */
+static void end_deferred_highlighting(PlumaDocument *doc) {
+  GtkTextIter begin;
+  GtkTextIter end;
+  gboolean syntax_hl;
+
+  /* neither are available for large files */
+  if (doc->priv->pager != NULL) return;
+
+  syntax_hl = g_settings_get_boolean(doc->priv->editor_settings,
+                                     PLUMA_SETTINGS_SYNTAX_HIGHLIGHTING);
+
+  gtk_source_buffer_set_highlight_syntax(
+      GTK_SOURCE_BUFFER(doc),
+      syntax_hl &&
+          gtk_source_buffer_get_language(GTK_SOURCE_BUFFER(doc)) != NULL);
+
+  gtk_text_buffer_get_bounds(GTK_TEXT_BUFFER(doc), &begin, &end);
+  to_search_region_range(doc, &begin, &end);
+}
+
 static void document_loader_loaded(PlumaDocumentLoader *loader,
                                    const GError *error, PlumaDocument *doc) {
+  end_deferred_highlighting(doc);
+
   /* load was successful */
   if (error == NULL ||
       (error->domain == PLUMA_DOCUMENT_ERROR &&
@@ -1177,6 +1330,11 @@ static void document_loader_loaded(PlumaDocumentLoader *loader,
 
     doc->priv->mtime = (gint64)mtime;
 
+    doc->priv->partial = pluma_document_loader_is_partial(loader);
+
+    /* the buffer only holds a part of the file */
+    if (doc->priv->pager != NULL || doc->priv->partial) read_only = TRUE;
+
     set_readonly(doc, read_only);
 
     doc->priv->time_of_last_save_or_load = g_get_real_time();
@@ -1189,11 +1347,34 @@ static void document_loader_loaded(PlumaDocumentLoader *loader,
     pluma_document_set_newline_type(
         doc, pluma_document_loader_get_newline_type(loader));
 
+    /* the file is the buffer, unless text had to be converted or only a
+     * part of it is loaded */
+    _pluma_document_set_file_in_sync(
+        doc,
+        error == NULL && !read_only &&
+            doc->priv->encoding == pluma_encoding_get_utf8(),
+        FALSE);
+
     restore_cursor = g_settings_get_boolean(
         doc->priv->editor_settings, PLUMA_SETTINGS_RESTORE_CURSOR_POSITION);
 
+    /* lines and offsets are not the ones of the file, the end of a log is
+     * usually what matters */
+    if (doc->priv->partial) {
+      if (doc->priv->load_range == PLUMA_DOCUMENT_LOAD_RANGE_TAIL)
+        gtk_text_buffer_get_end_iter(GTK_TEXT_BUFFER(doc), &iter);
+      else
+        gtk_text_buffer_get_start_iter(GTK_TEXT_BUFFER(doc), &iter);
+    }
+    /* in a large file, the line may not be in the first window */
+    else if (doc->priv->pager != NULL) {
+      goto_line_paged(doc, MAX(doc->priv->requested_line_pos - 1, 0));
+      gtk_text_buffer_get_iter_at_mark(
+          GTK_TEXT_BUFFER(doc), &iter,
+          gtk_text_buffer_get_insert(GTK_TEXT_BUFFER(doc)));
+    }
     /* move the cursor at the requested line if any */
-    if (doc->priv->requested_line_pos > 0) {
+    else if (doc->priv->requested_line_pos > 0) {
       /* line_pos - 1 because get_iter_at_line counts from 0 */
       gtk_text_buffer_get_iter_at_line(GTK_TEXT_BUFFER(doc), &iter,
                                        doc->priv->requested_line_pos - 1);
@@ -1259,6 +1440,9 @@ static void document_loader_loading(PlumaDocumentLoader *loader,
       size = g_file_info_get_attribute_uint64(info,
                                               G_FILE_ATTRIBUTE_STANDARD_SIZE);
 
+    if (doc->priv->load_range != PLUMA_DOCUMENT_LOAD_RANGE_ALL)
+      size = MIN(size, doc->priv->load_range_size);
+
     read = pluma_document_loader_get_bytes_read(loader);
 
     g_signal_emit(doc, document_signals[LOADING], 0, read, size);
@@ -1278,13 +1462,22 @@ static void pluma_document_load_real(PlumaDocument *doc, const gchar *uri,
   g_signal_connect(doc->priv->loader, "loading",
                    G_CALLBACK(document_loader_loading), doc);
 
+  pluma_document_loader_set_range(doc->priv->loader, doc->priv->load_range,
+                                  doc->priv->load_range_size);
+
   doc->priv->create = create;
   doc->priv->requested_encoding = encoding;
   doc->priv->requested_line_pos = line_pos;
 
+  _pluma_document_set_pager(doc, NULL);
+  _pluma_document_set_file_in_sync(doc, FALSE, FALSE);
+
   set_uri(doc, uri);
   set_content_type(doc, NULL);
 
+  /* see end_deferred_highlighting() */
+  gtk_source_buffer_set_highlight_syntax(GTK_SOURCE_BUFFER(doc), FALSE);
+
   pluma_document_loader_load(doc->priv->loader);
 }
 
@@ -1368,7 +1561,10 @@ static void document_saver_saving(PlumaDocumentSaver *saver, gboolean completed,
 
       _pluma_document_set_readonly(doc, FALSE);
 
-      gtk_text_buffer_set_modified(GTK_TEXT_BUFFER(doc), FALSE);
+      /* the file holds the text from before the changes made during the
+       * save */
+      if (!pluma_document_saver_get_document_changed(saver))
+        gtk_text_buffer_set_modified(GTK_TEXT_BUFFER(doc), FALSE);
 
       set_encoding(doc, doc->priv->requested_encoding, TRUE);
     }
@@ -1394,11 +1590,36 @@ static void document_saver_saving(PlumaDocumentSaver *saver, gboolean completed,
   }
 }
 
+/* The file is only looked at when it is local, for remote ones it may block */
+static gboolean save_would_change_file(PlumaDocument *doc, const gchar *uri,
+                                       const PlumaEncoding *encoding,
+                                       PlumaDocumentSaveFlags flags) {
+  if ((flags & PLUMA_DOCUMENT_SAVE_IGNORE_MTIME) ||
+      g_strcmp0(uri, doc->priv->uri) != 0 || !pluma_document_is_local(doc))
+    return TRUE;
+
+  if (!_pluma_document_is_file_unchanged(doc, encoding)) return TRUE;
+
+  return pluma_document_get_deleted(doc) ||
+         _pluma_document_check_externally_modified(doc);
+}
+
 static void pluma_document_save_real(PlumaDocument *doc, const gchar *uri,
                                      const PlumaEncoding *encoding,
                                      PlumaDocumentSaveFlags flags) {
   g_return_if_fail(doc->priv->saver == NULL);
 
+  /* e.g. the changes were undone: rewriting the file would only wake up
+   * whoever watches it */
+  if (!save_would_change_file(doc, uri, encoding, flags)) {
+    pluma_debug_message(DEBUG_DOCUMENT, "The file is unchanged, not saving");
+
+    gtk_text_buffer_set_modified(GTK_TEXT_BUFFER(doc), FALSE);
+
+    g_signal_emit(doc, document_signals[SAVED], 0, NULL);
+    return;
+  }
+
   /* create a saver, it will be destroyed once saving is complete */
   doc->priv->saver = pluma_document_saver_new(doc, uri, encoding,
                                               doc->priv->newline_type, flags);
@@ -1492,6 +1713,43 @@ gboolean pluma_document_get_deleted(PlumaDocument *doc) {
   return doc->priv->uri && !pluma_utils_uri_exists(doc->priv->uri);
 }
 
+static void set_window_text(PlumaDocument *doc, gchar *text) {
+  gtk_source_buffer_begin_not_undoable_action(GTK_SOURCE_BUFFER(doc));
+  gtk_text_buffer_set_text(GTK_TEXT_BUFFER(doc), text, -1);
+  gtk_text_buffer_set_modified(GTK_TEXT_BUFFER(doc), FALSE);
+  gtk_source_buffer_end_not_undoable_action(GTK_SOURCE_BUFFER(doc));
+
+  g_free(text);
+}
+
+/* line is a line of the file, the window is moved if it does not show it */
+static gboolean goto_line_paged(PlumaDocument *doc, gint line) {
+  gboolean ret = TRUE;
+  gint line_count;
+  gint first;
+  GtkTextIter iter;
+
+  line_count = pluma_document_pager_get_line_count(doc->priv->pager);
+
+  if (line >= line_count) ret = FALSE;
+
+  if (line < 0 || line >= line_count) line = line_count - 1;
+
+  first = pluma_document_pager_get_first_line(doc->priv->pager);
+
+  if (line < first ||
+      line >= first + gtk_text_buffer_get_line_count(GTK_TEXT_BUFFER(doc))) {
+    set_window_text(doc,
+                    pluma_document_pager_get_window(doc->priv->pager, line));
+    first = pluma_document_pager_get_first_line(doc->priv->pager);
+  }
+
+  gtk_text_buffer_get_iter_at_line(GTK_TEXT_BUFFER(doc), &iter, line - first);
+  gtk_text_buffer_place_cursor(GTK_TEXT_BUFFER(doc), &iter);
+
+  return ret;
+}
+
 /*
  * If @line is bigger than the lines of the document, the cursor is moved
  * to the last line and FALSE is returned.
@@ -1506,6 +1764,8 @@ gboolean pluma_document_goto_line(PlumaDocument *doc, gint line) {
   g_return_val_if_fail(PLUMA_IS_DOCUMENT(doc), FALSE);
   g_return_val_if_fail(line >= -1, FALSE);
 
+  if (doc->priv->pager != NULL) return goto_line_paged(doc, line);
+
   line_count = gtk_text_buffer_get_line_count(GTK_TEXT_BUFFER(doc));
 
   if (line >= line_count) {
@@ -1615,6 +1875,9 @@ void pluma_document_set_search_text(PlumaDocument *doc, const gchar *text,
     GtkTextIter begin;
     GtkTextIter end;
 
+    if (doc->priv->match_index != NULL)
+      pluma_match_index_clear(doc->priv->match_index);
+
     gtk_text_buffer_get_bounds(GTK_TEXT_BUFFER(doc), &begin, &end);
 
     to_search_region_range(doc, &begin, &end);
@@ -1669,6 +1932,112 @@ gboolean pluma_document_get_can_search_again(PlumaDocument *doc) {
           (*doc->priv->search_text != '\0'));
 }
 
+static PlumaRegexSearch *get_regex_search(PlumaDocument *doc) {
+  if (doc->priv->regex_search == NULL)
+    doc->priv->regex_search = pluma_regex_search_new(GTK_TEXT_BUFFER(doc));
+
+  return doc->priv->regex_search;
+}
+
+static PlumaLiteralSearch *get_literal_search(PlumaDocument *doc) {
+  if (doc->priv->literal_search == NULL) {
+    doc->priv->literal_search =
+        pluma_literal_search_new(GTK_TEXT_BUFFER(doc));
+  }
+
+  return doc->priv->literal_search;
+}
+
+/* Whether two matches of text can overlap, as "aa" twice in "aaa". The
+ * highlighting goes on after the end of each match, so the match index
+ * only holds all the matches of the texts which cannot. */
+static gboolean search_text_can_overlap(const gchar *text,
+                                        gboolean case_sensitive) {
+  gchar *folded;
+  const gchar *p;
+  gsize length;
+  gboolean overlap = FALSE;
+
+  folded = case_sensitive ? g_strdup(text) : g_utf8_casefold(text, -1);
+  length = strlen(folded);
+
+  /* a suffix which is also a prefix */
+  for (p = g_utf8_next_char(folded); *p != '\0'; p = g_utf8_next_char(p)) {
+    if (memcmp(folded, p, length - (p - folded)) == 0) {
+      overlap = TRUE;
+      break;
+    }
+  }
+
+  g_free(folded);
+
+  return overlap;
+}
+
+/* Whether the match index holds all the matches of the search text, the
+ * text still to be highlighted is searched first if it takes less than a
+ * frame */
+static gboolean match_index_ready(PlumaDocument *doc) {
+  GtkTextIter begin;
+  GtkTextIter end;
+
+  if (doc->priv->match_index == NULL || doc->priv->search_text == NULL ||
+      *doc->priv->search_text == '\0')
+    return FALSE;
+
+  /* the highlighting is deferred or off */
+  if (doc->priv->loader != NULL || doc->priv->pager != NULL) return FALSE;
+
+  gtk_text_buffer_get_bounds(GTK_TEXT_BUFFER(doc), &begin, &end);
+
+  return search_pending(
+      doc, &begin, &end,
+      g_get_monotonic_time() + SEARCH_HIGHLIGHT_FRAME_BUDGET);
+}
+
+/* Looks for the search text from iter to limit with a binary search in the
+ * match index instead of going through the text, returns FALSE when the
+ * index cannot tell. A regex can match from iter differently than from the
+ * end of the previous match, only its matches are counted in the index. */
+static gboolean search_match_index(PlumaDocument *doc, const GtkTextIter *iter,
+                                   const GtkTextIter *limit,
+                                   gboolean forward_search, gboolean *found,
+                                   GtkTextIter *match_start,
+                                   GtkTextIter *match_end) {
+  gint offset;
+  gint start_offset;
+  gint end_offset;
+
+  if (PLUMA_SEARCH_IS_MATCH_REGEX(doc->priv->search_flags) ||
+      !match_index_ready(doc) ||
+      search_text_can_overlap(
+          doc->priv->search_text,
+          PLUMA_SEARCH_IS_CASE_SENSITIVE(doc->priv->search_flags)))
+    return FALSE;
+
+  offset = gtk_text_iter_get_offset(iter);
+
+  if (forward_search) {
+    *found = pluma_match_index_find_next(doc->priv->match_index, offset,
+                                         &start_offset, &end_offset) &&
+             (limit == NULL || end_offset <= gtk_text_iter_get_offset(limit));
+  } else {
+    *found =
+        pluma_match_index_find_previous(doc->priv->match_index, offset,
+                                        &start_offset, &end_offset) &&
+        (limit == NULL || start_offset >= gtk_text_iter_get_offset(limit));
+  }
+
+  if (*found) {
+    gtk_text_buffer_get_iter_at_offset(GTK_TEXT_BUFFER(doc), match_start,
+                                       start_offset);
+    *match_end = *match_start;
+    gtk_text_iter_forward_chars(match_end, end_offset - start_offset);
+  }
+
+  return TRUE;
+}
+
 /**
  * pluma_document_search_forward:
  * @doc:
@@ -1685,6 +2054,7 @@ gboolean pluma_document_search_forward(PlumaDocument *doc,
   GtkTextIter iter;
   GtkTextSearchFlags search_flags;
   gboolean found = FALSE;
+  gboolean indexed;
   GtkTextIter m_start;
   GtkTextIter m_end;
 
@@ -1714,14 +2084,18 @@ gboolean pluma_document_search_forward(PlumaDocument *doc,
     search_flags = search_flags | GTK_TEXT_SEARCH_CASE_INSENSITIVE;
   }
 
-  while (!found) {
+  indexed =
+      search_match_index(doc, &iter, end, TRUE, &found, &m_start, &m_end);
+
+  while (!indexed && !found) {
     if (!PLUMA_SEARCH_IS_MATCH_REGEX(doc->priv->search_flags)) {
-      found = gtk_text_iter_forward_search(&iter, doc->priv->search_text,
-                                           search_flags, &m_start, &m_end, end);
+      found = pluma_literal_search_find(
+          get_literal_search(doc), doc->priv->search_text, search_flags, &iter,
+          end, TRUE, &m_start, &m_end);
     } else {
-      found = pluma_gtk_text_iter_regex_search(
-          &iter, doc->priv->search_text, search_flags, &m_start, &m_end, end,
-          TRUE, &doc->priv->last_replace_text);
+      found = pluma_regex_search_find(
+          get_regex_search(doc), doc->priv->search_text, search_flags, &iter,
+          end, TRUE, &m_start, &m_end, &doc->priv->last_replace_text);
     }
 
     if (found && PLUMA_SEARCH_IS_ENTIRE_WORD(doc->priv->search_flags)) {
@@ -1756,6 +2130,7 @@ gboolean pluma_document_search_backward(PlumaDocument *doc,
   GtkTextIter iter;
   GtkTextSearchFlags search_flags;
   gboolean found = FALSE;
+  gboolean indexed;
   GtkTextIter m_start;
   GtkTextIter m_end;
 
@@ -1785,14 +2160,18 @@ gboolean pluma_document_search_backward(PlumaDocument *doc,
     search_flags = search_flags | GTK_TEXT_SEARCH_CASE_INSENSITIVE;
   }
 
-  while (!found) {
+  indexed =
+      search_match_index(doc, &iter, start, FALSE, &found, &m_start, &m_end);
+
+  while (!indexed && !found) {
     if (!PLUMA_SEARCH_IS_MATCH_REGEX(doc->priv->search_flags)) {
-      found = gtk_text_iter_backward_search(
-          &iter, doc->priv->search_text, search_flags, &m_start, &m_end, start);
+      found = pluma_literal_search_find(
+          get_literal_search(doc), doc->priv->search_text, search_flags, &iter,
+          start, FALSE, &m_start, &m_end);
     } else {
-      found = pluma_gtk_text_iter_regex_search(
-          &iter, doc->priv->search_text, search_flags, &m_start, &m_end, start,
-          FALSE, &doc->priv->last_replace_text);
+      found = pluma_regex_search_find(
+          get_regex_search(doc), doc->priv->search_text, search_flags, &iter,
+          start, FALSE, &m_start, &m_end, &doc->priv->last_replace_text);
     }
 
     if (found && PLUMA_SEARCH_IS_ENTIRE_WORD(doc->priv->search_flags)) {
@@ -1811,6 +2190,43 @@ gboolean pluma_document_search_backward(PlumaDocument *doc,
   return found;
 }
 
+/* Replaces the characters from start to end with the new text of a block,
+ * returns by how many characters the text after it moved */
+static gint replace_block(GtkTextBuffer *buffer, gint start, gint end,
+                          GString *text) {
+  GtkTextIter b_start;
+  GtkTextIter b_end;
+  gint n_chars;
+
+  gtk_text_buffer_get_iter_at_offset(buffer, &b_start, start);
+  gtk_text_buffer_get_iter_at_offset(buffer, &b_end, end);
+
+  gtk_text_buffer_delete(buffer, &b_start, &b_end);
+  gtk_text_buffer_insert(buffer, &b_start, text->str, text->len);
+
+  n_chars = g_utf8_strlen(text->str, text->len);
+  g_string_truncate(text, 0);
+
+  return n_chars - (end - start);
+}
+
+/* Appends the text of the buffer from start to end */
+static void append_slice(GtkTextBuffer *buffer, GString *text, gint start,
+                         gint end) {
+  GtkTextIter s;
+  GtkTextIter e;
+  gchar *slice;
+
+  if (start == end) return;
+
+  gtk_text_buffer_get_iter_at_offset(buffer, &s, start);
+  gtk_text_buffer_get_iter_at_offset(buffer, &e, end);
+
+  slice = gtk_text_iter_get_slice(&s, &e);
+  g_string_append(text, slice);
+  g_free(slice);
+}
+
 /* FIXME this is an issue for introspection regardning @find */
 gint pluma_document_replace_all(PlumaDocument *doc, const gchar *find,
                                 const gchar *replace, guint flags) {
@@ -1822,10 +2238,12 @@ gint pluma_document_replace_all(PlumaDocument *doc, const gchar *find,
   gint cont = 0;
   gchar *search_text;
   gchar *replace_text = NULL;
-  gint replace_text_len = 0;
   GtkTextBuffer *buffer;
   gboolean brackets_highlighting;
   gboolean search_highliting;
+  GString *block_text;
+  gint block_start = -1;
+  gint block_end = -1;
 
   g_return_val_if_fail(PLUMA_IS_DOCUMENT(doc), 0);
   g_return_val_if_fail(replace != NULL, 0);
@@ -1840,7 +2258,6 @@ gint pluma_document_replace_all(PlumaDocument *doc, const gchar *find,
 
   if (!PLUMA_SEARCH_IS_MATCH_REGEX(flags)) {
     replace_text = pluma_utils_unescape_search_text(replace);
-    replace_text_len = strlen(replace_text);
   }
 
   gtk_text_buffer_get_start_iter(buffer, &iter);
@@ -1869,42 +2286,76 @@ gint pluma_document_replace_all(PlumaDocument *doc, const gchar *find,
 
   gtk_text_buffer_begin_user_action(buffer);
 
+  /* The matches are looked for in the text as it was and the blocks of
+   * text around them are rewritten with a single deletion and insertion
+   * each, behind the search, instead of one per match. */
+  block_text = g_string_new(NULL);
+
   do {
+    gint start;
+    gint end;
+
     if (!PLUMA_SEARCH_IS_MATCH_REGEX(flags)) {
-      found = gtk_text_iter_forward_search(&iter, search_text, search_flags,
-                                           &m_start, &m_end, NULL);
+      found = pluma_literal_search_find(get_literal_search(doc), search_text,
+                                        search_flags, &iter, NULL, TRUE,
+                                        &m_start, &m_end);
     } else {
       g_free(replace_text);
       replace_text = g_strdup(replace);
-      found = pluma_gtk_text_iter_regex_search(&iter, search_text, search_flags,
-                                               &m_start, &m_end, NULL, TRUE,
-                                               &replace_text);
-      replace_text_len = strlen(replace_text);
+      found = pluma_regex_search_find(get_regex_search(doc), search_text,
+                                      search_flags, &iter, NULL, TRUE,
+                                      &m_start, &m_end, &replace_text);
     }
 
-    if (found && PLUMA_SEARCH_IS_ENTIRE_WORD(flags)) {
+    if (!found) break;
+
+    iter = m_end;
+
+    /* an empty match is not found again */
+    if (gtk_text_iter_equal(&m_start, &m_end)) {
+      found = !gtk_text_iter_is_end(&iter);
+      gtk_text_iter_forward_char(&iter);
+    }
+
+    if (PLUMA_SEARCH_IS_ENTIRE_WORD(flags)) {
       gboolean word;
 
       word = gtk_text_iter_starts_word(&m_start) &&
              gtk_text_iter_ends_word(&m_end);
 
-      if (!word) {
-        iter = m_end;
-        continue;
-      }
+      if (!word) continue;
     }
 
-    if (found) {
-      ++cont;
+    ++cont;
+
+    start = gtk_text_iter_get_offset(&m_start);
+    end = gtk_text_iter_get_offset(&m_end);
+
+    if (block_start >= 0 && (start - block_end > REPLACE_MAX_GAP ||
+                             end - block_start > REPLACE_BLOCK_SIZE)) {
+      gint next = gtk_text_iter_get_offset(&iter);
+      gint moved;
 
-      gtk_text_buffer_delete(buffer, &m_start, &m_end);
-      gtk_text_buffer_insert(buffer, &m_start, replace_text, replace_text_len);
+      moved = replace_block(buffer, block_start, block_end, block_text);
+      start += moved;
+      end += moved;
+      block_start = -1;
 
-      iter = m_start;
+      gtk_text_buffer_get_iter_at_offset(buffer, &iter, next + moved);
     }
 
+    if (block_start < 0)
+      block_start = start;
+    else
+      append_slice(buffer, block_text, block_end, start);
+
+    g_string_append(block_text, replace_text);
+    block_end = end;
   } while (found);
 
+  if (block_start >= 0)
+    replace_block(buffer, block_start, block_end, block_text);
+
   gtk_text_buffer_end_user_action(buffer);
 
   /* re-enable cursor_moved emission and notify
@@ -1917,6 +2368,7 @@ gint pluma_document_replace_all(PlumaDocument *doc, const gchar *find,
                                                     brackets_highlighting);
   pluma_document_set_enable_search_highlighting(doc, search_highliting);
 
+  g_string_free(block_text, TRUE);
   g_free(search_text);
   g_free(replace_text);
 
@@ -1961,6 +2413,111 @@ glong _pluma_document_get_seconds_since_last_save_or_load(PlumaDocument *doc) {
           G_USEC_PER_SEC);
 }
 
+/* Takes ownership of pager, see pluma_document_loader_load() */
+void _pluma_document_set_pager(PlumaDocument *doc,
+                               struct _PlumaDocumentPager *pager) {
+  g_return_if_fail(PLUMA_IS_DOCUMENT(doc));
+
+  pluma_document_pager_free(doc->priv->pager);
+  doc->priv->pager = pager;
+}
+
+gboolean _pluma_document_is_paged(PlumaDocument *doc) {
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT(doc), FALSE);
+
+  return doc->priv->pager != NULL;
+}
+
+/* The line of the file at the start of the buffer, it is 0 unless only a
+ * window of the file is loaded */
+gint _pluma_document_get_first_line(PlumaDocument *doc) {
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT(doc), 0);
+
+  if (doc->priv->pager == NULL) return 0;
+
+  return pluma_document_pager_get_first_line(doc->priv->pager);
+}
+
+/* Moves the window shown in a large file towards its end (direction > 0) or
+ * its start. Returns by how many lines the start of the buffer moved in the
+ * file, 0 if it did not move. */
+gint _pluma_document_move_window(PlumaDocument *doc, gint direction) {
+  gint first;
+  gchar *text;
+
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT(doc), 0);
+
+  if (doc->priv->pager == NULL) return 0;
+
+  first = pluma_document_pager_get_first_line(doc->priv->pager);
+
+  text = pluma_document_pager_move_window(doc->priv->pager, direction);
+  if (text == NULL) return 0;
+
+  set_window_text(doc, text);
+
+  return pluma_document_pager_get_first_line(doc->priv->pager) - first;
+}
+
+/* Applies to the next loads of the document, including reverts, until it is
+ * set again. size is in bytes. */
+void _pluma_document_set_load_range(PlumaDocument *doc,
+                                    PlumaDocumentLoadRange range,
+                                    goffset size) {
+  g_return_if_fail(PLUMA_IS_DOCUMENT(doc));
+  g_return_if_fail(range == PLUMA_DOCUMENT_LOAD_RANGE_ALL || size > 0);
+
+  doc->priv->load_range = range;
+  doc->priv->load_range_size =
+      range == PLUMA_DOCUMENT_LOAD_RANGE_ALL ? 0 : size;
+}
+
+PlumaDocumentLoadRange _pluma_document_get_load_range(PlumaDocument *doc,
+                                                      goffset *size) {
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT(doc), PLUMA_DOCUMENT_LOAD_RANGE_ALL);
+
+  if (size != NULL) *size = doc->priv->load_range_size;
+
+  return doc->priv->load_range;
+}
+
+/* Whether only a part of the file was loaded: the range set with
+ * _pluma_document_set_load_range() was smaller than the file */
+gboolean _pluma_document_is_partial(PlumaDocument *doc) {
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT(doc), FALSE);
+
+  return doc->priv->partial;
+}
+
+gboolean _pluma_document_is_saving_snapshot(PlumaDocument *doc) {
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT(doc), FALSE);
+
+  return doc->priv->saver != NULL &&
+         pluma_document_saver_is_saving_snapshot(doc->priv->saver);
+}
+
+/* Used when the document is updated from the file without reloading it */
+void _pluma_document_set_mtime(PlumaDocument *doc, gint64 mtime) {
+  g_return_if_fail(PLUMA_IS_DOCUMENT(doc));
+
+  doc->priv->mtime = mtime;
+}
+
+/* Whether a line terminator was stripped from the end of the text when it was
+ * loaded, see pluma_document_output_stream_new_for_append() */
+void _pluma_document_set_implicit_trailing_newline(PlumaDocument *doc,
+                                                   gboolean implicit) {
+  g_return_if_fail(PLUMA_IS_DOCUMENT(doc));
+
+  doc->priv->implicit_trailing_newline = (implicit != FALSE);
+}
+
+gboolean _pluma_document_get_implicit_trailing_newline(PlumaDocument *doc) {
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT(doc), FALSE);
+
+  return doc->priv->implicit_trailing_newline;
+}
+
 static void get_search_match_colors(PlumaDocument *doc,
                                     gboolean *foreground_set,
                                     GdkRGBA *foreground,
@@ -2038,13 +2595,65 @@ static void text_tag_set_highest_priority(GtkTextTag *tag,
   gtk_text_tag_set_priority(tag, n - 1);
 }
 
-static void search_region(PlumaDocument *doc, GtkTextIter *start,
-                          GtkTextIter *end) {
+typedef struct {
+  PlumaDocument *doc;
+
+  /* the offsets of the matches, in pairs */
+  GArray *matches;
+
+  /* the search stops after the deadline, once past min_offset so that it
+   * gets on */
+  gint64 deadline;
+  gint min_offset;
+  gboolean stopped;
+  GtkTextIter stop;
+} RegionSearch;
+
+static gboolean highlight_match(GtkTextIter *match_start,
+                                GtkTextIter *match_end,
+                                RegionSearch *region_search) {
+  PlumaDocument *doc = region_search->doc;
+
+  /* regexes can match nothing */
+  if (!gtk_text_iter_equal(match_start, match_end) &&
+      (!PLUMA_SEARCH_IS_ENTIRE_WORD(doc->priv->search_flags) ||
+       (gtk_text_iter_starts_word(match_start) &&
+        gtk_text_iter_ends_word(match_end)))) {
+    gint m_offsets[2];
+
+    gtk_text_buffer_apply_tag(GTK_TEXT_BUFFER(doc), doc->priv->found_tag,
+                              match_start, match_end);
+
+    m_offsets[0] = gtk_text_iter_get_offset(match_start);
+    m_offsets[1] = gtk_text_iter_get_offset(match_end);
+    g_array_append_vals(region_search->matches, m_offsets, 2);
+  }
+
+  if (gtk_text_iter_get_offset(match_end) > region_search->min_offset &&
+      g_get_monotonic_time() >= region_search->deadline) {
+    region_search->stopped = TRUE;
+    region_search->stop = *match_end;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Highlights the matches from start to end until the deadline, returns
+ * FALSE if it passed before the end, which is then moved back to where the
+ * search stopped */
+static gboolean search_region(PlumaDocument *doc, GtkTextIter *start,
+                              GtkTextIter *end, gint64 deadline) {
   GtkTextIter iter;
   GtkTextIter m_start;
   GtkTextIter m_end;
+  GtkTextIter bound;
   GtkTextSearchFlags search_flags = 0;
-  gboolean found = TRUE;
+  RegionSearch region_search;
+  const GtkTextIter *limit;
+  gboolean given_up = FALSE;
+  gint start_offset;
+  gint end_offset;
 
   GtkTextBuffer *buffer;
 
@@ -2066,16 +2675,38 @@ static void search_region(PlumaDocument *doc, GtkTextIter *start,
    * syntax highlighting tags */
   text_tag_set_highest_priority(doc->priv->found_tag, GTK_TEXT_BUFFER(doc));
 
-  if (doc->priv->search_text == NULL) return;
+  if (doc->priv->search_text == NULL) return TRUE;
 
-  g_return_if_fail(doc->priv->num_of_lines_search_text > 0);
+  g_return_val_if_fail(doc->priv->num_of_lines_search_text > 0, TRUE);
 
-  gtk_text_iter_backward_lines(start, doc->priv->num_of_lines_search_text);
+  region_search.doc = doc;
+  region_search.deadline = deadline;
+  region_search.min_offset = gtk_text_iter_get_offset(start);
+  region_search.stopped = FALSE;
+
+  /* The matches which could cross the bounds are searched again, within
+   * SEARCH_HIGHLIGHT_CHUNK_SIZE characters so that a long line is not
+   * searched again from its start each time. Where the last search stopped
+   * no match crosses. */
+  if (region_search.min_offset == doc->priv->search_resume_offset) {
+    doc->priv->search_resume_offset = -1;
+  } else {
+    bound = *start;
+    gtk_text_iter_backward_chars(&bound, SEARCH_HIGHLIGHT_CHUNK_SIZE);
+    gtk_text_iter_backward_lines(start, doc->priv->num_of_lines_search_text);
+
+    if (gtk_text_iter_compare(start, &bound) < 0) *start = bound;
+
+    if (gtk_text_iter_has_tag(start, doc->priv->found_tag) &&
+        !gtk_text_iter_starts_tag(start, doc->priv->found_tag))
+      gtk_text_iter_backward_to_tag_toggle(start, doc->priv->found_tag);
+  }
+
+  bound = *end;
+  gtk_text_iter_forward_chars(&bound, SEARCH_HIGHLIGHT_CHUNK_SIZE);
   gtk_text_iter_forward_lines(end, doc->priv->num_of_lines_search_text);
 
-  if (gtk_text_iter_has_tag(start, doc->priv->found_tag) &&
-      !gtk_text_iter_starts_tag(start, doc->priv->found_tag))
-    gtk_text_iter_backward_to_tag_toggle(start, doc->priv->found_tag);
+  if (gtk_text_iter_compare(end, &bound) > 0) *end = bound;
 
   if (gtk_text_iter_has_tag(end, doc->priv->found_tag) &&
       !gtk_text_iter_ends_tag(end, doc->priv->found_tag))
@@ -2089,9 +2720,11 @@ static void search_region(PlumaDocument *doc, GtkTextIter *start,
 
   gtk_text_buffer_remove_tag(buffer, doc->priv->found_tag, start, end);
 
-  if (*doc->priv->search_text == '\0') return;
+  if (*doc->priv->search_text == '\0') return TRUE;
 
-  iter = *start;
+  start_offset = gtk_text_iter_get_offset(start);
+  end_offset = gtk_text_iter_get_offset(end);
+  region_search.matches = g_array_new(FALSE, FALSE, sizeof(gint));
 
   search_flags = GTK_TEXT_SEARCH_VISIBLE_ONLY | GTK_TEXT_SEARCH_TEXT_ONLY;
 
@@ -2099,28 +2732,55 @@ static void search_region(PlumaDocument *doc, GtkTextIter *start,
     search_flags = search_flags | GTK_TEXT_SEARCH_CASE_INSENSITIVE;
   }
 
-  do {
-    if ((end != NULL) && gtk_text_iter_is_end(end)) end = NULL;
+  /* the regex only sees a line start or end at the bounds when there is
+   * one */
+  if (PLUMA_SEARCH_IS_MATCH_REGEX(doc->priv->search_flags)) {
+    given_up = !pluma_regex_search_foreach(
+        get_regex_search(doc), doc->priv->search_text, search_flags, start,
+        end, (PlumaRegexSearchFunc)highlight_match, &region_search);
+  } else {
+    iter = *start;
+    limit = gtk_text_iter_is_end(end) ? NULL : end;
 
-    found = gtk_text_iter_forward_search(&iter, doc->priv->search_text,
-                                         search_flags, &m_start, &m_end, end);
+    while (pluma_literal_search_find(get_literal_search(doc),
+                                     doc->priv->search_text, search_flags,
+                                     &iter, limit, TRUE, &m_start, &m_end) &&
+           highlight_match(&m_start, &m_end, &region_search)) {
+      iter = m_end;
+    }
+  }
 
-    iter = m_end;
+  if (given_up) {
+    GtkTextIter begin;
+    GtkTextIter buffer_end;
 
-    if (found && PLUMA_SEARCH_IS_ENTIRE_WORD(doc->priv->search_flags)) {
-      gboolean word;
+    pluma_debug_message(DEBUG_DOCUMENT, "Regex too costly, not highlighting");
 
-      word = gtk_text_iter_starts_word(&m_start) &&
-             gtk_text_iter_ends_word(&m_end);
+    /* until the text or the search changes */
+    gtk_text_buffer_get_bounds(buffer, &begin, &buffer_end);
+    pluma_text_region_subtract(doc->priv->to_search_region, &begin,
+                               &buffer_end);
+  } else if (region_search.stopped) {
+    /* the rest, whose tags are gone, when there is time again */
+    pluma_text_region_add(doc->priv->to_search_region, &region_search.stop,
+                          end);
 
-      if (!word) continue;
-    }
+    *end = region_search.stop;
+    end_offset = gtk_text_iter_get_offset(end);
 
-    if (found) {
-      gtk_text_buffer_apply_tag(buffer, doc->priv->found_tag, &m_start, &m_end);
-    }
+    doc->priv->search_resume_offset = end_offset;
+  }
 
-  } while (found);
+  if (doc->priv->match_index != NULL) {
+    pluma_match_index_set_range(doc->priv->match_index, start_offset,
+                                end_offset,
+                                (const gint *)region_search.matches->data,
+                                region_search.matches->len / 2);
+  }
+
+  g_array_free(region_search.matches, TRUE);
+
+  return !region_search.stopped;
 }
 
 static void to_search_region_range(PlumaDocument *doc, GtkTextIter *start,
@@ -2129,6 +2789,11 @@ static void to_search_region_range(PlumaDocument *doc, GtkTextIter *start,
 
   if (doc->priv->to_search_region == NULL) return;
 
+  /* search highlighting is off for large files */
+  if (doc->priv->pager != NULL) return;
+
+  doc->priv->search_resume_offset = -1;
+
   gtk_text_iter_set_line_offset(start, 0);
   gtk_text_iter_forward_to_line_end(end);
 
@@ -2146,11 +2811,131 @@ static void to_search_region_range(PlumaDocument *doc, GtkTextIter *start,
   gtk_text_iter_forward_lines(end, doc->priv->num_of_lines_search_text);
 
   g_signal_emit(doc, document_signals[SEARCH_HIGHLIGHT_UPDATED], 0, start, end);
+
+  schedule_search_highlighting(doc);
+}
+
+/* The first text between start and end still to be searched, if any */
+static gboolean get_pending_range(PlumaDocument *doc, const GtkTextIter *start,
+                                  const GtkTextIter *end,
+                                  GtkTextIter *pending_start,
+                                  GtkTextIter *pending_end) {
+  PlumaTextRegionIterator reg_iter;
+
+  pluma_text_region_get_iterator(doc->priv->to_search_region, &reg_iter, 0);
+
+  while (!pluma_text_region_iterator_is_end(&reg_iter)) {
+    GtkTextIter sr_start;
+    GtkTextIter sr_end;
+
+    pluma_text_region_iterator_get_subregion(&reg_iter, &sr_start, &sr_end);
+
+    if (gtk_text_iter_compare(&sr_start, end) >= 0) break;
+
+    if (gtk_text_iter_compare(&sr_end, start) > 0 &&
+        !gtk_text_iter_equal(&sr_start, &sr_end)) {
+      *pending_start =
+          gtk_text_iter_compare(&sr_start, start) < 0 ? *start : sr_start;
+      *pending_end = gtk_text_iter_compare(&sr_end, end) > 0 ? *end : sr_end;
+
+      return TRUE;
+    }
+
+    pluma_text_region_iterator_next(&reg_iter);
+  }
+
+  return FALSE;
+}
+
+/* Highlights the text still to be searched between start and end a chunk
+ * at a time until the deadline, returns whether none is left */
+static gboolean search_pending(PlumaDocument *doc, const GtkTextIter *start,
+                               const GtkTextIter *end, gint64 deadline) {
+  GtkTextIter chunk_start;
+  GtkTextIter pending_end;
+
+  while (get_pending_range(doc, start, end, &chunk_start, &pending_end)) {
+    GtkTextIter chunk_end;
+    GtkTextIter line_end;
+    GtkTextIter search_start;
+    GtkTextIter search_end;
+
+    if (g_get_monotonic_time() >= deadline) return FALSE;
+
+    chunk_end = chunk_start;
+    gtk_text_iter_forward_chars(&chunk_end, SEARCH_HIGHLIGHT_CHUNK_SIZE);
+
+    /* up to the line end, unless the line is a long one */
+    line_end = chunk_end;
+    if (!gtk_text_iter_ends_line(&line_end))
+      gtk_text_iter_forward_to_line_end(&line_end);
+
+    if (gtk_text_iter_get_offset(&line_end) -
+            gtk_text_iter_get_offset(&chunk_end) <=
+        SEARCH_HIGHLIGHT_CHUNK_SIZE)
+      chunk_end = line_end;
+
+    if (gtk_text_iter_compare(&chunk_end, &pending_end) > 0)
+      chunk_end = pending_end;
+
+    search_start = chunk_start;
+    search_end = chunk_end;
+
+    if (!search_region(doc, &search_start, &search_end, deadline) &&
+        gtk_text_iter_compare(&search_end, &chunk_end) < 0)
+      chunk_end = search_end;
+
+    pluma_text_region_subtract(doc->priv->to_search_region, &chunk_start,
+                               &chunk_end);
+  }
+
+  return TRUE;
+}
+
+static gboolean search_highlight_idle(PlumaDocument *doc) {
+  GtkTextBuffer *buffer = GTK_TEXT_BUFFER(doc);
+  GtkTextIter visible_start;
+  GtkTextIter visible_end;
+  GtkTextIter begin;
+  GtkTextIter end;
+  gint64 deadline;
+  gboolean done;
+
+  deadline = g_get_monotonic_time() + SEARCH_HIGHLIGHT_IDLE_BUDGET;
+
+  gtk_text_buffer_get_iter_at_line(buffer, &visible_start,
+                                   doc->priv->search_visible_start);
+  gtk_text_buffer_get_iter_at_line(buffer, &visible_end,
+                                   doc->priv->search_visible_end);
+  gtk_text_buffer_get_bounds(buffer, &begin, &end);
+
+  /* what is visible, what comes after it and then what comes before */
+  done = search_pending(doc, &visible_start, &visible_end, deadline) &&
+         search_pending(doc, &visible_end, &end, deadline) &&
+         search_pending(doc, &begin, &visible_start, deadline);
+
+  g_object_notify(G_OBJECT(doc), "search-highlight-progress");
+
+  if (!done) return G_SOURCE_CONTINUE;
+
+  doc->priv->search_highlight_id = 0;
+
+  return G_SOURCE_REMOVE;
+}
+
+/* after the redraws, which have a higher priority */
+static void schedule_search_highlighting(PlumaDocument *doc) {
+  if (doc->priv->search_highlight_id != 0) return;
+
+  doc->priv->search_highlight_id = g_idle_add_full(
+      G_PRIORITY_DEFAULT_IDLE, (GSourceFunc)search_highlight_idle, doc, NULL);
+
+  g_object_notify(G_OBJECT(doc), "search-highlight-progress");
 }
 
 void _pluma_document_search_region(PlumaDocument *doc, const GtkTextIter *start,
                                    const GtkTextIter *end) {
-  PlumaTextRegion *region;
+  gint64 deadline;
 
   pluma_debug(DEBUG_DOCUMENT);
 
@@ -2160,32 +2945,157 @@ void _pluma_document_search_region(PlumaDocument *doc, const GtkTextIter *start,
 
   if (doc->priv->to_search_region == NULL) return;
 
-  /*
-  g_print ("U [%u (%u), %u (%u)]\n", gtk_text_iter_get_line (start),
-  gtk_text_iter_get_offset (start), gtk_text_iter_get_line (end),
-  gtk_text_iter_get_offset (end));
-  */
+  doc->priv->search_visible_start = gtk_text_iter_get_line(start);
+  doc->priv->search_visible_end = gtk_text_iter_get_line(end);
+
+  /* the visible lines within the frame budget, the idle goes on with the
+   * rest */
+  deadline = g_get_monotonic_time() + SEARCH_HIGHLIGHT_FRAME_BUDGET;
+
+  if (!search_pending(doc, start, end, deadline))
+    schedule_search_highlighting(doc);
+}
+
+gdouble _pluma_document_get_search_highlight_progress(PlumaDocument *doc) {
+  PlumaTextRegionIterator reg_iter;
+  gint n_chars;
+  gint pending = 0;
+
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT(doc), 1.0);
+
+  if (doc->priv->to_search_region == NULL) return 1.0;
+
+  n_chars = gtk_text_buffer_get_char_count(GTK_TEXT_BUFFER(doc));
+  if (n_chars == 0) return 1.0;
+
+  pluma_text_region_get_iterator(doc->priv->to_search_region, &reg_iter, 0);
+
+  while (!pluma_text_region_iterator_is_end(&reg_iter)) {
+    GtkTextIter sr_start;
+    GtkTextIter sr_end;
+
+    pluma_text_region_iterator_get_subregion(&reg_iter, &sr_start, &sr_end);
+    pending +=
+        gtk_text_iter_get_offset(&sr_end) - gtk_text_iter_get_offset(&sr_start);
+
+    pluma_text_region_iterator_next(&reg_iter);
+  }
+
+  return 1.0 - MIN(pending, n_chars) / (gdouble)n_chars;
+}
+
+gboolean _pluma_document_get_match_position(PlumaDocument *doc,
+                                            const GtkTextIter *match_start,
+                                            gint *position, gint *n_matches) {
+  gint match_position;
+
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT(doc), FALSE);
+  g_return_val_if_fail(match_start != NULL, FALSE);
+
+  if (!match_index_ready(doc)) return FALSE;
 
-  /* get the subregions not yet highlighted */
-  region = pluma_text_region_intersect(doc->priv->to_search_region, start, end);
-  if (region) {
-    gint i;
-    GtkTextIter start_search;
-    GtkTextIter end_search;
+  match_position = pluma_match_index_get_position(
+      doc->priv->match_index, gtk_text_iter_get_offset(match_start));
 
-    i = pluma_text_region_subregions(region);
-    pluma_text_region_nth_subregion(region, 0, &start_search, NULL);
+  if (match_position < 0) return FALSE;
 
-    pluma_text_region_nth_subregion(region, i - 1, NULL, &end_search);
+  if (position != NULL) *position = match_position + 1;
+
+  if (n_matches != NULL)
+    *n_matches = pluma_match_index_get_n_matches(doc->priv->match_index);
+
+  return TRUE;
+}
+
+/* The text at start has been changed */
+static void update_unsaved_offset(PlumaDocument *doc,
+                                  const GtkTextIter *start) {
+  GtkTextIter iter;
+
+  if (doc->priv->unsaved_offset < 0 ||
+      gtk_text_iter_get_offset(start) > doc->priv->unsaved_offset)
+    return;
+
+  /* the line before too, its \r may now be followed by a \n */
+  iter = *start;
+  gtk_text_iter_backward_char(&iter);
+  gtk_text_iter_set_line_offset(&iter, 0);
+
+  doc->priv->unsaved_offset = gtk_text_iter_get_offset(&iter);
+}
+
+/* What a save writes to the file, besides the text of the buffer */
+static guint64 get_file_hash_seed(PlumaDocument *doc, gboolean normalized) {
+  /* both ways give the same file */
+  normalized = normalized && pluma_document_has_mixed_newlines(doc);
+
+  return ((guint64)doc->priv->newline_type << 2) |
+         ((guint64)(normalized != FALSE) << 1) |
+         (guint64)(doc->priv->implicit_trailing_newline != FALSE);
+}
+
+/* The hash of the text of the buffer, see pluma_utils_hash64() */
+guint64 _pluma_document_hash_text(PlumaDocument *doc, guint64 seed) {
+  GtkTextIter start;
+  GtkTextIter end;
+  guint64 hash = seed;
 
-    pluma_text_region_destroy(region, TRUE);
+  gtk_text_buffer_get_start_iter(GTK_TEXT_BUFFER(doc), &start);
 
-    gtk_text_iter_order(&start_search, &end_search);
+  while (!gtk_text_iter_is_end(&start)) {
+    gchar *text;
 
-    search_region(doc, &start_search, &end_search);
+    end = start;
+    gtk_text_iter_forward_chars(&end, FILE_HASH_SEGMENT_SIZE);
 
-    /* remove the just highlighted region */
-    pluma_text_region_subtract(doc->priv->to_search_region, start, end);
+    text = gtk_text_iter_get_slice(&start, &end);
+    hash = pluma_utils_hash64(text, strlen(text), hash);
+    g_free(text);
+
+    start = end;
+  }
+
+  return hash;
+}
+
+/* The buffer is about to change, the text of the file is hashed while it is
+ * still there */
+static void hash_file_text(PlumaDocument *doc) {
+  if (!doc->priv->file_hash_pending) return;
+
+  doc->priv->file_hash_pending = FALSE;
+  doc->priv->file_hash_valid =
+      gtk_text_buffer_get_char_count(GTK_TEXT_BUFFER(doc)) <=
+      FILE_HASH_MAX_SIZE;
+
+  if (doc->priv->file_hash_valid) {
+    doc->priv->file_hash =
+        _pluma_document_hash_text(doc, doc->priv->file_hash_seed);
+  }
+}
+
+static void before_insert_text_cb(PlumaDocument *doc, GtkTextIter *pos,
+                                  const gchar *text, gint length) {
+  hash_file_text(doc);
+
+  if (doc->priv->match_index != NULL) {
+    pluma_match_index_text_inserted(doc->priv->match_index,
+                                    gtk_text_iter_get_offset(pos),
+                                    g_utf8_strlen(text, length));
+  }
+}
+
+static void before_delete_range_cb(PlumaDocument *doc, GtkTextIter *start,
+                                   GtkTextIter *end) {
+  hash_file_text(doc);
+
+  if (doc->priv->match_index != NULL) {
+    gint start_offset = gtk_text_iter_get_offset(start);
+    gint end_offset = gtk_text_iter_get_offset(end);
+
+    pluma_match_index_text_deleted(doc->priv->match_index,
+                                   MIN(start_offset, end_offset),
+                                   MAX(start_offset, end_offset));
   }
 }
 
@@ -2196,6 +3106,9 @@ static void insert_text_cb(PlumaDocument *doc, GtkTextIter *pos,
 
   pluma_debug(DEBUG_DOCUMENT);
 
+  /* search highlighting is deferred until the load completes */
+  if (doc->priv->loader != NULL) return;
+
   start = end = *pos;
 
   /*
@@ -2206,6 +3119,8 @@ static void insert_text_cb(PlumaDocument *doc, GtkTextIter *pos,
    */
   gtk_text_iter_backward_chars(&start, g_utf8_strlen(text, length));
 
+  update_unsaved_offset(doc, &start);
+
   to_search_region_range(doc, &start, &end);
 }
 
@@ -2216,9 +3131,14 @@ static void delete_range_cb(PlumaDocument *doc, GtkTextIter *start,
 
   pluma_debug(DEBUG_DOCUMENT);
 
+  /* search highlighting is deferred until the load completes */
+  if (doc->priv->loader != NULL) return;
+
   d_start = *start;
   d_end = *end;
 
+  update_unsaved_offset(doc, &d_start);
+
   to_search_region_range(doc, &d_start, &d_end);
 }
 
@@ -2245,8 +3165,21 @@ void pluma_document_set_enable_search_highlighting(PlumaDocument *doc,
 
     pluma_text_region_destroy(doc->priv->to_search_region, TRUE);
     doc->priv->to_search_region = NULL;
+
+    pluma_match_index_free(doc->priv->match_index);
+    doc->priv->match_index = NULL;
+    doc->priv->search_resume_offset = -1;
+
+    if (doc->priv->search_highlight_id != 0) {
+      g_source_remove(doc->priv->search_highlight_id);
+      doc->priv->search_highlight_id = 0;
+    }
+
+    g_object_notify(G_OBJECT(doc), "search-highlight-progress");
   } else {
     doc->priv->to_search_region = pluma_text_region_new(GTK_TEXT_BUFFER(doc));
+    doc->priv->match_index = pluma_match_index_new();
+
     if (pluma_document_get_can_search_again(doc)) {
       /* If search_text is not empty, highligth all its occurrences */
       GtkTextIter begin;
@@ -2272,6 +3205,10 @@ void pluma_document_set_newline_type(PlumaDocument *doc,
   if (doc->priv->newline_type != newline_type) {
     doc->priv->newline_type = newline_type;
 
+    /* the terminators of the file are not the ones the buffer is saved
+     * with anymore */
+    doc->priv->unsaved_offset = -1;
+
     g_object_notify(G_OBJECT(doc), "newline-type");
   }
 }
@@ -2282,6 +3219,117 @@ PlumaDocumentNewlineType pluma_document_get_newline_type(PlumaDocument *doc) {
   return doc->priv->newline_type;
 }
 
+/**
+ * pluma_document_get_newline_count:
+ * @doc: a #PlumaDocument
+ * @type: a line terminator
+ *
+ * Returns: how many @type line terminators the file had when it was last
+ * loaded or saved.
+ */
+guint pluma_document_get_newline_count(PlumaDocument *doc,
+                                       PlumaDocumentNewlineType type) {
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT(doc), 0);
+  g_return_val_if_fail(type <= PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF, 0);
+
+  return doc->priv->newline_counts[type];
+}
+
+/**
+ * pluma_document_has_mixed_newlines:
+ * @doc: a #PlumaDocument
+ *
+ * Returns: %TRUE if the file used more than one kind of line terminator when
+ * it was last loaded or saved.
+ */
+gboolean pluma_document_has_mixed_newlines(PlumaDocument *doc) {
+  const guint *counts;
+
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT(doc), FALSE);
+
+  counts = doc->priv->newline_counts;
+
+  return (counts[PLUMA_DOCUMENT_NEWLINE_TYPE_LF] > 0) +
+             (counts[PLUMA_DOCUMENT_NEWLINE_TYPE_CR] > 0) +
+             (counts[PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF] > 0) >
+         1;
+}
+
+void _pluma_document_set_newline_counts(PlumaDocument *doc,
+                                        const guint *counts) {
+  g_return_if_fail(PLUMA_IS_DOCUMENT(doc));
+  g_return_if_fail(counts != NULL);
+
+  memcpy(doc->priv->newline_counts, counts, sizeof(doc->priv->newline_counts));
+}
+
+/* Records whether the file now holds the text of the buffer, with its line
+ * terminators replaced by the newline type if normalized, see
+ * pluma_document_input_stream_set_normalize_newlines() */
+void _pluma_document_set_file_in_sync(PlumaDocument *doc, gboolean in_sync,
+                                      gboolean normalized) {
+  g_return_if_fail(PLUMA_IS_DOCUMENT(doc));
+
+  doc->priv->unsaved_offset = in_sync ? G_MAXINT : -1;
+  doc->priv->file_newlines_normalized = (normalized != FALSE);
+
+  /* both ways give the same file */
+  doc->priv->file_newlines_unmixed =
+      !normalized && !pluma_document_has_mixed_newlines(doc);
+
+  doc->priv->file_hash_pending = (in_sync != FALSE);
+  doc->priv->file_hash_valid = FALSE;
+  doc->priv->file_hash_seed = get_file_hash_seed(doc, normalized);
+}
+
+/* Whether saving the buffer with @encoding would write the file as it was
+ * last loaded or saved, e.g. once the changes to the buffer are undone. The
+ * file itself is not looked at. */
+gboolean _pluma_document_is_file_unchanged(PlumaDocument *doc,
+                                           const PlumaEncoding *encoding) {
+  gboolean normalized;
+  guint64 seed;
+
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT(doc), FALSE);
+
+  if (encoding != pluma_encoding_get_utf8() || doc->priv->pager != NULL ||
+      doc->priv->partial)
+    return FALSE;
+
+  if (!doc->priv->file_hash_pending && !doc->priv->file_hash_valid)
+    return FALSE;
+
+  /* as the saver does */
+  normalized =
+      !pluma_document_has_mixed_newlines(doc) ||
+      g_settings_get_boolean(doc->priv->editor_settings,
+                             PLUMA_SETTINGS_NORMALIZE_NEWLINES);
+
+  seed = get_file_hash_seed(doc, normalized);
+  if (seed != doc->priv->file_hash_seed) return FALSE;
+
+  return doc->priv->file_hash_pending ||
+         _pluma_document_hash_text(doc, seed) == doc->priv->file_hash;
+}
+
+/* The start of the first line of the buffer which may differ from the file
+ * when the buffer is saved with the same encoding and newline type, the end
+ * of the buffer if none does, or -1 if the file cannot be assumed to hold the
+ * text before it. */
+gint _pluma_document_get_unsaved_offset(PlumaDocument *doc,
+                                        gboolean normalized) {
+  g_return_val_if_fail(PLUMA_IS_DOCUMENT(doc), -1);
+
+  if (doc->priv->unsaved_offset < 0) return -1;
+
+  if (!doc->priv->file_newlines_unmixed &&
+      doc->priv->file_newlines_normalized != (normalized != FALSE))
+    return -1;
+
+  return MIN(doc->priv->unsaved_offset,
+             gtk_text_buffer_get_char_count(GTK_TEXT_BUFFER(doc)));
+}
+
 void _pluma_document_set_mount_operation_factory(
     PlumaDocument *doc, PlumaMountOperationFactory callback,
     gpointer userdata) {
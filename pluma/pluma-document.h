@@ -91,6 +91,20 @@ typedef enum {
   PLUMA_DOCUMENT_SAVE_PRESERVE_BACKUP = 1 << 2
 } PlumaDocumentSaveFlags;
 
+/**
+ * PlumaDocumentLoadRange:
+ * @PLUMA_DOCUMENT_LOAD_RANGE_ALL: load the whole file.
+ * @PLUMA_DOCUMENT_LOAD_RANGE_HEAD: only load the start of the file.
+ * @PLUMA_DOCUMENT_LOAD_RANGE_TAIL: only load the end of the file.
+ *
+ * Which part of a file is loaded, see _pluma_document_set_load_range().
+ */
+typedef enum {
+  PLUMA_DOCUMENT_LOAD_RANGE_ALL,
+  PLUMA_DOCUMENT_LOAD_RANGE_HEAD,
+  PLUMA_DOCUMENT_LOAD_RANGE_TAIL
+} PlumaDocumentLoadRange;
+
 /* Private structure type */
 typedef struct _PlumaDocumentPrivate PlumaDocumentPrivate;
 
@@ -245,6 +259,11 @@ void pluma_document_set_newline_type(PlumaDocument *doc,
 
 PlumaDocumentNewlineType pluma_document_get_newline_type(PlumaDocument *doc);
 
+guint pluma_document_get_newline_count(PlumaDocument *doc,
+                                       PlumaDocumentNewlineType type);
+
+gboolean pluma_document_has_mixed_newlines(PlumaDocument *doc);
+
 gchar *pluma_document_get_metadata(PlumaDocument *doc, const gchar *key);
 
 void pluma_document_set_metadata(PlumaDocument *doc, const gchar *first_key,
@@ -263,6 +282,61 @@ gboolean _pluma_document_check_externally_modified(PlumaDocument *doc);
 void _pluma_document_search_region(PlumaDocument *doc, const GtkTextIter *start,
                                    const GtkTextIter *end);
 
+/* See the PlumaDocument:search-highlight-progress property */
+gdouble _pluma_document_get_search_highlight_progress(PlumaDocument *doc);
+
+/* The position from 1 of the highlighted match at match_start among the
+ * n_matches ones, FALSE while they are not all known */
+gboolean _pluma_document_get_match_position(PlumaDocument *doc,
+                                            const GtkTextIter *match_start,
+                                            gint *position, gint *n_matches);
+
+void _pluma_document_set_mtime(PlumaDocument *doc, gint64 mtime);
+
+/* Large file mode, see pluma-document-pager.h */
+void _pluma_document_set_pager(PlumaDocument *doc,
+                               struct _PlumaDocumentPager *pager);
+
+gboolean _pluma_document_is_paged(PlumaDocument *doc);
+
+gint _pluma_document_get_first_line(PlumaDocument *doc);
+
+gint _pluma_document_move_window(PlumaDocument *doc, gint direction);
+
+/* Partial loads of huge files, see pluma_document_loader_set_range() */
+void _pluma_document_set_load_range(PlumaDocument *doc,
+                                    PlumaDocumentLoadRange range,
+                                    goffset size);
+
+PlumaDocumentLoadRange _pluma_document_get_load_range(PlumaDocument *doc,
+                                                      goffset *size);
+
+gboolean _pluma_document_is_partial(PlumaDocument *doc);
+
+void _pluma_document_set_implicit_trailing_newline(PlumaDocument *doc,
+                                                   gboolean implicit);
+
+gboolean _pluma_document_get_implicit_trailing_newline(PlumaDocument *doc);
+
+/* counts has one entry per PlumaDocumentNewlineType */
+void _pluma_document_set_newline_counts(PlumaDocument *doc,
+                                        const guint *counts);
+
+/* Incremental saves, see pluma-document-saver.c */
+void _pluma_document_set_file_in_sync(PlumaDocument *doc, gboolean in_sync,
+                                      gboolean normalized);
+
+gint _pluma_document_get_unsaved_offset(PlumaDocument *doc,
+                                        gboolean normalized);
+
+gboolean _pluma_document_is_file_unchanged(PlumaDocument *doc,
+                                           const PlumaEncoding *encoding);
+
+guint64 _pluma_document_hash_text(PlumaDocument *doc, guint64 seed);
+
+/* Whether the document can be edited while it is being saved */
+gboolean _pluma_document_is_saving_snapshot(PlumaDocument *doc);
+
 /* Search macros */
 #define PLUMA_SEARCH_IS_DONT_SET_FLAGS(sflags) \
   ((sflags & PLUMA_SEARCH_DONT_SET_FLAGS) != 0)
@@ -61,6 +61,10 @@ void pluma_encoding_free(PlumaEncoding *enc);
 GSList *_pluma_encoding_strv_to_list(const gchar *const *enc_str);
 gchar **_pluma_encoding_list_to_strv(const GSList *enc);
 
+/* The characters of the bytes 0x80 to 0xff if enc is a single byte encoding
+   with a built-in table, 0 for the bytes it does not use, NULL otherwise */
+const guint16 *_pluma_encoding_get_byte_table(const PlumaEncoding *enc);
+
 G_END_DECLS
 
 #endif /* __PLUMA_ENCODINGS_H__ */
@@ -61,6 +61,9 @@ struct _PlumaFileChooserDialogPrivate {
   GtkWidget *newline_label;
   GtkWidget *newline_combo;
   GtkListStore *newline_store;
+
+  GtkWidget *range_label;
+  GtkWidget *range_combo;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE(PlumaFileChooserDialog, pluma_file_chooser_dialog,
@@ -168,6 +171,57 @@ static void create_newline_combo(PlumaFileChooserDialog *dialog) {
   update_newline_visibility(dialog);
 }
 
+static void update_range_visibility(PlumaFileChooserDialog *dialog) {
+  if (gtk_file_chooser_get_action(GTK_FILE_CHOOSER(dialog)) ==
+      GTK_FILE_CHOOSER_ACTION_OPEN) {
+    gtk_widget_show(dialog->priv->range_label);
+    gtk_widget_show(dialog->priv->range_combo);
+  } else {
+    gtk_widget_hide(dialog->priv->range_label);
+    gtk_widget_hide(dialog->priv->range_combo);
+  }
+}
+
+/* the items are in the order of PlumaDocumentLoadRange */
+static void create_range_combo(PlumaFileChooserDialog *dialog) {
+  GtkWidget *label, *combo;
+  guint size;
+  gchar *text;
+
+  label = gtk_label_new_with_mnemonic(_("_Load:"));
+  gtk_label_set_xalign(GTK_LABEL(label), 0.0);
+
+  combo = gtk_combo_box_text_new();
+
+  size = g_settings_get_uint(dialog->priv->filter_settings,
+                             PLUMA_SETTINGS_PARTIAL_LOAD_SIZE);
+
+  gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(combo), _("Whole File"));
+
+  text = g_strdup_printf(_("First %u MB"), size);
+  gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(combo), text);
+  g_free(text);
+
+  text = g_strdup_printf(_("Last %u MB"), size);
+  gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(combo), text);
+  g_free(text);
+
+  gtk_combo_box_set_active(GTK_COMBO_BOX(combo),
+                           PLUMA_DOCUMENT_LOAD_RANGE_ALL);
+
+  gtk_label_set_mnemonic_widget(GTK_LABEL(label), combo);
+
+  gtk_box_pack_start(GTK_BOX(dialog->priv->extra_widget), label, FALSE, TRUE,
+                     0);
+
+  gtk_box_pack_start(GTK_BOX(dialog->priv->extra_widget), combo, TRUE, TRUE, 0);
+
+  dialog->priv->range_combo = combo;
+  dialog->priv->range_label = label;
+
+  update_range_visibility(dialog);
+}
+
 static void create_extra_widget(PlumaFileChooserDialog *dialog) {
   dialog->priv->extra_widget = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
 
@@ -175,6 +229,7 @@ static void create_extra_widget(PlumaFileChooserDialog *dialog) {
 
   create_option_menu(dialog);
   create_newline_combo(dialog);
+  create_range_combo(dialog);
 
   gtk_file_chooser_set_extra_widget(GTK_FILE_CHOOSER(dialog),
                                     dialog->priv->extra_widget);
@@ -200,6 +255,7 @@ static void action_changed(PlumaFileChooserDialog *dialog, GParamSpec *pspec,
   }
 
   update_newline_visibility(dialog);
+  update_range_visibility(dialog);
 }
 
 static void filter_changed(PlumaFileChooserDialog *dialog, GParamSpec *pspec,
@@ -489,3 +545,35 @@ PlumaDocumentNewlineType pluma_file_chooser_dialog_get_newline_type(
 
   return newline_type;
 }
+
+/**
+ * pluma_file_chooser_dialog_get_load_range:
+ * @dialog: a #PlumaFileChooserDialog in open mode
+ * @size: (out): return location for the size of the range in bytes
+ *
+ * Returns: which part of the files to load
+ */
+PlumaDocumentLoadRange pluma_file_chooser_dialog_get_load_range(
+    PlumaFileChooserDialog *dialog, goffset *size) {
+  gint active;
+
+  g_return_val_if_fail(PLUMA_IS_FILE_CHOOSER_DIALOG(dialog),
+                       PLUMA_DOCUMENT_LOAD_RANGE_ALL);
+  g_return_val_if_fail(gtk_file_chooser_get_action(GTK_FILE_CHOOSER(dialog)) ==
+                           GTK_FILE_CHOOSER_ACTION_OPEN,
+                       PLUMA_DOCUMENT_LOAD_RANGE_ALL);
+  g_return_val_if_fail(size != NULL, PLUMA_DOCUMENT_LOAD_RANGE_ALL);
+
+  active = gtk_combo_box_get_active(GTK_COMBO_BOX(dialog->priv->range_combo));
+
+  if (active <= PLUMA_DOCUMENT_LOAD_RANGE_ALL) {
+    *size = 0;
+    return PLUMA_DOCUMENT_LOAD_RANGE_ALL;
+  }
+
+  *size = (goffset)g_settings_get_uint(dialog->priv->filter_settings,
+                                       PLUMA_SETTINGS_PARTIAL_LOAD_SIZE) *
+          1024 * 1024;
+
+  return (PlumaDocumentLoadRange)active;
+}
@@ -88,6 +88,9 @@ void pluma_file_chooser_dialog_set_newline_type(
 PlumaDocumentNewlineType pluma_file_chooser_dialog_get_newline_type(
     PlumaFileChooserDialog *dialog);
 
+PlumaDocumentLoadRange pluma_file_chooser_dialog_get_load_range(
+    PlumaFileChooserDialog *dialog, goffset *size);
+
 G_END_DECLS
 
 #endif /* __PLUMA_FILE_CHOOSER_DIALOG_H__ */
@@ -1097,3 +1097,215 @@ GtkWidget *pluma_externally_modified_message_area_new(
 
   return message_area;
 }
+
+GtkWidget *pluma_partial_load_message_area_new(const gchar *uri,
+                                               PlumaDocumentLoadRange range,
+                                               goffset size) {
+  GtkWidget *message_area;
+  gchar *primary_text;
+  const gchar *secondary_text;
+  gchar *full_formatted_uri;
+  gchar *uri_for_display;
+  gchar *temp_uri_for_display;
+  gchar *size_for_display;
+
+  g_return_val_if_fail(uri != NULL, NULL);
+  g_return_val_if_fail(range != PLUMA_DOCUMENT_LOAD_RANGE_ALL, NULL);
+
+  full_formatted_uri = pluma_utils_uri_for_display(uri);
+
+  /* Truncate the URI so it doesn't get insanely wide. Note that even
+   * though the dialog uses wrapped text, if the URI doesn't contain
+   * white space then the text-wrapping code is too stupid to wrap it.
+   */
+  temp_uri_for_display = pluma_utils_str_middle_truncate(
+      full_formatted_uri, MAX_URI_IN_DIALOG_LENGTH);
+  g_free(full_formatted_uri);
+
+  uri_for_display = g_markup_printf_escaped("<i>%s</i>", temp_uri_for_display);
+  g_free(temp_uri_for_display);
+
+  size_for_display = g_format_size(size);
+
+  if (range == PLUMA_DOCUMENT_LOAD_RANGE_TAIL)
+    primary_text = g_strdup_printf(_("Only the last %s of %s were loaded."),
+                                   size_for_display, uri_for_display);
+  else
+    primary_text = g_strdup_printf(_("Only the first %s of %s were loaded."),
+                                   size_for_display, uri_for_display);
+
+  g_free(size_for_display);
+  g_free(uri_for_display);
+
+  secondary_text =
+      _("The document is read-only. Loading the whole file may take a long "
+        "time.");
+
+  message_area = gtk_info_bar_new();
+
+  info_bar_add_icon_button_with_text(GTK_INFO_BAR(message_area),
+                                     _("Load _Whole File"), "document-open",
+                                     GTK_RESPONSE_OK);
+
+  gtk_button_set_image(
+      GTK_BUTTON(gtk_info_bar_add_button(GTK_INFO_BAR(message_area),
+                                         _("_Close"), GTK_RESPONSE_CANCEL)),
+      gtk_image_new_from_icon_name("window-close", GTK_ICON_SIZE_BUTTON));
+
+  gtk_info_bar_set_message_type(GTK_INFO_BAR(message_area), GTK_MESSAGE_INFO);
+
+  set_message_area_text_and_icon(message_area, "dialog-information",
+                                 primary_text, secondary_text);
+
+  g_free(primary_text);
+
+  return message_area;
+}
+
+GtkWidget *pluma_paged_load_message_area_new(const gchar *uri) {
+  GtkWidget *message_area;
+  gchar *primary_text;
+  const gchar *secondary_text;
+  gchar *full_formatted_uri;
+  gchar *uri_for_display;
+  gchar *temp_uri_for_display;
+
+  g_return_val_if_fail(uri != NULL, NULL);
+
+  full_formatted_uri = pluma_utils_uri_for_display(uri);
+
+  /* Truncate the URI so it doesn't get insanely wide. Note that even
+   * though the dialog uses wrapped text, if the URI doesn't contain
+   * white space then the text-wrapping code is too stupid to wrap it.
+   */
+  temp_uri_for_display = pluma_utils_str_middle_truncate(
+      full_formatted_uri, MAX_URI_IN_DIALOG_LENGTH);
+  g_free(full_formatted_uri);
+
+  uri_for_display = g_markup_printf_escaped("<i>%s</i>", temp_uri_for_display);
+  g_free(temp_uri_for_display);
+
+  primary_text = g_strdup_printf(_("%s is too big to be loaded at once."),
+                                 uri_for_display);
+  g_free(uri_for_display);
+
+  secondary_text =
+      _("Only a part of it is shown at a time, scroll to see the rest. The "
+        "document is read-only and cannot be searched.");
+
+  message_area = gtk_info_bar_new();
+
+  gtk_button_set_image(
+      GTK_BUTTON(gtk_info_bar_add_button(GTK_INFO_BAR(message_area),
+                                         _("_Close"), GTK_RESPONSE_CANCEL)),
+      gtk_image_new_from_icon_name("window-close", GTK_ICON_SIZE_BUTTON));
+
+  gtk_info_bar_set_message_type(GTK_INFO_BAR(message_area), GTK_MESSAGE_INFO);
+
+  set_message_area_text_and_icon(message_area, "dialog-information",
+                                 primary_text, secondary_text);
+
+  g_free(primary_text);
+
+  return message_area;
+}
+
+GtkWidget *pluma_journal_recovered_message_area_new(const gchar *uri) {
+  GtkWidget *message_area;
+  gchar *primary_text;
+  const gchar *secondary_text;
+  gchar *full_formatted_uri;
+  gchar *uri_for_display;
+  gchar *temp_uri_for_display;
+
+  g_return_val_if_fail(uri != NULL, NULL);
+
+  full_formatted_uri = pluma_utils_uri_for_display(uri);
+
+  /* Truncate the URI so it doesn't get insanely wide. Note that even
+   * though the dialog uses wrapped text, if the URI doesn't contain
+   * white space then the text-wrapping code is too stupid to wrap it.
+   */
+  temp_uri_for_display = pluma_utils_str_middle_truncate(
+      full_formatted_uri, MAX_URI_IN_DIALOG_LENGTH);
+  g_free(full_formatted_uri);
+
+  uri_for_display = g_markup_printf_escaped("<i>%s</i>", temp_uri_for_display);
+  g_free(temp_uri_for_display);
+
+  primary_text = g_strdup_printf(
+      _("The unsaved changes to %s were recovered."), uri_for_display);
+  g_free(uri_for_display);
+
+  secondary_text =
+      _("They were kept when pluma was last closed without saving them.");
+
+  message_area = gtk_info_bar_new();
+
+  info_bar_add_icon_button_with_text(GTK_INFO_BAR(message_area),
+                                     _("_Discard Changes"), "document-revert",
+                                     GTK_RESPONSE_OK);
+
+  gtk_button_set_image(
+      GTK_BUTTON(gtk_info_bar_add_button(GTK_INFO_BAR(message_area),
+                                         _("_Close"), GTK_RESPONSE_CANCEL)),
+      gtk_image_new_from_icon_name("window-close", GTK_ICON_SIZE_BUTTON));
+
+  gtk_info_bar_set_message_type(GTK_INFO_BAR(message_area), GTK_MESSAGE_INFO);
+
+  set_message_area_text_and_icon(message_area, "dialog-information",
+                                 primary_text, secondary_text);
+
+  g_free(primary_text);
+
+  return message_area;
+}
+
+GtkWidget *pluma_follow_error_message_area_new(const gchar *uri,
+                                               const GError *error) {
+  GtkWidget *message_area;
+  gchar *primary_text;
+  gchar *secondary_text;
+  gchar *full_formatted_uri;
+  gchar *uri_for_display;
+  gchar *temp_uri_for_display;
+
+  g_return_val_if_fail(uri != NULL, NULL);
+  g_return_val_if_fail(error != NULL, NULL);
+
+  full_formatted_uri = pluma_utils_uri_for_display(uri);
+
+  /* Truncate the URI so it doesn't get insanely wide. Note that even
+   * though the dialog uses wrapped text, if the URI doesn't contain
+   * white space then the text-wrapping code is too stupid to wrap it.
+   */
+  temp_uri_for_display = pluma_utils_str_middle_truncate(
+      full_formatted_uri, MAX_URI_IN_DIALOG_LENGTH);
+  g_free(full_formatted_uri);
+
+  uri_for_display = g_markup_printf_escaped("<i>%s</i>", temp_uri_for_display);
+  g_free(temp_uri_for_display);
+
+  primary_text = g_strdup_printf(_("Stopped following %s."), uri_for_display);
+  g_free(uri_for_display);
+
+  secondary_text = g_markup_escape_text(error->message, -1);
+
+  message_area = gtk_info_bar_new();
+
+  gtk_button_set_image(
+      GTK_BUTTON(gtk_info_bar_add_button(GTK_INFO_BAR(message_area),
+                                         _("_Close"), GTK_RESPONSE_CANCEL)),
+      gtk_image_new_from_icon_name("window-close", GTK_ICON_SIZE_BUTTON));
+
+  gtk_info_bar_set_message_type(GTK_INFO_BAR(message_area),
+                                GTK_MESSAGE_WARNING);
+
+  set_message_area_text_and_icon(message_area, "dialog-warning",
+                                 primary_text, secondary_text);
+
+  g_free(primary_text);
+  g_free(secondary_text);
+
+  return message_area;
+}
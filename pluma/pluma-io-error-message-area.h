@@ -62,6 +62,17 @@ GtkWidget *pluma_unrecoverable_saving_error_message_area_new(
 GtkWidget *pluma_externally_modified_message_area_new(
     const gchar *uri, gboolean document_modified);
 
+GtkWidget *pluma_partial_load_message_area_new(const gchar *uri,
+                                               PlumaDocumentLoadRange range,
+                                               goffset size);
+
+GtkWidget *pluma_paged_load_message_area_new(const gchar *uri);
+
+GtkWidget *pluma_journal_recovered_message_area_new(const gchar *uri);
+
+GtkWidget *pluma_follow_error_message_area_new(const gchar *uri,
+                                               const GError *error);
+
 G_END_DECLS
 
 #endif /* __PLUMA_IO_ERROR_MESSAGE_AREA_H__  */
@@ -0,0 +1,409 @@
+/*
+ * pluma-literal-search.c
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * pluma is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * pluma is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pluma; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "pluma-literal-search.h"
+
+#include <string.h>
+
+/* The characters of the first slice of text looked into, each next one is
+ * twice as long up to MAX_SEGMENT_SIZE, so that a match close by is found
+ * without copying much text */
+#define MIN_SEGMENT_SIZE 256
+#define MAX_SEGMENT_SIZE 65536
+
+/* U+FFFC, which stands for the images and the widgets in the slices */
+#define OBJECT_REPLACEMENT_CHAR "\357\277\274"
+
+struct _PlumaLiteralSearch {
+  GtkTextBuffer *buffer;
+  GtkTextTagTable *tag_table;
+
+  /* whether a tag of the buffer may hide text, checked again after the
+   * tags change */
+  gboolean invisible_checked;
+  gboolean invisible_tags;
+
+  /* the last string looked for, needle holds it with the case folded */
+  gchar *str;
+  gboolean caseless;
+  guchar *needle;
+  gsize length;
+  glong n_chars;
+
+  /* the bytes compare through fold, which folds the ASCII letters to
+   * lower case when the case is ignored */
+  guchar fold[256];
+
+  /* the shifts of the Horspool searches for each byte of the text */
+  gsize forward_shift[256];
+  gsize backward_shift[256];
+};
+
+static void tags_changed_cb(GtkTextTagTable *table, GtkTextTag *tag,
+                            PlumaLiteralSearch *search) {
+  search->invisible_checked = FALSE;
+}
+
+static void tag_changed_cb(GtkTextTagTable *table, GtkTextTag *tag,
+                           gboolean size_changed, PlumaLiteralSearch *search) {
+  search->invisible_checked = FALSE;
+}
+
+static void check_invisible(GtkTextTag *tag, gpointer data) {
+  gboolean *invisible_tags = data;
+  gboolean invisible_set;
+
+  g_object_get(tag, "invisible-set", &invisible_set, NULL);
+
+  if (invisible_set) *invisible_tags = TRUE;
+}
+
+static gboolean has_invisible_tags(PlumaLiteralSearch *search) {
+  if (!search->invisible_checked) {
+    search->invisible_tags = FALSE;
+    gtk_text_tag_table_foreach(search->tag_table, check_invisible,
+                               &search->invisible_tags);
+    search->invisible_checked = TRUE;
+  }
+
+  return search->invisible_tags;
+}
+
+static void update_needle(PlumaLiteralSearch *search, const gchar *str,
+                          gboolean caseless) {
+  gsize i;
+
+  if (search->str != NULL && search->caseless == caseless &&
+      strcmp(search->str, str) == 0)
+    return;
+
+  g_free(search->str);
+  g_free(search->needle);
+
+  search->str = g_strdup(str);
+  search->caseless = caseless;
+  search->length = strlen(str);
+  search->n_chars = g_utf8_strlen(str, -1);
+
+  for (i = 0; i < 256; i++)
+    search->fold[i] = caseless ? g_ascii_tolower(i) : i;
+
+  search->needle = g_malloc(search->length);
+
+  for (i = 0; i < search->length; i++)
+    search->needle[i] = search->fold[(guchar)str[i]];
+
+  /* how far the window can move when a byte of the text is under its last
+   * byte going forward, or under its first byte going backward */
+  for (i = 0; i < 256; i++) {
+    search->forward_shift[i] = search->length;
+    search->backward_shift[i] = search->length;
+  }
+
+  for (i = 0; i + 1 < search->length; i++)
+    search->forward_shift[search->needle[i]] = search->length - 1 - i;
+
+  for (i = search->length - 1; i > 0; i--)
+    search->backward_shift[search->needle[i]] = i;
+}
+
+static gboolean matches_at(PlumaLiteralSearch *search, const guchar *text) {
+  gsize i;
+
+  if (!search->caseless)
+    return memcmp(text, search->needle, search->length) == 0;
+
+  for (i = 0; i < search->length; i++) {
+    if (search->fold[text[i]] != search->needle[i]) return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* the first match in text, memchr() alone finds the single bytes */
+static const gchar *find_forward(PlumaLiteralSearch *search, const gchar *text,
+                                 gsize length) {
+  const guchar *t = (const guchar *)text;
+  gsize last = search->length - 1;
+  gsize pos = 0;
+
+  if (search->length > length) return NULL;
+
+  if (search->length == 1 && !search->caseless)
+    return memchr(text, search->needle[0], length);
+
+  while (pos + last < length) {
+    guchar c = search->fold[t[pos + last]];
+
+    if (c == search->needle[last] && matches_at(search, t + pos))
+      return text + pos;
+
+    pos += search->forward_shift[c];
+  }
+
+  return NULL;
+}
+
+/* the last match in text */
+static const gchar *find_backward(PlumaLiteralSearch *search,
+                                  const gchar *text, gsize length) {
+  const guchar *t = (const guchar *)text;
+  gsize pos;
+
+  if (search->length > length) return NULL;
+
+  pos = length - search->length;
+
+  for (;;) {
+    guchar c = search->fold[t[pos]];
+
+    if (c == search->needle[0] && matches_at(search, t + pos))
+      return text + pos;
+
+    if (pos < search->backward_shift[c]) return NULL;
+
+    pos -= search->backward_shift[c];
+  }
+}
+
+/* Whether a slice of text is searched as GTK would, without images in it
+ * and, when the case is ignored, with only ASCII characters */
+static gboolean can_search_slice(PlumaLiteralSearch *search, const gchar *text,
+                                 GtkTextSearchFlags flags) {
+  const gchar *p;
+
+  if (search->caseless) {
+    for (p = text; *p != '\0'; p++) {
+      if ((guchar)*p >= 0x80) return FALSE;
+    }
+
+    return TRUE;
+  }
+
+  return (flags & GTK_TEXT_SEARCH_TEXT_ONLY) == 0 ||
+         strstr(text, OBJECT_REPLACEMENT_CHAR) == NULL;
+}
+
+static void set_match(PlumaLiteralSearch *search, const GtkTextIter *start,
+                      const gchar *text, const gchar *match,
+                      GtkTextIter *match_start, GtkTextIter *match_end) {
+  GtkTextIter m_start;
+
+  m_start = *start;
+  gtk_text_iter_forward_chars(&m_start, g_utf8_pointer_to_offset(text, match));
+
+  if (match_start != NULL) *match_start = m_start;
+
+  if (match_end != NULL) {
+    *match_end = m_start;
+    gtk_text_iter_forward_chars(match_end, search->n_chars);
+  }
+}
+
+static gboolean search_forward(PlumaLiteralSearch *search,
+                               const GtkTextIter *iter,
+                               const GtkTextIter *limit,
+                               GtkTextSearchFlags flags,
+                               GtkTextIter *match_start,
+                               GtkTextIter *match_end) {
+  GtkTextIter segment_start = *iter;
+  gint segment_size = MIN_SEGMENT_SIZE;
+
+  while (gtk_text_iter_compare(&segment_start, limit) < 0) {
+    GtkTextIter segment_end;
+    GtkTextIter slice_end;
+    gchar *text;
+    const gchar *match;
+
+    segment_end = segment_start;
+    gtk_text_iter_forward_chars(&segment_end, segment_size);
+
+    if (gtk_text_iter_compare(&segment_end, limit) > 0) segment_end = *limit;
+
+    /* with the start of the matches which go on after the segment */
+    slice_end = segment_end;
+    gtk_text_iter_forward_chars(&slice_end, search->n_chars);
+
+    if (gtk_text_iter_compare(&slice_end, limit) > 0) slice_end = *limit;
+
+    text = gtk_text_iter_get_slice(&segment_start, &slice_end);
+
+    if (!can_search_slice(search, text, flags)) {
+      g_free(text);
+
+      return gtk_text_iter_forward_search(&segment_start, search->str, flags,
+                                          match_start, match_end, limit);
+    }
+
+    /* then no match starts before it in the segments after */
+    match = find_forward(search, text, strlen(text));
+
+    if (match != NULL)
+      set_match(search, &segment_start, text, match, match_start, match_end);
+
+    g_free(text);
+
+    if (match != NULL) return TRUE;
+
+    segment_start = segment_end;
+    segment_size = MIN(segment_size * 2, MAX_SEGMENT_SIZE);
+  }
+
+  return FALSE;
+}
+
+static gboolean search_backward(PlumaLiteralSearch *search,
+                                const GtkTextIter *iter,
+                                const GtkTextIter *limit,
+                                GtkTextSearchFlags flags,
+                                GtkTextIter *match_start,
+                                GtkTextIter *match_end) {
+  GtkTextIter segment_end = *iter;
+  gint segment_size = MIN_SEGMENT_SIZE;
+
+  while (gtk_text_iter_compare(&segment_end, limit) > 0) {
+    GtkTextIter segment_start;
+    GtkTextIter slice_start;
+    gchar *text;
+    const gchar *match;
+
+    segment_start = segment_end;
+    gtk_text_iter_backward_chars(&segment_start, segment_size);
+
+    if (gtk_text_iter_compare(&segment_start, limit) < 0)
+      segment_start = *limit;
+
+    /* with the end of the matches which start before the segment */
+    slice_start = segment_start;
+    gtk_text_iter_backward_chars(&slice_start, search->n_chars);
+
+    if (gtk_text_iter_compare(&slice_start, limit) < 0) slice_start = *limit;
+
+    text = gtk_text_iter_get_slice(&slice_start, &segment_end);
+
+    if (!can_search_slice(search, text, flags)) {
+      g_free(text);
+
+      return gtk_text_iter_backward_search(&segment_end, search->str, flags,
+                                           match_start, match_end, limit);
+    }
+
+    match = find_backward(search, text, strlen(text));
+
+    if (match != NULL)
+      set_match(search, &slice_start, text, match, match_start, match_end);
+
+    g_free(text);
+
+    if (match != NULL) return TRUE;
+
+    segment_end = segment_start;
+    segment_size = MIN(segment_size * 2, MAX_SEGMENT_SIZE);
+  }
+
+  return FALSE;
+}
+
+PlumaLiteralSearch *pluma_literal_search_new(GtkTextBuffer *buffer) {
+  PlumaLiteralSearch *search;
+
+  g_return_val_if_fail(GTK_IS_TEXT_BUFFER(buffer), NULL);
+
+  search = g_slice_new0(PlumaLiteralSearch);
+  search->buffer = buffer;
+  search->tag_table = gtk_text_buffer_get_tag_table(buffer);
+
+  g_signal_connect(search->tag_table, "tag-added",
+                   G_CALLBACK(tags_changed_cb), search);
+  g_signal_connect(search->tag_table, "tag-removed",
+                   G_CALLBACK(tags_changed_cb), search);
+  g_signal_connect(search->tag_table, "tag-changed",
+                   G_CALLBACK(tag_changed_cb), search);
+
+  return search;
+}
+
+void pluma_literal_search_free(PlumaLiteralSearch *search) {
+  if (search == NULL) return;
+
+  g_signal_handlers_disconnect_by_data(search->tag_table, search);
+
+  g_free(search->str);
+  g_free(search->needle);
+
+  g_slice_free(PlumaLiteralSearch, search);
+}
+
+gboolean pluma_literal_search_find(PlumaLiteralSearch *search, const gchar *str,
+                                   GtkTextSearchFlags flags,
+                                   const GtkTextIter *iter,
+                                   const GtkTextIter *limit,
+                                   gboolean forward_search,
+                                   GtkTextIter *match_start,
+                                   GtkTextIter *match_end) {
+  GtkTextIter bound;
+  gboolean caseless;
+  const gchar *p;
+
+  g_return_val_if_fail(search != NULL, FALSE);
+  g_return_val_if_fail(str != NULL, FALSE);
+  g_return_val_if_fail(iter != NULL, FALSE);
+
+  caseless = (flags & GTK_TEXT_SEARCH_CASE_INSENSITIVE) != 0;
+
+  /* GTK folds the case of the other characters its own way, and finds the
+   * empty string anywhere */
+  for (p = str; caseless && *p != '\0'; p++) {
+    if ((guchar)*p >= 0x80) break;
+  }
+
+  if (*str == '\0' || (caseless && *p != '\0') ||
+      ((flags & GTK_TEXT_SEARCH_VISIBLE_ONLY) != 0 &&
+       has_invisible_tags(search))) {
+    if (forward_search)
+      return gtk_text_iter_forward_search(iter, str, flags, match_start,
+                                          match_end, limit);
+    else
+      return gtk_text_iter_backward_search(iter, str, flags, match_start,
+                                           match_end, limit);
+  }
+
+  update_needle(search, str, caseless);
+
+  if (limit != NULL)
+    bound = *limit;
+  else if (forward_search)
+    gtk_text_buffer_get_end_iter(search->buffer, &bound);
+  else
+    gtk_text_buffer_get_start_iter(search->buffer, &bound);
+
+  if (forward_search)
+    return search_forward(search, iter, &bound, flags, match_start,
+                          match_end);
+  else
+    return search_backward(search, iter, &bound, flags, match_start,
+                           match_end);
+}
@@ -0,0 +1,54 @@
+/*
+ * pluma-literal-search.h
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * pluma is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * pluma is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pluma; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __PLUMA_LITERAL_SEARCH_H__
+#define __PLUMA_LITERAL_SEARCH_H__
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+/* Searches a buffer for a string in slices of its text with the
+ * Boyer-Moore-Horspool algorithm, instead of a character at a time like
+ * gtk_text_iter_forward_search(). The text it cannot search the same way,
+ * as text hidden by a tag, images or, ignoring the case, anything but
+ * ASCII, is left to GTK. */
+typedef struct _PlumaLiteralSearch PlumaLiteralSearch;
+
+PlumaLiteralSearch *pluma_literal_search_new(GtkTextBuffer *buffer);
+
+void pluma_literal_search_free(PlumaLiteralSearch *search);
+
+/* Looks for str from iter to limit, or to the end of the buffer when
+   searching forward and to its start when searching backward, like
+   gtk_text_iter_forward_search() and gtk_text_iter_backward_search(). */
+gboolean pluma_literal_search_find(PlumaLiteralSearch *search, const gchar *str,
+                                   GtkTextSearchFlags flags,
+                                   const GtkTextIter *iter,
+                                   const GtkTextIter *limit,
+                                   gboolean forward_search,
+                                   GtkTextIter *match_start,
+                                   GtkTextIter *match_end);
+
+G_END_DECLS
+
+#endif /* __PLUMA_LITERAL_SEARCH_H__ */
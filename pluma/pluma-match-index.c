@@ -0,0 +1,404 @@
+/*
+ * pluma-match-index.c
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * pluma is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * pluma is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pluma; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "pluma-match-index.h"
+
+#include <string.h>
+
+/* matches split off a block, which is split when it holds twice as many */
+#define MATCH_BLOCK_SIZE 1024
+
+typedef struct {
+  gint start;
+  gint end;
+} Match;
+
+/* The offsets of the matches are relative to base, which is at or before
+ * the first of them. Blocks are never empty. */
+typedef struct {
+  gint base;
+  GArray *matches;
+} Block;
+
+struct _PlumaMatchIndex {
+  GPtrArray *blocks;
+  guint n_matches;
+};
+
+#define BLOCK_MATCH(block, i) (&g_array_index((block)->matches, Match, (i)))
+#define INDEX_BLOCK(index, i) ((Block *)g_ptr_array_index((index)->blocks, (i)))
+
+static Block *block_new(gint base) {
+  Block *block;
+
+  block = g_slice_new(Block);
+  block->base = base;
+  block->matches = g_array_new(FALSE, FALSE, sizeof(Match));
+
+  return block;
+}
+
+static void block_free(Block *block) {
+  g_array_free(block->matches, TRUE);
+  g_slice_free(Block, block);
+}
+
+static gint block_get_start(Block *block) {
+  return block->base + BLOCK_MATCH(block, 0)->start;
+}
+
+static void block_rebase(Block *block, gint base) {
+  gint delta = block->base - base;
+  guint i;
+
+  for (i = 0; i < block->matches->len; i++) {
+    BLOCK_MATCH(block, i)->start += delta;
+    BLOCK_MATCH(block, i)->end += delta;
+  }
+
+  block->base = base;
+}
+
+/* the first match of the block starting at or after offset */
+static guint block_find_start(Block *block, gint offset) {
+  guint low = 0;
+  guint high = block->matches->len;
+
+  offset -= block->base;
+
+  while (low < high) {
+    guint mid = (low + high) / 2;
+
+    if (BLOCK_MATCH(block, mid)->start < offset)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return low;
+}
+
+/* the number of matches of the block ending at or before offset, as they
+ * do not overlap their ends are in order too */
+static guint block_count_ended(Block *block, gint offset) {
+  guint low = 0;
+  guint high = block->matches->len;
+
+  offset -= block->base;
+
+  while (low < high) {
+    guint mid = (low + high) / 2;
+
+    if (BLOCK_MATCH(block, mid)->end <= offset)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return low;
+}
+
+/* The last block whose first match starts at or before offset, or the
+ * first block when there is none */
+static guint find_block(PlumaMatchIndex *index, gint offset) {
+  guint low = 0;
+  guint high = index->blocks->len;
+
+  while (low < high) {
+    guint mid = (low + high) / 2;
+
+    if (block_get_start(INDEX_BLOCK(index, mid)) <= offset)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return low > 0 ? low - 1 : 0;
+}
+
+static void split_block(PlumaMatchIndex *index, guint i) {
+  Block *block = INDEX_BLOCK(index, i);
+
+  while (block->matches->len > 2 * MATCH_BLOCK_SIZE) {
+    guint first = block->matches->len - MATCH_BLOCK_SIZE;
+    Block *tail;
+
+    tail = block_new(block->base);
+    g_array_append_vals(tail->matches, BLOCK_MATCH(block, first),
+                        MATCH_BLOCK_SIZE);
+    block_rebase(tail, block_get_start(tail));
+
+    g_array_set_size(block->matches, first);
+    g_ptr_array_insert(index->blocks, i + 1, tail);
+  }
+}
+
+/* Drops the matches overlapping the text from start to end and moves the
+ * ones after it shift characters back */
+static void remove_range(PlumaMatchIndex *index, gint start, gint end,
+                         gint shift) {
+  guint i;
+
+  if (index->blocks->len == 0) return;
+
+  i = find_block(index, start);
+
+  while (i < index->blocks->len) {
+    Block *block = INDEX_BLOCK(index, i);
+    guint n_kept = 0;
+    guint j;
+
+    if (block_get_start(block) >= end) {
+      block->base -= shift;
+      i++;
+      continue;
+    }
+
+    for (j = 0; j < block->matches->len; j++) {
+      Match match = *BLOCK_MATCH(block, j);
+
+      if (block->base + match.start >= end) {
+        match.start -= shift;
+        match.end -= shift;
+      } else if (block->base + match.end > start) {
+        index->n_matches--;
+        continue;
+      }
+
+      *BLOCK_MATCH(block, n_kept++) = match;
+    }
+
+    g_array_set_size(block->matches, n_kept);
+
+    if (n_kept == 0) {
+      g_ptr_array_remove_index(index->blocks, i);
+      continue;
+    }
+
+    if (BLOCK_MATCH(block, 0)->start < 0)
+      block_rebase(block, block_get_start(block));
+
+    i++;
+  }
+}
+
+PlumaMatchIndex *pluma_match_index_new(void) {
+  PlumaMatchIndex *index;
+
+  index = g_slice_new0(PlumaMatchIndex);
+  index->blocks = g_ptr_array_new_with_free_func((GDestroyNotify)block_free);
+
+  return index;
+}
+
+void pluma_match_index_free(PlumaMatchIndex *index) {
+  if (index == NULL) return;
+
+  g_ptr_array_free(index->blocks, TRUE);
+
+  g_slice_free(PlumaMatchIndex, index);
+}
+
+void pluma_match_index_clear(PlumaMatchIndex *index) {
+  g_return_if_fail(index != NULL);
+
+  g_ptr_array_set_size(index->blocks, 0);
+  index->n_matches = 0;
+}
+
+void pluma_match_index_text_inserted(PlumaMatchIndex *index, gint offset,
+                                     gint length) {
+  guint i;
+
+  g_return_if_fail(index != NULL);
+
+  if (length <= 0 || index->blocks->len == 0) return;
+
+  /* the blocks before it end before offset */
+  for (i = find_block(index, offset); i < index->blocks->len; i++) {
+    Block *block = INDEX_BLOCK(index, i);
+    guint j;
+
+    if (block->base >= offset) {
+      block->base += length;
+      continue;
+    }
+
+    for (j = 0; j < block->matches->len; j++) {
+      Match *match = BLOCK_MATCH(block, j);
+
+      /* a match around offset grows until it is searched again */
+      if (block->base + match->start >= offset)
+        match->start += length;
+
+      if (block->base + match->end > offset) match->end += length;
+    }
+  }
+}
+
+void pluma_match_index_text_deleted(PlumaMatchIndex *index, gint start,
+                                    gint end) {
+  g_return_if_fail(index != NULL);
+
+  if (end <= start) return;
+
+  remove_range(index, start, end, end - start);
+}
+
+void pluma_match_index_set_range(PlumaMatchIndex *index, gint start, gint end,
+                                 const gint *offsets, guint n_matches) {
+  Block *block;
+  guint i;
+  guint j;
+  guint k;
+
+  g_return_if_fail(index != NULL);
+  g_return_if_fail(offsets != NULL || n_matches == 0);
+
+  remove_range(index, start, end, 0);
+
+  if (n_matches == 0) return;
+
+  if (index->blocks->len == 0) {
+    i = 0;
+    g_ptr_array_add(index->blocks, block_new(offsets[0]));
+  } else {
+    i = find_block(index, offsets[0]);
+  }
+
+  block = INDEX_BLOCK(index, i);
+
+  if (block->matches->len > 0 && offsets[0] < block->base)
+    block_rebase(block, offsets[0]);
+  else if (block->matches->len == 0)
+    block->base = offsets[0];
+
+  /* nothing is left between the matches around them */
+  j = block_find_start(block, offsets[0]);
+
+  g_array_set_size(block->matches, block->matches->len + n_matches);
+  memmove(BLOCK_MATCH(block, j + n_matches), BLOCK_MATCH(block, j),
+          (block->matches->len - n_matches - j) * sizeof(Match));
+
+  for (k = 0; k < n_matches; k++) {
+    BLOCK_MATCH(block, j + k)->start = offsets[2 * k] - block->base;
+    BLOCK_MATCH(block, j + k)->end = offsets[2 * k + 1] - block->base;
+  }
+
+  index->n_matches += n_matches;
+
+  split_block(index, i);
+}
+
+guint pluma_match_index_get_n_matches(PlumaMatchIndex *index) {
+  g_return_val_if_fail(index != NULL, 0);
+
+  return index->n_matches;
+}
+
+gboolean pluma_match_index_find_next(PlumaMatchIndex *index, gint offset,
+                                     gint *match_start, gint *match_end) {
+  Block *block;
+  guint i;
+  guint j;
+
+  g_return_val_if_fail(index != NULL, FALSE);
+
+  if (index->blocks->len == 0) return FALSE;
+
+  i = find_block(index, offset);
+  block = INDEX_BLOCK(index, i);
+  j = block_find_start(block, offset);
+
+  /* then the first match of the next block is after offset */
+  if (j == block->matches->len) {
+    if (++i == index->blocks->len) return FALSE;
+
+    block = INDEX_BLOCK(index, i);
+    j = 0;
+  }
+
+  if (match_start != NULL)
+    *match_start = block->base + BLOCK_MATCH(block, j)->start;
+
+  if (match_end != NULL) *match_end = block->base + BLOCK_MATCH(block, j)->end;
+
+  return TRUE;
+}
+
+gboolean pluma_match_index_find_previous(PlumaMatchIndex *index, gint offset,
+                                         gint *match_start, gint *match_end) {
+  Block *block;
+  guint i;
+  guint j;
+
+  g_return_val_if_fail(index != NULL, FALSE);
+
+  if (index->blocks->len == 0) return FALSE;
+
+  i = find_block(index, offset);
+  block = INDEX_BLOCK(index, i);
+  j = block_count_ended(block, offset);
+
+  /* then the last match of the previous block ends before offset */
+  if (j == 0) {
+    if (i == 0) return FALSE;
+
+    block = INDEX_BLOCK(index, i - 1);
+    j = block->matches->len;
+  }
+
+  if (match_start != NULL)
+    *match_start = block->base + BLOCK_MATCH(block, j - 1)->start;
+
+  if (match_end != NULL)
+    *match_end = block->base + BLOCK_MATCH(block, j - 1)->end;
+
+  return TRUE;
+}
+
+gint pluma_match_index_get_position(PlumaMatchIndex *index, gint match_start) {
+  Block *block;
+  gint position = 0;
+  guint i;
+  guint j;
+
+  g_return_val_if_fail(index != NULL, -1);
+
+  if (index->blocks->len == 0) return -1;
+
+  i = find_block(index, match_start);
+  block = INDEX_BLOCK(index, i);
+  j = block_find_start(block, match_start);
+
+  if (j == block->matches->len ||
+      block->base + BLOCK_MATCH(block, j)->start != match_start)
+    return -1;
+
+  while (i > 0) position += INDEX_BLOCK(index, --i)->matches->len;
+
+  return position + j;
+}
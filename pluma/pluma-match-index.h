@@ -0,0 +1,73 @@
+/*
+ * pluma-match-index.h
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * pluma is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * pluma is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pluma; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __PLUMA_MATCH_INDEX_H__
+#define __PLUMA_MATCH_INDEX_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* The character offsets of the matches of the search text in a buffer, in
+ * order and without overlaps. The matches are kept in blocks whose offsets
+ * are relative to the start of the block, so that an edit only moves the
+ * matches of its own block and the starts of the blocks after it. */
+typedef struct _PlumaMatchIndex PlumaMatchIndex;
+
+PlumaMatchIndex *pluma_match_index_new(void);
+
+void pluma_match_index_free(PlumaMatchIndex *index);
+
+void pluma_match_index_clear(PlumaMatchIndex *index);
+
+/* length characters have been inserted at offset */
+void pluma_match_index_text_inserted(PlumaMatchIndex *index, gint offset,
+                                     gint length);
+
+/* the characters from start to end have been deleted, the matches which
+ * overlap them are dropped */
+void pluma_match_index_text_deleted(PlumaMatchIndex *index, gint start,
+                                    gint end);
+
+/* Replaces the matches which overlap the text from start to end with the
+ * n_matches ones found there again, given as pairs of start and end
+ * offsets in offsets */
+void pluma_match_index_set_range(PlumaMatchIndex *index, gint start, gint end,
+                                 const gint *offsets, guint n_matches);
+
+guint pluma_match_index_get_n_matches(PlumaMatchIndex *index);
+
+/* the first match starting at or after offset */
+gboolean pluma_match_index_find_next(PlumaMatchIndex *index, gint offset,
+                                     gint *match_start, gint *match_end);
+
+/* the last match ending at or before offset */
+gboolean pluma_match_index_find_previous(PlumaMatchIndex *index, gint offset,
+                                         gint *match_start, gint *match_end);
+
+/* The position from 0 of the match starting at match_start, or -1 if no
+ * match starts there */
+gint pluma_match_index_get_position(PlumaMatchIndex *index, gint match_start);
+
+G_END_DECLS
+
+#endif /* __PLUMA_MATCH_INDEX_H__ */
@@ -0,0 +1,440 @@
+/*
+ * pluma-regex-search.c
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * pluma is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * pluma is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pluma; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "pluma-regex-search.h"
+
+#include <string.h>
+
+#include "pluma-debug.h"
+
+/* characters between two entries of the offset map */
+#define OFFSET_MAP_STEP 1024
+
+/* backtracking steps of one match */
+#define MATCH_LIMIT 1000000
+
+struct _PlumaRegexSearch {
+  GtkTextBuffer *buffer;
+
+  /* the last pattern, regex is NULL if it does not compile */
+  gchar *pattern;
+  GRegexCompileFlags compile_flags;
+  GRegex *regex;
+
+  /* A copy of the text of the buffer, NULL until a search needs it. The
+   * characters of the buffer from valid_offset on are shift characters
+   * further than in the copy, the edits before them made the copy stale. */
+  gchar *text;
+  gsize length;
+  gint n_chars;
+  gint valid_offset;
+  gint shift;
+
+  /* the byte index in text of every OFFSET_MAP_STEP-th character */
+  GArray *offset_map;
+
+  /* the last character looked up, the searches mostly go forward */
+  gint cursor_offset;
+  gsize cursor_index;
+};
+
+static void drop_text(PlumaRegexSearch *search) {
+  g_free(search->text);
+  search->text = NULL;
+
+  g_array_set_size(search->offset_map, 0);
+}
+
+static void copy_text(PlumaRegexSearch *search) {
+  GtkTextIter start;
+  GtkTextIter end;
+  gint offset;
+  gsize index = 0;
+
+  pluma_debug(DEBUG_SEARCH);
+
+  gtk_text_buffer_get_bounds(search->buffer, &start, &end);
+
+  /* the hidden characters and the images keep their place */
+  search->text = gtk_text_iter_get_slice(&start, &end);
+  search->length = strlen(search->text);
+  search->n_chars = gtk_text_iter_get_offset(&end);
+  search->valid_offset = 0;
+  search->shift = 0;
+  search->cursor_offset = 0;
+  search->cursor_index = 0;
+
+  for (offset = 0; offset <= search->n_chars; offset += OFFSET_MAP_STEP) {
+    if (offset > 0) {
+      index = g_utf8_offset_to_pointer(search->text + index, OFFSET_MAP_STEP) -
+              search->text;
+    }
+
+    g_array_append_val(search->offset_map, index);
+  }
+}
+
+/* start and old_end are the bounds of the changed text before the change,
+ * new_end is its end after it */
+static void text_changed(PlumaRegexSearch *search, gint start, gint old_end,
+                         gint new_end) {
+  if (start < search->valid_offset) {
+    drop_text(search);
+    return;
+  }
+
+  search->valid_offset = new_end;
+  search->shift += new_end - old_end;
+}
+
+static void insert_text_cb(GtkTextBuffer *buffer, GtkTextIter *pos,
+                           const gchar *text, gint length,
+                           PlumaRegexSearch *search) {
+  gint offset;
+
+  if (search->text == NULL) return;
+
+  offset = gtk_text_iter_get_offset(pos);
+  text_changed(search, offset, offset, offset + g_utf8_strlen(text, length));
+}
+
+static void delete_range_cb(GtkTextBuffer *buffer, GtkTextIter *start,
+                            GtkTextIter *end, PlumaRegexSearch *search) {
+  gint start_offset;
+  gint end_offset;
+
+  if (search->text == NULL) return;
+
+  start_offset = gtk_text_iter_get_offset(start);
+  end_offset = gtk_text_iter_get_offset(end);
+
+  text_changed(search, MIN(start_offset, end_offset),
+               MAX(start_offset, end_offset), MIN(start_offset, end_offset));
+}
+
+/* The byte index of a character of the copy, walking from the last one
+ * looked up when it is closer than the offset map */
+static gsize get_index(PlumaRegexSearch *search, gint offset) {
+  gint entry = offset / OFFSET_MAP_STEP;
+  const gchar *p;
+
+  if (search->cursor_offset > offset ||
+      search->cursor_offset < entry * OFFSET_MAP_STEP) {
+    search->cursor_offset = entry * OFFSET_MAP_STEP;
+    search->cursor_index = g_array_index(search->offset_map, gsize, entry);
+  }
+
+  p = g_utf8_offset_to_pointer(search->text + search->cursor_index,
+                               offset - search->cursor_offset);
+
+  search->cursor_offset = offset;
+  search->cursor_index = p - search->text;
+
+  return search->cursor_index;
+}
+
+/* The character of the copy at a byte index */
+static gint get_offset(PlumaRegexSearch *search, gsize index) {
+  GArray *map = search->offset_map;
+  guint low = 0;
+  guint high = map->len;
+
+  /* the last entry at or before index */
+  while (high - low > 1) {
+    guint mid = (low + high) / 2;
+
+    if (g_array_index(map, gsize, mid) <= index)
+      low = mid;
+    else
+      high = mid;
+  }
+
+  if (search->cursor_index > index ||
+      search->cursor_index < g_array_index(map, gsize, low)) {
+    search->cursor_offset = low * OFFSET_MAP_STEP;
+    search->cursor_index = g_array_index(map, gsize, low);
+  }
+
+  search->cursor_offset +=
+      g_utf8_pointer_to_offset(search->text + search->cursor_index,
+                               search->text + index);
+  search->cursor_index = index;
+
+  return search->cursor_offset;
+}
+
+static gboolean update_regex(PlumaRegexSearch *search, const gchar *pattern,
+                             GtkTextSearchFlags flags) {
+  GRegexCompileFlags compile_flags;
+  gchar *limited;
+
+  compile_flags = G_REGEX_OPTIMIZE | G_REGEX_MULTILINE;
+
+  if ((flags & GTK_TEXT_SEARCH_CASE_INSENSITIVE) != 0)
+    compile_flags |= G_REGEX_CASELESS;
+
+  if (search->pattern != NULL && search->compile_flags == compile_flags &&
+      strcmp(search->pattern, pattern) == 0)
+    return search->regex != NULL;
+
+  pluma_debug_message(DEBUG_SEARCH, "compiling %s", pattern);
+
+  if (search->regex != NULL) g_regex_unref(search->regex);
+
+  g_free(search->pattern);
+  search->pattern = g_strdup(pattern);
+  search->compile_flags = compile_flags;
+
+  /* the matching is bounded, a pattern which backtracks without end fails
+   * instead of hanging the editor */
+  limited = g_strdup_printf("(*LIMIT_MATCH=%d)%s", MATCH_LIMIT, pattern);
+  search->regex = g_regex_new(limited, compile_flags, 0, NULL);
+  g_free(limited);
+
+  return search->regex != NULL;
+}
+
+PlumaRegexSearch *pluma_regex_search_new(GtkTextBuffer *buffer) {
+  PlumaRegexSearch *search;
+
+  g_return_val_if_fail(GTK_IS_TEXT_BUFFER(buffer), NULL);
+
+  search = g_slice_new0(PlumaRegexSearch);
+  search->buffer = buffer;
+  search->offset_map = g_array_new(FALSE, FALSE, sizeof(gsize));
+
+  g_signal_connect(buffer, "insert-text", G_CALLBACK(insert_text_cb), search);
+  g_signal_connect(buffer, "delete-range", G_CALLBACK(delete_range_cb),
+                   search);
+
+  return search;
+}
+
+void pluma_regex_search_free(PlumaRegexSearch *search) {
+  if (search == NULL) return;
+
+  g_signal_handlers_disconnect_by_data(search->buffer, search);
+
+  if (search->regex != NULL) g_regex_unref(search->regex);
+
+  g_free(search->pattern);
+  g_free(search->text);
+  g_array_free(search->offset_map, TRUE);
+
+  g_slice_free(PlumaRegexSearch, search);
+}
+
+gboolean pluma_regex_search_find(PlumaRegexSearch *search,
+                                 const gchar *pattern,
+                                 GtkTextSearchFlags flags,
+                                 const GtkTextIter *iter,
+                                 const GtkTextIter *limit,
+                                 gboolean forward_search,
+                                 GtkTextIter *match_start,
+                                 GtkTextIter *match_end, gchar **replace_text) {
+  GtkTextIter bound;
+  GRegexMatchFlags match_flags = 0;
+  GMatchInfo *match_info;
+  const gchar *subject;
+  gint start_offset;
+  gint end_offset;
+  gsize valid_index;
+  gsize start_index;
+  gsize end_index;
+  gint start_pos;
+  gint end_pos;
+  gboolean found;
+
+  g_return_val_if_fail(search != NULL, FALSE);
+  g_return_val_if_fail(pattern != NULL, FALSE);
+  g_return_val_if_fail(iter != NULL, FALSE);
+
+  if (!update_regex(search, pattern, flags)) return FALSE;
+
+  if (limit != NULL)
+    bound = *limit;
+  else if (forward_search)
+    gtk_text_buffer_get_end_iter(search->buffer, &bound);
+  else
+    gtk_text_buffer_get_start_iter(search->buffer, &bound);
+
+  start_offset = gtk_text_iter_get_offset(iter);
+  end_offset = gtk_text_iter_get_offset(&bound);
+
+  if (start_offset > end_offset) {
+    gint tmp = start_offset;
+
+    start_offset = end_offset;
+    end_offset = tmp;
+  }
+
+  if (search->text == NULL || start_offset < search->valid_offset) {
+    drop_text(search);
+    copy_text(search);
+  }
+
+  /* The text before valid_offset is not in the copy anymore, only whether
+   * a line starts there is known */
+  if (search->valid_offset > 0) {
+    GtkTextIter valid_iter;
+
+    gtk_text_buffer_get_iter_at_offset(search->buffer, &valid_iter,
+                                       search->valid_offset);
+
+    if (!gtk_text_iter_starts_line(&valid_iter))
+      match_flags |= G_REGEX_MATCH_NOTBOL;
+  }
+
+  /* in order, so that each lookup walks on from the previous one, and the
+   * matches from the start */
+  if (end_offset - search->shift == search->n_chars)
+    end_index = search->length;
+  else
+    end_index = get_index(search, end_offset - search->shift);
+
+  valid_index = get_index(search, search->valid_offset - search->shift);
+  start_index = get_index(search, start_offset - search->shift);
+
+  subject = search->text + valid_index;
+
+  g_regex_match_full(search->regex, subject, end_index - valid_index,
+                     start_index - valid_index, match_flags, &match_info,
+                     NULL);
+
+  found = g_match_info_matches(match_info);
+
+  if (found && !forward_search) {
+    /* the last match, found again for its references */
+    do {
+      g_match_info_fetch_pos(match_info, 0, &start_pos, NULL);
+    } while (g_match_info_next(match_info, NULL));
+
+    g_match_info_free(match_info);
+    g_regex_match_full(search->regex, subject, end_index - valid_index,
+                       start_pos, match_flags, &match_info, NULL);
+  }
+
+  if (found) {
+    GtkTextIter m_start;
+    GtkTextIter m_end;
+
+    g_match_info_fetch_pos(match_info, 0, &start_pos, &end_pos);
+
+    start_offset = get_offset(search, valid_index + start_pos) + search->shift;
+    end_offset = get_offset(search, valid_index + end_pos) + search->shift;
+
+    gtk_text_buffer_get_iter_at_offset(search->buffer, &m_start, start_offset);
+    m_end = m_start;
+    gtk_text_iter_forward_chars(&m_end, end_offset - start_offset);
+
+    if (match_start != NULL) *match_start = m_start;
+
+    if (match_end != NULL) *match_end = m_end;
+
+    if (replace_text != NULL && *replace_text != NULL) {
+      gchar *expanded;
+
+      expanded =
+          g_match_info_expand_references(match_info, *replace_text, NULL);
+      g_free(*replace_text);
+      *replace_text = expanded;
+    }
+  }
+
+  g_match_info_free(match_info);
+
+  return found;
+}
+
+gboolean pluma_regex_search_foreach(PlumaRegexSearch *search,
+                                    const gchar *pattern,
+                                    GtkTextSearchFlags flags,
+                                    const GtkTextIter *start,
+                                    const GtkTextIter *end,
+                                    PlumaRegexSearchFunc func,
+                                    gpointer user_data) {
+  GRegexMatchFlags match_flags = 0;
+  GMatchInfo *match_info;
+  GtkTextIter iter;
+  GError *error = NULL;
+  gchar *segment;
+  gint index = 0;
+
+  g_return_val_if_fail(search != NULL, FALSE);
+  g_return_val_if_fail(pattern != NULL, FALSE);
+  g_return_val_if_fail(start != NULL, FALSE);
+  g_return_val_if_fail(end != NULL, FALSE);
+  g_return_val_if_fail(func != NULL, FALSE);
+
+  if (!update_regex(search, pattern, flags)) return FALSE;
+
+  if (!gtk_text_iter_starts_line(start)) match_flags |= G_REGEX_MATCH_NOTBOL;
+
+  if (!gtk_text_iter_ends_line(end)) match_flags |= G_REGEX_MATCH_NOTEOL;
+
+  /* the hidden characters and the images keep their place */
+  segment = gtk_text_iter_get_slice(start, end);
+  iter = *start;
+
+  g_regex_match_full(search->regex, segment, -1, 0, match_flags, &match_info,
+                     &error);
+
+  while (error == NULL && g_match_info_matches(match_info)) {
+    GtkTextIter m_start;
+    GtkTextIter m_end;
+    gint start_pos;
+    gint end_pos;
+
+    g_match_info_fetch_pos(match_info, 0, &start_pos, &end_pos);
+
+    /* from the previous match, they come in order */
+    gtk_text_iter_forward_chars(
+        &iter, g_utf8_pointer_to_offset(segment + index, segment + start_pos));
+    index = start_pos;
+
+    m_start = iter;
+    m_end = iter;
+    gtk_text_iter_forward_chars(
+        &m_end, g_utf8_pointer_to_offset(segment + start_pos,
+                                         segment + end_pos));
+
+    if (!func(&m_start, &m_end, user_data)) break;
+
+    g_match_info_next(match_info, &error);
+  }
+
+  g_match_info_free(match_info);
+  g_free(segment);
+
+  if (error != NULL) {
+    pluma_debug_message(DEBUG_SEARCH, "matching failed: %s", error->message);
+    g_error_free(error);
+
+    return FALSE;
+  }
+
+  return TRUE;
+}
@@ -0,0 +1,76 @@
+/*
+ * pluma-regex-search.h
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * pluma is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * pluma is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pluma; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __PLUMA_REGEX_SEARCH_H__
+#define __PLUMA_REGEX_SEARCH_H__
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+/* Searches a buffer for a regular expression again and again without
+ * compiling it or copying the text each time. The copy of the text follows
+ * the edits behind the searches, so that a replace all does not copy it
+ * again after each replacement. */
+typedef struct _PlumaRegexSearch PlumaRegexSearch;
+
+PlumaRegexSearch *pluma_regex_search_new(GtkTextBuffer *buffer);
+
+void pluma_regex_search_free(PlumaRegexSearch *search);
+
+/* Looks for pattern from iter to limit, or to the end of the buffer when
+   searching forward and to its start when searching backward, like
+   pluma_gtk_text_iter_regex_search(). *replace_text is replaced by its
+   expansion for the match. */
+gboolean pluma_regex_search_find(PlumaRegexSearch *search,
+                                 const gchar *pattern,
+                                 GtkTextSearchFlags flags,
+                                 const GtkTextIter *iter,
+                                 const GtkTextIter *limit,
+                                 gboolean forward_search,
+                                 GtkTextIter *match_start,
+                                 GtkTextIter *match_end, gchar **replace_text);
+
+/* Called with each match of pluma_regex_search_foreach(), which stops when
+   it returns FALSE. */
+typedef gboolean (*PlumaRegexSearchFunc)(GtkTextIter *match_start,
+                                         GtkTextIter *match_end,
+                                         gpointer user_data);
+
+/* Calls func with the matches of pattern from start to end, empty matches
+   included. Only that text is copied and matched, so that the copy of the
+   whole buffer is left to the searches: the pattern sees nothing of the text
+   around it, and sees a line start or end at its bounds only if there is
+   one in the buffer. Returns FALSE when the pattern is not valid or the
+   matching failed, for instance at the match limit of a pattern which
+   backtracks too much. */
+gboolean pluma_regex_search_foreach(PlumaRegexSearch *search,
+                                    const gchar *pattern,
+                                    GtkTextSearchFlags flags,
+                                    const GtkTextIter *start,
+                                    const GtkTextIter *end,
+                                    PlumaRegexSearchFunc func,
+                                    gpointer user_data);
+
+G_END_DECLS
+
+#endif /* __PLUMA_REGEX_SEARCH_H__ */
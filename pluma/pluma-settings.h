@@ -103,8 +103,10 @@ GSList *pluma_settings_get_writable_vfs_schemes(GSettings *settings);
 #define PLUMA_SETTINGS_EDITOR_FONT "editor-font"
 #define PLUMA_SETTINGS_COLOR_SCHEME "color-scheme"
 #define PLUMA_SETTINGS_CREATE_BACKUP_COPY "create-backup-copy"
+#define PLUMA_SETTINGS_NORMALIZE_NEWLINES "normalize-newlines"
 #define PLUMA_SETTINGS_AUTO_SAVE "auto-save"
 #define PLUMA_SETTINGS_AUTO_SAVE_INTERVAL "auto-save-interval"
+#define PLUMA_SETTINGS_AUTO_SAVE_JOURNAL "auto-save-journal"
 #define PLUMA_SETTINGS_MAX_UNDO_ACTIONS "max-undo-actions"
 #define PLUMA_SETTINGS_WRAP_MODE "wrap-mode"
 #define PLUMA_SETTINGS_TABS_SIZE "tabs-size"
@@ -117,6 +119,10 @@ GSList *pluma_settings_get_writable_vfs_schemes(GSettings *settings);
 #define PLUMA_SETTINGS_RIGHT_MARGIN_POSITION "right-margin-position"
 #define PLUMA_SETTINGS_WRITABLE_VFS_SCHEMES "writable-vfs-schemes"
 #define PLUMA_SETTINGS_RESTORE_CURSOR_POSITION "restore-cursor-position"
+#define PLUMA_SETTINGS_FOLLOW_AUTO_SCROLL "follow-auto-scroll"
+#define PLUMA_SETTINGS_MAX_IO_BLOCK_SIZE "max-io-block-size"
+#define PLUMA_SETTINGS_LARGE_FILE_THRESHOLD "large-file-threshold"
+#define PLUMA_SETTINGS_PARTIAL_LOAD_SIZE "partial-load-size"
 #define PLUMA_SETTINGS_SYNTAX_HIGHLIGHTING "syntax-highlighting"
 #define PLUMA_SETTINGS_SEARCH_HIGHLIGHTING "search-highlighting"
 #define PLUMA_SETTINGS_TOOLBAR_VISIBLE "toolbar-visible"
@@ -0,0 +1,324 @@
+/*
+ * pluma-single-byte-converter.c
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * pluma is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * pluma is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pluma; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "pluma-single-byte-converter.h"
+
+#include <gio/gio.h>
+#include <glib/gi18n.h>
+#include <string.h>
+
+#include "pluma-debug.h"
+
+/* the high bit of every byte of a word */
+#define ASCII_MASK ((gsize)G_GUINT64_CONSTANT(0x8080808080808080))
+
+struct _PlumaSingleByteConverterPrivate {
+  gboolean to_utf8;
+
+  /* decoding: the UTF-8 form of each byte, the characters of the tables are
+     all in the BMP. A length of 0 marks the bytes the encoding leaves
+     undefined. */
+  gchar decode[256][3];
+  guint8 decode_length[256];
+
+  /* encoding: the byte of each character by blocks of 256 characters, the
+     index is the number of the block in pages plus one, 0 if none of the
+     characters of the block can be encoded */
+  guint8 page_index[256];
+  guint8 (*pages)[256];
+};
+
+static void pluma_single_byte_converter_iface_init(GConverterIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(
+    PlumaSingleByteConverter, pluma_single_byte_converter, G_TYPE_OBJECT,
+    G_ADD_PRIVATE(PlumaSingleByteConverter)
+        G_IMPLEMENT_INTERFACE(G_TYPE_CONVERTER,
+                              pluma_single_byte_converter_iface_init))
+
+static void pluma_single_byte_converter_finalize(GObject *object) {
+  PlumaSingleByteConverter *conv = PLUMA_SINGLE_BYTE_CONVERTER(object);
+
+  g_free(conv->priv->pages);
+
+  G_OBJECT_CLASS(pluma_single_byte_converter_parent_class)->finalize(object);
+}
+
+static void pluma_single_byte_converter_class_init(
+    PlumaSingleByteConverterClass *klass) {
+  GObjectClass *object_class = G_OBJECT_CLASS(klass);
+
+  object_class->finalize = pluma_single_byte_converter_finalize;
+}
+
+static void pluma_single_byte_converter_init(PlumaSingleByteConverter *conv) {
+  conv->priv = pluma_single_byte_converter_get_instance_private(conv);
+}
+
+/* The length of the ASCII run at the start of buf, a word at a time */
+static gsize get_ascii_length(const guchar *buf, gsize len) {
+  gsize i = 0;
+
+  while (i + sizeof(gsize) <= len) {
+    gsize word;
+
+    memcpy(&word, buf + i, sizeof(gsize));
+    if ((word & ASCII_MASK) != 0) break;
+
+    i += sizeof(gsize);
+  }
+
+  while (i < len && buf[i] < 0x80) i++;
+
+  return i;
+}
+
+static GConverterResult get_result(gsize nread, gsize inbuf_size,
+                                   gboolean invalid, gboolean partial,
+                                   GConverterFlags flags, GError **error) {
+  if (nread == inbuf_size) {
+    if (flags & G_CONVERTER_INPUT_AT_END) return G_CONVERTER_FINISHED;
+
+    if (flags & G_CONVERTER_FLUSH) return G_CONVERTER_FLUSHED;
+
+    return G_CONVERTER_CONVERTED;
+  }
+
+  /* report the problem when there is nothing left to convert before it */
+  if (nread > 0) return G_CONVERTER_CONVERTED;
+
+  if (invalid) {
+    g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                        _("Invalid byte sequence in conversion input"));
+  } else if (partial) {
+    g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT,
+                        _("Incomplete multibyte sequence in input"));
+  } else {
+    g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_NO_SPACE,
+                        _("Not enough space in destination"));
+  }
+
+  return G_CONVERTER_ERROR;
+}
+
+static GConverterResult decode(PlumaSingleByteConverterPrivate *priv,
+                               const guchar *in, gsize inbuf_size, gchar *out,
+                               gsize outbuf_size, GConverterFlags flags,
+                               gsize *bytes_read, gsize *bytes_written,
+                               GError **error) {
+  gboolean invalid = FALSE;
+  gsize nread = 0;
+  gsize nwritten = 0;
+
+  while (nread < inbuf_size) {
+    gsize n;
+    guint len;
+    guchar c;
+
+    /* ASCII is the same in both */
+    n = get_ascii_length(in + nread,
+                         MIN(inbuf_size - nread, outbuf_size - nwritten));
+    memcpy(out + nwritten, in + nread, n);
+    nread += n;
+    nwritten += n;
+
+    if (nread == inbuf_size || nwritten == outbuf_size) break;
+
+    c = in[nread];
+    len = priv->decode_length[c];
+
+    if (len == 0) {
+      invalid = TRUE;
+      break;
+    }
+
+    if (outbuf_size - nwritten < len) break;
+
+    memcpy(out + nwritten, priv->decode[c], len);
+    nread++;
+    nwritten += len;
+  }
+
+  *bytes_read = nread;
+  *bytes_written = nwritten;
+
+  return get_result(nread, inbuf_size, invalid, FALSE, flags, error);
+}
+
+static GConverterResult encode(PlumaSingleByteConverterPrivate *priv,
+                               const guchar *in, gsize inbuf_size, gchar *out,
+                               gsize outbuf_size, GConverterFlags flags,
+                               gsize *bytes_read, gsize *bytes_written,
+                               GError **error) {
+  gboolean invalid = FALSE;
+  gboolean partial = FALSE;
+  gsize nread = 0;
+  gsize nwritten = 0;
+
+  while (nread < inbuf_size) {
+    gsize n;
+    gunichar c;
+    guint page;
+    guint8 byte = 0;
+
+    n = get_ascii_length(in + nread,
+                         MIN(inbuf_size - nread, outbuf_size - nwritten));
+    memcpy(out + nwritten, in + nread, n);
+    nread += n;
+    nwritten += n;
+
+    if (nread == inbuf_size || nwritten == outbuf_size) break;
+
+    c = g_utf8_get_char_validated((const gchar *)in + nread,
+                                  inbuf_size - nread);
+
+    /* the rest of it comes with the next block */
+    if (c == (gunichar)-2) {
+      partial = TRUE;
+      break;
+    }
+
+    if (c != (gunichar)-1 && c <= 0xffff) {
+      page = priv->page_index[c >> 8];
+
+      if (page != 0) byte = priv->pages[page - 1][c & 0xff];
+    }
+
+    if (byte == 0) {
+      invalid = TRUE;
+      break;
+    }
+
+    out[nwritten++] = byte;
+    nread += g_utf8_skip[in[nread]];
+  }
+
+  *bytes_read = nread;
+  *bytes_written = nwritten;
+
+  return get_result(nread, inbuf_size, invalid, partial, flags, error);
+}
+
+static GConverterResult pluma_single_byte_converter_convert(
+    GConverter *converter, const void *inbuf, gsize inbuf_size, void *outbuf,
+    gsize outbuf_size, GConverterFlags flags, gsize *bytes_read,
+    gsize *bytes_written, GError **error) {
+  PlumaSingleByteConverter *conv = PLUMA_SINGLE_BYTE_CONVERTER(converter);
+
+  if (conv->priv->to_utf8) {
+    return decode(conv->priv, inbuf, inbuf_size, outbuf, outbuf_size, flags,
+                  bytes_read, bytes_written, error);
+  }
+
+  return encode(conv->priv, inbuf, inbuf_size, outbuf, outbuf_size, flags,
+                bytes_read, bytes_written, error);
+}
+
+/* one byte maps to one character, there is nothing to forget */
+static void pluma_single_byte_converter_reset(GConverter *converter) {}
+
+static void pluma_single_byte_converter_iface_init(GConverterIface *iface) {
+  iface->convert = pluma_single_byte_converter_convert;
+  iface->reset = pluma_single_byte_converter_reset;
+}
+
+static void build_decode_table(PlumaSingleByteConverterPrivate *priv,
+                               const guint16 *table) {
+  guint i;
+
+  for (i = 0; i < 0x80; i++) {
+    priv->decode[i][0] = i;
+    priv->decode_length[i] = 1;
+  }
+
+  for (i = 0x80; i < 0x100; i++) {
+    gchar utf8[6];
+
+    if (table[i - 0x80] == 0) continue;
+
+    priv->decode_length[i] = g_unichar_to_utf8(table[i - 0x80], utf8);
+    memcpy(priv->decode[i], utf8, priv->decode_length[i]);
+  }
+}
+
+/* only the upper half, ASCII never gets to the table */
+static void build_encode_table(PlumaSingleByteConverterPrivate *priv,
+                               const guint16 *table) {
+  guint n_pages = 0;
+  guint i;
+
+  for (i = 0; i < 0x80; i++) {
+    if (table[i] != 0 && priv->page_index[table[i] >> 8] == 0)
+      priv->page_index[table[i] >> 8] = ++n_pages;
+  }
+
+  priv->pages = g_malloc0(n_pages * sizeof(priv->pages[0]));
+
+  for (i = 0; i < 0x80; i++) {
+    if (table[i] != 0)
+      priv->pages[priv->page_index[table[i] >> 8] - 1][table[i] & 0xff] =
+          0x80 + i;
+  }
+}
+
+PlumaSingleByteConverter *pluma_single_byte_converter_new(
+    const PlumaEncoding *enc, gboolean to_utf8) {
+  PlumaSingleByteConverter *conv;
+  const guint16 *table;
+
+  g_return_val_if_fail(enc != NULL, NULL);
+
+  table = _pluma_encoding_get_byte_table(enc);
+  if (table == NULL) return NULL;
+
+  conv = g_object_new(PLUMA_TYPE_SINGLE_BYTE_CONVERTER, NULL);
+  conv->priv->to_utf8 = to_utf8;
+
+  if (to_utf8) {
+    build_decode_table(conv->priv, table);
+  } else {
+    build_encode_table(conv->priv, table);
+  }
+
+  return conv;
+}
+
+GConverter *pluma_single_byte_converter_new_with_fallback(
+    const PlumaEncoding *enc, gboolean to_utf8, GError **error) {
+  PlumaSingleByteConverter *conv;
+  const gchar *charset;
+
+  g_return_val_if_fail(enc != NULL, NULL);
+
+  conv = pluma_single_byte_converter_new(enc, to_utf8);
+  if (conv != NULL) return G_CONVERTER(conv);
+
+  charset = pluma_encoding_get_charset(enc);
+
+  pluma_debug_message(DEBUG_UTILS, "no table for %s, using iconv", charset);
+
+  if (to_utf8) {
+    return G_CONVERTER(g_charset_converter_new("UTF-8", charset, error));
+  }
+
+  return G_CONVERTER(g_charset_converter_new(charset, "UTF-8", error));
+}
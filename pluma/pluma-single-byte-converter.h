@@ -0,0 +1,80 @@
+/*
+ * pluma-single-byte-converter.h
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * pluma is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * pluma is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pluma; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __PLUMA_SINGLE_BYTE_CONVERTER_H__
+#define __PLUMA_SINGLE_BYTE_CONVERTER_H__
+
+#include <gio/gio.h>
+#include <glib-object.h>
+
+#include "pluma-encodings.h"
+
+G_BEGIN_DECLS
+
+#define PLUMA_TYPE_SINGLE_BYTE_CONVERTER \
+  (pluma_single_byte_converter_get_type())
+#define PLUMA_SINGLE_BYTE_CONVERTER(obj)                               \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), PLUMA_TYPE_SINGLE_BYTE_CONVERTER, \
+                              PlumaSingleByteConverter))
+#define PLUMA_SINGLE_BYTE_CONVERTER_CONST(obj)                         \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), PLUMA_TYPE_SINGLE_BYTE_CONVERTER, \
+                              PlumaSingleByteConverter const))
+#define PLUMA_SINGLE_BYTE_CONVERTER_CLASS(klass)                      \
+  (G_TYPE_CHECK_CLASS_CAST((klass), PLUMA_TYPE_SINGLE_BYTE_CONVERTER, \
+                           PlumaSingleByteConverterClass))
+#define PLUMA_IS_SINGLE_BYTE_CONVERTER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), PLUMA_TYPE_SINGLE_BYTE_CONVERTER))
+#define PLUMA_IS_SINGLE_BYTE_CONVERTER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass), PLUMA_TYPE_SINGLE_BYTE_CONVERTER))
+#define PLUMA_SINGLE_BYTE_CONVERTER_GET_CLASS(obj)                    \
+  (G_TYPE_INSTANCE_GET_CLASS((obj), PLUMA_TYPE_SINGLE_BYTE_CONVERTER, \
+                             PlumaSingleByteConverterClass))
+
+typedef struct _PlumaSingleByteConverter PlumaSingleByteConverter;
+typedef struct _PlumaSingleByteConverterClass PlumaSingleByteConverterClass;
+typedef struct _PlumaSingleByteConverterPrivate
+    PlumaSingleByteConverterPrivate;
+
+struct _PlumaSingleByteConverter {
+  GObject parent;
+
+  PlumaSingleByteConverterPrivate *priv;
+};
+
+struct _PlumaSingleByteConverterClass {
+  GObjectClass parent_class;
+};
+
+GType pluma_single_byte_converter_get_type(void) G_GNUC_CONST;
+
+/* Converts from enc to UTF-8 if to_utf8 is set, from UTF-8 to enc otherwise.
+   Returns NULL if enc has no built-in table. */
+PlumaSingleByteConverter *pluma_single_byte_converter_new(
+    const PlumaEncoding *enc, gboolean to_utf8);
+
+/* The same, falling back to iconv for the encodings without a table */
+GConverter *pluma_single_byte_converter_new_with_fallback(
+    const PlumaEncoding *enc, gboolean to_utf8, GError **error);
+
+G_END_DECLS
+
+#endif /* __PLUMA_SINGLE_BYTE_CONVERTER_H__ */
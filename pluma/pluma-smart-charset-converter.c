@@ -25,12 +25,14 @@
 
 #include <gio/gio.h>
 #include <glib/gi18n.h>
+#include <string.h>
 
 #include "pluma-debug.h"
 #include "pluma-document.h"
+#include "pluma-single-byte-converter.h"
 
 struct _PlumaSmartCharsetConverterPrivate {
-  GCharsetConverter *charset_conv;
+  GConverter *charset_conv;
 
   GSList *encodings;
   GSList *current_encoding;
@@ -91,20 +93,7 @@ static void pluma_smart_charset_converter_init(
   pluma_debug_message(DEBUG_UTILS, "initializing smart charset converter");
 }
 
-static const PlumaEncoding *get_encoding(PlumaSmartCharsetConverter *smart) {
-  if (smart->priv->current_encoding == NULL) {
-    smart->priv->current_encoding = smart->priv->encodings;
-  } else {
-    smart->priv->current_encoding = g_slist_next(smart->priv->current_encoding);
-  }
-
-  if (smart->priv->current_encoding != NULL)
-    return (const PlumaEncoding *)smart->priv->current_encoding->data;
-
-  return NULL;
-}
-
-static gboolean try_convert(GCharsetConverter *converter, const void *inbuf,
+static gboolean try_convert(GConverter *converter, const void *inbuf,
                             gsize inbuf_size) {
   GError *err;
   gsize bytes_read, nread;
@@ -125,10 +114,10 @@ static gboolean try_convert(GCharsetConverter *converter, const void *inbuf,
   out = g_malloc(out_size);
 
   do {
-    res = g_converter_convert(
-        G_CONVERTER(converter), (void *)((gsize)inbuf + nread),
-        inbuf_size - nread, out + nwritten, out_size - nwritten,
-        G_CONVERTER_INPUT_AT_END, &bytes_read, &bytes_written, &err);
+    res = g_converter_convert(converter, (void *)((gsize)inbuf + nread),
+                              inbuf_size - nread, out + nwritten,
+                              out_size - nwritten, G_CONVERTER_INPUT_AT_END,
+                              &bytes_read, &bytes_written, &err);
 
     nread += bytes_read;
     nwritten += bytes_written;
@@ -160,9 +149,358 @@ static gboolean try_convert(GCharsetConverter *converter, const void *inbuf,
   return ret;
 }
 
-static GCharsetConverter *guess_encoding(PlumaSmartCharsetConverter *smart,
-                                         const void *inbuf, gsize inbuf_size) {
-  GCharsetConverter *conv = NULL;
+typedef enum {
+  ENCODING_CLASS_UTF8,
+  ENCODING_CLASS_UTF16,
+  ENCODING_CLASS_UTF32,
+  ENCODING_CLASS_SINGLE_BYTE,
+  ENCODING_CLASS_OTHER
+} EncodingClass;
+
+/* What we learn about the first block in a single pass over it */
+typedef struct {
+  gsize size;
+  gsize nulls[4];  /* zero bytes, by offset modulo 4 */
+  gsize c1;        /* bytes in the 0x80-0x9f range */
+  gsize n_high;    /* bytes in the 0x80-0xff range */
+  gsize high[128]; /* count of each of them */
+  gboolean utf8_valid;
+  gsize utf8_multibyte; /* complete multibyte characters */
+
+  /* byte order mark, if any */
+  EncodingClass bom_class;
+  gboolean bom_big_endian;
+} EncodingStats;
+
+#define SCORE_REJECTED G_MININT
+#define SCORE_BOM 1000
+#define SCORE_NULL_PATTERN 500
+#define SCORE_UTF8_MULTIBYTE 300
+#define SCORE_NO_NULL_PATTERN -200
+#define SCORE_C1_CONTROLS -100
+#define SCORE_LETTERS 100
+
+static const gchar *single_byte_prefixes[] = {
+    "ISO-8859-", "WINDOWS-125", "KOI8", "CP866", "IBM85", "IBM86",
+    "ARMSCII-8", "GEORGIAN-ACADEMY", "ISO-IR-111", "TIS-620", "VISCII"};
+
+static EncodingClass get_encoding_class(const PlumaEncoding *enc) {
+  const gchar *charset;
+  guint i;
+
+  if (enc == pluma_encoding_get_utf8()) return ENCODING_CLASS_UTF8;
+
+  charset = pluma_encoding_get_charset(enc);
+
+  if (g_str_has_prefix(charset, "UTF-16") || strcmp(charset, "UCS-2") == 0)
+    return ENCODING_CLASS_UTF16;
+
+  if (strcmp(charset, "UTF-32") == 0 || strcmp(charset, "UCS-4") == 0)
+    return ENCODING_CLASS_UTF32;
+
+  for (i = 0; i < G_N_ELEMENTS(single_byte_prefixes); i++) {
+    if (g_str_has_prefix(charset, single_byte_prefixes[i]))
+      return ENCODING_CLASS_SINGLE_BYTE;
+  }
+
+  return ENCODING_CLASS_OTHER;
+}
+
+static void get_bom(EncodingStats *stats, const guchar *buf, gsize size) {
+  stats->bom_class = ENCODING_CLASS_OTHER;
+
+  if (size >= 3 && buf[0] == 0xef && buf[1] == 0xbb && buf[2] == 0xbf) {
+    stats->bom_class = ENCODING_CLASS_UTF8;
+  } else if (size >= 4 && buf[0] == 0xff && buf[1] == 0xfe && buf[2] == 0 &&
+             buf[3] == 0) {
+    stats->bom_class = ENCODING_CLASS_UTF32;
+    stats->bom_big_endian = FALSE;
+  } else if (size >= 4 && buf[0] == 0 && buf[1] == 0 && buf[2] == 0xfe &&
+             buf[3] == 0xff) {
+    stats->bom_class = ENCODING_CLASS_UTF32;
+    stats->bom_big_endian = TRUE;
+  } else if (size >= 2 && buf[0] == 0xff && buf[1] == 0xfe) {
+    stats->bom_class = ENCODING_CLASS_UTF16;
+    stats->bom_big_endian = FALSE;
+  } else if (size >= 2 && buf[0] == 0xfe && buf[1] == 0xff) {
+    stats->bom_class = ENCODING_CLASS_UTF16;
+    stats->bom_big_endian = TRUE;
+  }
+}
+
+/* Counts the byte classes and checks the UTF-8 structure at the same time.
+ * The UTF-8 check follows the well-formed byte sequences table of the
+ * Unicode standard, so it agrees with g_utf8_validate except that a
+ * character cut at the end of the block is accepted. */
+static void get_stats(EncodingStats *stats, const guchar *buf, gsize size) {
+  guint need = 0;
+  guchar lo = 0x80;
+  guchar hi = 0xbf;
+  gsize i;
+
+  memset(stats, 0, sizeof(EncodingStats));
+  stats->size = size;
+  stats->utf8_valid = TRUE;
+
+  get_bom(stats, buf, size);
+
+  for (i = 0; i < size; i++) {
+    guchar c = buf[i];
+
+    if (c == 0) {
+      stats->nulls[i & 3]++;
+    } else if (c >= 0x80) {
+      stats->n_high++;
+      stats->high[c - 0x80]++;
+
+      if (c < 0xa0) stats->c1++;
+    }
+
+    if (!stats->utf8_valid) continue;
+
+    if (need > 0) {
+      if (c < lo || c > hi) {
+        stats->utf8_valid = FALSE;
+      } else {
+        need--;
+        lo = 0x80;
+        hi = 0xbf;
+
+        if (need == 0) stats->utf8_multibyte++;
+      }
+    } else if (c == 0) {
+      stats->utf8_valid = FALSE;
+    } else if (c < 0x80) {
+      /* ascii */
+    } else if (c >= 0xc2 && c <= 0xdf) {
+      need = 1;
+    } else if (c == 0xe0) {
+      need = 2;
+      lo = 0xa0;
+    } else if (c == 0xed) {
+      need = 2;
+      hi = 0x9f;
+    } else if (c >= 0xe1 && c <= 0xef) {
+      need = 2;
+    } else if (c == 0xf0) {
+      need = 3;
+      lo = 0x90;
+    } else if (c == 0xf4) {
+      need = 3;
+      hi = 0x8f;
+    } else if (c >= 0xf1 && c <= 0xf3) {
+      need = 3;
+    } else {
+      stats->utf8_valid = FALSE;
+    }
+  }
+}
+
+static gint score_wide(const EncodingStats *stats, EncodingClass klass,
+                       const gchar *charset) {
+  gboolean big_endian, little_endian;
+  gboolean has_bom;
+  gboolean le, be;
+  gint score = 0;
+
+  big_endian = g_str_has_suffix(charset, "BE");
+  little_endian = g_str_has_suffix(charset, "LE");
+
+  if (klass == ENCODING_CLASS_UTF16) {
+    gsize pairs = stats->size / 2;
+    gsize even = stats->nulls[0] + stats->nulls[2];
+    gsize odd = stats->nulls[1] + stats->nulls[3];
+
+    le = pairs > 0 && odd >= pairs / 2 && even < pairs / 8;
+    be = pairs > 0 && even >= pairs / 2 && odd < pairs / 8;
+  } else {
+    gsize quads = stats->size / 4;
+
+    le = quads > 0 && stats->nulls[2] >= quads * 3 / 4 &&
+         stats->nulls[3] >= quads * 3 / 4;
+    be = quads > 0 && stats->nulls[0] >= quads * 3 / 4 &&
+         stats->nulls[1] >= quads * 3 / 4;
+  }
+
+  has_bom = stats->bom_class == klass;
+
+  if (has_bom && (!(big_endian || little_endian) ||
+                  stats->bom_big_endian == big_endian)) {
+    score += SCORE_BOM;
+  }
+
+  /* without a byte order mark "UTF-16", "UCS-2" etc. are big endian */
+  if ((be && !little_endian) ||
+      (le && (little_endian ||
+              (!big_endian && has_bom && !stats->bom_big_endian)))) {
+    score += SCORE_NULL_PATTERN;
+  } else {
+    score += SCORE_NO_NULL_PATTERN;
+  }
+
+  return score;
+}
+
+/* The most used lowercase letters outside ascii of the scripts the single
+ * byte tables cover, most frequent first. A single byte encoding is likely
+ * the right one when the high bytes of the block decode to the frequent
+ * letters of one of them. */
+static const gunichar western_letters[] = {
+    0x00e9, 0x00e0, 0x00e8, 0x00e7, 0x00e1, 0x00ed, 0x00f3, 0x00fa,
+    0x00f1, 0x00e3, 0x00f5, 0x00ea, 0x00e2, 0x00f4, 0x00fc, 0x00f6,
+    0x00e4, 0x00df, 0x00eb, 0x00ef, 0x00ee, 0x00fb, 0x0153, 0x00e6,
+    0x00f8, 0x00e5, 0x00ec, 0x00f2, 0x00f9, 0x00fd, 0x00ff};
+
+static const gunichar central_european_letters[] = {
+    0x0105, 0x0119, 0x0142, 0x015b, 0x017c, 0x017a, 0x0107, 0x0144,
+    0x00f3, 0x010d, 0x0161, 0x017e, 0x0159, 0x011b, 0x016f, 0x00fd,
+    0x00e1, 0x00e9, 0x00ed, 0x0151, 0x0171, 0x0165, 0x010f, 0x013e,
+    0x013a, 0x0155, 0x0103, 0x0219, 0x021b, 0x0163, 0x015f};
+
+static const gunichar baltic_letters[] = {
+    0x0101, 0x0113, 0x012b, 0x016b, 0x0161, 0x017e, 0x0146, 0x013c, 0x0137,
+    0x0123, 0x010d, 0x0117, 0x012f, 0x0173, 0x00f5, 0x00e4, 0x00f6, 0x00fc};
+
+static const gunichar turkish_letters[] = {0x0131, 0x015f, 0x011f, 0x00e7,
+                                           0x00f6, 0x00fc, 0x00e2, 0x00ee};
+
+static const gunichar cyrillic_letters[] = {
+    0x043e, 0x0435, 0x0430, 0x0438, 0x043d, 0x0442, 0x0441, 0x0440,
+    0x0432, 0x043b, 0x043a, 0x043c, 0x0434, 0x043f, 0x0443, 0x044f,
+    0x044b, 0x044c, 0x0433, 0x0437, 0x0431, 0x0447, 0x0439, 0x0445,
+    0x0436, 0x0448, 0x044e, 0x0446, 0x0449, 0x044d, 0x0444, 0x044a,
+    0x0451, 0x0456, 0x0457, 0x0454, 0x0491, 0x045e};
+
+static const gunichar greek_letters[] = {
+    0x03b1, 0x03bf, 0x03b5, 0x03b9, 0x03c4, 0x03bd, 0x03c3, 0x03c2,
+    0x03c1, 0x03b7, 0x03c0, 0x03ba, 0x03c5, 0x03bc, 0x03bb, 0x03c9,
+    0x03b3, 0x03b4, 0x03ac, 0x03ad, 0x03af, 0x03cc, 0x03cd, 0x03ae,
+    0x03ce, 0x03c7, 0x03b8, 0x03c6, 0x03b2, 0x03be, 0x03b6, 0x03c8};
+
+static const gunichar arabic_letters[] = {
+    0x0627, 0x0644, 0x064a, 0x0645, 0x0648, 0x0646, 0x0647, 0x0631,
+    0x062a, 0x0628, 0x0639, 0x062f, 0x0633, 0x0641, 0x0642, 0x0643,
+    0x062d, 0x062c, 0x0634, 0x0635, 0x0637, 0x0632, 0x062e, 0x0630,
+    0x0636, 0x062b, 0x063a, 0x0638, 0x0629, 0x0649, 0x0623, 0x0625,
+    0x0622, 0x0621, 0x0626, 0x0624, 0x06cc};
+
+static const gunichar hebrew_letters[] = {
+    0x05d9, 0x05d5, 0x05d4, 0x05dc, 0x05d0, 0x05e8, 0x05de, 0x05d1, 0x05e0,
+    0x05e9, 0x05ea, 0x05d3, 0x05db, 0x05e2, 0x05e7, 0x05e4, 0x05d7, 0x05e1,
+    0x05d2, 0x05e6, 0x05d6, 0x05d8, 0x05da, 0x05dd, 0x05df, 0x05e3, 0x05e5};
+
+static const struct {
+  const gunichar *letters;
+  guint n_letters;
+} scripts[] = {
+    {western_letters, G_N_ELEMENTS(western_letters)},
+    {central_european_letters, G_N_ELEMENTS(central_european_letters)},
+    {baltic_letters, G_N_ELEMENTS(baltic_letters)},
+    {turkish_letters, G_N_ELEMENTS(turkish_letters)},
+    {cyrillic_letters, G_N_ELEMENTS(cyrillic_letters)},
+    {greek_letters, G_N_ELEMENTS(greek_letters)},
+    {arabic_letters, G_N_ELEMENTS(arabic_letters)},
+    {hebrew_letters, G_N_ELEMENTS(hebrew_letters)}};
+
+/* From 3 for the most frequent letters down to -3 for unused bytes and
+ * control characters */
+static gint get_char_weight(gunichar c) {
+  gunichar lower;
+  gint weight = 0;
+  guint i, j;
+
+  if (c == 0 || g_unichar_iscntrl(c)) return -3;
+
+  if (!g_unichar_isalpha(c)) return -1;
+
+  lower = g_unichar_tolower(c);
+
+  for (i = 0; i < G_N_ELEMENTS(scripts); i++) {
+    for (j = 0; j < scripts[i].n_letters; j++) {
+      if (scripts[i].letters[j] == lower) {
+        weight = MAX(weight, 3 - (gint)(3 * j / scripts[i].n_letters));
+        break;
+      }
+    }
+  }
+
+  /* capitals are rarer, whatever the letter */
+  if (weight > 0 && lower != c) weight = 1;
+
+  return weight;
+}
+
+/* Up to SCORE_LETTERS when all the high bytes decode to frequent letters */
+static gint score_letters(const EncodingStats *stats, const guint16 *table) {
+  gint64 sum = 0;
+  guint i;
+
+  if (stats->n_high == 0) return 0;
+
+  for (i = 0; i < 128; i++) {
+    if (stats->high[i] > 0)
+      sum += (gint64)stats->high[i] * get_char_weight(table[i]);
+  }
+
+  return (gint)(SCORE_LETTERS * sum / (gint64)(3 * stats->n_high));
+}
+
+/* How well the block matches the encoding, on top of its position in the
+ * candidate list, or SCORE_REJECTED if it cannot be the right one */
+static gint score_encoding(const EncodingStats *stats,
+                           const PlumaEncoding *enc) {
+  EncodingClass klass;
+  const guint16 *table;
+  gboolean has_nulls;
+
+  klass = get_encoding_class(enc);
+
+  has_nulls = (stats->nulls[0] + stats->nulls[1] + stats->nulls[2] +
+               stats->nulls[3]) > 0;
+
+  switch (klass) {
+    case ENCODING_CLASS_UTF8:
+      if (!stats->utf8_valid) return SCORE_REJECTED;
+
+      return (stats->bom_class == ENCODING_CLASS_UTF8 ? SCORE_BOM : 0) +
+             (stats->utf8_multibyte > 0 ? SCORE_UTF8_MULTIBYTE : 0);
+
+    case ENCODING_CLASS_UTF16:
+    case ENCODING_CLASS_UTF32:
+      return score_wide(stats, klass, pluma_encoding_get_charset(enc));
+
+    case ENCODING_CLASS_SINGLE_BYTE:
+      if (has_nulls) return SCORE_REJECTED;
+
+      table = _pluma_encoding_get_byte_table(enc);
+      if (table != NULL) return score_letters(stats, table);
+
+      /* C1 controls are allowed, but hardly used in real text */
+      if (stats->c1 > 0 &&
+          g_str_has_prefix(pluma_encoding_get_charset(enc), "ISO-8859-"))
+        return SCORE_C1_CONTROLS;
+
+      return 0;
+
+    default:
+      /* nothing to tell about multibyte encodings without converting */
+      return has_nulls ? SCORE_REJECTED : 0;
+  }
+}
+
+typedef struct {
+  GSList *node;
+  gint score;
+} Candidate;
+
+static GConverter *guess_encoding(PlumaSmartCharsetConverter *smart,
+                                  const void *inbuf, gsize inbuf_size) {
+  GConverter *conv = NULL;
+  EncodingStats stats;
+  Candidate *candidates;
+  GSList *l;
+  guint n_candidates;
+  guint i;
 
   if (inbuf == NULL || inbuf_size == 0) {
     smart->priv->is_utf8 = TRUE;
@@ -172,62 +510,85 @@ static GCharsetConverter *guess_encoding(PlumaSmartCharsetConverter *smart,
   if (smart->priv->encodings != NULL && smart->priv->encodings->next == NULL)
     smart->priv->use_first = TRUE;
 
-  /* We just check the first block */
-  while (TRUE) {
-    const PlumaEncoding *enc;
+  /* If there is just one encoding we use it */
+  if (smart->priv->use_first) {
+    const PlumaEncoding *enc = smart->priv->encodings->data;
 
-    if (conv != NULL) {
-      g_object_unref(conv);
-      conv = NULL;
+    smart->priv->current_encoding = smart->priv->encodings;
+
+    if (enc == pluma_encoding_get_utf8()) {
+      smart->priv->is_utf8 = TRUE;
+      return NULL;
     }
 
-    /* We get an encoding from the list */
-    enc = get_encoding(smart);
+    return pluma_single_byte_converter_new_with_fallback(enc, TRUE, NULL);
+  }
 
-    /* if it is NULL we didn't guess anything */
-    if (enc == NULL) {
-      break;
-    }
+  /* We just check the first block */
+  get_stats(&stats, inbuf, inbuf_size);
 
-    pluma_debug_message(
-        DEBUG_UTILS, "trying charset: %s",
-        pluma_encoding_get_charset(smart->priv->current_encoding->data));
+  /* The position in the candidate list is the prior, the evidence from the
+     block can override it */
+  n_candidates = g_slist_length(smart->priv->encodings);
+  candidates = g_new(Candidate, n_candidates);
 
-    if (enc == pluma_encoding_get_utf8()) {
-      gsize remainder;
-      const gchar *end;
+  for (l = smart->priv->encodings, i = 0; l != NULL; l = l->next, i++) {
+    gint score = score_encoding(&stats, l->data);
 
-      if (g_utf8_validate(inbuf, inbuf_size, &end) || smart->priv->use_first) {
-        smart->priv->is_utf8 = TRUE;
-        break;
-      }
+    candidates[i].node = l;
+    candidates[i].score =
+        score == SCORE_REJECTED ? SCORE_REJECTED
+                                : score + (gint)(n_candidates - i);
 
-      /* Check if the end is less than one char */
-      remainder = inbuf_size - (end - (gchar *)inbuf);
-      if (remainder < 6) {
-        smart->priv->is_utf8 = TRUE;
-        break;
-      }
+    pluma_debug_message(DEBUG_UTILS, "charset %s scored %d",
+                        pluma_encoding_get_charset(l->data),
+                        candidates[i].score);
+  }
 
-      continue;
+  /* Confirm the best candidates, usually the first one is right */
+  while (TRUE) {
+    const PlumaEncoding *enc;
+    Candidate *best = NULL;
+
+    for (i = 0; i < n_candidates; i++) {
+      if (candidates[i].score != SCORE_REJECTED &&
+          (best == NULL || candidates[i].score > best->score))
+        best = &candidates[i];
+    }
+
+    /* if it is NULL we didn't guess anything */
+    if (best == NULL) {
+      smart->priv->current_encoding = NULL;
+      break;
     }
 
-    conv =
-        g_charset_converter_new("UTF-8", pluma_encoding_get_charset(enc), NULL);
+    best->score = SCORE_REJECTED;
+    smart->priv->current_encoding = best->node;
+    enc = best->node->data;
+
+    pluma_debug_message(DEBUG_UTILS, "trying charset: %s",
+                        pluma_encoding_get_charset(enc));
 
-    /* If we tried all encodings we use the first one */
-    if (smart->priv->use_first) {
+    /* the utf-8 check above is exact */
+    if (enc == pluma_encoding_get_utf8()) {
+      smart->priv->is_utf8 = TRUE;
       break;
     }
 
+    conv = pluma_single_byte_converter_new_with_fallback(enc, TRUE, NULL);
+
     /* Try to convert */
-    if (try_convert(conv, inbuf, inbuf_size)) {
+    if (conv != NULL && try_convert(conv, inbuf, inbuf_size)) {
       break;
     }
+
+    g_clear_object(&conv);
   }
 
+  g_free(candidates);
+
   if (conv != NULL) {
-    g_converter_reset(G_CONVERTER(conv));
+    g_converter_reset(conv);
 
     /* FIXME: uncomment this when we want to use the fallback
     g_charset_converter_set_use_fallback (conv, TRUE);*/
@@ -281,8 +642,8 @@ static GConverterResult pluma_smart_charset_converter_convert(
 
   /* If we reached here is because we need to convert the text so, we
      convert it with the charset converter */
-  return g_converter_convert(G_CONVERTER(smart->priv->charset_conv), inbuf,
-                             inbuf_size, outbuf, outbuf_size, flags, bytes_read,
+  return g_converter_convert(smart->priv->charset_conv, inbuf, inbuf_size,
+                             outbuf, outbuf_size, flags, bytes_read,
                              bytes_written, error);
 }
 
@@ -333,7 +694,9 @@ guint pluma_smart_charset_converter_get_num_fallbacks(
     PlumaSmartCharsetConverter *smart) {
   g_return_val_if_fail(PLUMA_IS_SMART_CHARSET_CONVERTER(smart), FALSE);
 
-  if (smart->priv->charset_conv == NULL) return FALSE;
+  /* the tables never fall back */
+  if (!G_IS_CHARSET_CONVERTER(smart->priv->charset_conv)) return FALSE;
 
-  return g_charset_converter_get_num_fallbacks(smart->priv->charset_conv) != 0;
+  return g_charset_converter_get_num_fallbacks(
+             G_CHARSET_CONVERTER(smart->priv->charset_conv)) != 0;
 }
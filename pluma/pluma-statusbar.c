@@ -41,6 +41,7 @@
 
 struct _PlumaStatusbarPrivate {
   GtkWidget *overwrite_mode_label;
+  GtkWidget *newlines_label;
   GtkWidget *cursor_position_label;
 
   GtkWidget *state_frame;
@@ -102,6 +103,11 @@ static void pluma_statusbar_init(PlumaStatusbar *statusbar) {
   gtk_box_pack_end(GTK_BOX(statusbar), statusbar->priv->overwrite_mode_label,
                    FALSE, TRUE, 0);
 
+  statusbar->priv->newlines_label = gtk_label_new(NULL);
+  gtk_widget_show(statusbar->priv->newlines_label);
+  gtk_box_pack_end(GTK_BOX(statusbar), statusbar->priv->newlines_label, FALSE,
+                   TRUE, 0);
+
   statusbar->priv->cursor_position_label = gtk_label_new(NULL);
   gtk_label_set_width_chars(GTK_LABEL(statusbar->priv->cursor_position_label),
                             CURSOR_POSITION_LABEL_WIDTH_CHARS);
@@ -225,6 +231,60 @@ void pluma_statusbar_set_cursor_position(PlumaStatusbar *statusbar, gint line,
   g_free(msg);
 }
 
+static const gchar *get_newline_name(PlumaDocumentNewlineType type) {
+  switch (type) {
+    case PLUMA_DOCUMENT_NEWLINE_TYPE_CR:
+      return "CR";
+    case PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF:
+      return "CRLF";
+    default:
+      return "LF";
+  }
+}
+
+/**
+ * pluma_statusbar_set_newlines:
+ * @statusbar: a #PlumaStatusbar
+ * @type: the line ending type of the document
+ * @lf: number of LF line endings in the file
+ * @cr: number of CR line endings in the file
+ * @crlf: number of CRLF line endings in the file
+ *
+ * Shows the line ending type on the statusbar, and whether the file mixes
+ * several of them.
+ **/
+void pluma_statusbar_set_newlines(PlumaStatusbar *statusbar,
+                                  PlumaDocumentNewlineType type, guint lf,
+                                  guint cr, guint crlf) {
+  gchar *msg;
+  gchar *tip;
+
+  g_return_if_fail(PLUMA_IS_STATUSBAR(statusbar));
+
+  if ((lf > 0) + (cr > 0) + (crlf > 0) > 1)
+    /* Translators: the line ending type of a file which also has other
+       line endings, e.g. "LF, mixed" */
+    msg = g_strdup_printf(_("  %s, mixed"), get_newline_name(type));
+  else
+    msg = g_strconcat("  ", get_newline_name(type), NULL);
+
+  tip = g_strdup_printf(_("Line endings: %u LF, %u CR, %u CRLF"), lf, cr,
+                        crlf);
+
+  gtk_label_set_text(GTK_LABEL(statusbar->priv->newlines_label), msg);
+  gtk_widget_set_tooltip_text(statusbar->priv->newlines_label, tip);
+
+  g_free(msg);
+  g_free(tip);
+}
+
+void pluma_statusbar_clear_newlines(PlumaStatusbar *statusbar) {
+  g_return_if_fail(PLUMA_IS_STATUSBAR(statusbar));
+
+  gtk_label_set_text(GTK_LABEL(statusbar->priv->newlines_label), NULL);
+  gtk_widget_set_tooltip_text(statusbar->priv->newlines_label, NULL);
+}
+
 static gboolean remove_message_timeout(PlumaStatusbar *statusbar) {
   gtk_statusbar_remove(GTK_STATUSBAR(statusbar),
                        statusbar->priv->flash_context_id,
@@ -31,6 +31,7 @@
 #define PLUMA_STATUSBAR_H
 
 #include <gtk/gtk.h>
+#include <pluma/pluma-document.h>
 #include <pluma/pluma-window.h>
 
 G_BEGIN_DECLS
@@ -78,6 +79,12 @@ void pluma_statusbar_set_cursor_position(PlumaStatusbar *statusbar, gint line,
 
 void pluma_statusbar_clear_overwrite(PlumaStatusbar *statusbar);
 
+void pluma_statusbar_set_newlines(PlumaStatusbar *statusbar,
+                                  PlumaDocumentNewlineType type, guint lf,
+                                  guint cr, guint crlf);
+
+void pluma_statusbar_clear_newlines(PlumaStatusbar *statusbar);
+
 void pluma_statusbar_flash_message(PlumaStatusbar *statusbar, guint context_id,
                                    const gchar *format, ...)
     G_GNUC_PRINTF(3, 4);
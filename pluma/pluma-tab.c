@@ -36,6 +36,8 @@
 
 #include "pluma-app.h"
 #include "pluma-debug.h"
+#include "pluma-document-follower.h"
+#include "pluma-document-journal.h"
 #include "pluma-enum-types.h"
 #include "pluma-io-error-message-area.h"
 #include "pluma-notebook.h"
@@ -77,19 +79,43 @@ struct _PlumaTabPrivate {
   gint auto_save_interval;
   guint auto_save_timeout;
 
+  /* autosave records the changes here instead of saving the file */
+  PlumaDocumentJournal *journal;
+  /* the changes made while the snapshot is being saved */
+  PlumaDocumentJournal *save_journal;
+
   gint not_editable : 1;
   gint auto_save : 1;
 
   gint ask_if_externally_modified : 1;
 
+  /* the document is saved from a snapshot, and can be edited meanwhile */
+  gint saving_in_background : 1;
+
+  /* follow mode */
+  PlumaDocumentFollower *follower;
+  gint follow_after_revert : 1;
+
+  /* large file mode */
+  gdouble last_scroll_value;
+  gint moving_window : 1;
+
   guint idle_scroll;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE(PlumaTab, pluma_tab, GTK_TYPE_BOX)
 
-enum { PROP_0, PROP_NAME, PROP_STATE, PROP_AUTO_SAVE, PROP_AUTO_SAVE_INTERVAL };
+enum {
+  PROP_0,
+  PROP_NAME,
+  PROP_STATE,
+  PROP_AUTO_SAVE,
+  PROP_AUTO_SAVE_INTERVAL,
+  PROP_FOLLOW
+};
 
 static gboolean pluma_tab_auto_save(PlumaTab *tab);
+static void set_message_area(PlumaTab *tab, GtkWidget *message_area);
 
 static void install_auto_save_timeout(PlumaTab *tab) {
   gint timeout;
@@ -115,6 +141,111 @@ static void install_auto_save_timeout(PlumaTab *tab) {
   tab->priv->auto_save_timeout = timeout;
 }
 
+static void journal_recovered_message_area_response(GtkWidget *message_area,
+                                                    gint response_id,
+                                                    PlumaTab *tab) {
+  /* reverting drops the journal along with the changes */
+  if (response_id == GTK_RESPONSE_OK) {
+    _pluma_tab_revert(tab);
+    return;
+  }
+
+  set_message_area(tab, NULL);
+
+  gtk_widget_grab_focus(GTK_WIDGET(pluma_tab_get_view(tab)));
+}
+
+static gboolean journal_enabled(PlumaTab *tab) {
+  /* the text appended while following is not an edit */
+  if (!tab->priv->auto_save || tab->priv->not_editable ||
+      tab->priv->follower != NULL)
+    return FALSE;
+
+  return g_settings_get_boolean(tab->priv->editor_settings,
+                                PLUMA_SETTINGS_AUTO_SAVE_JOURNAL);
+}
+
+static void start_journal(PlumaTab *tab) {
+  PlumaDocument *doc;
+  gboolean recovered = FALSE;
+
+  if (tab->priv->journal != NULL || !journal_enabled(tab)) return;
+
+  doc = pluma_tab_get_document(tab);
+
+  /* the journal starts from the text of the file */
+  if (pluma_document_is_untitled(doc) || pluma_document_get_readonly(doc) ||
+      _pluma_document_is_partial(doc) || _pluma_document_is_paged(doc) ||
+      gtk_text_buffer_get_modified(GTK_TEXT_BUFFER(doc)))
+    return;
+
+  tab->priv->journal = pluma_document_journal_new(doc, &recovered);
+
+  if (recovered) {
+    GtkWidget *emsg;
+    gchar *uri;
+
+    pluma_debug_message(DEBUG_TAB, "Changes recovered from the journal");
+
+    uri = pluma_document_get_uri(doc);
+    emsg = pluma_journal_recovered_message_area_new(uri);
+    g_free(uri);
+
+    set_message_area(tab, emsg);
+
+    g_signal_connect(emsg, "response",
+                     G_CALLBACK(journal_recovered_message_area_response), tab);
+
+    gtk_info_bar_set_default_response(GTK_INFO_BAR(emsg), GTK_RESPONSE_CANCEL);
+
+    gtk_widget_show(emsg);
+  }
+}
+
+static void stop_journal(PlumaTab *tab) {
+  g_clear_pointer(&tab->priv->journal, pluma_document_journal_free);
+}
+
+/* Called when the snapshot of a background save is taken: the text saved
+ * is the one of the snapshot, the edits made since go to a new journal */
+static void start_save_journal(PlumaTab *tab) {
+  PlumaDocument *doc;
+
+  if (tab->priv->save_journal != NULL || !journal_enabled(tab)) return;
+
+  doc = pluma_tab_get_document(tab);
+
+  if (_pluma_document_is_partial(doc) || _pluma_document_is_paged(doc)) return;
+
+  tab->priv->save_journal =
+      pluma_document_journal_new_for_save(doc, tab->priv->tmp_save_uri);
+}
+
+/* The journal of the saved file replaces the one of the text before */
+static void replace_journal(PlumaTab *tab) {
+  PlumaDocumentJournal *journal;
+
+  stop_journal(tab);
+
+  journal = tab->priv->save_journal;
+  tab->priv->save_journal = NULL;
+
+  /* the save did not go through a snapshot */
+  if (journal == NULL) {
+    start_journal(tab);
+    return;
+  }
+
+  /* auto save may have been turned off meanwhile */
+  if (!journal_enabled(tab) ||
+      !pluma_document_journal_commit(journal, tab->priv->tmp_save_uri)) {
+    pluma_document_journal_free(journal);
+    return;
+  }
+
+  tab->priv->journal = journal;
+}
+
 static gboolean install_auto_save_timeout_if_needed(PlumaTab *tab) {
   PlumaDocument *doc;
 
@@ -169,6 +300,9 @@ static void pluma_tab_get_property(GObject *object, guint prop_id,
     case PROP_AUTO_SAVE_INTERVAL:
       g_value_set_int(value, pluma_tab_get_auto_save_interval(tab));
       break;
+    case PROP_FOLLOW:
+      g_value_set_boolean(value, _pluma_tab_get_follow(tab));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
       break;
@@ -195,12 +329,21 @@ static void pluma_tab_set_property(GObject *object, guint prop_id,
 static void pluma_tab_finalize(GObject *object) {
   PlumaTab *tab = PLUMA_TAB(object);
 
+  if (tab->priv->follower != NULL) {
+    g_signal_handlers_disconnect_by_data(tab->priv->follower, tab);
+    pluma_document_follower_stop(tab->priv->follower);
+    g_clear_object(&tab->priv->follower);
+  }
+
   if (tab->priv->timer != NULL) g_timer_destroy(tab->priv->timer);
 
   g_free(tab->priv->tmp_save_uri);
 
   if (tab->priv->auto_save_timeout > 0) remove_auto_save_timeout(tab);
 
+  stop_journal(tab);
+  g_clear_pointer(&tab->priv->save_journal, pluma_document_journal_free);
+
   if (tab->priv->idle_scroll != 0) {
     g_source_remove(tab->priv->idle_scroll);
     tab->priv->idle_scroll = 0;
@@ -241,6 +384,12 @@ static void pluma_tab_class_init(PlumaTabClass *klass) {
       g_param_spec_int("autosave-interval", "AutosaveInterval",
                        "Time between two autosaves", 0, G_MAXINT, 0,
                        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(
+      object_class, PROP_FOLLOW,
+      g_param_spec_boolean("follow", "Follow",
+                           "Whether text appended to the file is shown", FALSE,
+                           G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 /**
@@ -257,18 +406,29 @@ PlumaTabState pluma_tab_get_state(PlumaTab *tab) {
   return tab->priv->state;
 }
 
+/* A document saved from a snapshot can be edited meanwhile */
+static gboolean is_saving_in_background(PlumaDocument *doc,
+                                        PlumaTabState state) {
+  return state == PLUMA_TAB_STATE_SAVING &&
+         _pluma_document_is_saving_snapshot(doc);
+}
+
 static void set_cursor_according_to_state(GtkTextView *view,
                                           PlumaTabState state) {
   GdkCursor *cursor;
   GdkWindow *text_window;
   GdkWindow *left_window;
+  PlumaDocument *doc;
 
   text_window = gtk_text_view_get_window(view, GTK_TEXT_WINDOW_TEXT);
   left_window = gtk_text_view_get_window(view, GTK_TEXT_WINDOW_LEFT);
 
+  doc = PLUMA_DOCUMENT(gtk_text_view_get_buffer(view));
+
   if ((state == PLUMA_TAB_STATE_LOADING) ||
       (state == PLUMA_TAB_STATE_REVERTING) ||
-      (state == PLUMA_TAB_STATE_SAVING) ||
+      (state == PLUMA_TAB_STATE_SAVING &&
+       !_pluma_document_is_saving_snapshot(doc)) ||
       (state == PLUMA_TAB_STATE_PRINTING) ||
       (state == PLUMA_TAB_STATE_PRINT_PREVIEWING) ||
       (state == PLUMA_TAB_STATE_CLOSING)) {
@@ -302,8 +462,12 @@ static void set_view_properties_according_to_state(PlumaTab *tab,
   hl_current_line = g_settings_get_boolean(
       tab->priv->editor_settings, PLUMA_SETTINGS_HIGHLIGHT_CURRENT_LINE);
 
-  val = ((state == PLUMA_TAB_STATE_NORMAL) &&
-         (tab->priv->print_preview == NULL) && !tab->priv->not_editable);
+  val = ((state == PLUMA_TAB_STATE_NORMAL ||
+          is_saving_in_background(pluma_tab_get_document(tab), state)) &&
+         (tab->priv->print_preview == NULL) && !tab->priv->not_editable &&
+         (tab->priv->follower == NULL) &&
+         !_pluma_document_is_paged(pluma_tab_get_document(tab)) &&
+         !_pluma_document_is_partial(pluma_tab_get_document(tab)));
   gtk_text_view_set_editable(GTK_TEXT_VIEW(tab->priv->view), val);
 
   val = ((state != PLUMA_TAB_STATE_LOADING) &&
@@ -323,6 +487,7 @@ static void pluma_tab_set_state(PlumaTab *tab, PlumaTabState state) {
   if (tab->priv->state == state) return;
 
   tab->priv->state = state;
+  tab->priv->saving_in_background = FALSE;
 
   set_view_properties_according_to_state(tab, state);
 
@@ -459,6 +624,36 @@ static void file_already_open_warning_message_area_response(
   gtk_widget_grab_focus(GTK_WIDGET(view));
 }
 
+static void partial_load_message_area_response(GtkWidget *message_area,
+                                               gint response_id,
+                                               PlumaTab *tab) {
+  if (response_id == GTK_RESPONSE_OK) {
+    _pluma_document_set_load_range(pluma_tab_get_document(tab),
+                                   PLUMA_DOCUMENT_LOAD_RANGE_ALL, 0);
+    _pluma_tab_revert(tab);
+    return;
+  }
+
+  set_message_area(tab, NULL);
+
+  gtk_widget_grab_focus(GTK_WIDGET(pluma_tab_get_view(tab)));
+}
+
+static void paged_load_message_area_response(GtkWidget *message_area,
+                                             gint response_id, PlumaTab *tab) {
+  set_message_area(tab, NULL);
+
+  gtk_widget_grab_focus(GTK_WIDGET(pluma_tab_get_view(tab)));
+}
+
+static void follow_error_message_area_response(GtkWidget *message_area,
+                                              gint response_id,
+                                              PlumaTab *tab) {
+  set_message_area(tab, NULL);
+
+  gtk_widget_grab_focus(GTK_WIDGET(pluma_tab_get_view(tab)));
+}
+
 static void load_cancelled(GtkWidget *area, gint response_id, PlumaTab *tab) {
   g_return_if_fail(PLUMA_IS_PROGRESS_MESSAGE_AREA(tab->priv->message_area));
 
@@ -713,10 +908,13 @@ static gboolean remove_tab_idle(PlumaTab *tab) {
   return FALSE;
 }
 
+static void start_following(PlumaTab *tab);
+
 static void document_loaded(PlumaDocument *document, const GError *error,
                             PlumaTab *tab) {
   GFile *location;
   gchar *uri;
+  gboolean follow;
 
   g_return_if_fail((tab->priv->state == PLUMA_TAB_STATE_LOADING) ||
                    (tab->priv->state == PLUMA_TAB_STATE_REVERTING));
@@ -728,6 +926,9 @@ static void document_loaded(PlumaDocument *document, const GError *error,
   }
   tab->priv->times_called = 0;
 
+  follow = tab->priv->follow_after_revert;
+  tab->priv->follow_after_revert = FALSE;
+
   set_message_area(tab, NULL);
 
   location = pluma_document_get_location(document);
@@ -739,6 +940,8 @@ static void document_loaded(PlumaDocument *document, const GError *error,
        error->code != PLUMA_DOCUMENT_ERROR_CONVERSION_FALLBACK)) {
     GtkWidget *emsg;
 
+    if (follow) g_object_notify(G_OBJECT(tab), "follow");
+
     if (tab->priv->state == PLUMA_TAB_STATE_LOADING)
       pluma_tab_set_state(tab, PLUMA_TAB_STATE_LOADING_ERROR);
     else
@@ -796,6 +999,39 @@ static void document_loaded(PlumaDocument *document, const GError *error,
                       uri, mime);
     g_free(mime);
 
+    if (_pluma_document_is_partial(document)) {
+      GtkWidget *emsg;
+      PlumaDocumentLoadRange range;
+      goffset size;
+
+      range = _pluma_document_get_load_range(document, &size);
+      emsg = pluma_partial_load_message_area_new(uri, range, size);
+
+      set_message_area(tab, emsg);
+
+      g_signal_connect(emsg, "response",
+                       G_CALLBACK(partial_load_message_area_response), tab);
+
+      gtk_info_bar_set_default_response(GTK_INFO_BAR(emsg),
+                                        GTK_RESPONSE_CANCEL);
+
+      gtk_widget_show(emsg);
+    } else if (_pluma_document_is_paged(document)) {
+      GtkWidget *emsg;
+
+      emsg = pluma_paged_load_message_area_new(uri);
+
+      set_message_area(tab, emsg);
+
+      g_signal_connect(emsg, "response",
+                       G_CALLBACK(paged_load_message_area_response), tab);
+
+      gtk_info_bar_set_default_response(GTK_INFO_BAR(emsg),
+                                        GTK_RESPONSE_CANCEL);
+
+      gtk_widget_show(emsg);
+    }
+
     if (error && error->domain == PLUMA_DOCUMENT_ERROR &&
         error->code == PLUMA_DOCUMENT_ERROR_CONVERSION_FALLBACK) {
       GtkWidget *emsg;
@@ -867,6 +1103,10 @@ static void document_loaded(PlumaDocument *document, const GError *error,
     install_auto_save_timeout_if_needed(tab);
 
     tab->priv->ask_if_externally_modified = TRUE;
+
+    if (follow) start_following(tab);
+
+    start_journal(tab);
   }
 
 end:
@@ -887,6 +1127,18 @@ static void document_saving(PlumaDocument *document, goffset size,
   pluma_debug_message(DEBUG_TAB, "%" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT,
                       size, total_size);
 
+  /* the snapshot has just been taken */
+  if (is_saving_in_background(document, tab->priv->state) &&
+      !tab->priv->saving_in_background) {
+    tab->priv->saving_in_background = TRUE;
+
+    start_save_journal(tab);
+
+    set_view_properties_according_to_state(tab, tab->priv->state);
+    set_cursor_according_to_state(GTK_TEXT_VIEW(tab->priv->view),
+                                  tab->priv->state);
+  }
+
   if (tab->priv->timer == NULL) {
     g_return_if_fail(tab->priv->times_called == 0);
     tab->priv->timer = g_timer_new();
@@ -1036,13 +1288,19 @@ static void document_saved(PlumaDocument *document, const GError *error,
   g_return_if_fail(tab->priv->tmp_encoding != NULL);
   g_return_if_fail(tab->priv->auto_save_timeout <= 0);
 
-  g_timer_destroy(tab->priv->timer);
-  tab->priv->timer = NULL;
+  /* not there if the file was left as it is */
+  if (tab->priv->timer != NULL) {
+    g_timer_destroy(tab->priv->timer);
+    tab->priv->timer = NULL;
+  }
   tab->priv->times_called = 0;
 
   set_message_area(tab, NULL);
 
   if (error != NULL) {
+    /* the journal of the text before is still the good one */
+    g_clear_pointer(&tab->priv->save_journal, pluma_document_journal_free);
+
     pluma_tab_set_state(tab, PLUMA_TAB_STATE_SAVING_ERROR);
 
     if (error->domain == PLUMA_DOCUMENT_ERROR &&
@@ -1120,6 +1378,9 @@ static void document_saved(PlumaDocument *document, const GError *error,
 
     tab->priv->ask_if_externally_modified = TRUE;
 
+    /* the file may have moved too */
+    replace_journal(tab);
+
     end_saving(tab);
   }
 }
@@ -1187,6 +1448,11 @@ static gboolean view_focused_in(GtkWidget *widget, GdkEventFocus *event,
     return FALSE;
   }
 
+  /* the changes are being appended as they come */
+  if (tab->priv->follower != NULL) {
+    return FALSE;
+  }
+
   doc = pluma_tab_get_document(tab);
 
   /* If file was never saved or is remote we do not check */
@@ -1205,6 +1471,66 @@ static gboolean view_focused_in(GtkWidget *widget, GdkEventFocus *event,
   return FALSE;
 }
 
+/* In large file mode the window shown in the document is moved when the view
+ * is scrolled close to one of its ends */
+static void vadjustment_value_changed(GtkAdjustment *adjustment,
+                                      PlumaTab *tab) {
+  PlumaDocument *doc;
+  GtkTextBuffer *buffer;
+  GtkTextMark *mark;
+  GtkTextIter iter;
+  gdouble value;
+  gdouble page_size;
+  gint direction;
+  gint top_line;
+  gint moved;
+
+  doc = pluma_tab_get_document(tab);
+
+  if (!_pluma_document_is_paged(doc) || tab->priv->moving_window) return;
+
+  value = gtk_adjustment_get_value(adjustment);
+  page_size = gtk_adjustment_get_page_size(adjustment);
+
+  if (value > tab->priv->last_scroll_value &&
+      value + 2 * page_size >= gtk_adjustment_get_upper(adjustment))
+    direction = 1;
+  else if (value < tab->priv->last_scroll_value &&
+           value <= gtk_adjustment_get_lower(adjustment) + page_size)
+    direction = -1;
+  else
+    direction = 0;
+
+  tab->priv->last_scroll_value = value;
+
+  if (direction == 0) return;
+
+  buffer = GTK_TEXT_BUFFER(doc);
+
+  gtk_text_view_get_line_at_y(GTK_TEXT_VIEW(tab->priv->view), &iter,
+                              (gint)value, NULL);
+  top_line = gtk_text_iter_get_line(&iter);
+
+  tab->priv->moving_window = TRUE;
+  moved = _pluma_document_move_window(doc, direction);
+  tab->priv->moving_window = FALSE;
+
+  if (moved == 0) return;
+
+  /* keep the same line of the file at the top of the view */
+  gtk_text_buffer_get_iter_at_line(buffer, &iter, MAX(top_line - moved, 0));
+  gtk_text_buffer_place_cursor(buffer, &iter);
+
+  mark = gtk_text_buffer_get_mark(buffer, "pluma-window-top");
+  if (mark == NULL)
+    mark = gtk_text_buffer_create_mark(buffer, "pluma-window-top", &iter, TRUE);
+  else
+    gtk_text_buffer_move_mark(buffer, mark, &iter);
+
+  gtk_text_view_scroll_to_mark(GTK_TEXT_VIEW(tab->priv->view), mark, 0.0, TRUE,
+                               0.0, 0.0);
+}
+
 static GMountOperation *tab_mount_operation_factory(PlumaDocument *doc,
                                                     gpointer userdata) {
   PlumaTab *tab = PLUMA_TAB(userdata);
@@ -1325,6 +1651,9 @@ static void pluma_tab_init(PlumaTab *tab) {
 
   g_signal_connect_after(tab->priv->view, "realize", G_CALLBACK(view_realized),
                          tab);
+
+  g_signal_connect(gtk_scrolled_window_get_vadjustment(GTK_SCROLLED_WINDOW(sw)),
+                   "value-changed", G_CALLBACK(vadjustment_value_changed), tab);
 }
 
 GtkWidget *_pluma_tab_new(void) {
@@ -1634,6 +1963,131 @@ PlumaTab *pluma_tab_get_from_document(PlumaDocument *doc) {
   return (res != NULL) ? PLUMA_TAB(res) : NULL;
 }
 
+static void follower_appended(PlumaDocumentFollower *follower, PlumaTab *tab) {
+  GtkTextBuffer *buffer;
+  GtkTextIter end;
+
+  if (!g_settings_get_boolean(tab->priv->editor_settings,
+                              PLUMA_SETTINGS_FOLLOW_AUTO_SCROLL))
+    return;
+
+  buffer = GTK_TEXT_BUFFER(pluma_tab_get_document(tab));
+
+  gtk_text_buffer_get_end_iter(buffer, &end);
+  gtk_text_buffer_place_cursor(buffer, &end);
+
+  pluma_view_scroll_to_cursor(PLUMA_VIEW(tab->priv->view));
+}
+
+static void follower_stopped(PlumaDocumentFollower *follower,
+                             const GError *error, PlumaTab *tab) {
+  if (error != NULL) {
+    GtkWidget *emsg;
+    gchar *uri;
+
+    pluma_debug_message(DEBUG_TAB, "Stopped following: %s", error->message);
+
+    uri = pluma_document_get_uri(pluma_tab_get_document(tab));
+    emsg = pluma_follow_error_message_area_new(uri, error);
+    g_free(uri);
+
+    set_message_area(tab, emsg);
+
+    g_signal_connect(emsg, "response",
+                     G_CALLBACK(follow_error_message_area_response), tab);
+
+    gtk_info_bar_set_default_response(GTK_INFO_BAR(emsg), GTK_RESPONSE_CANCEL);
+
+    gtk_widget_show(emsg);
+  }
+
+  g_signal_handlers_disconnect_by_data(follower, tab);
+  g_clear_object(&tab->priv->follower);
+
+  /* unless a load drops the text anyway, the journal starts again from
+   * what was appended */
+  if (tab->priv->state == PLUMA_TAB_STATE_NORMAL) start_journal(tab);
+
+  set_view_properties_according_to_state(tab, tab->priv->state);
+
+  g_object_notify(G_OBJECT(tab), "follow");
+}
+
+static void start_following(PlumaTab *tab) {
+  g_return_if_fail(tab->priv->follower == NULL);
+
+  /* the appended text would make the hash of the journal stale */
+  stop_journal(tab);
+
+  tab->priv->follower =
+      pluma_document_follower_new(pluma_tab_get_document(tab));
+
+  g_signal_connect(tab->priv->follower, "appended",
+                   G_CALLBACK(follower_appended), tab);
+  g_signal_connect(tab->priv->follower, "stopped",
+                   G_CALLBACK(follower_stopped), tab);
+
+  pluma_document_follower_start(tab->priv->follower);
+
+  set_view_properties_according_to_state(tab, tab->priv->state);
+
+  g_object_notify(G_OBJECT(tab), "follow");
+}
+
+static void stop_following(PlumaTab *tab) {
+  /* the "stopped" handler releases the follower */
+  if (tab->priv->follower != NULL)
+    pluma_document_follower_stop(tab->priv->follower);
+}
+
+gboolean _pluma_tab_get_follow(PlumaTab *tab) {
+  g_return_val_if_fail(PLUMA_IS_TAB(tab), FALSE);
+
+  return (tab->priv->follower != NULL) || tab->priv->follow_after_revert;
+}
+
+/* In follow mode the text written at the end of the file is appended to the
+ * document as it comes, without reloading the whole file */
+void _pluma_tab_set_follow(PlumaTab *tab, gboolean follow) {
+  PlumaDocument *doc;
+
+  g_return_if_fail(PLUMA_IS_TAB(tab));
+
+  if (follow == _pluma_tab_get_follow(tab)) return;
+
+  if (!follow) {
+    tab->priv->follow_after_revert = FALSE;
+    stop_following(tab);
+    g_object_notify(G_OBJECT(tab), "follow");
+    return;
+  }
+
+  g_return_if_fail(tab->priv->state == PLUMA_TAB_STATE_NORMAL);
+
+  doc = pluma_tab_get_document(tab);
+  g_return_if_fail(!pluma_document_is_untitled(doc));
+  g_return_if_fail(!_pluma_document_is_paged(doc));
+  /* the text is only appended to the tail of the file */
+  g_return_if_fail(!_pluma_document_is_partial(doc) ||
+                   _pluma_document_get_load_range(doc, NULL) ==
+                       PLUMA_DOCUMENT_LOAD_RANGE_TAIL);
+
+  /* the edits would be mixed with the text read from the file, the action
+   * is insensitive then */
+  g_return_if_fail(!gtk_text_buffer_get_modified(GTK_TEXT_BUFFER(doc)));
+
+  /* we would not know where the text we have ends in the file */
+  if (pluma_document_is_local(doc) &&
+      _pluma_document_check_externally_modified(doc)) {
+    _pluma_tab_revert(tab);
+    tab->priv->follow_after_revert = TRUE;
+    g_object_notify(G_OBJECT(tab), "follow");
+    return;
+  }
+
+  start_following(tab);
+}
+
 void _pluma_tab_load(PlumaTab *tab, const gchar *uri,
                      const PlumaEncoding *encoding, gint line_pos,
                      gboolean create) {
@@ -1647,11 +2101,15 @@ void _pluma_tab_load(PlumaTab *tab, const gchar *uri,
 
   pluma_tab_set_state(tab, PLUMA_TAB_STATE_LOADING);
 
+  stop_following(tab);
+
   tab->priv->tmp_line_pos = line_pos;
   tab->priv->tmp_encoding = encoding;
 
   if (tab->priv->auto_save_timeout > 0) remove_auto_save_timeout(tab);
 
+  stop_journal(tab);
+
   pluma_document_load(doc, uri, encoding, line_pos, create);
 }
 
@@ -1673,6 +2131,8 @@ void _pluma_tab_revert(PlumaTab *tab) {
 
   pluma_tab_set_state(tab, PLUMA_TAB_STATE_REVERTING);
 
+  stop_following(tab);
+
   uri = pluma_document_get_uri(doc);
   g_return_if_fail(uri != NULL);
 
@@ -1681,6 +2141,9 @@ void _pluma_tab_revert(PlumaTab *tab) {
 
   if (tab->priv->auto_save_timeout > 0) remove_auto_save_timeout(tab);
 
+  /* the changes are dropped */
+  stop_journal(tab);
+
   pluma_document_load(doc, uri, tab->priv->tmp_encoding, 0, FALSE);
 
   g_free(uri);
@@ -1714,6 +2177,8 @@ void _pluma_tab_save(PlumaTab *tab) {
     save_flags = tab->priv->save_flags;
   }
 
+  stop_following(tab);
+
   pluma_tab_set_state(tab, PLUMA_TAB_STATE_SAVING);
 
   /* uri used in error messages, will be freed in document_saved */
@@ -1748,6 +2213,15 @@ static gboolean pluma_tab_auto_save(PlumaTab *tab) {
     return TRUE;
   }
 
+  /* the changes are appended to the journal as they are made, the file is
+   * left alone */
+  if (tab->priv->journal != NULL &&
+      pluma_document_journal_sync(tab->priv->journal)) {
+    pluma_debug_message(DEBUG_TAB, "Changes synced to the journal");
+
+    return TRUE;
+  }
+
   if ((tab->priv->state != PLUMA_TAB_STATE_NORMAL) &&
       (tab->priv->state != PLUMA_TAB_STATE_SHOWING_PRINT_PREVIEW)) {
     /* Retry after 30 seconds */
@@ -1797,6 +2271,8 @@ void _pluma_tab_save_as(PlumaTab *tab, const gchar *uri,
       (tab->priv->state == PLUMA_TAB_STATE_EXTERNALLY_MODIFIED_NOTIFICATION) ||
       (tab->priv->state == PLUMA_TAB_STATE_SHOWING_PRINT_PREVIEW));
   g_return_if_fail(encoding != NULL);
+  g_return_if_fail(!_pluma_document_is_paged(pluma_tab_get_document(tab)));
+  g_return_if_fail(!_pluma_document_is_partial(pluma_tab_get_document(tab)));
 
   g_return_if_fail(tab->priv->tmp_save_uri == NULL);
   g_return_if_fail(tab->priv->tmp_encoding == NULL);
@@ -1804,6 +2280,8 @@ void _pluma_tab_save_as(PlumaTab *tab, const gchar *uri,
   doc = pluma_tab_get_document(tab);
   g_return_if_fail(PLUMA_IS_DOCUMENT(doc));
 
+  stop_following(tab);
+
   /* reset the save flags, when saving as */
   tab->priv->save_flags = 0;
 
@@ -2154,6 +2632,12 @@ void pluma_tab_set_auto_save_enabled(PlumaTab *tab, gboolean enable) {
 
   tab->priv->auto_save = enable;
 
+  if (!enable) {
+    stop_journal(tab);
+  } else if (tab->priv->state == PLUMA_TAB_STATE_NORMAL) {
+    start_journal(tab);
+  }
+
   if (enable && (tab->priv->auto_save_timeout <= 0) &&
       !pluma_document_is_untitled(doc) && !pluma_document_get_readonly(doc)) {
     if ((tab->priv->state != PLUMA_TAB_STATE_LOADING) &&
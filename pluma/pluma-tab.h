@@ -134,6 +134,8 @@ void _pluma_tab_load(PlumaTab *tab, const gchar *uri,
                      const PlumaEncoding *encoding, gint line_pos,
                      gboolean create);
 void _pluma_tab_revert(PlumaTab *tab);
+gboolean _pluma_tab_get_follow(PlumaTab *tab);
+void _pluma_tab_set_follow(PlumaTab *tab, gboolean follow);
 void _pluma_tab_save(PlumaTab *tab);
 void _pluma_tab_save_as(PlumaTab *tab, const gchar *uri,
                         const PlumaEncoding *encoding,
@@ -177,6 +177,12 @@ static const GtkToggleActionEntry pluma_always_sensitive_toggle_menu_entries[] =
       N_("Edit text in fullscreen"),
       G_CALLBACK(_pluma_cmd_view_toggle_fullscreen_mode), FALSE}};
 
+/* follow mode of the active tab */
+static const GtkToggleActionEntry pluma_toggle_menu_entries[] = {
+    {"ViewFollow", NULL, N_("F_ollow File"), NULL,
+     N_("Show text as it is appended to the file"),
+     G_CALLBACK(_pluma_cmd_view_toggle_follow), FALSE}};
+
 /* separate group, should be always sensitive except when there are no panes */
 static const GtkToggleActionEntry pluma_panes_toggle_menu_entries[] = {
     {"ViewSidePane", NULL, N_("Side _Pane"), "F9",
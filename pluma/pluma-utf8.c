@@ -0,0 +1,211 @@
+/*
+ * pluma-utf8.c
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "pluma-utf8.h"
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define WORD_ONES G_GUINT64_CONSTANT(0x0101010101010101)
+#define WORD_HIGHS G_GUINT64_CONSTANT(0x8080808080808080)
+#define WORD_HAS_ZERO(w) (((w) - WORD_ONES) & ~(w) & WORD_HIGHS)
+#define WORD_HAS_BYTE(w, b) WORD_HAS_ZERO((w) ^ (WORD_ONES * (b)))
+
+/* Returns the end of the run of non-nul ASCII bytes starting at p */
+static const guchar *skip_ascii(const guchar *p, const guchar *stop) {
+#if defined(__AVX2__)
+  const __m256i zero = _mm256_setzero_si256();
+
+  while (stop - p >= 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+
+    if (_mm256_movemask_epi8(_mm256_or_si256(v, _mm256_cmpeq_epi8(v, zero))))
+      break;
+
+    p += 32;
+  }
+#elif defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+
+  while (stop - p >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+
+    if (_mm_movemask_epi8(_mm_or_si128(v, _mm_cmpeq_epi8(v, zero)))) break;
+
+    p += 16;
+  }
+#endif
+
+  while (stop - p >= 8) {
+    guint64 word;
+
+    memcpy(&word, p, sizeof(guint64));
+
+    if ((word & WORD_HIGHS) != 0 || WORD_HAS_ZERO(word)) break;
+
+    p += 8;
+  }
+
+  while (p < stop && *p != 0 && *p < 0x80) p++;
+
+  return p;
+}
+
+/* Returns the length of the well-formed multibyte sequence at p, see the
+ * table of well-formed byte sequences of the Unicode standard, or 0 */
+static gsize get_sequence_length(const guchar *p, const guchar *stop) {
+  guchar lo = 0x80;
+  guchar hi = 0xbf;
+  gsize len;
+  gsize i;
+
+  if (p[0] >= 0xc2 && p[0] <= 0xdf) {
+    len = 2;
+  } else if (p[0] >= 0xe0 && p[0] <= 0xef) {
+    len = 3;
+
+    if (p[0] == 0xe0)
+      lo = 0xa0;
+    else if (p[0] == 0xed)
+      hi = 0x9f;
+  } else if (p[0] >= 0xf0 && p[0] <= 0xf4) {
+    len = 4;
+
+    if (p[0] == 0xf0)
+      lo = 0x90;
+    else if (p[0] == 0xf4)
+      hi = 0x8f;
+  } else {
+    return 0;
+  }
+
+  if ((gsize)(stop - p) < len) return 0;
+
+  if (p[1] < lo || p[1] > hi) return 0;
+
+  for (i = 2; i < len; i++) {
+    if (p[i] < 0x80 || p[i] > 0xbf) return 0;
+  }
+
+  return len;
+}
+
+gboolean pluma_utf8_validate(const gchar *str, gsize max_len,
+                             const gchar **end) {
+  const guchar *p = (const guchar *)str;
+  const guchar *stop = p + max_len;
+
+  while (p < stop) {
+    gsize len;
+
+    p = skip_ascii(p, stop);
+
+    if (p == stop) break;
+
+    len = get_sequence_length(p, stop);
+
+    if (len == 0) break;
+
+    p += len;
+  }
+
+  if (end != NULL) *end = (const gchar *)p;
+
+  return p == stop;
+}
+
+/* Returns the first '\r', '\n' or 0xe2 byte, the lead byte of U+2029, at or
+ * after p, or stop */
+static const guchar *find_break_candidate(const guchar *p,
+                                          const guchar *stop) {
+#if defined(__AVX2__)
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const __m256i lf = _mm256_set1_epi8('\n');
+  const __m256i ps = _mm256_set1_epi8((gchar)0xe2);
+
+  while (stop - p >= 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    guint mask = _mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, cr),
+                                        _mm256_cmpeq_epi8(v, lf)),
+                        _mm256_cmpeq_epi8(v, ps)));
+
+    if (mask != 0) return p + __builtin_ctz(mask);
+
+    p += 32;
+  }
+#elif defined(__SSE2__)
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+  const __m128i ps = _mm_set1_epi8((gchar)0xe2);
+
+  while (stop - p >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    guint mask = _mm_movemask_epi8(_mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)),
+        _mm_cmpeq_epi8(v, ps)));
+
+    if (mask != 0) return p + __builtin_ctz(mask);
+
+    p += 16;
+  }
+#endif
+
+  while (stop - p >= 8) {
+    guint64 word;
+
+    memcpy(&word, p, sizeof(guint64));
+
+    if (WORD_HAS_BYTE(word, '\r') || WORD_HAS_BYTE(word, '\n') ||
+        WORD_HAS_BYTE(word, 0xe2))
+      break;
+
+    p += 8;
+  }
+
+  while (p < stop && *p != '\r' && *p != '\n' && *p != 0xe2) p++;
+
+  return p;
+}
+
+const gchar *pluma_utf8_find_line_break(const gchar *str, const gchar *end) {
+  const guchar *p = (const guchar *)str;
+  const guchar *stop = (const guchar *)end;
+
+  while ((p = find_break_candidate(p, stop)) < stop) {
+    if (*p != 0xe2 || (stop - p >= 3 && p[1] == 0x80 && p[2] == 0xa9)) break;
+
+    p++;
+  }
+
+  return (const gchar *)p;
+}
@@ -0,0 +1,43 @@
+/*
+ * pluma-utf8.h
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __PLUMA_UTF8_H__
+#define __PLUMA_UTF8_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Same as g_utf8_validate() with a length, but skips runs of ASCII many
+ * bytes at a time. Like g_utf8_validate(), nul bytes are invalid. */
+gboolean pluma_utf8_validate(const gchar *str, gsize max_len,
+                             const gchar **end);
+
+/* Returns the first line terminator of the valid UTF-8 text between str and
+ * end, that is '\r', '\n' or U+2029 PARAGRAPH SEPARATOR like GtkTextBuffer,
+ * or end when there is none. */
+const gchar *pluma_utf8_find_line_break(const gchar *str, const gchar *end);
+
+G_END_DECLS
+
+#endif /* __PLUMA_UTF8_H__ */
@@ -47,6 +47,7 @@
 
 #include "pluma-debug.h"
 #include "pluma-document.h"
+#include "pluma-regex-search.h"
 #include "pluma-settings.h"
 #include "pluma-utils.h"
 
@@ -1091,6 +1092,135 @@ gboolean pluma_utils_file_has_parent(GFile *gfile) {
   return ret;
 }
 
+#define MIN_IO_BLOCK_SIZE (8 * 1024)
+#define DEFAULT_IO_BLOCK_SIZE (64 * 1024)
+#define IO_BLOCKS_PER_FILE 64
+
+/**
+ * pluma_utils_get_io_block_size:
+ * @size: the size of the file in bytes, or -1 if it is not known
+ * @max_size: the largest block size to use, in bytes
+ *
+ * Returns the size of the blocks to read or write a file with: a power of two
+ * around 1/64th of @size, of at least 8 KiB and at most @max_size. Bigger
+ * blocks mean fewer requests, which is what matters on network file systems.
+ */
+gsize pluma_utils_get_io_block_size(goffset size, gsize max_size) {
+  gsize block_size = MIN_IO_BLOCK_SIZE;
+
+  max_size = MAX(max_size, MIN_IO_BLOCK_SIZE);
+
+  if (size < 0) return MIN(DEFAULT_IO_BLOCK_SIZE, max_size);
+
+  while (block_size < max_size &&
+         (goffset)block_size * IO_BLOCKS_PER_FILE < size) {
+    block_size *= 2;
+  }
+
+  return MIN(block_size, max_size);
+}
+
+#define HASH64_PRIME_1 G_GUINT64_CONSTANT(0x9E3779B185EBCA87)
+#define HASH64_PRIME_2 G_GUINT64_CONSTANT(0xC2B2AE3D27D4EB4F)
+#define HASH64_PRIME_3 G_GUINT64_CONSTANT(0x165667B19E3779F9)
+#define HASH64_PRIME_4 G_GUINT64_CONSTANT(0x85EBCA77C2B2AE63)
+#define HASH64_PRIME_5 G_GUINT64_CONSTANT(0x27D4EB2F165667C5)
+
+static inline guint64 hash64_rotl(guint64 x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+static inline guint64 hash64_read64(const guint8 *p) {
+  guint64 v;
+
+  memcpy(&v, p, sizeof(v));
+  return GUINT64_FROM_LE(v);
+}
+
+static inline guint64 hash64_read32(const guint8 *p) {
+  guint32 v;
+
+  memcpy(&v, p, sizeof(v));
+  return GUINT32_FROM_LE(v);
+}
+
+static inline guint64 hash64_round(guint64 acc, guint64 input) {
+  acc += input * HASH64_PRIME_2;
+  acc = hash64_rotl(acc, 31);
+  return acc * HASH64_PRIME_1;
+}
+
+static inline guint64 hash64_merge_round(guint64 acc, guint64 val) {
+  acc ^= hash64_round(0, val);
+  return acc * HASH64_PRIME_1 + HASH64_PRIME_4;
+}
+
+/**
+ * pluma_utils_hash64:
+ * @data: the bytes to hash
+ * @len: the length of @data
+ * @seed: the seed, e.g. the hash of the data before @data
+ *
+ * Returns a 64 bit hash of @data, the same as XXH64 from xxHash. It is not a
+ * cryptographic hash, but it is fast enough to hash a whole document.
+ */
+guint64 pluma_utils_hash64(const void *data, gsize len, guint64 seed) {
+  const guint8 *p = data;
+  const guint8 *end = p + len;
+  guint64 h;
+
+  if (len >= 32) {
+    const guint8 *limit = end - 32;
+    guint64 v1 = seed + HASH64_PRIME_1 + HASH64_PRIME_2;
+    guint64 v2 = seed + HASH64_PRIME_2;
+    guint64 v3 = seed;
+    guint64 v4 = seed - HASH64_PRIME_1;
+
+    do {
+      v1 = hash64_round(v1, hash64_read64(p));
+      v2 = hash64_round(v2, hash64_read64(p + 8));
+      v3 = hash64_round(v3, hash64_read64(p + 16));
+      v4 = hash64_round(v4, hash64_read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+
+    h = hash64_rotl(v1, 1) + hash64_rotl(v2, 7) + hash64_rotl(v3, 12) +
+        hash64_rotl(v4, 18);
+    h = hash64_merge_round(h, v1);
+    h = hash64_merge_round(h, v2);
+    h = hash64_merge_round(h, v3);
+    h = hash64_merge_round(h, v4);
+  } else {
+    h = seed + HASH64_PRIME_5;
+  }
+
+  h += (guint64)len;
+
+  for (; p + 8 <= end; p += 8) {
+    h ^= hash64_round(0, hash64_read64(p));
+    h = hash64_rotl(h, 27) * HASH64_PRIME_1 + HASH64_PRIME_4;
+  }
+
+  if (p + 4 <= end) {
+    h ^= hash64_read32(p) * HASH64_PRIME_1;
+    h = hash64_rotl(h, 23) * HASH64_PRIME_2 + HASH64_PRIME_3;
+    p += 4;
+  }
+
+  for (; p < end; p++) {
+    h ^= (*p) * HASH64_PRIME_5;
+    h = hash64_rotl(h, 11) * HASH64_PRIME_1;
+  }
+
+  h ^= h >> 33;
+  h *= HASH64_PRIME_2;
+  h ^= h >> 29;
+  h *= HASH64_PRIME_3;
+  h ^= h >> 32;
+
+  return h;
+}
+
 /**
  * pluma_utils_basename_for_display:
  * @uri: uri for which the basename should be displayed
@@ -1350,79 +1480,16 @@ gboolean pluma_gtk_text_iter_regex_search(
     const GtkTextIter *iter, const gchar *str, GtkTextSearchFlags flags,
     GtkTextIter *match_start, GtkTextIter *match_end, const GtkTextIter *limit,
     gboolean forward_search, gchar **replace_text) {
-  GRegex *regex;
-  GRegexCompileFlags compile_flags;
-  GMatchInfo *match_info;
-  gchar *text;
-  GtkTextIter *begin_iter;
-  GtkTextIter *end_iter;
-  gchar *match_string;
+  PlumaRegexSearch *search;
   gboolean found;
 
-  match_string = "";
-  compile_flags = G_REGEX_OPTIMIZE | G_REGEX_MULTILINE;
-
-  if ((flags & GTK_TEXT_SEARCH_CASE_INSENSITIVE) != 0)
-    compile_flags |= G_REGEX_CASELESS;
-
-  regex = g_regex_new(str, compile_flags, 0, NULL);
-
-  if (regex == NULL) return FALSE;
-
-  begin_iter = gtk_text_iter_copy(iter);
-
-  if (limit == NULL) {
-    end_iter = gtk_text_iter_copy(begin_iter);
-    if (forward_search) {
-      gtk_text_buffer_get_end_iter(gtk_text_iter_get_buffer(begin_iter),
-                                   end_iter);
-    } else {
-      gtk_text_buffer_get_start_iter(gtk_text_iter_get_buffer(begin_iter),
-                                     end_iter);
-    }
-  } else {
-    end_iter = gtk_text_iter_copy(limit);
-  }
+  search = pluma_regex_search_new(gtk_text_iter_get_buffer(iter));
 
-  if ((flags & GTK_TEXT_SEARCH_TEXT_ONLY) != 0) {
-    if ((flags & GTK_TEXT_SEARCH_VISIBLE_ONLY) != 0)
-      text = gtk_text_iter_get_visible_text(begin_iter, end_iter);
-    else
-      text = gtk_text_iter_get_text(begin_iter, end_iter);
-  } else if ((flags & GTK_TEXT_SEARCH_VISIBLE_ONLY) != 0)
-    text = gtk_text_iter_get_visible_slice(begin_iter, end_iter);
-  else
-    text = gtk_text_iter_get_slice(begin_iter, end_iter);
-
-  found = g_regex_match(regex, text, 0, &match_info);
+  found = pluma_regex_search_find(search, str, flags, iter, limit,
+                                  forward_search, match_start, match_end,
+                                  replace_text);
 
-  if (!found) goto free_resources;
-
-  if ((replace_text != NULL) && (*replace_text != NULL)) {
-    *replace_text =
-        g_match_info_expand_references(match_info, *replace_text, NULL);
-  }
-
-  while (g_match_info_matches(match_info)) {
-    match_string = g_match_info_fetch(match_info, 0);
-
-    if (forward_search) break;
-
-    g_match_info_next(match_info, NULL);
-  }
-
-  if (forward_search) {
-    gtk_text_iter_forward_search(begin_iter, match_string, flags, match_start,
-                                 match_end, limit);
-  } else {
-    gtk_text_iter_backward_search(begin_iter, match_string, flags, match_start,
-                                  match_end, limit);
-  }
+  pluma_regex_search_free(search);
 
-free_resources:
-  gtk_text_iter_free(begin_iter);
-  gtk_text_iter_free(end_iter);
-  g_match_info_free(match_info);
-  g_regex_unref(regex);
   return found;
 }
@@ -115,6 +115,10 @@ gboolean pluma_utils_get_ui_objects(const gchar *filename, gchar **root_objects,
 
 gboolean pluma_utils_file_has_parent(GFile *gfile);
 
+gsize pluma_utils_get_io_block_size(goffset size, gsize max_size);
+
+guint64 pluma_utils_hash64(const void *data, gsize len, guint64 seed);
+
 /* Return NULL if str is not a valid URI and/or filename */
 gchar *pluma_utils_make_canonical_uri_from_shell_arg(const gchar *str);
 
@@ -126,7 +130,7 @@ gboolean pluma_utils_decode_uri(const gchar *uri, gchar **scheme, gchar **user,
 /* Turns data from a drop into a list of well formatted uris */
 gchar **pluma_utils_drop_get_uris(GtkSelectionData *selection_data);
 
-/* Provides regexp forward search */
+/* Provides regexp forward and backward search */
 gboolean pluma_gtk_text_iter_regex_search(
     const GtkTextIter *iter, const gchar *str, GtkTextSearchFlags flags,
     GtkTextIter *match_start, GtkTextIter *match_end, const GtkTextIter *limit,
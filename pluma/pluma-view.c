@@ -1723,6 +1723,12 @@ static gboolean reset_searched_text(PlumaView *view) {
 }
 
 static gboolean start_interactive_search(PlumaView *view) {
+  GtkTextBuffer *buffer;
+
+  /* in large file mode only the window shown could be searched */
+  buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(view));
+  if (_pluma_document_is_paged(PLUMA_DOCUMENT(buffer))) return FALSE;
+
   view->priv->search_mode = SEARCH;
 
   return start_interactive_search_real(view);
@@ -610,6 +610,27 @@ static void set_paste_sensitivity_according_to_clipboard(
   }
 }
 
+/* following the file appends to the document, which is only right when it
+ * ends where the file does */
+static gboolean is_partial_head(PlumaDocument *doc) {
+  return _pluma_document_is_partial(doc) &&
+         _pluma_document_get_load_range(doc, NULL) ==
+             PLUMA_DOCUMENT_LOAD_RANGE_HEAD;
+}
+
+/* whether follow mode can be turned on, the edits would be mixed with the
+ * appended text */
+static gboolean can_follow(PlumaTab *tab) {
+  PlumaDocument *doc;
+
+  doc = pluma_tab_get_document(tab);
+
+  return pluma_tab_get_state(tab) == PLUMA_TAB_STATE_NORMAL &&
+         !pluma_document_is_untitled(doc) && !_pluma_document_is_paged(doc) &&
+         !is_partial_head(doc) &&
+         !gtk_text_buffer_get_modified(GTK_TEXT_BUFFER(doc));
+}
+
 static void set_sensitivity_according_to_tab(PlumaWindow *window,
                                              PlumaTab *tab) {
   PlumaDocument *doc;
@@ -657,13 +678,17 @@ static void set_sensitivity_according_to_tab(PlumaWindow *window,
                   !(lockdown & PLUMA_LOCKDOWN_SAVE_TO_DISK) && (cansave) &&
                   (editable));
 
+  /* in large file mode or when only the head or the tail of the file is
+   * loaded the document only holds a part of the file */
   action =
       gtk_action_group_get_action(window->priv->action_group, "FileSaveAs");
   gtk_action_set_sensitive(
       action, (state_normal || (state == PLUMA_TAB_STATE_SAVING_ERROR) ||
                (state == PLUMA_TAB_STATE_EXTERNALLY_MODIFIED_NOTIFICATION) ||
                (state == PLUMA_TAB_STATE_SHOWING_PRINT_PREVIEW)) &&
-                  !(lockdown & PLUMA_LOCKDOWN_SAVE_TO_DISK));
+                  !(lockdown & PLUMA_LOCKDOWN_SAVE_TO_DISK) &&
+                  !_pluma_document_is_paged(doc) &&
+                  !_pluma_document_is_partial(doc));
 
   action =
       gtk_action_group_get_action(window->priv->action_group, "FileRevert");
@@ -726,23 +751,27 @@ static void set_sensitivity_according_to_tab(PlumaWindow *window,
       action, state_normal && editable &&
                   gtk_text_buffer_get_has_selection(GTK_TEXT_BUFFER(doc)));
 
+  /* in large file mode the search would only see the window shown */
   action =
       gtk_action_group_get_action(window->priv->action_group, "SearchFind");
   gtk_action_set_sensitive(
       action, (state_normal ||
-               state == PLUMA_TAB_STATE_EXTERNALLY_MODIFIED_NOTIFICATION));
+               state == PLUMA_TAB_STATE_EXTERNALLY_MODIFIED_NOTIFICATION) &&
+                  !_pluma_document_is_paged(doc));
 
   action = gtk_action_group_get_action(window->priv->action_group,
                                        "SearchIncrementalSearch");
   gtk_action_set_sensitive(
       action, (state_normal ||
-               state == PLUMA_TAB_STATE_EXTERNALLY_MODIFIED_NOTIFICATION));
+               state == PLUMA_TAB_STATE_EXTERNALLY_MODIFIED_NOTIFICATION) &&
+                  !_pluma_document_is_paged(doc));
 
   action =
       gtk_action_group_get_action(window->priv->action_group, "SearchReplace");
   gtk_action_set_sensitive(action, state_normal && editable);
 
-  b = pluma_document_get_can_search_again(doc);
+  b = pluma_document_get_can_search_again(doc) &&
+      !_pluma_document_is_paged(doc);
   action =
       gtk_action_group_get_action(window->priv->action_group, "SearchFindNext");
   gtk_action_set_sensitive(
@@ -775,6 +804,15 @@ static void set_sensitivity_according_to_tab(PlumaWindow *window,
   gtk_action_set_sensitive(
       action, (state != PLUMA_TAB_STATE_CLOSING) && enable_syntax_highlighting);
 
+  b = _pluma_tab_get_follow(tab);
+  action = gtk_action_group_get_action(window->priv->action_group, "ViewFollow");
+  g_signal_handlers_block_by_func(
+      action, G_CALLBACK(_pluma_cmd_view_toggle_follow), window);
+  gtk_toggle_action_set_active(GTK_TOGGLE_ACTION(action), b);
+  g_signal_handlers_unblock_by_func(
+      action, G_CALLBACK(_pluma_cmd_view_toggle_follow), window);
+  gtk_action_set_sensitive(action, b || can_follow(tab));
+
   update_next_prev_doc_sensitivity(window, tab);
 
   peas_extension_set_call(window->priv->extensions, "update_state");
@@ -1271,6 +1309,9 @@ static void create_menu_bar_and_toolbar(PlumaWindow *window,
   gtk_action_group_set_translation_domain(action_group, NULL);
   gtk_action_group_add_actions(action_group, pluma_menu_entries,
                                G_N_ELEMENTS(pluma_menu_entries), window);
+  gtk_action_group_add_toggle_actions(action_group, pluma_toggle_menu_entries,
+                                      G_N_ELEMENTS(pluma_toggle_menu_entries),
+                                      window);
   gtk_ui_manager_insert_action_group(manager, action_group, 0);
   g_object_unref(action_group);
   window->priv->action_group = action_group;
@@ -1783,7 +1824,9 @@ static void update_cursor_position_statusbar(GtkTextBuffer *buffer,
   gtk_text_buffer_get_iter_at_mark(buffer, &iter,
                                    gtk_text_buffer_get_insert(buffer));
 
-  row = gtk_text_iter_get_line(&iter);
+  /* the line in the file, not in the part of it which is loaded */
+  row = gtk_text_iter_get_line(&iter) +
+        _pluma_document_get_first_line(PLUMA_DOCUMENT(buffer));
 
   col = gtk_source_view_get_visual_column(GTK_SOURCE_VIEW(view), &iter);
 
@@ -1803,6 +1846,21 @@ static void update_overwrite_mode_statusbar(GtkTextView *view,
                                 !gtk_text_view_get_overwrite(view));
 }
 
+/* connected to "loaded", "saved" and "notify::newline-type", which all have
+ * one pointer argument */
+static void update_newlines_statusbar(PlumaDocument *doc, gpointer unused,
+                                      PlumaWindow *window) {
+  if (doc != pluma_window_get_active_document(window)) return;
+
+  pluma_statusbar_set_newlines(
+      PLUMA_STATUSBAR(window->priv->statusbar),
+      pluma_document_get_newline_type(doc),
+      pluma_document_get_newline_count(doc, PLUMA_DOCUMENT_NEWLINE_TYPE_LF),
+      pluma_document_get_newline_count(doc, PLUMA_DOCUMENT_NEWLINE_TYPE_CR),
+      pluma_document_get_newline_count(doc,
+                                       PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF));
+}
+
 #define MAX_TITLE_LENGTH 100
 
 static void set_title(PlumaWindow *window) {
@@ -1868,11 +1926,18 @@ static void set_title(PlumaWindow *window) {
     cansave = FALSE;
 
   if (pluma_document_get_readonly(doc)) {
+    const gchar *read_only;
+
+    /* only the head or the tail of the file is loaded */
+    if (_pluma_document_is_partial(doc))
+      read_only = _("Partial, Read-Only");
+    else
+      read_only = _("Read-Only");
+
     if (dirname != NULL)
-      title = g_strdup_printf("%s [%s] (%s) - Pluma", name, _("Read-Only"),
-                              dirname);
+      title = g_strdup_printf("%s [%s] (%s) - Pluma", name, read_only, dirname);
     else
-      title = g_strdup_printf("%s [%s] - Pluma", name, _("Read-Only"));
+      title = g_strdup_printf("%s [%s] - Pluma", name, read_only);
   } else {
     if (dirname != NULL)
       title = g_strdup_printf("%s (%s) - Pluma", name, dirname);
@@ -2060,6 +2125,7 @@ static void notebook_switch_page(GtkNotebook *book, GtkWidget *pg,
   pluma_statusbar_set_overwrite(
       PLUMA_STATUSBAR(window->priv->statusbar),
       gtk_text_view_get_overwrite(GTK_TEXT_VIEW(view)));
+  update_newlines_statusbar(pluma_tab_get_document(tab), NULL, window);
 
   gtk_widget_show(window->priv->tab_width_combo);
   gtk_widget_show(window->priv->language_combo);
@@ -2268,6 +2334,15 @@ static void sync_state(PlumaTab *tab, GParamSpec *pspec, PlumaWindow *window) {
   g_signal_emit(G_OBJECT(window), signals[ACTIVE_TAB_STATE_CHANGED], 0);
 }
 
+static void sync_follow(PlumaTab *tab, GParamSpec *pspec,
+                        PlumaWindow *window) {
+  pluma_debug(DEBUG_WINDOW);
+
+  if (tab != window->priv->active_tab) return;
+
+  set_sensitivity_according_to_tab(window, tab);
+}
+
 static void sync_name(PlumaTab *tab, GParamSpec *pspec, PlumaWindow *window) {
   GtkAction *action;
   gchar *action_name;
@@ -2560,6 +2635,19 @@ static void can_search_again(PlumaDocument *doc, GParamSpec *pspec,
   gtk_action_set_sensitive(action, sensitive);
 }
 
+static void modified_changed(PlumaDocument *doc, PlumaWindow *window) {
+  PlumaTab *tab;
+  GtkAction *action;
+
+  tab = pluma_window_get_active_tab(window);
+  if (tab == NULL || doc != pluma_tab_get_document(tab)) return;
+
+  action =
+      gtk_action_group_get_action(window->priv->action_group, "ViewFollow");
+  gtk_action_set_sensitive(action,
+                           _pluma_tab_get_follow(tab) || can_follow(tab));
+}
+
 static void can_undo(PlumaDocument *doc, GParamSpec *pspec,
                      PlumaWindow *window) {
   GtkAction *action;
@@ -2683,11 +2771,14 @@ static void notebook_tab_added(PlumaNotebook *notebook, PlumaTab *tab,
 
   g_signal_connect(tab, "notify::name", G_CALLBACK(sync_name), window);
   g_signal_connect(tab, "notify::state", G_CALLBACK(sync_state), window);
+  g_signal_connect(tab, "notify::follow", G_CALLBACK(sync_follow), window);
 
   g_signal_connect(doc, "cursor-moved",
                    G_CALLBACK(update_cursor_position_statusbar), window);
   g_signal_connect(doc, "notify::can-search-again",
                    G_CALLBACK(can_search_again), window);
+  g_signal_connect(doc, "modified-changed", G_CALLBACK(modified_changed),
+                   window);
   g_signal_connect(doc, "notify::can-undo", G_CALLBACK(can_undo), window);
   g_signal_connect(doc, "notify::can-redo", G_CALLBACK(can_redo), window);
   g_signal_connect(doc, "notify::has-selection", G_CALLBACK(selection_changed),
@@ -2696,6 +2787,12 @@ static void notebook_tab_added(PlumaNotebook *notebook, PlumaTab *tab,
                    window);
   g_signal_connect(doc, "notify::read-only", G_CALLBACK(readonly_changed),
                    window);
+  g_signal_connect(doc, "notify::newline-type",
+                   G_CALLBACK(update_newlines_statusbar), window);
+  g_signal_connect(doc, "loaded", G_CALLBACK(update_newlines_statusbar),
+                   window);
+  g_signal_connect(doc, "saved", G_CALLBACK(update_newlines_statusbar),
+                   window);
   g_signal_connect(view, "toggle_overwrite",
                    G_CALLBACK(update_overwrite_mode_statusbar), window);
   g_signal_connect(view, "notify::editable", G_CALLBACK(editable_changed),
@@ -2727,10 +2824,13 @@ static void notebook_tab_removed(PlumaNotebook *notebook, PlumaTab *tab,
 
   g_signal_handlers_disconnect_by_func(tab, G_CALLBACK(sync_name), window);
   g_signal_handlers_disconnect_by_func(tab, G_CALLBACK(sync_state), window);
+  g_signal_handlers_disconnect_by_func(tab, G_CALLBACK(sync_follow), window);
   g_signal_handlers_disconnect_by_func(
       doc, G_CALLBACK(update_cursor_position_statusbar), window);
   g_signal_handlers_disconnect_by_func(doc, G_CALLBACK(can_search_again),
                                        window);
+  g_signal_handlers_disconnect_by_func(doc, G_CALLBACK(modified_changed),
+                                       window);
   g_signal_handlers_disconnect_by_func(doc, G_CALLBACK(can_undo), window);
   g_signal_handlers_disconnect_by_func(doc, G_CALLBACK(can_redo), window);
   g_signal_handlers_disconnect_by_func(doc, G_CALLBACK(selection_changed),
@@ -2739,6 +2839,8 @@ static void notebook_tab_removed(PlumaNotebook *notebook, PlumaTab *tab,
                                        window);
   g_signal_handlers_disconnect_by_func(doc, G_CALLBACK(readonly_changed),
                                        window);
+  g_signal_handlers_disconnect_by_func(
+      doc, G_CALLBACK(update_newlines_statusbar), window);
   g_signal_handlers_disconnect_by_func(
       view, G_CALLBACK(update_overwrite_mode_statusbar), window);
   g_signal_handlers_disconnect_by_func(view, G_CALLBACK(editable_changed),
@@ -2762,6 +2864,7 @@ static void notebook_tab_removed(PlumaNotebook *notebook, PlumaTab *tab,
         PLUMA_STATUSBAR(window->priv->statusbar), -1, -1);
 
     pluma_statusbar_clear_overwrite(PLUMA_STATUSBAR(window->priv->statusbar));
+    pluma_statusbar_clear_newlines(PLUMA_STATUSBAR(window->priv->statusbar));
 
     /* hide the combos */
     gtk_widget_hide(window->priv->tab_width_combo);
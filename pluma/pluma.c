@@ -75,6 +75,8 @@ static BaconMessageConnection *connection;
 /* command line */
 static gint line_position = 0;
 static gchar *encoding_charset = NULL;
+static gint head_size = 0;
+static gint tail_size = 0;
 static gboolean new_window_option = FALSE;
 static gboolean new_document_option = FALSE;
 static gchar **remaining_args = NULL;
@@ -108,6 +110,16 @@ static const GOptionEntry options[] = {
         "command line"),
      N_("ENCODING")},
 
+    {"head", '\0', 0, G_OPTION_ARG_INT, &head_size,
+     N_("Only load the first SIZE megabytes of the files listed on the "
+        "command line, read-only"),
+     N_("SIZE")},
+
+    {"tail", '\0', 0, G_OPTION_ARG_INT, &tail_size,
+     N_("Only load the last SIZE megabytes of the files listed on the "
+        "command line, read-only"),
+     N_("SIZE")},
+
     {"list-encodings", '\0', G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK,
      list_encodings_and_quit,
      N_("Display list of possible values for the encoding option"), NULL},
@@ -134,6 +146,9 @@ static void free_command_line_data(void) {
   g_free(encoding_charset);
   encoding_charset = NULL;
 
+  head_size = 0;
+  tail_size = 0;
+
   new_window_option = FALSE;
   new_document_option = FALSE;
   line_position = 0;
@@ -165,6 +180,28 @@ static void pluma_get_command_line_data(void) {
       (pluma_encoding_get_from_charset(encoding_charset) == NULL)) {
     g_print(_("%s: invalid encoding.\n"), encoding_charset);
   }
+
+  if (head_size < 0 || tail_size < 0) {
+    g_print(_("The size of the part of the files to load must be positive.\n"));
+    head_size = 0;
+    tail_size = 0;
+  }
+}
+
+/* --tail wins when both are given */
+static PlumaDocumentLoadRange get_load_range(goffset *size) {
+  if (tail_size > 0) {
+    *size = (goffset)tail_size * 1024 * 1024;
+    return PLUMA_DOCUMENT_LOAD_RANGE_TAIL;
+  }
+
+  if (head_size > 0) {
+    *size = (goffset)head_size * 1024 * 1024;
+    return PLUMA_DOCUMENT_LOAD_RANGE_HEAD;
+  }
+
+  *size = 0;
+  return PLUMA_DOCUMENT_LOAD_RANGE_ALL;
 }
 
 static guint32 get_startup_timestamp(void) {
@@ -265,6 +302,9 @@ static void on_message_received(const char *message, gpointer data) {
       new_window_option = TRUE;
     } else if (strcmp(params[0], "NEW-DOCUMENT") == 0) {
       new_document_option = TRUE;
+    } else if (strcmp(params[0], "LOAD-RANGE") == 0) {
+      head_size = atoi(params[1]);
+      tail_size = atoi(params[2]);
     } else if (strcmp(params[0], "OPEN-URIS") == 0) {
       gint n_uris, j;
       gchar **uris;
@@ -309,8 +349,12 @@ static void on_message_received(const char *message, gpointer data) {
   }
 
   if (file_list != NULL) {
+    PlumaDocumentLoadRange range;
+    goffset range_size;
+
+    range = get_load_range(&range_size);
     _pluma_cmd_load_files_from_prompt(window, file_list, encoding,
-                                      line_position);
+                                      line_position, range, range_size);
 
     if (new_document_option) pluma_window_create_tab(window, TRUE);
   } else {
@@ -406,6 +450,13 @@ static void send_bacon_message(void) {
     command = g_string_append(command, "NEW-DOCUMENT");
   }
 
+  /* LOAD-RANGE command, for the files of the OPEN-URIS command */
+  if (head_size > 0 || tail_size > 0) {
+    command = g_string_append_c(command, '\v');
+    g_string_append_printf(command, "LOAD-RANGE\t%d\t%d", head_size,
+                           tail_size);
+  }
+
   /* OPEN_URIS command, optionally specify line_num and encoding */
   if (file_list) {
     GSList *l;
@@ -539,13 +590,17 @@ int main(int argc, char *argv[]) {
 
     if (file_list != NULL) {
       const PlumaEncoding *encoding = NULL;
+      PlumaDocumentLoadRange range;
+      goffset range_size;
 
       if (encoding_charset)
         encoding = pluma_encoding_get_from_charset(encoding_charset);
 
+      range = get_load_range(&range_size);
+
       pluma_debug_message(DEBUG_APP, "Load files");
       _pluma_cmd_load_files_from_prompt(window, file_list, encoding,
-                                        line_position);
+                                        line_position, range, range_size);
     } else {
       pluma_debug_message(DEBUG_APP, "Create tab");
       pluma_window_create_tab(window, TRUE);
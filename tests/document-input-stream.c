@@ -28,6 +28,10 @@
 
 #include "pluma-document-input-stream.h"
 
+/* a common block size of the saver */
+#define READ_BENCHMARK_CHUNK (64 * 1024)
+#define READ_BENCHMARK_LINES 1000000
+
 static void test_consecutive_read(const gchar *inbuf, const gchar *outbuf,
                                   PlumaDocumentNewlineType type,
                                   gsize read_chunk_len) {
@@ -157,6 +161,195 @@ static void test_consecutive_multibyte_big_read() {
                         PLUMA_DOCUMENT_NEWLINE_TYPE_LF, 200);
 }
 
+static void test_preserved_read(const gchar *inbuf, const gchar *outbuf,
+                                PlumaDocumentNewlineType type,
+                                gsize read_chunk_len, guint lf, guint cr,
+                                guint crlf) {
+  GtkTextBuffer *buf;
+  GInputStream *in;
+  PlumaDocumentInputStream *dstream;
+  gssize n, r;
+  GError *err = NULL;
+  gchar *b;
+
+  buf = gtk_text_buffer_new(NULL);
+  gtk_text_buffer_set_text(buf, inbuf, -1);
+
+  b = g_malloc(200);
+  in = pluma_document_input_stream_new(buf, type);
+  dstream = PLUMA_DOCUMENT_INPUT_STREAM(in);
+
+  pluma_document_input_stream_set_normalize_newlines(dstream, FALSE);
+
+  n = 0;
+
+  do {
+    r = g_input_stream_read(in, b + n, read_chunk_len, NULL, &err);
+    g_assert_cmpint(r, >=, 0);
+    g_assert_no_error(err);
+
+    n += r;
+  } while (r != 0);
+
+  b[n] = '\0';
+
+  g_assert_cmpstr(b, ==, outbuf);
+
+  g_assert_cmpuint(pluma_document_input_stream_get_newline_count(
+                       dstream, PLUMA_DOCUMENT_NEWLINE_TYPE_LF),
+                   ==, lf);
+  g_assert_cmpuint(pluma_document_input_stream_get_newline_count(
+                       dstream, PLUMA_DOCUMENT_NEWLINE_TYPE_CR),
+                   ==, cr);
+  g_assert_cmpuint(pluma_document_input_stream_get_newline_count(
+                       dstream, PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF),
+                   ==, crlf);
+
+  g_input_stream_close(in, NULL, &err);
+  g_assert_no_error(err);
+
+  g_object_unref(buf);
+  g_object_unref(in);
+  g_free(b);
+}
+
+static void test_preserved_newlines() {
+  /* only the trailing line ending is of the requested type */
+  test_preserved_read("fo\r\nbar\nblah\rend", "fo\r\nbar\nblah\rend\r\n",
+                      PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF, 200, 1, 1, 2);
+  test_preserved_read("fo\r\nbar\nblah\rend", "fo\r\nbar\nblah\rend\n",
+                      PLUMA_DOCUMENT_NEWLINE_TYPE_LF, 6, 2, 1, 1);
+  test_preserved_read("\r\n\n\r", "\r\n\n\r\r", PLUMA_DOCUMENT_NEWLINE_TYPE_CR,
+                      6, 1, 2, 1);
+}
+
+static void test_long_text() {
+  GtkTextBuffer *buf;
+  GInputStream *in;
+  PlumaDocumentInputStream *dstream;
+  GString *text;
+  gssize n, r;
+  GError *err = NULL;
+  gchar *b;
+  gint prefix;
+  gint i;
+
+  /* more than one segment of the stream, with \r\n anywhere on the cut */
+  for (prefix = 0; prefix < 3; prefix++) {
+    text = g_string_new(NULL);
+    g_string_append_len(text, "xx", prefix);
+    for (i = 0; i < 100000; i++) {
+      g_string_append(text, "a\r\n");
+    }
+
+    buf = gtk_text_buffer_new(NULL);
+    gtk_text_buffer_set_text(buf, text->str, text->len);
+
+    b = g_malloc(text->len + 4099);
+    in = pluma_document_input_stream_new(buf, PLUMA_DOCUMENT_NEWLINE_TYPE_LF);
+    dstream = PLUMA_DOCUMENT_INPUT_STREAM(in);
+
+    pluma_document_input_stream_set_normalize_newlines(dstream, FALSE);
+
+    n = 0;
+
+    do {
+      r = g_input_stream_read(in, b + n, 4099, NULL, &err);
+      g_assert_no_error(err);
+
+      n += r;
+    } while (r != 0);
+
+    g_assert_cmpint(n, ==, text->len + 1);
+    g_assert(memcmp(b, text->str, text->len) == 0);
+    g_assert_cmpint(b[text->len], ==, '\n');
+
+    g_assert_cmpuint(pluma_document_input_stream_get_newline_count(
+                         dstream, PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF),
+                     ==, 100000);
+    g_assert_cmpuint(pluma_document_input_stream_tell(dstream), ==,
+                     gtk_text_buffer_get_char_count(buf));
+
+    g_input_stream_close(in, NULL, &err);
+    g_assert_no_error(err);
+
+    g_object_unref(buf);
+    g_object_unref(in);
+    g_string_free(text, TRUE);
+    g_free(b);
+  }
+}
+
+static void run_read_benchmark(GtkTextBuffer *buf,
+                               PlumaDocumentNewlineType type,
+                               const gchar *name) {
+  GInputStream *in;
+  gsize total;
+  gssize r;
+  gdouble elapsed;
+  GError *err = NULL;
+  gchar *b;
+
+  b = g_malloc(READ_BENCHMARK_CHUNK);
+  in = pluma_document_input_stream_new(buf, type);
+  total = 0;
+
+  g_test_timer_start();
+
+  do {
+    r = g_input_stream_read(in, b, READ_BENCHMARK_CHUNK, NULL, &err);
+    g_assert_no_error(err);
+
+    total += r;
+  } while (r != 0);
+
+  elapsed = g_test_timer_elapsed();
+
+  g_test_minimized_result(elapsed,
+                          "reading %" G_GSIZE_FORMAT " MiB with %s newlines: "
+                          "%g s (%g MiB/s)",
+                          total / (1024 * 1024), name, elapsed,
+                          (total / (1024.0 * 1024.0)) / elapsed);
+
+  g_input_stream_close(in, NULL, &err);
+  g_assert_no_error(err);
+
+  g_object_unref(in);
+  g_free(b);
+}
+
+static void test_read_benchmark() {
+  const gchar *line = "The quick brown fox jumps over the lazy dog.\n";
+  GtkTextBuffer *buf;
+  GtkTextIter iter;
+  GString *text;
+  gint i;
+
+  if (!g_test_perf()) {
+    g_test_skip("only run in performance mode");
+    return;
+  }
+
+  text = g_string_new(NULL);
+  for (i = 0; i < 10000; i++) {
+    g_string_append(text, line);
+  }
+
+  /* many short lines, the worst case of a line by line reader */
+  buf = gtk_text_buffer_new(NULL);
+  gtk_text_buffer_get_end_iter(buf, &iter);
+  for (i = 0; i < READ_BENCHMARK_LINES / 10000; i++) {
+    gtk_text_buffer_insert(buf, &iter, text->str, text->len);
+  }
+
+  g_string_free(text, TRUE);
+
+  run_read_benchmark(buf, PLUMA_DOCUMENT_NEWLINE_TYPE_LF, "LF");
+  run_read_benchmark(buf, PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF, "CR LF");
+
+  g_object_unref(buf);
+}
+
 int main(int argc, char *argv[]) {
   g_test_init(&argc, &argv, NULL);
 
@@ -174,5 +367,13 @@ int main(int argc, char *argv[]) {
   g_test_add_func("/document-input-stream/consecutive_multibyte_big_read",
                   test_consecutive_multibyte_big_read);
 
+  g_test_add_func("/document-input-stream/preserved_newlines",
+                  test_preserved_newlines);
+
+  g_test_add_func("/document-input-stream/long_text", test_long_text);
+
+  g_test_add_func("/document-input-stream/read_benchmark",
+                  test_read_benchmark);
+
   return g_test_run();
 }
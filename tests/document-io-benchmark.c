@@ -0,0 +1,259 @@
+/*
+ * document-io-benchmark.c
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * pluma is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * pluma is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pluma; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+#include <string.h>
+
+#include "pluma-document.h"
+#include "pluma-encodings.h"
+#include "pluma-settings.h"
+#include "pluma-utils.h"
+
+#define REMOTE_DIRECTORY "sftp://localhost/tmp"
+#define BENCHMARK_FILENAME "pluma-document-io-benchmark.txt"
+
+/* block sizes compared by the benchmark, in KiB */
+#define SMALL_BLOCK_SIZE 8
+#define DEFAULT_MAX_BLOCK_SIZE 1024
+
+static gboolean test_completed;
+static gboolean mount_completed;
+static gboolean mount_success;
+
+static void test_block_size() {
+  /* unknown size */
+  g_assert_cmpuint(pluma_utils_get_io_block_size(-1, 1024 * 1024), ==,
+                   64 * 1024);
+  g_assert_cmpuint(pluma_utils_get_io_block_size(-1, 16 * 1024), ==,
+                   16 * 1024);
+
+  /* small files still get a reasonable block */
+  g_assert_cmpuint(pluma_utils_get_io_block_size(0, 1024 * 1024), ==,
+                   8 * 1024);
+  g_assert_cmpuint(pluma_utils_get_io_block_size(100 * 1024, 1024 * 1024), ==,
+                   8 * 1024);
+
+  /* bigger files get bigger blocks, up to the maximum */
+  g_assert_cmpuint(pluma_utils_get_io_block_size(16 * 1024 * 1024, 1024 * 1024),
+                   ==, 256 * 1024);
+  g_assert_cmpuint(
+      pluma_utils_get_io_block_size(1024 * 1024 * 1024, 1024 * 1024), ==,
+      1024 * 1024);
+  g_assert_cmpuint(
+      pluma_utils_get_io_block_size(1024 * 1024 * 1024, 100 * 1024), ==,
+      100 * 1024);
+}
+
+static void mount_ready_callback(GObject *object, GAsyncResult *result,
+                                 gpointer data) {
+  GError *error = NULL;
+  mount_success =
+      g_file_mount_enclosing_volume_finish(G_FILE(object), result, &error);
+
+  if (error && error->code == G_IO_ERROR_ALREADY_MOUNTED) {
+    mount_success = TRUE;
+  }
+
+  g_clear_error(&error);
+  mount_completed = TRUE;
+}
+
+static gboolean ensure_mounted(GFile *file) {
+  GMountOperation *mo;
+
+  mount_success = FALSE;
+  mount_completed = FALSE;
+
+  if (g_file_is_native(file)) {
+    return TRUE;
+  }
+
+  mo = gtk_mount_operation_new(NULL);
+
+  g_file_mount_enclosing_volume(file, G_MOUNT_MOUNT_NONE, mo, NULL,
+                                mount_ready_callback, NULL);
+
+  while (!mount_completed) {
+    g_main_context_iteration(NULL, TRUE);
+  }
+
+  g_object_unref(mo);
+
+  return mount_success;
+}
+
+static void on_document_done(PlumaDocument *document, const GError *error,
+                             gpointer data) {
+  g_assert_no_error(error);
+  test_completed = TRUE;
+}
+
+static void wait_for_document() {
+  while (!test_completed) {
+    g_main_context_iteration(NULL, TRUE);
+  }
+}
+
+static gchar *create_contents(gsize size) {
+  const gchar *line = "The quick brown fox jumps over the lazy dog.\n";
+  gsize line_len = strlen(line);
+  gchar *contents;
+  gsize i;
+
+  contents = g_malloc(size + 1);
+
+  for (i = 0; i + line_len <= size; i += line_len) {
+    memcpy(contents + i, line, line_len);
+  }
+
+  memset(contents + i, '\n', size - i);
+  contents[size] = '\0';
+
+  return contents;
+}
+
+static void run_benchmark(const gchar *directory, gsize size,
+                          guint max_block_size) {
+  GSettings *settings;
+  PlumaDocument *document;
+  GFile *dir;
+  GFile *file;
+  gchar *contents;
+  gchar *uri;
+  gdouble elapsed;
+  GError *error = NULL;
+
+  dir = g_file_new_for_commandline_arg(directory);
+  file = g_file_get_child(dir, BENCHMARK_FILENAME);
+  g_object_unref(dir);
+
+  if (!ensure_mounted(file)) {
+    g_test_skip("could not mount the benchmark location");
+    g_object_unref(file);
+    return;
+  }
+
+  settings = g_settings_new(PLUMA_SCHEMA_ID);
+  g_settings_set_uint(settings, PLUMA_SETTINGS_MAX_IO_BLOCK_SIZE,
+                      max_block_size);
+
+  contents = create_contents(size);
+  g_file_replace_contents(file, contents, size, NULL, FALSE,
+                          G_FILE_CREATE_NONE, NULL, NULL, &error);
+  g_assert_no_error(error);
+  g_free(contents);
+
+  uri = g_file_get_uri(file);
+  document = pluma_document_new();
+
+  g_signal_connect(document, "loaded", G_CALLBACK(on_document_done), NULL);
+  g_signal_connect(document, "saved", G_CALLBACK(on_document_done), NULL);
+
+  /* a single byte encoding, so that the file goes through the converter */
+  test_completed = FALSE;
+  g_test_timer_start();
+  pluma_document_load(document, uri,
+                      pluma_encoding_get_from_charset("ISO-8859-15"), 0,
+                      FALSE);
+  wait_for_document();
+  elapsed = g_test_timer_elapsed();
+
+  g_test_minimized_result(elapsed,
+                          "loading %" G_GSIZE_FORMAT " MiB from %s with %u KiB "
+                          "blocks: %g s (%g MiB/s)",
+                          size / (1024 * 1024), directory, max_block_size,
+                          elapsed, (size / (1024.0 * 1024.0)) / elapsed);
+
+  test_completed = FALSE;
+  g_test_timer_start();
+  pluma_document_save_as(document, uri, pluma_encoding_get_utf8(),
+                         PLUMA_DOCUMENT_SAVE_IGNORE_MTIME);
+  wait_for_document();
+  elapsed = g_test_timer_elapsed();
+
+  g_test_minimized_result(elapsed,
+                          "saving %" G_GSIZE_FORMAT " MiB to %s with %u KiB "
+                          "blocks: %g s (%g MiB/s)",
+                          size / (1024 * 1024), directory, max_block_size,
+                          elapsed, (size / (1024.0 * 1024.0)) / elapsed);
+
+  g_object_unref(document);
+  g_file_delete(file, NULL, NULL);
+  g_settings_reset(settings, PLUMA_SETTINGS_MAX_IO_BLOCK_SIZE);
+
+  g_free(uri);
+  g_object_unref(settings);
+  g_object_unref(file);
+}
+
+static void test_benchmark(gconstpointer data) {
+  const gchar *directory = data;
+  gsize sizes[] = {1, 16, 128, 1024};
+  guint n_sizes;
+  guint i;
+
+  if (!g_test_perf()) {
+    g_test_skip("only run in performance mode");
+    return;
+  }
+
+  /* a gigabyte takes a while */
+  n_sizes = g_test_thorough() ? G_N_ELEMENTS(sizes) : G_N_ELEMENTS(sizes) - 1;
+
+  for (i = 0; i < n_sizes; i++) {
+    run_benchmark(directory, sizes[i] * 1024 * 1024, SMALL_BLOCK_SIZE);
+    run_benchmark(directory, sizes[i] * 1024 * 1024, DEFAULT_MAX_BLOCK_SIZE);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  const gchar *benchmark_dir;
+  GSettings *settings;
+
+  /* the benchmark changes settings, keep them out of the user's dconf */
+  g_setenv("GSETTINGS_BACKEND", "memory", TRUE);
+
+  gtk_init(&argc, &argv);
+  g_test_init(&argc, &argv, NULL);
+
+  /* load whole files, not windows of them */
+  settings = g_settings_new(PLUMA_SCHEMA_ID);
+  g_settings_set_uint(settings, PLUMA_SETTINGS_LARGE_FILE_THRESHOLD, 0);
+  g_object_unref(settings);
+
+  g_test_add_func("/document-io/block-size", test_block_size);
+  g_test_add_data_func("/document-io/local", g_get_tmp_dir(), test_benchmark);
+  g_test_add_data_func("/document-io/remote", REMOTE_DIRECTORY,
+                       test_benchmark);
+
+  /* e.g. a NFS or FUSE mount */
+  benchmark_dir = g_getenv("PLUMA_BENCHMARK_DIR");
+  if (benchmark_dir != NULL) {
+    g_test_add_data_func("/document-io/benchmark-dir", benchmark_dir,
+                         test_benchmark);
+  }
+
+  return g_test_run();
+}
@@ -0,0 +1,269 @@
+/*
+ * document-journal.c
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * pluma is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * pluma is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pluma; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+#include <string.h>
+
+#include "pluma-document-journal.h"
+
+#define JOURNAL_TEST_FILENAME "/tmp/pluma-document-journal.txt"
+
+static gboolean test_completed;
+
+static void on_document_loaded(PlumaDocument *document, const GError *error,
+                               gpointer data) {
+  g_assert_no_error(error);
+  test_completed = TRUE;
+}
+
+static PlumaDocument *load_document(const gchar *uri) {
+  PlumaDocument *document;
+
+  document = pluma_document_new();
+  g_signal_connect(document, "loaded", G_CALLBACK(on_document_loaded), NULL);
+
+  test_completed = FALSE;
+  pluma_document_load(document, uri, pluma_encoding_get_utf8(), 0, FALSE);
+
+  while (!test_completed) {
+    g_main_context_iteration(NULL, TRUE);
+  }
+
+  return document;
+}
+
+static gchar *get_text(PlumaDocument *document) {
+  GtkTextIter start;
+  GtkTextIter end;
+
+  gtk_text_buffer_get_bounds(GTK_TEXT_BUFFER(document), &start, &end);
+
+  return gtk_text_buffer_get_text(GTK_TEXT_BUFFER(document), &start, &end,
+                                  TRUE);
+}
+
+/* the journal is left behind as if pluma had crashed */
+static gchar *record_changes(const gchar *uri, gsize *length) {
+  PlumaDocument *document;
+  PlumaDocumentJournal *journal;
+  GtkTextIter iter;
+  GtkTextIter end;
+  gboolean recovered;
+  gchar *path;
+  gchar *contents;
+
+  document = load_document(uri);
+
+  journal = pluma_document_journal_new(document, &recovered);
+  g_assert(journal != NULL);
+  g_assert(!recovered);
+
+  gtk_text_buffer_get_iter_at_line(GTK_TEXT_BUFFER(document), &iter, 1);
+  gtk_text_buffer_insert(GTK_TEXT_BUFFER(document), &iter, "h\303\251llo ",
+                         -1);
+
+  gtk_text_buffer_get_start_iter(GTK_TEXT_BUFFER(document), &iter);
+  end = iter;
+  gtk_text_iter_forward_chars(&end, 4);
+  gtk_text_buffer_delete(GTK_TEXT_BUFFER(document), &iter, &end);
+
+  g_assert(pluma_document_journal_sync(journal));
+
+  path = pluma_document_journal_get_path(uri);
+  g_file_get_contents(path, &contents, length, NULL);
+  g_assert(contents != NULL);
+
+  pluma_document_journal_free(journal);
+  g_assert(!g_file_test(path, G_FILE_TEST_EXISTS));
+
+  g_file_set_contents(path, contents, *length, NULL);
+
+  g_free(path);
+  g_object_unref(document);
+
+  return contents;
+}
+
+static void test_recover() {
+  PlumaDocument *document;
+  PlumaDocumentJournal *journal;
+  gboolean recovered;
+  GFile *file;
+  gchar *uri;
+  gchar *journal_contents;
+  gsize length;
+  gchar *path;
+  gchar *text;
+
+  g_file_set_contents(JOURNAL_TEST_FILENAME, "one\ntwo\nthree\n", -1, NULL);
+  file = g_file_new_for_path(JOURNAL_TEST_FILENAME);
+  uri = g_file_get_uri(file);
+  path = pluma_document_journal_get_path(uri);
+
+  journal_contents = record_changes(uri, &length);
+
+  /* replayed when the file is opened again */
+  document = load_document(uri);
+  journal = pluma_document_journal_new(document, &recovered);
+  g_assert(recovered);
+
+  text = get_text(document);
+  g_assert_cmpstr(text, ==, "h\303\251llo two\nthree");
+  g_free(text);
+  g_assert(gtk_text_buffer_get_modified(GTK_TEXT_BUFFER(document)));
+
+  pluma_document_journal_free(journal);
+  g_object_unref(document);
+
+  /* a cut record is dropped */
+  g_file_set_contents(path, journal_contents, length - 1, NULL);
+
+  document = load_document(uri);
+  journal = pluma_document_journal_new(document, &recovered);
+  g_assert(recovered);
+
+  text = get_text(document);
+  g_assert_cmpstr(text, ==, "one\nh\303\251llo two\nthree");
+  g_free(text);
+
+  pluma_document_journal_free(journal);
+  g_object_unref(document);
+
+  /* not replayed over another text */
+  g_file_set_contents(path, journal_contents, length, NULL);
+  g_file_set_contents(JOURNAL_TEST_FILENAME, "four\n", -1, NULL);
+
+  document = load_document(uri);
+  journal = pluma_document_journal_new(document, &recovered);
+  g_assert(!recovered);
+
+  text = get_text(document);
+  g_assert_cmpstr(text, ==, "four");
+  g_free(text);
+
+  pluma_document_journal_free(journal);
+  g_object_unref(document);
+
+  g_unlink(JOURNAL_TEST_FILENAME);
+
+  g_free(journal_contents);
+  g_free(path);
+  g_free(uri);
+  g_object_unref(file);
+}
+
+static void test_save() {
+  PlumaDocument *document;
+  PlumaDocumentJournal *journal;
+  GtkTextIter iter;
+  gboolean recovered;
+  GFile *file;
+  gchar *uri;
+  gchar *path;
+  gchar *new_path;
+  gchar *contents;
+  gsize length;
+  gchar *text;
+
+  g_file_set_contents(JOURNAL_TEST_FILENAME, "one\ntwo\n", -1, NULL);
+  file = g_file_new_for_path(JOURNAL_TEST_FILENAME);
+  uri = g_file_get_uri(file);
+  path = pluma_document_journal_get_path(uri);
+  new_path = g_strconcat(path, ".new", NULL);
+
+  document = load_document(uri);
+
+  gtk_text_buffer_get_start_iter(GTK_TEXT_BUFFER(document), &iter);
+  gtk_text_buffer_insert(GTK_TEXT_BUFFER(document), &iter, "zero\n", -1);
+
+  /* dropped when the save fails */
+  journal = pluma_document_journal_new_for_save(document, uri);
+  g_assert(journal != NULL);
+  pluma_document_journal_free(journal);
+  g_assert(!g_file_test(new_path, G_FILE_TEST_EXISTS));
+  g_assert(!g_file_test(path, G_FILE_TEST_EXISTS));
+
+  /* the snapshot is saved while the document is edited */
+  journal = pluma_document_journal_new_for_save(document, uri);
+  g_assert(journal != NULL);
+
+  gtk_text_buffer_get_end_iter(GTK_TEXT_BUFFER(document), &iter);
+  gtk_text_buffer_insert(GTK_TEXT_BUFFER(document), &iter, "\nthree", -1);
+
+  g_file_set_contents(JOURNAL_TEST_FILENAME, "zero\none\ntwo\n", -1, NULL);
+
+  g_assert(pluma_document_journal_commit(journal, uri));
+  g_assert(!g_file_test(new_path, G_FILE_TEST_EXISTS));
+
+  g_assert(pluma_document_journal_sync(journal));
+  g_file_get_contents(path, &contents, &length, NULL);
+  g_assert(contents != NULL);
+
+  pluma_document_journal_free(journal);
+  g_object_unref(document);
+
+  g_file_set_contents(path, contents, length, NULL);
+
+  /* the edits are replayed over the saved text */
+  document = load_document(uri);
+  journal = pluma_document_journal_new(document, &recovered);
+  g_assert(recovered);
+
+  text = get_text(document);
+  g_assert_cmpstr(text, ==, "zero\none\ntwo\nthree");
+  g_free(text);
+
+  pluma_document_journal_free(journal);
+  g_object_unref(document);
+
+  g_unlink(JOURNAL_TEST_FILENAME);
+
+  g_free(contents);
+  g_free(new_path);
+  g_free(path);
+  g_free(uri);
+  g_object_unref(file);
+}
+
+int main(int argc, char *argv[]) {
+  gchar *cache_dir;
+  int ret;
+
+  /* keep the journals out of the user's cache */
+  cache_dir = g_dir_make_tmp("pluma-document-journal-XXXXXX", NULL);
+  g_setenv("XDG_CACHE_HOME", cache_dir, TRUE);
+
+  gtk_init(&argc, &argv);
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/document-journal/recover", test_recover);
+  g_test_add_func("/document-journal/save", test_save);
+
+  ret = g_test_run();
+
+  g_free(cache_dir);
+
+  return ret;
+}
@@ -82,8 +82,11 @@ static void on_document_loaded(PlumaDocument *document, GError *error,
   delete_document(data->file);
 }
 
-static void test_loader(const gchar *filename, const gchar *contents,
-                        const gchar *in_buffer, gint newline_type) {
+static void test_loader_with_encoding(const gchar *filename,
+                                      const gchar *contents,
+                                      const gchar *in_buffer,
+                                      gint newline_type,
+                                      const PlumaEncoding *encoding) {
   GFile *file;
   gchar *uri;
   PlumaDocument *document;
@@ -103,7 +106,7 @@ static void test_loader(const gchar *filename, const gchar *contents,
 
   uri = g_file_get_uri(file);
 
-  pluma_document_load(document, uri, pluma_encoding_get_utf8(), 0, FALSE);
+  pluma_document_load(document, uri, encoding, 0, FALSE);
 
   g_free(uri);
 
@@ -116,6 +119,12 @@ static void test_loader(const gchar *filename, const gchar *contents,
   g_object_unref(document);
 }
 
+static void test_loader(const gchar *filename, const gchar *contents,
+                        const gchar *in_buffer, gint newline_type) {
+  test_loader_with_encoding(filename, contents, in_buffer, newline_type,
+                            pluma_encoding_get_utf8());
+}
+
 static void test_end_line_stripping() {
   test_loader("document-loader.txt", "hello world\n", "hello world", -1);
 
@@ -163,6 +172,121 @@ static void test_begin_new_line_detection() {
               PLUMA_DOCUMENT_NEWLINE_TYPE_CR);
 }
 
+static void test_big_file() {
+  GString *contents;
+  gchar *in_buffer;
+  gint i;
+
+  /* big enough to be inserted in more than one batch, with multibyte
+     chars and CRLF sequences ending up across batch boundaries */
+  contents = g_string_new(NULL);
+  for (i = 0; contents->len < 9 * 1024 * 1024; i++) {
+    g_string_append_printf(contents, "line %d \xe6\x96\x87\r\n", i);
+  }
+
+  in_buffer = g_strndup(contents->str, contents->len - 2);
+
+  test_loader("document-loader.txt", contents->str, in_buffer,
+              PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF);
+
+  g_free(in_buffer);
+  g_string_free(contents, TRUE);
+}
+
+static void test_converted_file() {
+  GString *contents;
+  GString *in_buffer;
+  gint i;
+
+  /* goes through the charset converter, spanning several decode blocks */
+  contents = g_string_new(NULL);
+  in_buffer = g_string_new(NULL);
+  for (i = 0; contents->len < 512 * 1024; i++) {
+    g_string_append_printf(contents, "line %d \xe8\xe9\r\n", i);
+    g_string_append_printf(in_buffer, "line %d \xc3\xa8\xc3\xa9\r\n", i);
+  }
+
+  g_string_truncate(in_buffer, in_buffer->len - 2);
+
+  test_loader_with_encoding("document-loader.txt", contents->str,
+                            in_buffer->str, PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF,
+                            pluma_encoding_get_from_charset("ISO-8859-15"));
+
+  g_string_free(in_buffer, TRUE);
+  g_string_free(contents, TRUE);
+}
+
+static void test_loader_range(const gchar *contents, const gchar *in_buffer,
+                              PlumaDocumentLoadRange range, goffset size,
+                              gboolean partial) {
+  PlumaDocument *document;
+  LoaderTestData data;
+  gchar *uri;
+
+  data.in_buffer = in_buffer;
+  data.newline_type = -1;
+  data.file = create_document("document-loader.txt", contents);
+
+  document = pluma_document_new();
+  _pluma_document_set_load_range(document, range, size);
+
+  test_completed = FALSE;
+
+  g_signal_connect(document, "loaded", G_CALLBACK(on_document_loaded), &data);
+
+  uri = g_file_get_uri(data.file);
+  pluma_document_load(document, uri, pluma_encoding_get_utf8(), 0, FALSE);
+  g_free(uri);
+
+  while (!test_completed) {
+    g_main_context_iteration(NULL, TRUE);
+  }
+
+  g_assert(_pluma_document_is_partial(document) == partial);
+  g_assert(pluma_document_get_readonly(document) == partial);
+
+  g_object_unref(data.file);
+  g_object_unref(document);
+}
+
+static void test_head_and_tail() {
+  GString *contents;
+  GString *head;
+  GString *tail;
+  gint i;
+
+  /* 10 bytes per line */
+  contents = g_string_new(NULL);
+  head = g_string_new(NULL);
+  tail = g_string_new(NULL);
+  for (i = 0; i < 1000; i++) {
+    g_string_append_printf(contents, "%09d\n", i);
+
+    if (i < 100) g_string_append_printf(head, "%09d\n", i);
+    if (i >= 900) g_string_append_printf(tail, "%09d\n", i);
+  }
+
+  g_string_truncate(head, head->len - 1);
+  g_string_truncate(tail, tail->len - 1);
+
+  /* the lines which are cut are left out */
+  test_loader_range(contents->str, head->str, PLUMA_DOCUMENT_LOAD_RANGE_HEAD,
+                    1005, TRUE);
+  test_loader_range(contents->str, tail->str, PLUMA_DOCUMENT_LOAD_RANGE_TAIL,
+                    1005, TRUE);
+
+  /* bigger than the file */
+  g_string_truncate(contents, contents->len - 1);
+  test_loader_range(contents->str, contents->str,
+                    PLUMA_DOCUMENT_LOAD_RANGE_HEAD, 20000, FALSE);
+  test_loader_range(contents->str, contents->str,
+                    PLUMA_DOCUMENT_LOAD_RANGE_TAIL, 20000, FALSE);
+
+  g_string_free(tail, TRUE);
+  g_string_free(head, TRUE);
+  g_string_free(contents, TRUE);
+}
+
 int main(int argc, char *argv[]) {
   g_test_init(&argc, &argv, NULL);
 
@@ -172,6 +296,9 @@ int main(int argc, char *argv[]) {
                   test_end_new_line_detection);
   g_test_add_func("/document-loader/begin-new-line-detection",
                   test_begin_new_line_detection);
+  g_test_add_func("/document-loader/big-file", test_big_file);
+  g_test_add_func("/document-loader/converted-file", test_converted_file);
+  g_test_add_func("/document-loader/head-and-tail", test_head_and_tail);
 
   return g_test_run();
 }
@@ -27,6 +27,10 @@
 #include <string.h>
 
 #include "pluma-document-output-stream.h"
+#include "pluma-utf8.h"
+
+#define BENCHMARK_SIZE (64 * 1024 * 1024)
+#define BENCHMARK_CHUNK_SIZE 8192
 
 static void test_consecutive_write(const gchar *inbuf, const gchar *outbuf,
                                    gsize write_chunk_len,
@@ -111,6 +115,293 @@ static void test_big_char() {
                          2, PLUMA_DOCUMENT_NEWLINE_TYPE_LF);
 }
 
+static void test_newline_counts_write(const gchar *inbuf, gsize write_chunk_len,
+                                      guint lf, guint cr, guint crlf,
+                                      PlumaDocumentNewlineType newline_type) {
+  PlumaDocument *doc;
+  GOutputStream *out;
+  PlumaDocumentOutputStream *ostream;
+  gsize n, len;
+  gssize w;
+  GError *err = NULL;
+
+  doc = pluma_document_new();
+  out = pluma_document_output_stream_new(doc);
+  ostream = PLUMA_DOCUMENT_OUTPUT_STREAM(out);
+
+  for (n = 0; inbuf[n] != '\0'; n += w) {
+    len = MIN(write_chunk_len, strlen(inbuf + n));
+    w = g_output_stream_write(out, inbuf + n, len, NULL, &err);
+    g_assert_cmpint(w, >, 0);
+    g_assert_no_error(err);
+  }
+
+  g_assert(g_output_stream_flush(out, NULL, &err) == TRUE);
+  g_assert_no_error(err);
+
+  g_assert(pluma_document_output_stream_detect_newline_type(ostream) ==
+           newline_type);
+
+  g_output_stream_close(out, NULL, &err);
+  g_assert_no_error(err);
+
+  g_assert_cmpuint(
+      pluma_document_output_stream_get_newline_count(
+          ostream, PLUMA_DOCUMENT_NEWLINE_TYPE_LF), ==, lf);
+  g_assert_cmpuint(
+      pluma_document_output_stream_get_newline_count(
+          ostream, PLUMA_DOCUMENT_NEWLINE_TYPE_CR), ==, cr);
+  g_assert_cmpuint(
+      pluma_document_output_stream_get_newline_count(
+          ostream, PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF), ==, crlf);
+
+  /* the counts are kept by the document */
+  g_assert_cmpuint(
+      pluma_document_get_newline_count(doc, PLUMA_DOCUMENT_NEWLINE_TYPE_LF),
+      ==, lf);
+  g_assert_cmpuint(
+      pluma_document_get_newline_count(doc, PLUMA_DOCUMENT_NEWLINE_TYPE_CR),
+      ==, cr);
+  g_assert_cmpuint(pluma_document_get_newline_count(
+                       doc, PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF),
+                   ==, crlf);
+  g_assert(pluma_document_has_mixed_newlines(doc) ==
+           ((lf > 0) + (cr > 0) + (crlf > 0) > 1));
+
+  g_object_unref(doc);
+  g_object_unref(out);
+}
+
+static void test_newline_counts() {
+  const gchar *mixed = "first line\r\nsecond line\nthird\r\nfourth\r"
+                       "a rather long fifth line\r\n";
+  gsize chunk;
+
+  for (chunk = 1; chunk <= 17; chunk++) {
+    test_newline_counts_write(mixed, chunk, 1, 1, 3,
+                              PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF);
+  }
+
+  test_newline_counts_write("no line ending at all", 4, 0, 0, 0,
+                            PLUMA_DOCUMENT_NEWLINE_TYPE_DEFAULT);
+  test_newline_counts_write("\r\r\n\n\r", 1, 1, 2, 1,
+                            PLUMA_DOCUMENT_NEWLINE_TYPE_CR);
+  test_newline_counts_write("one\ntwo\rthree\nfour", 10, 2, 1, 0,
+                            PLUMA_DOCUMENT_NEWLINE_TYPE_LF);
+}
+
+static void test_split_chars() {
+  const gchar *text = "h\xc3\xa9llo\r\nw\xf0\x9f\x98\x80rld\r\n\xe6\x96\x87\r";
+  const gchar *loaded = "h\xc3\xa9llo\r\nw\xf0\x9f\x98\x80rld\r\n\xe6\x96\x87";
+  gsize chunk;
+
+  /* every character and CRLF gets cut at some point */
+  for (chunk = 1; chunk <= 8; chunk++) {
+    test_consecutive_write(text, loaded, chunk,
+                           PLUMA_DOCUMENT_NEWLINE_TYPE_CR_LF);
+  }
+}
+
+static void test_invalid_write(const gchar *inbuf, gsize write_chunk_len) {
+  PlumaDocument *doc;
+  GOutputStream *out;
+  gsize n, len;
+  gssize w = 0;
+  GError *err = NULL;
+
+  doc = pluma_document_new();
+  out = pluma_document_output_stream_new(doc);
+
+  for (n = 0; inbuf[n] != '\0'; n += w) {
+    len = MIN(write_chunk_len, strlen(inbuf + n));
+    w = g_output_stream_write(out, inbuf + n, len, NULL, &err);
+
+    if (w == -1) break;
+  }
+
+  g_assert_cmpint(w, ==, -1);
+  g_assert_error(err, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+
+  g_error_free(err);
+  g_object_unref(doc);
+  g_object_unref(out);
+}
+
+static void test_invalid() {
+  gsize chunk;
+
+  for (chunk = 1; chunk <= 4; chunk++) {
+    /* a character cut by another one */
+    test_invalid_write("ab\xe6\x96z", chunk);
+    /* overlong */
+    test_invalid_write("ab\xe0\x80\x80z", chunk);
+    /* surrogate */
+    test_invalid_write("ab\xed\xa0\x80z", chunk);
+  }
+}
+
+static void test_utf8_validate() {
+  const gchar *samples[] = {"",
+                            "ascii only",
+                            "caf\xc3\xa9",
+                            "\xe6\x96\x87\xf0\x9f\x98\x80",
+                            "cut \xe6\x96",
+                            "overlong \xc0\xaf",
+                            "overlong \xe0\x80\xaf",
+                            "surrogate \xed\xa0\x80",
+                            "too big \xf4\x90\x80\x80",
+                            "stray \x80 continuation",
+                            "\xff"};
+  GString *text;
+  guint i;
+  gsize pad;
+
+  text = g_string_new(NULL);
+
+  /* with ascii in front, so that the samples are at every position of the
+   * blocks scanned at once */
+  for (pad = 0; pad < 70; pad++) {
+    for (i = 0; i < G_N_ELEMENTS(samples); i++) {
+      const gchar *end1;
+      const gchar *end2;
+      gboolean valid;
+
+      g_string_truncate(text, 0);
+      g_string_append_printf(text, "%*s%s tail", (gint)pad, "", samples[i]);
+
+      valid = g_utf8_validate(text->str, text->len, &end1);
+      g_assert(pluma_utf8_validate(text->str, text->len, &end2) == valid);
+      g_assert(end1 == end2);
+    }
+  }
+
+  /* nul bytes are not valid either */
+  g_string_truncate(text, 0);
+  g_string_append_len(text, "0123456789abcdef\0 tail", 22);
+  g_assert(!pluma_utf8_validate(text->str, text->len, NULL));
+
+  g_string_free(text, TRUE);
+}
+
+static void test_write_benchmark() {
+  const gchar *line = "The quick brown fox jumps over the lazy dog, "
+                      "d\xc3\xa9j\xc3\xa0 vu \xe6\x96\x87\r\n";
+  GString *text;
+  gdouble elapsed;
+  gsize n;
+
+  if (!g_test_perf()) {
+    g_test_skip("only run in performance mode");
+    return;
+  }
+
+  text = g_string_new(NULL);
+  while (text->len < BENCHMARK_SIZE) g_string_append(text, line);
+
+  g_test_timer_start();
+  g_assert(pluma_utf8_validate(text->str, text->len, NULL));
+  elapsed = g_test_timer_elapsed();
+
+  g_test_minimized_result(elapsed, "validating %u MiB: %g s",
+                          BENCHMARK_SIZE / (1024 * 1024), elapsed);
+
+  g_test_timer_start();
+  g_assert(g_utf8_validate(text->str, text->len, NULL));
+  elapsed = g_test_timer_elapsed();
+
+  g_test_message("validating %u MiB with g_utf8_validate: %g s",
+                 BENCHMARK_SIZE / (1024 * 1024), elapsed);
+
+  /* chunks which cut characters and CRLFs */
+  for (n = 0; n < 3; n++) {
+    PlumaDocument *doc;
+    GOutputStream *out;
+    gsize chunk = BENCHMARK_CHUNK_SIZE + n;
+    gsize i;
+
+    doc = pluma_document_new();
+    out = pluma_document_output_stream_new(doc);
+
+    g_test_timer_start();
+
+    for (i = 0; i < text->len; i += chunk) {
+      g_assert_cmpint(g_output_stream_write(out, text->str + i,
+                                            MIN(chunk, text->len - i), NULL,
+                                            NULL),
+                      >, 0);
+    }
+
+    g_assert(g_output_stream_close(out, NULL, NULL));
+
+    elapsed = g_test_timer_elapsed();
+
+    g_test_minimized_result(elapsed, "writing %u MiB in %" G_GSIZE_FORMAT
+                            " bytes chunks: %g s",
+                            BENCHMARK_SIZE / (1024 * 1024), chunk, elapsed);
+
+    g_object_unref(out);
+    g_object_unref(doc);
+  }
+
+  g_string_free(text, TRUE);
+}
+
+static void write_all_in_chunks(GOutputStream *out, const gchar *inbuf,
+                                gsize write_chunk_len) {
+  gsize n, len;
+  gssize w;
+  GError *err = NULL;
+
+  for (n = 0; inbuf[n] != '\0'; n += w) {
+    len = MIN(write_chunk_len, strlen(inbuf + n));
+    w = g_output_stream_write(out, inbuf + n, len, NULL, &err);
+    g_assert_cmpint(w, >, 0);
+    g_assert_no_error(err);
+  }
+
+  g_output_stream_close(out, NULL, &err);
+  g_assert_no_error(err);
+}
+
+static void test_append_write(const gchar *loaded, const gchar *first,
+                              const gchar *second, const gchar *outbuf,
+                              gsize write_chunk_len) {
+  PlumaDocument *doc;
+  GOutputStream *out;
+  gchar *b;
+
+  doc = pluma_document_new();
+
+  out = pluma_document_output_stream_new(doc);
+  write_all_in_chunks(out, loaded, write_chunk_len);
+  g_object_unref(out);
+
+  out = pluma_document_output_stream_new_for_append(doc);
+  write_all_in_chunks(out, first, write_chunk_len);
+  g_object_unref(out);
+
+  out = pluma_document_output_stream_new_for_append(doc);
+  write_all_in_chunks(out, second, write_chunk_len);
+  g_object_unref(out);
+
+  g_object_get(G_OBJECT(doc), "text", &b, NULL);
+
+  g_assert_cmpstr(outbuf, ==, b);
+  g_free(b);
+
+  g_assert(gtk_text_buffer_get_modified(GTK_TEXT_BUFFER(doc)) == FALSE);
+
+  g_object_unref(doc);
+}
+
+static void test_append() {
+  test_append_write("hello\n", "how\nare\n", "you\n", "hello\nhow\nare\nyou",
+                    3);
+  test_append_write("hello", "how\n", "are", "hellohow\nare", 2);
+  test_append_write("hello\n", "", "how\n\n", "hello\nhow\n", 10);
+  test_append_write("", "hello\n", "how", "hello\nhow", 1);
+}
+
 int main(int argc, char *argv[]) {
   g_test_init(&argc, &argv, NULL);
 
@@ -120,6 +411,15 @@ int main(int argc, char *argv[]) {
   g_test_add_func("/document-output-stream/consecutive_tnewline",
                   test_consecutive_tnewline);
   g_test_add_func("/document-output-stream/big-char", test_big_char);
+  g_test_add_func("/document-output-stream/append", test_append);
+  g_test_add_func("/document-output-stream/newline-counts",
+                  test_newline_counts);
+  g_test_add_func("/document-output-stream/split-chars", test_split_chars);
+  g_test_add_func("/document-output-stream/invalid", test_invalid);
+  g_test_add_func("/document-output-stream/utf8-validate",
+                  test_utf8_validate);
+  g_test_add_func("/document-output-stream/write-benchmark",
+                  test_write_benchmark);
 
   return g_test_run();
 }
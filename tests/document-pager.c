@@ -0,0 +1,191 @@
+/*
+ * document-pager.c
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * pluma is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * pluma is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pluma; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pluma-document-pager.h"
+
+/* 100 bytes per line */
+#define LINE_FORMAT "%099d\n"
+
+static PlumaDocumentPager *create_pager(const gchar *filename,
+                                        const gchar *contents) {
+  PlumaDocumentPager *pager;
+  GError *error = NULL;
+
+  g_file_set_contents(filename, contents, -1, &error);
+  g_assert_no_error(error);
+
+  pager = pluma_document_pager_new(filename, &error);
+  g_assert_no_error(error);
+
+  /* small steps, so that lines end up across them */
+  while (!pluma_document_pager_index(pager, 4000)) {
+  }
+
+  return pager;
+}
+
+/* checks that the window starts at the expected line and is contiguous */
+static void check_window(PlumaDocumentPager *pager, gchar *text,
+                         gint n_lines) {
+  gchar **lines;
+  gint first;
+  gint i;
+
+  g_assert(text != NULL);
+
+  first = pluma_document_pager_get_first_line(pager);
+  lines = g_strsplit(text, "\n", -1);
+
+  g_assert_cmpint(g_strv_length(lines), ==, n_lines);
+
+  for (i = 0; lines[i] != NULL; i++) {
+    g_assert_cmpint(g_ascii_strtoll(lines[i], NULL, 10), ==, first + i);
+  }
+
+  g_strfreev(lines);
+  g_free(text);
+}
+
+static void test_small_file() {
+  PlumaDocumentPager *pager;
+  gchar *text;
+
+  pager = create_pager("document-pager.txt", "hello\nworld\n");
+
+  g_assert_cmpint(pluma_document_pager_get_line_count(pager), ==, 2);
+
+  text = pluma_document_pager_get_window(pager, 1);
+  g_assert_cmpstr(text, ==, "hello\nworld");
+  g_free(text);
+  g_assert_cmpint(pluma_document_pager_get_first_line(pager), ==, 0);
+
+  g_assert(pluma_document_pager_move_window(pager, 1) == NULL);
+  g_assert(pluma_document_pager_move_window(pager, -1) == NULL);
+
+  pluma_document_pager_free(pager);
+  g_unlink("document-pager.txt");
+}
+
+static void test_windows() {
+  PlumaDocumentPager *pager;
+  GString *contents;
+  gint i;
+
+  /* bigger than one window */
+  contents = g_string_new(NULL);
+  for (i = 0; i < 60000; i++) {
+    g_string_append_printf(contents, LINE_FORMAT, i);
+  }
+
+  pager = create_pager("document-pager.txt", contents->str);
+  g_string_free(contents, TRUE);
+
+  g_assert_cmpint(pluma_document_pager_get_line_count(pager), ==, 60000);
+
+  check_window(pager, pluma_document_pager_get_window(pager, 0), 40 * 1024);
+  g_assert_cmpint(pluma_document_pager_get_first_line(pager), ==, 0);
+
+  /* the rest of the file fits in the window */
+  check_window(pager, pluma_document_pager_move_window(pager, 1),
+               60000 - 20 * 1024);
+  g_assert_cmpint(pluma_document_pager_get_first_line(pager), ==, 20 * 1024);
+
+  g_assert(pluma_document_pager_move_window(pager, 1) == NULL);
+
+  check_window(pager, pluma_document_pager_move_window(pager, -1),
+               40 * 1024);
+  g_assert_cmpint(pluma_document_pager_get_first_line(pager), ==, 1024);
+
+  /* the window starts a bit above the line */
+  check_window(pager, pluma_document_pager_get_window(pager, 50000),
+               60000 - 47 * 1024);
+  g_assert_cmpint(pluma_document_pager_get_first_line(pager), ==, 47 * 1024);
+
+  pluma_document_pager_free(pager);
+  g_unlink("document-pager.txt");
+}
+
+static void test_not_utf8() {
+  PlumaDocumentPager *pager;
+  GString *contents;
+  gint i;
+
+  /* a character cut between two steps is still valid */
+  contents = g_string_new(NULL);
+  for (i = 0; i < 2000; i++) {
+    g_string_append(contents, "d\xc3\xa9j\xc3\xa0 vu!\n");
+  }
+
+  pager = create_pager("document-pager.txt", contents->str);
+  g_assert(pluma_document_pager_is_valid(pager));
+  pluma_document_pager_free(pager);
+
+  /* latin-1 */
+  g_string_append(contents, "d\xe9j\xe0 vu\n");
+
+  pager = create_pager("document-pager.txt", contents->str);
+  g_assert(!pluma_document_pager_is_valid(pager));
+  pluma_document_pager_free(pager);
+
+  g_string_free(contents, TRUE);
+  g_unlink("document-pager.txt");
+}
+
+static void test_truncated() {
+  PlumaDocumentPager *pager;
+  GString *contents;
+  gint i;
+
+  contents = g_string_new(NULL);
+  for (i = 0; i < 3000; i++) {
+    g_string_append_printf(contents, LINE_FORMAT, i);
+  }
+
+  pager = create_pager("document-pager.txt", contents->str);
+  g_string_free(contents, TRUE);
+
+  /* as when a log is rotated, the windows are only shorter */
+  g_assert(truncate("document-pager.txt", 1500 * 100) == 0);
+
+  check_window(pager, pluma_document_pager_get_window(pager, 0), 1500);
+  check_window(pager, pluma_document_pager_get_window(pager, 2500),
+               1500 - 1024);
+
+  pluma_document_pager_free(pager);
+  g_unlink("document-pager.txt");
+}
+
+int main(int argc, char *argv[]) {
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/document-pager/small-file", test_small_file);
+  g_test_add_func("/document-pager/windows", test_windows);
+  g_test_add_func("/document-pager/not-utf8", test_not_utf8);
+  g_test_add_func("/document-pager/truncated", test_truncated);
+
+  return g_test_run();
+}
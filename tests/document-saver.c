@@ -24,11 +24,13 @@
 #include <gio/gio.h>
 #include <glib.h>
 #include <glib/gprintf.h>
+#include <glib/gstdio.h>
 #include <gtk/gtk.h>
 #include <string.h>
 #include <sys/stat.h>
 
 #include "pluma-document-loader.h"
+#include "pluma-settings.h"
 
 /* linux/bsd has it. others such as Solaris, do not */
 #ifndef ACCESSPERMS
@@ -48,6 +50,15 @@
   "sftp://localhost/tmp/pluma-document-saver-unowned/" \
   "pluma-document-saver-test.txt"
 
+#define INCREMENTAL_LOCAL_URI "/tmp/pluma-document-saver-incremental.txt"
+
+#define UNCHANGED_LOCAL_URI "/tmp/pluma-document-saver-unchanged.txt"
+
+#define EDITED_LOCAL_URI "/tmp/pluma-document-saver-edited.txt"
+
+#define BACKUP_LOCAL_URI "/tmp/pluma-document-saver-backup.txt"
+#define BACKUP_LOCAL_BACKUP_URI "/tmp/pluma-document-saver-backup.txt~"
+
 #define UNOWNED_GROUP_LOCAL_URI "/tmp/pluma-document-saver-unowned-group.txt"
 #define UNOWNED_GROUP_REMOTE_URI \
   "sftp://localhost/tmp/pluma-document-saver-unowned-group.txt"
@@ -119,6 +130,18 @@ static const gchar *read_file(const gchar *uri) {
   return buffer;
 }
 
+/* the contents of a local file, until the next call */
+static const gchar *read_big_file(const gchar *path) {
+  static gchar *contents = NULL;
+  GError *error = NULL;
+
+  g_free(contents);
+  g_file_get_contents(path, &contents, NULL, &error);
+  g_assert_no_error(error);
+
+  return contents;
+}
+
 static void complete_test(PlumaDocument *document, GError *error,
                           SaverTestData *data) {
   test_completed = TRUE;
@@ -309,6 +332,321 @@ static void test_remote() {
              saver_test_data_new(DEFAULT_REMOTE_URI, "hello world\n\n", NULL));
 }
 
+static void on_incremental_done(PlumaDocument *document, GError *error,
+                                gpointer data) {
+  g_assert_no_error(error);
+  test_completed = TRUE;
+}
+
+static void save_and_check(PlumaDocument *document, const gchar *expected,
+                           gsize expected_len) {
+  gchar *contents;
+  gsize len;
+  GError *error = NULL;
+
+  test_completed = FALSE;
+  pluma_document_save(document, PLUMA_DOCUMENT_SAVE_PRESERVE_BACKUP);
+
+  while (!test_completed) {
+    g_main_context_iteration(NULL, TRUE);
+  }
+
+  g_file_get_contents(INCREMENTAL_LOCAL_URI, &contents, &len, &error);
+  g_assert_no_error(error);
+
+  g_assert_cmpuint(len, ==, expected_len);
+  g_assert(memcmp(contents, expected, len) == 0);
+
+  g_free(contents);
+}
+
+static void test_local_incremental() {
+  PlumaDocument *document;
+  GtkTextIter iter;
+  GString *contents;
+  GFile *file;
+  gchar *uri;
+  gsize pos;
+  gint i;
+
+  /* big enough to be saved incrementally */
+  contents = g_string_new(NULL);
+  for (i = 0; contents->len <= 17 * 1024 * 1024; i++) {
+    g_string_append_printf(contents, "line %08d\n", i);
+  }
+
+  g_file_set_contents(INCREMENTAL_LOCAL_URI, contents->str, contents->len,
+                      NULL);
+
+  file = g_file_new_for_path(INCREMENTAL_LOCAL_URI);
+  uri = g_file_get_uri(file);
+
+  document = pluma_document_new();
+  g_signal_connect(document, "loaded", G_CALLBACK(on_incremental_done), NULL);
+  g_signal_connect(document, "saved", G_CALLBACK(on_incremental_done), NULL);
+
+  test_completed = FALSE;
+  pluma_document_load(document, uri, pluma_encoding_get_utf8(), 0, FALSE);
+
+  while (!test_completed) {
+    g_main_context_iteration(NULL, TRUE);
+  }
+
+  /* the size changes, the end of a copy of the file is rewritten */
+  gtk_text_buffer_get_end_iter(GTK_TEXT_BUFFER(document), &iter);
+  gtk_text_iter_backward_line(&iter);
+  gtk_text_buffer_insert(GTK_TEXT_BUFFER(document), &iter, "inserted\n", -1);
+
+  pos = contents->len - strlen("line 00000000\n");
+  g_string_insert(contents, pos, "inserted\n");
+
+  save_and_check(document, contents->str, contents->len);
+
+  /* the size is the same, the file is patched in place */
+  gtk_text_buffer_get_iter_at_line(GTK_TEXT_BUFFER(document), &iter, 1000);
+  gtk_text_buffer_insert(GTK_TEXT_BUFFER(document), &iter, "X", -1);
+  gtk_text_iter_forward_char(&iter);
+  gtk_text_buffer_backspace(GTK_TEXT_BUFFER(document), &iter, FALSE, TRUE);
+
+  contents->str[1000 * strlen("line 00000000\n")] = 'X';
+
+  save_and_check(document, contents->str, contents->len);
+
+  g_object_unref(document);
+  g_file_delete(file, NULL, NULL);
+
+  g_string_free(contents, TRUE);
+  g_free(uri);
+  g_object_unref(file);
+}
+
+static guint64 get_mtime(GFile *file) {
+  GFileInfo *info;
+  guint64 mtime;
+
+  info = g_file_query_info(file, G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                           G_FILE_QUERY_INFO_NONE, NULL, NULL);
+  g_assert(info != NULL);
+
+  mtime =
+      g_file_info_get_attribute_uint64(info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+  g_object_unref(info);
+
+  return mtime;
+}
+
+static void test_local_unchanged() {
+  PlumaDocument *document;
+  GtkTextIter iter;
+  GFile *file;
+  gchar *uri;
+  guint64 mtime;
+
+  g_file_set_contents(UNCHANGED_LOCAL_URI, "hello\nworld\n", -1, NULL);
+
+  /* a rewrite would show */
+  file = g_file_new_for_path(UNCHANGED_LOCAL_URI);
+  g_file_set_attribute_uint64(file, G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                              1000000000, G_FILE_QUERY_INFO_NONE, NULL, NULL);
+  mtime = get_mtime(file);
+  uri = g_file_get_uri(file);
+
+  document = pluma_document_new();
+  g_signal_connect(document, "loaded", G_CALLBACK(on_incremental_done), NULL);
+  g_signal_connect(document, "saved", G_CALLBACK(on_incremental_done), NULL);
+
+  test_completed = FALSE;
+  pluma_document_load(document, uri, pluma_encoding_get_utf8(), 0, FALSE);
+
+  while (!test_completed) {
+    g_main_context_iteration(NULL, TRUE);
+  }
+
+  /* changed and changed back */
+  gtk_text_buffer_get_start_iter(GTK_TEXT_BUFFER(document), &iter);
+  gtk_text_buffer_insert(GTK_TEXT_BUFFER(document), &iter, "X", -1);
+  gtk_text_buffer_backspace(GTK_TEXT_BUFFER(document), &iter, FALSE, TRUE);
+  g_assert(gtk_text_buffer_get_modified(GTK_TEXT_BUFFER(document)));
+
+  test_completed = FALSE;
+  pluma_document_save(document, 0);
+  g_assert(test_completed);
+
+  g_assert(!gtk_text_buffer_get_modified(GTK_TEXT_BUFFER(document)));
+  g_assert_cmpuint(get_mtime(file), ==, mtime);
+
+  /* a real change is written */
+  gtk_text_buffer_get_start_iter(GTK_TEXT_BUFFER(document), &iter);
+  gtk_text_buffer_insert(GTK_TEXT_BUFFER(document), &iter, "X", -1);
+
+  test_completed = FALSE;
+  pluma_document_save(document, 0);
+
+  while (!test_completed) {
+    g_main_context_iteration(NULL, TRUE);
+  }
+
+  g_assert_cmpuint(get_mtime(file), !=, mtime);
+  g_assert_cmpstr(read_file(uri), ==, "Xhello\nworld\n");
+
+  g_object_unref(document);
+  g_file_delete(file, NULL, NULL);
+
+  g_free(uri);
+  g_object_unref(file);
+}
+
+static void insert_and_save(PlumaDocument *document, const gchar *text) {
+  GtkTextIter iter;
+
+  gtk_text_buffer_get_start_iter(GTK_TEXT_BUFFER(document), &iter);
+  gtk_text_buffer_insert(GTK_TEXT_BUFFER(document), &iter, text, -1);
+
+  test_completed = FALSE;
+  pluma_document_save(document, 0);
+
+  while (!test_completed) {
+    g_main_context_iteration(NULL, TRUE);
+  }
+}
+
+static void test_local_backup() {
+  PlumaDocument *document;
+  GSettings *settings;
+  GFile *file;
+  gchar *uri;
+
+  settings = g_settings_new(PLUMA_SCHEMA_ID);
+  g_settings_set_boolean(settings, PLUMA_SETTINGS_CREATE_BACKUP_COPY, TRUE);
+
+  g_file_set_contents(BACKUP_LOCAL_URI, "hello\n", -1, NULL);
+  g_unlink(BACKUP_LOCAL_BACKUP_URI);
+
+  file = g_file_new_for_path(BACKUP_LOCAL_URI);
+  uri = g_file_get_uri(file);
+
+  document = pluma_document_new();
+  g_signal_connect(document, "loaded", G_CALLBACK(on_incremental_done), NULL);
+  g_signal_connect(document, "saved", G_CALLBACK(on_incremental_done), NULL);
+
+  test_completed = FALSE;
+  pluma_document_load(document, uri, pluma_encoding_get_utf8(), 0, FALSE);
+
+  while (!test_completed) {
+    g_main_context_iteration(NULL, TRUE);
+  }
+
+  /* cloned, renamed or copied, the backup is the file as it was */
+  insert_and_save(document, "X");
+  g_assert_cmpstr(read_file(BACKUP_LOCAL_URI), ==, "Xhello\n");
+  g_assert_cmpstr(read_file(BACKUP_LOCAL_BACKUP_URI), ==, "hello\n");
+
+  insert_and_save(document, "Y");
+  g_assert_cmpstr(read_file(BACKUP_LOCAL_URI), ==, "YXhello\n");
+  g_assert_cmpstr(read_file(BACKUP_LOCAL_BACKUP_URI), ==, "Xhello\n");
+
+  g_object_unref(document);
+  g_file_delete(file, NULL, NULL);
+  g_unlink(BACKUP_LOCAL_BACKUP_URI);
+
+  g_settings_reset(settings, PLUMA_SETTINGS_CREATE_BACKUP_COPY);
+  g_object_unref(settings);
+
+  g_free(uri);
+  g_object_unref(file);
+}
+
+/* changes made at both ends and in the middle of the text, in the part
+ * which is written already and in the one which is not */
+static void edit_while_saving(PlumaDocument *document, goffset size,
+                              goffset total_size, gint *n_edits) {
+  GtkTextBuffer *buffer = GTK_TEXT_BUFFER(document);
+  GtkTextIter start;
+  GtkTextIter end;
+
+  if (!_pluma_document_is_saving_snapshot(document) || *n_edits >= 3) return;
+
+  (*n_edits)++;
+
+  gtk_text_buffer_get_start_iter(buffer, &start);
+  gtk_text_buffer_insert(buffer, &start, "edited ", -1);
+
+  gtk_text_buffer_get_iter_at_line(buffer, &start, *n_edits * 20000);
+  gtk_text_buffer_get_iter_at_line(buffer, &end, *n_edits * 20000 + 3);
+  gtk_text_buffer_delete(buffer, &start, &end);
+  gtk_text_buffer_insert(buffer, &start, "\n", -1);
+
+  gtk_text_buffer_get_end_iter(buffer, &end);
+  start = end;
+  gtk_text_iter_backward_chars(&start, 5);
+  gtk_text_buffer_delete(buffer, &start, &end);
+}
+
+static void test_local_edited_while_saving() {
+  PlumaDocument *document;
+  GtkTextIter start;
+  GtkTextIter end;
+  GString *contents;
+  GFile *file;
+  gchar *uri;
+  gchar *text;
+  gint n_edits = 0;
+  gint i;
+
+  /* a few blocks of text */
+  contents = g_string_new(NULL);
+  for (i = 0; i < 100000; i++) {
+    g_string_append_printf(contents, "line %08d\n", i);
+  }
+
+  g_file_set_contents(EDITED_LOCAL_URI, contents->str, contents->len, NULL);
+
+  file = g_file_new_for_path(EDITED_LOCAL_URI);
+  uri = g_file_get_uri(file);
+
+  document = pluma_document_new();
+  g_signal_connect(document, "loaded", G_CALLBACK(on_incremental_done), NULL);
+  g_signal_connect(document, "saved", G_CALLBACK(on_incremental_done), NULL);
+  g_signal_connect(document, "saving", G_CALLBACK(edit_while_saving),
+                   &n_edits);
+
+  test_completed = FALSE;
+  pluma_document_load(document, uri, pluma_encoding_get_utf8(), 0, FALSE);
+
+  while (!test_completed) {
+    g_main_context_iteration(NULL, TRUE);
+  }
+
+  /* the file holds the text as it was when the save started */
+  g_string_prepend(contents, "X");
+  insert_and_save(document, "X");
+
+  g_assert_cmpint(n_edits, >, 0);
+  g_assert(g_str_equal(read_big_file(EDITED_LOCAL_URI), contents->str));
+  g_assert(gtk_text_buffer_get_modified(GTK_TEXT_BUFFER(document)));
+
+  /* and the changes are written the next time */
+  n_edits = 3;
+  insert_and_save(document, "Y");
+
+  gtk_text_buffer_get_bounds(GTK_TEXT_BUFFER(document), &start, &end);
+  text = gtk_text_buffer_get_text(GTK_TEXT_BUFFER(document), &start, &end,
+                                  TRUE);
+  g_string_assign(contents, text);
+  g_string_append_c(contents, '\n');
+
+  g_assert(g_str_equal(read_big_file(EDITED_LOCAL_URI), contents->str));
+  g_assert(!gtk_text_buffer_get_modified(GTK_TEXT_BUFFER(document)));
+
+  g_object_unref(document);
+  g_file_delete(file, NULL, NULL);
+
+  g_free(text);
+  g_string_free(contents, TRUE);
+  g_free(uri);
+  g_object_unref(file);
+}
+
 static void check_permissions(GFile *file, guint permissions) {
   GError *error = NULL;
   GFileInfo *info;
@@ -563,6 +901,9 @@ int main(int argc, char *argv[]) {
   gboolean have_unowned;
   gboolean have_unowned_group;
 
+  /* the tests change settings, keep them out of the user's dconf */
+  g_setenv("GSETTINGS_BACKEND", "memory", TRUE);
+
   g_test_init(&argc, &argv, NULL);
 
   g_printf("\n***\n");
@@ -572,6 +913,11 @@ int main(int argc, char *argv[]) {
 
   g_test_add_func("/document-saver/local", test_local);
   g_test_add_func("/document-saver/local-new-line", test_local_newline);
+  g_test_add_func("/document-saver/local-incremental", test_local_incremental);
+  g_test_add_func("/document-saver/local-unchanged", test_local_unchanged);
+  g_test_add_func("/document-saver/local-backup", test_local_backup);
+  g_test_add_func("/document-saver/local-edited-while-saving",
+                  test_local_edited_while_saving);
 
   if (have_unowned) {
     g_test_add_func("/document-saver/local-unowned-directory",
@@ -0,0 +1,532 @@
+/*
+ * document-search-benchmark.c
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * pluma is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * pluma is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pluma; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <glib.h>
+#include <gtk/gtk.h>
+#include <gtksourceview/gtksource.h>
+#include <string.h>
+
+#include "pluma-document.h"
+
+static gchar *get_text(GtkTextBuffer *buffer) {
+  GtkTextIter start;
+  GtkTextIter end;
+
+  gtk_text_buffer_get_bounds(buffer, &start, &end);
+
+  return gtk_text_buffer_get_text(buffer, &start, &end, TRUE);
+}
+
+/* Lines of code with five identifiers each, and long comments without any
+ * between some of them */
+static gchar *create_code(gint n_identifiers) {
+  GString *code;
+  gint i;
+
+  code = g_string_new(NULL);
+
+  for (i = 0; i < n_identifiers / 5; i++) {
+    g_string_append(code, "value = value + value * (value - value);\n");
+
+    if (i % 100 == 0) {
+      gint j;
+
+      g_string_append(code, "/*");
+      for (j = 0; j < 100; j++) g_string_append(code, " n\303\251ant");
+      g_string_append(code, " */\n");
+    }
+  }
+
+  return g_string_free(code, FALSE);
+}
+
+/* the same text as replace all, without the document */
+static gchar *replace_text(const gchar *text, const gchar *find,
+                           const gchar *replace) {
+  gchar **parts;
+  gchar *result;
+
+  parts = g_strsplit(text, find, -1);
+  result = g_strjoinv(replace, parts);
+  g_strfreev(parts);
+
+  return result;
+}
+
+static void check_replace_all(PlumaDocument *doc, const gchar *text,
+                              const gchar *find, const gchar *replace,
+                              guint flags, gint n_matches,
+                              const gchar *expected) {
+  gchar *result;
+
+  gtk_source_buffer_begin_not_undoable_action(GTK_SOURCE_BUFFER(doc));
+  gtk_text_buffer_set_text(GTK_TEXT_BUFFER(doc), text, -1);
+  gtk_source_buffer_end_not_undoable_action(GTK_SOURCE_BUFFER(doc));
+
+  g_assert_cmpint(pluma_document_replace_all(doc, find, replace, flags), ==,
+                  n_matches);
+
+  result = get_text(GTK_TEXT_BUFFER(doc));
+  g_assert_cmpstr(result, ==, expected);
+  g_free(result);
+
+  /* a single step undoes it */
+  if (n_matches > 0) {
+    gtk_source_buffer_undo(GTK_SOURCE_BUFFER(doc));
+
+    result = get_text(GTK_TEXT_BUFFER(doc));
+    g_assert_cmpstr(result, ==, text);
+    g_free(result);
+
+    g_assert(!gtk_source_buffer_can_undo(GTK_SOURCE_BUFFER(doc)));
+  }
+}
+
+static void test_replace_all() {
+  PlumaDocument *doc;
+  gchar *code;
+  gchar *expected;
+  guint flags = 0;
+
+  doc = pluma_document_new();
+
+  /* over many blocks */
+  code = create_code(50000);
+
+  PLUMA_SEARCH_SET_CASE_SENSITIVE(flags, TRUE);
+
+  expected = replace_text(code, "value", "r\303\251sultat");
+  check_replace_all(doc, code, "value", "r\303\251sultat", flags, 50000,
+                    expected);
+  g_free(expected);
+
+  expected = replace_text(code, "n\303\251ant", "");
+  check_replace_all(doc, code, "n\303\251ant", "", flags, 10000, expected);
+  g_free(expected);
+
+  check_replace_all(doc, code, "nothing", "something", flags, 0, code);
+
+  g_free(code);
+
+  /* escapes, words and case */
+  check_replace_all(doc, "a\tb ab A\tB", "a\\tb", "x", flags, 1, "x ab A\tB");
+
+  flags = 0;
+  check_replace_all(doc, "a\tb ab A\tB", "a\\tb", "x", flags, 2, "x ab x");
+
+  PLUMA_SEARCH_SET_ENTIRE_WORD(flags, TRUE);
+  check_replace_all(doc, "ab abc AB cab", "ab", "x", flags, 2, "x abc x cab");
+
+  /* regex, empty matches included */
+  flags = 0;
+  PLUMA_SEARCH_SET_MATCH_REGEX(flags, TRUE);
+  PLUMA_SEARCH_SET_CASE_SENSITIVE(flags, TRUE);
+
+  check_replace_all(doc, "k1 = v1\nk2 = v2", "(\\w+) = (\\w+)", "\\2 = \\1",
+                    flags, 2, "v1 = k1\nv2 = k2");
+  check_replace_all(doc, "ab\ncd\n", "$", ";", flags, 3, "ab;\ncd;\n;");
+  check_replace_all(doc, "baaac", "a*", "-", flags, 4, "-b--c-");
+
+  g_object_unref(doc);
+}
+
+static gint count_tagged(PlumaDocument *doc, GtkTextTag *tag) {
+  GtkTextIter iter;
+  gint count = 0;
+
+  gtk_text_buffer_get_start_iter(GTK_TEXT_BUFFER(doc), &iter);
+
+  while (gtk_text_iter_forward_to_tag_toggle(&iter, tag)) {
+    if (gtk_text_iter_starts_tag(&iter, tag)) count++;
+  }
+
+  return count;
+}
+
+static void on_progress_notify(PlumaDocument *doc, GParamSpec *pspec,
+                               gint *n_notifies) {
+  (*n_notifies)++;
+}
+
+static void test_highlight() {
+  PlumaDocument *doc;
+  GtkTextTag *tag;
+  GtkTextIter start;
+  GtkTextIter end;
+  gchar *code;
+  gint n_notifies = 0;
+
+  doc = pluma_document_new();
+
+  code = create_code(50000);
+  gtk_text_buffer_set_text(GTK_TEXT_BUFFER(doc), code, -1);
+  g_free(code);
+
+  g_signal_connect(doc, "notify::search-highlight-progress",
+                   G_CALLBACK(on_progress_notify), &n_notifies);
+
+  pluma_document_set_enable_search_highlighting(doc, TRUE);
+  pluma_document_set_search_text(doc, "value", PLUMA_SEARCH_CASE_SENSITIVE);
+
+  g_assert_cmpfloat(_pluma_document_get_search_highlight_progress(doc), <,
+                    1.0);
+
+  /* what a view draws comes first */
+  gtk_text_buffer_get_iter_at_line(GTK_TEXT_BUFFER(doc), &start, 5000);
+  gtk_text_buffer_get_iter_at_line(GTK_TEXT_BUFFER(doc), &end, 5010);
+  _pluma_document_search_region(doc, &start, &end);
+
+  tag = gtk_text_tag_table_lookup(
+      gtk_text_buffer_get_tag_table(GTK_TEXT_BUFFER(doc)), "found");
+  g_assert(tag != NULL);
+  g_assert(gtk_text_iter_starts_tag(&start, tag) ||
+           gtk_text_iter_forward_to_tag_toggle(&start, tag));
+  g_assert_cmpint(gtk_text_iter_get_line(&start), <, 5010);
+
+  /* the rest in the idle time */
+  while (_pluma_document_get_search_highlight_progress(doc) < 1.0) {
+    g_main_context_iteration(NULL, TRUE);
+  }
+
+  g_assert_cmpint(count_tagged(doc, tag), ==, 50000);
+  g_assert_cmpint(n_notifies, >, 0);
+
+  /* edits are highlighted again */
+  gtk_text_buffer_get_start_iter(GTK_TEXT_BUFFER(doc), &start);
+  gtk_text_buffer_insert(GTK_TEXT_BUFFER(doc), &start, "value\n", -1);
+
+  while (g_main_context_iteration(NULL, FALSE)) {
+  }
+
+  g_assert_cmpfloat(_pluma_document_get_search_highlight_progress(doc), ==,
+                    1.0);
+  g_assert_cmpint(count_tagged(doc, tag), ==, 50001);
+
+  pluma_document_set_enable_search_highlighting(doc, FALSE);
+  g_assert_cmpint(count_tagged(doc, tag), ==, 0);
+
+  g_object_unref(doc);
+}
+
+static void wait_for_highlighting(PlumaDocument *doc) {
+  while (_pluma_document_get_search_highlight_progress(doc) < 1.0) {
+    g_main_context_iteration(NULL, TRUE);
+  }
+}
+
+/* finds the next match like Ctrl+G, returns its position */
+static gint find_again(PlumaDocument *doc, gboolean backward, gint *n_matches) {
+  GtkTextBuffer *buffer = GTK_TEXT_BUFFER(doc);
+  GtkTextIter start;
+  GtkTextIter end;
+  gint position = 0;
+
+  gtk_text_buffer_get_selection_bounds(buffer, &start, &end);
+
+  if (!backward)
+    g_assert(pluma_document_search_forward(doc, &end, NULL, &start, &end));
+  else
+    g_assert(pluma_document_search_backward(doc, NULL, &start, &start, &end));
+
+  gtk_text_buffer_select_range(buffer, &start, &end);
+
+  if (!_pluma_document_get_match_position(doc, &start, &position, n_matches))
+    position = 0;
+
+  return position;
+}
+
+static void test_match_index() {
+  PlumaDocument *doc;
+  GtkTextBuffer *buffer;
+  GtkTextIter iter;
+  GtkTextIter end;
+  gchar *code;
+  gint n_matches;
+
+  doc = pluma_document_new();
+  buffer = GTK_TEXT_BUFFER(doc);
+
+  code = create_code(50000);
+  gtk_text_buffer_set_text(buffer, code, -1);
+  g_free(code);
+
+  pluma_document_set_enable_search_highlighting(doc, TRUE);
+  pluma_document_set_search_text(doc, "value", PLUMA_SEARCH_CASE_SENSITIVE);
+  wait_for_highlighting(doc);
+
+  gtk_text_buffer_get_start_iter(buffer, &iter);
+  gtk_text_buffer_place_cursor(buffer, &iter);
+
+  g_assert_cmpint(find_again(doc, FALSE, &n_matches), ==, 1);
+  g_assert_cmpint(n_matches, ==, 50000);
+  g_assert_cmpint(find_again(doc, FALSE, &n_matches), ==, 2);
+  g_assert_cmpint(find_again(doc, TRUE, &n_matches), ==, 1);
+
+  gtk_text_buffer_get_end_iter(buffer, &iter);
+  gtk_text_buffer_place_cursor(buffer, &iter);
+
+  g_assert_cmpint(find_again(doc, TRUE, &n_matches), ==, 50000);
+
+  /* the edits are searched again when needed */
+  gtk_text_buffer_get_start_iter(buffer, &iter);
+  gtk_text_buffer_insert(buffer, &iter, "value ", -1);
+
+  gtk_text_buffer_get_iter_at_offset(buffer, &iter, 8);
+  end = iter;
+  gtk_text_iter_forward_chars(&end, 5);
+  gtk_text_buffer_delete(buffer, &iter, &end);
+
+  gtk_text_buffer_get_start_iter(buffer, &iter);
+  gtk_text_buffer_place_cursor(buffer, &iter);
+
+  g_assert_cmpint(find_again(doc, FALSE, &n_matches), ==, 1);
+  g_assert_cmpint(n_matches, ==, 50000);
+  g_assert_cmpint(find_again(doc, FALSE, &n_matches), ==, 2);
+
+  gtk_text_buffer_get_selection_bounds(buffer, &iter, NULL);
+  g_assert_cmpint(gtk_text_iter_get_offset(&iter), ==, 9);
+
+  /* overlapping matches are all found, not only the highlighted ones */
+  gtk_text_buffer_set_text(buffer, "aaa aa", -1);
+  pluma_document_set_search_text(doc, "aa", PLUMA_SEARCH_CASE_SENSITIVE);
+  wait_for_highlighting(doc);
+
+  gtk_text_buffer_get_iter_at_offset(buffer, &iter, 1);
+  gtk_text_buffer_place_cursor(buffer, &iter);
+  find_again(doc, FALSE, &n_matches);
+
+  gtk_text_buffer_get_selection_bounds(buffer, &iter, NULL);
+  g_assert_cmpint(gtk_text_iter_get_offset(&iter), ==, 1);
+
+  g_object_unref(doc);
+}
+
+/* regexes are highlighted and counted a line at a time */
+static void test_regex_highlight() {
+  PlumaDocument *doc;
+  GtkTextBuffer *buffer;
+  GtkTextTag *tag;
+  GtkTextIter iter;
+  gchar *code;
+  guint flags = 0;
+  gint n_matches;
+
+  doc = pluma_document_new();
+  buffer = GTK_TEXT_BUFFER(doc);
+
+  code = create_code(50000);
+  gtk_text_buffer_set_text(buffer, code, -1);
+  g_free(code);
+
+  PLUMA_SEARCH_SET_MATCH_REGEX(flags, TRUE);
+  PLUMA_SEARCH_SET_CASE_SENSITIVE(flags, TRUE);
+
+  pluma_document_set_enable_search_highlighting(doc, TRUE);
+  pluma_document_set_search_text(doc, "^value", flags);
+  wait_for_highlighting(doc);
+
+  tag = gtk_text_tag_table_lookup(gtk_text_buffer_get_tag_table(buffer),
+                                  "found");
+  g_assert_cmpint(count_tagged(doc, tag), ==, 10000);
+
+  gtk_text_buffer_get_start_iter(buffer, &iter);
+  gtk_text_buffer_place_cursor(buffer, &iter);
+
+  g_assert_cmpint(find_again(doc, FALSE, &n_matches), ==, 1);
+  g_assert_cmpint(n_matches, ==, 10000);
+  g_assert_cmpint(find_again(doc, FALSE, &n_matches), ==, 2);
+
+  /* edits are highlighted again */
+  gtk_text_buffer_get_start_iter(buffer, &iter);
+  gtk_text_buffer_insert(buffer, &iter, "value\n", -1);
+  wait_for_highlighting(doc);
+
+  g_assert_cmpint(count_tagged(doc, tag), ==, 10001);
+
+  /* the matches of nothing are not */
+  pluma_document_set_search_text(doc, "x*", flags);
+  wait_for_highlighting(doc);
+
+  g_assert_cmpint(count_tagged(doc, tag), ==, 0);
+
+  g_object_unref(doc);
+}
+
+/* How replace all used to work: a deletion and an insertion per match */
+static gint replace_all_per_match(PlumaDocument *doc, const gchar *find,
+                                  const gchar *replace) {
+  GtkTextBuffer *buffer = GTK_TEXT_BUFFER(doc);
+  GtkTextIter iter;
+  GtkTextIter m_start;
+  GtkTextIter m_end;
+  gint count = 0;
+
+  gtk_text_buffer_get_start_iter(buffer, &iter);
+  gtk_text_buffer_begin_user_action(buffer);
+
+  while (gtk_text_iter_forward_search(&iter, find, GTK_TEXT_SEARCH_TEXT_ONLY,
+                                      &m_start, &m_end, NULL)) {
+    gtk_text_buffer_delete(buffer, &m_start, &m_end);
+    gtk_text_buffer_insert(buffer, &m_start, replace, -1);
+    iter = m_start;
+    count++;
+  }
+
+  gtk_text_buffer_end_user_action(buffer);
+
+  return count;
+}
+
+static void run_benchmark(gint n_identifiers, gboolean per_match) {
+  PlumaDocument *doc;
+  gchar *code;
+  gdouble elapsed;
+  gint count;
+  guint flags = 0;
+
+  PLUMA_SEARCH_SET_CASE_SENSITIVE(flags, TRUE);
+
+  code = create_code(n_identifiers);
+
+  doc = pluma_document_new();
+  gtk_text_buffer_set_text(GTK_TEXT_BUFFER(doc), code, -1);
+
+  g_test_timer_start();
+
+  if (per_match)
+    count = replace_all_per_match(doc, "value", "result");
+  else
+    count = pluma_document_replace_all(doc, "value", "result", flags);
+
+  elapsed = g_test_timer_elapsed();
+
+  g_assert_cmpint(count, ==, n_identifiers);
+
+  g_test_minimized_result(elapsed, "replacing %d identifiers %s: %g s",
+                          n_identifiers,
+                          per_match ? "one at a time" : "by blocks", elapsed);
+
+  g_object_unref(doc);
+  g_free(code);
+}
+
+static void test_replace_all_benchmark() {
+  gint counts[] = {10000, 100000, 500000};
+  guint i;
+
+  if (!g_test_perf()) {
+    g_test_skip("only run in performance mode");
+    return;
+  }
+
+  for (i = 0; i < G_N_ELEMENTS(counts); i++) {
+    run_benchmark(counts[i], FALSE);
+
+    /* replacing them one at a time takes minutes for the most */
+    if (i < G_N_ELEMENTS(counts) - 1 || g_test_thorough())
+      run_benchmark(counts[i], TRUE);
+  }
+}
+
+/* A log with a match every few megabytes */
+static gchar *create_log(gint n_lines, gint n_matches) {
+  GString *log;
+  gint i;
+
+  log = g_string_new(NULL);
+
+  for (i = 0; i < n_lines; i++) {
+    g_string_append_printf(log, "%08d info: nothing to see on this line\n", i);
+
+    if (i % (n_lines / n_matches) == n_lines / n_matches / 2)
+      g_string_append(log, "error: the needle\n");
+  }
+
+  return g_string_free(log, FALSE);
+}
+
+static void run_find_again_benchmark(gboolean indexed) {
+  PlumaDocument *doc;
+  GtkTextIter iter;
+  gchar *log;
+  gdouble elapsed;
+  gint i;
+
+  log = create_log(500000, 8);
+
+  doc = pluma_document_new();
+  gtk_text_buffer_set_text(GTK_TEXT_BUFFER(doc), log, -1);
+  g_free(log);
+
+  pluma_document_set_enable_search_highlighting(doc, indexed);
+  pluma_document_set_search_text(doc, "needle", PLUMA_SEARCH_CASE_SENSITIVE);
+
+  if (indexed) wait_for_highlighting(doc);
+
+  gtk_text_buffer_get_start_iter(GTK_TEXT_BUFFER(doc), &iter);
+  gtk_text_buffer_place_cursor(GTK_TEXT_BUFFER(doc), &iter);
+
+  g_test_timer_start();
+
+  for (i = 0; i < 8; i++) {
+    gint n_matches = 0;
+    gint position;
+
+    position = find_again(doc, FALSE, &n_matches);
+    g_assert_cmpint(position, ==, indexed ? i + 1 : 0);
+  }
+
+  elapsed = g_test_timer_elapsed();
+
+  g_test_minimized_result(elapsed, "8 finds over 20 MB %s: %g s",
+                          indexed ? "with the match index" : "scanning",
+                          elapsed);
+
+  g_object_unref(doc);
+}
+
+static void test_find_again_benchmark() {
+  if (!g_test_perf()) {
+    g_test_skip("only run in performance mode");
+    return;
+  }
+
+  run_find_again_benchmark(FALSE);
+  run_find_again_benchmark(TRUE);
+}
+
+int main(int argc, char *argv[]) {
+  gtk_init(&argc, &argv);
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/document-search/replace-all", test_replace_all);
+  g_test_add_func("/document-search/highlight", test_highlight);
+  g_test_add_func("/document-search/match-index", test_match_index);
+  g_test_add_func("/document-search/regex-highlight", test_regex_highlight);
+  g_test_add_func("/document-search/replace-all-benchmark",
+                  test_replace_all_benchmark);
+  g_test_add_func("/document-search/find-again-benchmark",
+                  test_find_again_benchmark);
+
+  return g_test_run();
+}
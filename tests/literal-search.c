@@ -0,0 +1,262 @@
+/*
+ * literal-search.c
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * pluma is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * pluma is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pluma; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <glib.h>
+#include <gtk/gtk.h>
+#include <string.h>
+
+#include "pluma-literal-search.h"
+
+#define SEARCH_FLAGS (GTK_TEXT_SEARCH_VISIBLE_ONLY | GTK_TEXT_SEARCH_TEXT_ONLY)
+
+/* finds str both ways from every offset, or from a few hundred of them in
+ * the longer texts, as GTK does */
+static void check_like_gtk(GtkTextBuffer *buffer, PlumaLiteralSearch *search,
+                           const gchar *str, GtkTextSearchFlags flags,
+                           gint limit_offset) {
+  GtkTextIter iter;
+  GtkTextIter limit;
+  gint n_chars;
+  gint step;
+  gint offset;
+
+  n_chars = gtk_text_buffer_get_char_count(buffer);
+  step = MAX(1, n_chars / 300);
+
+  for (offset = 0; offset <= n_chars; offset += step) {
+    gboolean forward_search;
+
+    gtk_text_buffer_get_iter_at_offset(buffer, &iter, offset);
+
+    for (forward_search = FALSE; forward_search <= TRUE; forward_search++) {
+      GtkTextIter gtk_start;
+      GtkTextIter gtk_end;
+      GtkTextIter match_start;
+      GtkTextIter match_end;
+      const GtkTextIter *bound = NULL;
+      gboolean found;
+
+      if (limit_offset >= 0) {
+        gtk_text_buffer_get_iter_at_offset(buffer, &limit, limit_offset);
+        bound = &limit;
+      }
+
+      if (forward_search)
+        found = gtk_text_iter_forward_search(&iter, str, flags, &gtk_start,
+                                             &gtk_end, bound);
+      else
+        found = gtk_text_iter_backward_search(&iter, str, flags, &gtk_start,
+                                              &gtk_end, bound);
+
+      g_assert_cmpint(pluma_literal_search_find(search, str, flags, &iter,
+                                                bound, forward_search,
+                                                &match_start, &match_end),
+                      ==, found);
+
+      if (found) {
+        g_assert(gtk_text_iter_equal(&match_start, &gtk_start));
+        g_assert(gtk_text_iter_equal(&match_end, &gtk_end));
+      }
+    }
+  }
+}
+
+static void check_text(const gchar *text, const gchar *str) {
+  GtkTextBuffer *buffer;
+  PlumaLiteralSearch *search;
+  gint n_chars;
+
+  buffer = gtk_text_buffer_new(NULL);
+  gtk_text_buffer_set_text(buffer, text, -1);
+  n_chars = gtk_text_buffer_get_char_count(buffer);
+
+  search = pluma_literal_search_new(buffer);
+
+  check_like_gtk(buffer, search, str, SEARCH_FLAGS, -1);
+  check_like_gtk(buffer, search, str,
+                 SEARCH_FLAGS | GTK_TEXT_SEARCH_CASE_INSENSITIVE, -1);
+  check_like_gtk(buffer, search, str, SEARCH_FLAGS, n_chars / 2);
+
+  pluma_literal_search_free(search);
+  g_object_unref(buffer);
+}
+
+static void test_find() {
+  GString *text;
+  gint i;
+
+  check_text("Foo foo fOO\nfoofoo", "foo");
+  check_text("aaaa aa\na", "aa");
+  check_text("a;\nb a;\r\nb\na;\nb", "a;\nb");
+  check_text("abc", "abcd");
+  check_text("x\303\251t\303\251 \303\211T\303\211 \303\251t\303\251",
+             "\303\251t\303\251");
+  check_text("Stra\303\237e STRASSE strasse", "strasse");
+
+  /* over several slices of the text */
+  text = g_string_new(NULL);
+
+  for (i = 0; i < 2000; i++) {
+    g_string_append(text, i % 300 == 299 ? "Needle\n" : "hay hay\n");
+  }
+
+  check_text(text->str, "needle");
+  check_text(text->str, "e\nh");
+  check_text(text->str, "y");
+
+  g_string_free(text, TRUE);
+}
+
+/* the images and the hidden text are left out as GTK does */
+static void test_gtk_fallback() {
+  GtkTextBuffer *buffer;
+  PlumaLiteralSearch *search;
+  GtkTextTag *tag;
+  GtkTextIter start;
+  GtkTextIter end;
+
+  buffer = gtk_text_buffer_new(NULL);
+  gtk_text_buffer_set_text(buffer, "ab cab a", -1);
+
+  gtk_text_buffer_get_iter_at_offset(buffer, &start, 8);
+  gtk_text_buffer_insert_child_anchor(buffer, &start,
+                                      gtk_text_child_anchor_new());
+  gtk_text_buffer_get_end_iter(buffer, &start);
+  gtk_text_buffer_insert(buffer, &start, "b", -1);
+
+  search = pluma_literal_search_new(buffer);
+
+  check_like_gtk(buffer, search, "ab", SEARCH_FLAGS, -1);
+  check_like_gtk(buffer, search, "ab", 0, -1);
+
+  tag = gtk_text_buffer_create_tag(buffer, NULL, "invisible", TRUE, NULL);
+  gtk_text_buffer_get_iter_at_offset(buffer, &start, 4);
+  gtk_text_buffer_get_iter_at_offset(buffer, &end, 5);
+  gtk_text_buffer_apply_tag(buffer, tag, &start, &end);
+
+  check_like_gtk(buffer, search, "cb", SEARCH_FLAGS, -1);
+
+  pluma_literal_search_free(search);
+  g_object_unref(buffer);
+}
+
+/* Lines of a log, every one of the n_lines with a few occurrences of the
+ * first letters of the word looked for */
+static GtkTextBuffer *create_log(gint n_lines) {
+  GtkTextBuffer *buffer;
+  GString *log;
+  gint i;
+
+  log = g_string_new(NULL);
+
+  for (i = 0; i < n_lines; i++) {
+    g_string_append_printf(log,
+                           "%08d [worker-%d] Warn: waiting for the writer "
+                           "of the wal, %s\n",
+                           i, i % 16, i % 1000 == 0 ? "WARNING" : "ok");
+  }
+
+  buffer = gtk_text_buffer_new(NULL);
+  gtk_text_buffer_set_text(buffer, log->str, log->len);
+  g_string_free(log, TRUE);
+
+  return buffer;
+}
+
+static gint count_matches(GtkTextBuffer *buffer, PlumaLiteralSearch *search,
+                          const gchar *str, GtkTextSearchFlags flags) {
+  GtkTextIter iter;
+  GtkTextIter match_start;
+  gint count = 0;
+
+  gtk_text_buffer_get_start_iter(buffer, &iter);
+
+  for (;;) {
+    gboolean found;
+
+    if (search != NULL)
+      found = pluma_literal_search_find(search, str, flags, &iter, NULL, TRUE,
+                                        &match_start, &iter);
+    else
+      found = gtk_text_iter_forward_search(&iter, str, flags, &match_start,
+                                           &iter, NULL);
+
+    if (!found) break;
+
+    count++;
+  }
+
+  return count;
+}
+
+static void run_benchmark(GtkTextBuffer *buffer, GtkTextSearchFlags flags) {
+  PlumaLiteralSearch *search;
+  gdouble gtk_elapsed;
+  gdouble elapsed;
+  gint count;
+
+  search = pluma_literal_search_new(buffer);
+
+  g_test_timer_start();
+  count = count_matches(buffer, NULL, "warning", flags);
+  gtk_elapsed = g_test_timer_elapsed();
+
+  g_test_timer_start();
+  g_assert_cmpint(count_matches(buffer, search, "warning", flags), ==, count);
+  elapsed = g_test_timer_elapsed();
+
+  g_test_minimized_result(elapsed, "%d matches%s: %g s, %g s with GTK",
+                          count,
+                          (flags & GTK_TEXT_SEARCH_CASE_INSENSITIVE) != 0
+                              ? " ignoring the case"
+                              : "",
+                          elapsed, gtk_elapsed);
+
+  pluma_literal_search_free(search);
+}
+
+static void test_benchmark() {
+  GtkTextBuffer *buffer;
+
+  if (!g_test_perf()) {
+    g_test_skip("only run in performance mode");
+    return;
+  }
+
+  buffer = create_log(200000);
+
+  run_benchmark(buffer, SEARCH_FLAGS);
+  run_benchmark(buffer, SEARCH_FLAGS | GTK_TEXT_SEARCH_CASE_INSENSITIVE);
+
+  g_object_unref(buffer);
+}
+
+int main(int argc, char *argv[]) {
+  gtk_init(&argc, &argv);
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/literal-search/find", test_find);
+  g_test_add_func("/literal-search/gtk-fallback", test_gtk_fallback);
+  g_test_add_func("/literal-search/benchmark", test_benchmark);
+
+  return g_test_run();
+}
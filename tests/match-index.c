@@ -0,0 +1,174 @@
+/*
+ * match-index.c
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * pluma is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * pluma is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pluma; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <glib.h>
+
+#include "pluma-match-index.h"
+
+/* The matches the index should hold, as pairs of start and end offsets in
+ * a plain array */
+static void check_matches(PlumaMatchIndex *index, GArray *expected) {
+  guint n_matches = expected->len / 2;
+  gint offset = 0;
+  guint i;
+
+  g_assert_cmpuint(pluma_match_index_get_n_matches(index), ==, n_matches);
+
+  for (i = 0; i < n_matches; i++) {
+    gint start = g_array_index(expected, gint, 2 * i);
+    gint end = g_array_index(expected, gint, 2 * i + 1);
+    gint match_start;
+    gint match_end;
+
+    g_assert(pluma_match_index_find_next(index, offset, &match_start,
+                                         &match_end));
+    g_assert_cmpint(match_start, ==, start);
+    g_assert_cmpint(match_end, ==, end);
+
+    g_assert(pluma_match_index_find_previous(index, end, &match_start,
+                                             &match_end));
+    g_assert_cmpint(match_start, ==, start);
+
+    g_assert_cmpint(pluma_match_index_get_position(index, start), ==, i);
+
+    offset = end;
+  }
+
+  g_assert(!pluma_match_index_find_next(index, offset, NULL, NULL));
+
+  if (n_matches > 0) {
+    g_assert(!pluma_match_index_find_previous(
+        index, g_array_index(expected, gint, 1) - 1, NULL, NULL));
+    g_assert_cmpint(pluma_match_index_get_position(
+                        index, g_array_index(expected, gint, 0) + 1),
+                    ==, -1);
+  }
+}
+
+/* matches of two characters every ten from start to end */
+static void add_matches(GArray *matches, gint start, gint end) {
+  gint offset;
+
+  for (offset = start; offset + 2 <= end; offset += 10) {
+    gint match[2] = {offset, offset + 2};
+
+    g_array_append_vals(matches, match, 2);
+  }
+}
+
+static void test_set_range() {
+  PlumaMatchIndex *index;
+  GArray *expected;
+  GArray *matches;
+  gint start;
+
+  index = pluma_match_index_new();
+  expected = g_array_new(FALSE, FALSE, sizeof(gint));
+  matches = g_array_new(FALSE, FALSE, sizeof(gint));
+
+  check_matches(index, expected);
+
+  /* the second half first, over several blocks */
+  for (start = 50000; start >= 0; start -= 50000) {
+    g_array_set_size(matches, 0);
+    add_matches(matches, start, start + 50000);
+
+    pluma_match_index_set_range(index, start, start + 50000,
+                                (const gint *)matches->data, matches->len / 2);
+  }
+
+  add_matches(expected, 0, 100000);
+  check_matches(index, expected);
+
+  /* searched again with fewer matches */
+  g_array_set_size(matches, 0);
+  add_matches(matches, 20005, 20100);
+
+  pluma_match_index_set_range(index, 20000, 30000, (const gint *)matches->data,
+                              matches->len / 2);
+
+  g_array_set_size(expected, 0);
+  add_matches(expected, 0, 20000);
+  add_matches(expected, 20005, 20100);
+  add_matches(expected, 30000, 100000);
+  check_matches(index, expected);
+
+  pluma_match_index_set_range(index, 0, 100000, NULL, 0);
+
+  g_array_set_size(expected, 0);
+  check_matches(index, expected);
+
+  g_array_free(expected, TRUE);
+  g_array_free(matches, TRUE);
+  pluma_match_index_free(index);
+}
+
+static void test_edits() {
+  PlumaMatchIndex *index;
+  GArray *expected;
+
+  index = pluma_match_index_new();
+  expected = g_array_new(FALSE, FALSE, sizeof(gint));
+
+  add_matches(expected, 0, 100000);
+  pluma_match_index_set_range(index, 0, 100000, (const gint *)expected->data,
+                              expected->len / 2);
+
+  /* before a match, in one and in the last block */
+  pluma_match_index_text_inserted(index, 5, 3);
+  pluma_match_index_text_inserted(index, 14, 4);
+  pluma_match_index_text_inserted(index, 99995, 1);
+
+  g_array_set_size(expected, 0);
+  add_matches(expected, 0, 10);
+  add_matches(expected, 13, 15);
+  /* the match around the inserted text grows */
+  g_array_index(expected, gint, 3) = 19;
+  add_matches(expected, 27, 99990);
+  add_matches(expected, 99998, 100000);
+  check_matches(index, expected);
+
+  /* the matches deleted with the text go */
+  pluma_match_index_text_deleted(index, 1, 28);
+
+  g_array_set_size(expected, 0);
+  add_matches(expected, 10, 99963);
+  add_matches(expected, 99971, 99973);
+  check_matches(index, expected);
+
+  pluma_match_index_text_deleted(index, 0, 99973);
+
+  g_array_set_size(expected, 0);
+  check_matches(index, expected);
+
+  g_array_free(expected, TRUE);
+  pluma_match_index_free(index);
+}
+
+int main(int argc, char *argv[]) {
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/match-index/set-range", test_set_range);
+  g_test_add_func("/match-index/edits", test_edits);
+
+  return g_test_run();
+}
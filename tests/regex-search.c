@@ -0,0 +1,270 @@
+/*
+ * regex-search.c
+ * This file is part of pluma
+ *
+ * Copyright (C) 2012-2021 MATE Developers
+ *
+ * pluma is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * pluma is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with pluma; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <glib.h>
+#include <gtk/gtk.h>
+#include <string.h>
+
+#include "pluma-document.h"
+#include "pluma-regex-search.h"
+
+static gchar *get_text(GtkTextBuffer *buffer) {
+  GtkTextIter start;
+  GtkTextIter end;
+
+  gtk_text_buffer_get_bounds(buffer, &start, &end);
+
+  return gtk_text_buffer_get_text(buffer, &start, &end, TRUE);
+}
+
+/* searches from offset and checks the offsets of the match */
+static void check_find(PlumaRegexSearch *search, GtkTextBuffer *buffer,
+                       const gchar *pattern, gint offset,
+                       gboolean forward_search, gint match_start_offset,
+                       gint match_end_offset) {
+  GtkTextIter iter;
+  GtkTextIter match_start;
+  GtkTextIter match_end;
+  gboolean found;
+
+  gtk_text_buffer_get_iter_at_offset(buffer, &iter, offset);
+
+  found = pluma_regex_search_find(search, pattern,
+                                  GTK_TEXT_SEARCH_CASE_INSENSITIVE, &iter,
+                                  NULL, forward_search, &match_start,
+                                  &match_end, NULL);
+
+  if (match_start_offset < 0) {
+    g_assert(!found);
+    return;
+  }
+
+  g_assert(found);
+  g_assert_cmpint(gtk_text_iter_get_offset(&match_start), ==,
+                  match_start_offset);
+  g_assert_cmpint(gtk_text_iter_get_offset(&match_end), ==, match_end_offset);
+}
+
+static void test_find() {
+  GtkTextBuffer *buffer;
+  PlumaRegexSearch *search;
+  GtkTextIter iter;
+  GtkTextIter match_start;
+  GtkTextIter match_end;
+  gchar *replace_text;
+
+  buffer = gtk_text_buffer_new(NULL);
+  gtk_text_buffer_set_text(buffer, "x = 1\n\303\251t\303\251 = 22\nabc\n", -1);
+
+  search = pluma_regex_search_new(buffer);
+
+  check_find(search, buffer, "\\d+", 0, TRUE, 4, 5);
+  check_find(search, buffer, "\\d+", 5, TRUE, 12, 14);
+  check_find(search, buffer, "\\d+", 15, TRUE, -1, -1);
+  check_find(search, buffer, "\\d+", 15, FALSE, 12, 14);
+  check_find(search, buffer, "\\d+", 12, FALSE, 4, 5);
+  check_find(search, buffer, "\303\211T\303\211", 0, TRUE, 6, 9);
+
+  /* the text before the search start is seen */
+  check_find(search, buffer, "^b", 15, TRUE, -1, -1);
+  check_find(search, buffer, "(?<=a)b", 16, TRUE, 16, 17);
+
+  /* invalid patterns are not found */
+  check_find(search, buffer, "(", 0, TRUE, -1, -1);
+
+  gtk_text_buffer_get_start_iter(buffer, &iter);
+  replace_text = g_strdup("\\2:\\1");
+
+  g_assert(pluma_regex_search_find(search, "(\\w+) = (\\d+)", 0, &iter, NULL,
+                                   TRUE, &match_start, &match_end,
+                                   &replace_text));
+  g_assert_cmpstr(replace_text, ==, "1:x");
+
+  g_free(replace_text);
+  pluma_regex_search_free(search);
+  g_object_unref(buffer);
+}
+
+/* the copy of the text follows the edits */
+static void test_edits() {
+  GtkTextBuffer *buffer;
+  PlumaRegexSearch *search;
+  GtkTextIter iter;
+  GtkTextIter end;
+
+  buffer = gtk_text_buffer_new(NULL);
+  gtk_text_buffer_set_text(buffer, "one two three four", -1);
+
+  search = pluma_regex_search_new(buffer);
+
+  check_find(search, buffer, "t\\w+", 0, TRUE, 4, 7);
+
+  /* after the last search */
+  gtk_text_buffer_get_iter_at_offset(buffer, &iter, 4);
+  end = iter;
+  gtk_text_iter_forward_chars(&end, 3);
+  gtk_text_buffer_delete(buffer, &iter, &end);
+  gtk_text_buffer_insert(buffer, &iter, "\303\251\303\251\303\251\303\251", -1);
+
+  check_find(search, buffer, "t\\w+", 8, TRUE, 9, 14);
+  check_find(search, buffer, "f\\w+", 8, TRUE, 15, 19);
+
+  /* before it */
+  gtk_text_buffer_get_start_iter(buffer, &iter);
+  gtk_text_buffer_insert(buffer, &iter, "ten ", -1);
+
+  check_find(search, buffer, "t\\w+", 0, TRUE, 0, 3);
+  check_find(search, buffer, "t\\w+", 3, TRUE, 13, 18);
+
+  /* at the start of a line after an edit */
+  gtk_text_buffer_set_text(buffer, "ab\nab", -1);
+  check_find(search, buffer, "^a", 0, TRUE, 0, 1);
+
+  gtk_text_buffer_get_iter_at_offset(buffer, &iter, 2);
+  gtk_text_buffer_insert(buffer, &iter, "c", -1);
+
+  check_find(search, buffer, "^b", 3, TRUE, -1, -1);
+  check_find(search, buffer, "^a", 3, TRUE, 4, 5);
+
+  pluma_regex_search_free(search);
+  g_object_unref(buffer);
+}
+
+static gboolean append_match(GtkTextIter *match_start, GtkTextIter *match_end,
+                             GString *matches) {
+  g_string_append_printf(matches, "%d-%d ",
+                         gtk_text_iter_get_offset(match_start),
+                         gtk_text_iter_get_offset(match_end));
+
+  return TRUE;
+}
+
+/* matches from start_offset to end_offset, as "start-end " pairs */
+static gboolean check_foreach(PlumaRegexSearch *search, GtkTextBuffer *buffer,
+                              const gchar *pattern, gint start_offset,
+                              gint end_offset, const gchar *expected) {
+  GtkTextIter start;
+  GtkTextIter end;
+  GString *matches;
+  gboolean ok;
+
+  gtk_text_buffer_get_iter_at_offset(buffer, &start, start_offset);
+  gtk_text_buffer_get_iter_at_offset(buffer, &end, end_offset);
+  matches = g_string_new(NULL);
+
+  ok = pluma_regex_search_foreach(search, pattern, 0, &start, &end,
+                                  (PlumaRegexSearchFunc)append_match, matches);
+  g_assert_cmpstr(matches->str, ==, expected);
+
+  g_string_free(matches, TRUE);
+
+  return ok;
+}
+
+static void test_foreach() {
+  GtkTextBuffer *buffer;
+  PlumaRegexSearch *search;
+
+  buffer = gtk_text_buffer_new(NULL);
+  gtk_text_buffer_set_text(buffer, "ab\n\303\251b ab\nab", -1);
+
+  search = pluma_regex_search_new(buffer);
+
+  check_foreach(search, buffer, "b", 0, 11, "1-2 4-5 7-8 10-11 ");
+  check_foreach(search, buffer, "\303\251b", 0, 11, "3-5 ");
+
+  /* the bounds are line starts and ends only where the lines are */
+  check_foreach(search, buffer, "^a", 0, 11, "0-1 9-10 ");
+  check_foreach(search, buffer, "^a", 6, 11, "9-10 ");
+  check_foreach(search, buffer, "\\w$", 0, 7, "1-2 ");
+  check_foreach(search, buffer, "\\w$", 0, 8, "1-2 7-8 ");
+
+  g_assert_true(
+      check_foreach(search, buffer, "x*", 9, 11, "9-9 10-10 11-11 "));
+  g_assert_false(check_foreach(search, buffer, "(", 0, 11, ""));
+
+  /* a pattern which backtracks without end stops at the match limit */
+  gtk_text_buffer_set_text(buffer, "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa!",
+                           -1);
+  g_assert_false(check_foreach(search, buffer, "(a+)+$", 0, 41, ""));
+  g_assert_true(check_foreach(search, buffer, "a+!", 0, 41, "0-41 "));
+
+  pluma_regex_search_free(search);
+  g_object_unref(buffer);
+}
+
+static void test_replace_all() {
+  PlumaDocument *doc;
+  GString *text;
+  GString *expected;
+  gchar *result;
+  guint flags = 0;
+  gint i;
+
+  doc = pluma_document_new();
+
+  text = g_string_new(NULL);
+  expected = g_string_new(NULL);
+
+  for (i = 0; i < 10000; i++) {
+    g_string_append_printf(text, "k\303\251y%d = %d\n", i, i * 2);
+    g_string_append_printf(expected, "%d: k\303\251y%d\n", i * 2, i);
+  }
+
+  gtk_text_buffer_set_text(GTK_TEXT_BUFFER(doc), text->str, -1);
+
+  PLUMA_SEARCH_SET_MATCH_REGEX(flags, TRUE);
+  PLUMA_SEARCH_SET_CASE_SENSITIVE(flags, TRUE);
+
+  g_assert_cmpint(
+      pluma_document_replace_all(doc, "^(\\S+) = (\\d+)$", "\\2: \\1", flags),
+      ==, 10000);
+
+  result = get_text(GTK_TEXT_BUFFER(doc));
+  g_assert_cmpstr(result, ==, expected->str);
+  g_free(result);
+
+  /* the replacements do not start lines */
+  gtk_text_buffer_set_text(GTK_TEXT_BUFFER(doc), "aaa\naa", -1);
+
+  g_assert_cmpint(pluma_document_replace_all(doc, "^a", "b", flags), ==, 2);
+
+  result = get_text(GTK_TEXT_BUFFER(doc));
+  g_assert_cmpstr(result, ==, "baa\nba");
+  g_free(result);
+
+  g_string_free(text, TRUE);
+  g_string_free(expected, TRUE);
+  g_object_unref(doc);
+}
+
+int main(int argc, char *argv[]) {
+  gtk_init(&argc, &argv);
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/regex-search/find", test_find);
+  g_test_add_func("/regex-search/edits", test_edits);
+  g_test_add_func("/regex-search/foreach", test_foreach);
+  g_test_add_func("/regex-search/replace-all", test_replace_all);
+
+  return g_test_run();
+}
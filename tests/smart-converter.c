@@ -27,6 +27,7 @@
 #include <string.h>
 
 #include "pluma-encodings.h"
+#include "pluma-single-byte-converter.h"
 #include "pluma-smart-charset-converter.h"
 
 #define TEXT_TO_CONVERT "this is some text to make the tests"
@@ -297,6 +298,436 @@ static void test_guessed() {
   g_free(aux2);
 }
 
+static void test_utf8_evidence() {
+  GSList *encs = NULL;
+  gchar *aux;
+  const PlumaEncoding *guessed;
+
+  /* ISO-8859-15 can decode anything, but real multibyte characters are
+     strong evidence for UTF-8 */
+  encs = g_slist_append(
+      encs, (gpointer)pluma_encoding_get_from_charset("ISO-8859-15"));
+  encs = g_slist_append(encs, (gpointer)pluma_encoding_get_utf8());
+
+  aux = do_test(TEXT_TO_GUESS, NULL, encs, strlen(TEXT_TO_GUESS), &guessed);
+
+  g_assert(guessed == pluma_encoding_get_utf8());
+  g_assert_cmpstr(aux, ==, TEXT_TO_GUESS);
+
+  g_free(aux);
+  g_slist_free(encs);
+}
+
+static void test_utf16_byte_order() {
+  GSList *encs = NULL;
+  gchar *aux, *aux2;
+  gsize aux_len;
+  const PlumaEncoding *guessed;
+
+  aux = get_encoded_text(
+      TEXT_TO_CONVERT, -1, pluma_encoding_get_from_charset("UTF-16LE"),
+      pluma_encoding_get_from_charset("UTF-8"), &aux_len, TRUE);
+
+  /* both would convert, the null bytes tell which one is right */
+  encs = g_slist_append(encs,
+                        (gpointer)pluma_encoding_get_from_charset("UTF-16BE"));
+  encs = g_slist_append(encs,
+                        (gpointer)pluma_encoding_get_from_charset("UTF-16LE"));
+
+  aux2 = do_test(aux, NULL, encs, aux_len, &guessed);
+
+  g_assert(guessed == pluma_encoding_get_from_charset("UTF-16LE"));
+  g_assert_cmpstr(aux2, ==, TEXT_TO_CONVERT);
+
+  g_free(aux);
+  g_free(aux2);
+  g_slist_free(encs);
+}
+
+static void check_single_byte_guess(const gchar *text, const gchar *charset,
+                                    const gchar *first, const gchar *second) {
+  GSList *encs = NULL;
+  gchar *aux, *aux2;
+  gsize aux_len;
+  const PlumaEncoding *guessed;
+
+  aux = get_encoded_text(text, -1, pluma_encoding_get_from_charset(charset),
+                         pluma_encoding_get_from_charset("UTF-8"), &aux_len,
+                         TRUE);
+
+  encs = g_slist_append(encs, (gpointer)pluma_encoding_get_from_charset(first));
+  encs =
+      g_slist_append(encs, (gpointer)pluma_encoding_get_from_charset(second));
+
+  aux2 = do_test(aux, NULL, encs, aux_len, &guessed);
+
+  g_assert(guessed == pluma_encoding_get_from_charset(charset));
+  g_assert_cmpstr(aux2, ==, text);
+
+  g_free(aux);
+  g_free(aux2);
+  g_slist_free(encs);
+}
+
+static void test_single_byte_evidence() {
+  const gchar *russian =
+      "\xd0\xa1\xd1\x8a\xd0\xb5\xd1\x88\xd1\x8c \xd0\xb6\xd0\xb5 "
+      "\xd0\xb5\xd1\x89\xd1\x91 \xd1\x8d\xd1\x82\xd0\xb8\xd1\x85 "
+      "\xd0\xbc\xd1\x8f\xd0\xb3\xd0\xba\xd0\xb8\xd1\x85 "
+      "\xd1\x84\xd1\x80\xd0\xb0\xd0\xbd\xd1\x86\xd1\x83\xd0\xb7\xd1\x81"
+      "\xd0\xba\xd0\xb8\xd1\x85 \xd0\xb1\xd1\x83\xd0\xbb\xd0\xbe\xd0\xba, "
+      "\xd0\xb4\xd0\xb0 \xd0\xb2\xd1\x8b\xd0\xbf\xd0\xb5\xd0\xb9 "
+      "\xd1\x87\xd0\xb0\xd1\x8e";
+  const gchar *polish =
+      "Za\xc5\xbc\xc3\xb3\xc5\x82\xc4\x87 g\xc4\x99\xc5\x9bl\xc4\x85 "
+      "ja\xc5\xba\xc5\x84";
+
+  /* every single byte encoding decodes these, the letters they decode to
+     tell the right one, whatever its place in the list */
+  check_single_byte_guess(russian, "KOI8-R", "WINDOWS-1251", "KOI8-R");
+  check_single_byte_guess(russian, "WINDOWS-1251", "KOI8-R", "WINDOWS-1251");
+  check_single_byte_guess(polish, "ISO-8859-2", "WINDOWS-1252", "ISO-8859-2");
+
+  /* without high bytes there is nothing to tell, the first one wins */
+  check_single_byte_guess(TEXT_TO_CONVERT, "WINDOWS-1251", "WINDOWS-1251",
+                          "KOI8-R");
+  check_single_byte_guess(TEXT_TO_CONVERT, "KOI8-R", "KOI8-R", "WINDOWS-1251");
+}
+
+static gchar *convert_all(GConverter *converter, const gchar *in, gsize len,
+                          gsize *out_len) {
+  gchar *out;
+  gsize out_size;
+  gsize nread = 0;
+  gsize nwritten = 0;
+  GConverterResult res;
+  GError *err = NULL;
+
+  out_size = len * 4 + 1;
+  out = g_malloc(out_size);
+
+  do {
+    gsize bytes_read, bytes_written;
+
+    res = g_converter_convert(converter, in + nread, len - nread,
+                              out + nwritten, out_size - nwritten,
+                              G_CONVERTER_INPUT_AT_END, &bytes_read,
+                              &bytes_written, &err);
+    nread += bytes_read;
+    nwritten += bytes_written;
+  } while (res != G_CONVERTER_FINISHED && res != G_CONVERTER_ERROR);
+
+  g_assert_no_error(err);
+
+  *out_len = nwritten;
+
+  return out;
+}
+
+static void test_single_byte_tables() {
+  gint i;
+
+  for (i = 0; pluma_encoding_get_from_index(i) != NULL; i++) {
+    const PlumaEncoding *enc = pluma_encoding_get_from_index(i);
+    const gchar *charset = pluma_encoding_get_charset(enc);
+    PlumaSingleByteConverter *conv;
+    GCharsetConverter *iconv;
+    gchar bytes[255];
+    gchar *utf8, *expected, *encoded;
+    gsize n_bytes = 0;
+    gsize utf8_len, expected_len, encoded_len;
+    guint c;
+
+    conv = pluma_single_byte_converter_new(enc, TRUE);
+
+    if (conv == NULL) {
+      g_assert(_pluma_encoding_get_byte_table(enc) == NULL);
+      continue;
+    }
+
+    /* every byte the encoding uses */
+    for (c = 1; c < 0x100; c++) {
+      if (c < 0x80 || _pluma_encoding_get_byte_table(enc)[c - 0x80] != 0)
+        bytes[n_bytes++] = c;
+    }
+
+    /* the tables agree with iconv */
+    utf8 = convert_all(G_CONVERTER(conv), bytes, n_bytes, &utf8_len);
+    g_object_unref(conv);
+
+    iconv = g_charset_converter_new("UTF-8", charset, NULL);
+    expected = convert_all(G_CONVERTER(iconv), bytes, n_bytes, &expected_len);
+    g_object_unref(iconv);
+
+    g_assert_cmpuint(utf8_len, ==, expected_len);
+    g_assert(memcmp(utf8, expected, utf8_len) == 0);
+
+    /* and back */
+    conv = pluma_single_byte_converter_new(enc, FALSE);
+    encoded = convert_all(G_CONVERTER(conv), utf8, utf8_len, &encoded_len);
+    g_object_unref(conv);
+
+    g_assert_cmpuint(encoded_len, ==, n_bytes);
+    g_assert(memcmp(encoded, bytes, n_bytes) == 0);
+
+    g_free(utf8);
+    g_free(expected);
+    g_free(encoded);
+  }
+}
+
+static void test_single_byte_errors() {
+  const PlumaEncoding *enc = pluma_encoding_get_from_charset("WINDOWS-1252");
+  PlumaSingleByteConverter *conv;
+  GConverterResult res;
+  gsize bytes_read, bytes_written;
+  gchar out[16];
+  GError *err = NULL;
+
+  /* the text before an undefined byte is converted first */
+  conv = pluma_single_byte_converter_new(enc, TRUE);
+  res = g_converter_convert(G_CONVERTER(conv), "ab\x81", 3, out, sizeof(out),
+                            G_CONVERTER_INPUT_AT_END, &bytes_read,
+                            &bytes_written, &err);
+  g_assert_no_error(err);
+  g_assert_cmpint(res, ==, G_CONVERTER_CONVERTED);
+  g_assert_cmpuint(bytes_read, ==, 2);
+
+  res = g_converter_convert(G_CONVERTER(conv), "\x81", 1, out, sizeof(out),
+                            G_CONVERTER_INPUT_AT_END, &bytes_read,
+                            &bytes_written, &err);
+  g_assert_error(err, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+  g_assert_cmpint(res, ==, G_CONVERTER_ERROR);
+  g_clear_error(&err);
+  g_object_unref(conv);
+
+  conv = pluma_single_byte_converter_new(enc, FALSE);
+
+  /* a character which has no byte */
+  res = g_converter_convert(G_CONVERTER(conv), "\xe6\x96\x87", 3, out,
+                            sizeof(out), G_CONVERTER_INPUT_AT_END,
+                            &bytes_read, &bytes_written, &err);
+  g_assert_error(err, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+  g_clear_error(&err);
+
+  /* the euro sign, cut between two blocks */
+  res = g_converter_convert(G_CONVERTER(conv), "\xe2\x82", 2, out,
+                            sizeof(out), G_CONVERTER_NO_FLAGS, &bytes_read,
+                            &bytes_written, &err);
+  g_assert_error(err, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT);
+  g_clear_error(&err);
+
+  res = g_converter_convert(G_CONVERTER(conv), "\xe2\x82\xac", 3, out,
+                            sizeof(out), G_CONVERTER_INPUT_AT_END,
+                            &bytes_read, &bytes_written, &err);
+  g_assert_no_error(err);
+  g_assert_cmpint(res, ==, G_CONVERTER_FINISHED);
+  g_assert_cmpuint(bytes_written, ==, 1);
+  g_assert_cmpint((guchar)out[0], ==, 0x80);
+
+  /* no room for a character */
+  res = g_converter_convert(G_CONVERTER(conv), "abc", 3, out, 0,
+                            G_CONVERTER_INPUT_AT_END, &bytes_read,
+                            &bytes_written, &err);
+  g_assert_error(err, G_IO_ERROR, G_IO_ERROR_NO_SPACE);
+  g_clear_error(&err);
+
+  g_object_unref(conv);
+}
+
+#define BENCHMARK_BLOCK_SIZE 8192
+#define BENCHMARK_ITERATIONS 200
+
+static void test_guess_benchmark() {
+  const gchar *samples[][2] = {
+      {"UTF-8", "The quick brown fox jumps over the lazy dog. "},
+      {"UTF-8", "hello \xe6\x96\x87 world \xe4\xb8\xad\xe6\x96\x87 "},
+      {"ISO-8859-15", "D\xc3\xa9j\xc3\xa0 vu, na\xc3\xafve caf\xc3\xa9 "},
+      {"WINDOWS-1251",
+       "\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82 "
+       "\xd0\xbc\xd0\xb8\xd1\x80 "},
+      {"KOI8-R", "\xd0\x94\xd0\xbe\xd0\xbc \xd0\xb8 \xd1\x81\xd0\xb0\xd0\xb4 "},
+      {"UTF-16", "The quick brown fox jumps over the lazy dog. "},
+      {"GB18030", "\xe4\xb8\xad\xe6\x96\x87\xe6\xb5\x8b\xe8\xaf\x95 "}};
+  const gchar *candidates[] = {"UTF-8",  "ISO-8859-15", "WINDOWS-1252",
+                               "WINDOWS-1251", "KOI8-R", "UTF-16",
+                               "GB18030", "SHIFT_JIS"};
+  GSList *encs = NULL;
+  GPtrArray *corpus;
+  gchar *out;
+  gdouble elapsed;
+  guint i, j;
+
+  if (!g_test_perf()) {
+    g_test_skip("only run in performance mode");
+    return;
+  }
+
+  for (i = 0; i < G_N_ELEMENTS(candidates); i++) {
+    encs = g_slist_append(
+        encs, (gpointer)pluma_encoding_get_from_charset(candidates[i]));
+  }
+
+  /* one block for each sample, as it would be read from the file */
+  corpus = g_ptr_array_new_with_free_func((GDestroyNotify)g_bytes_unref);
+  for (i = 0; i < G_N_ELEMENTS(samples); i++) {
+    GString *text = g_string_new(NULL);
+    gchar *encoded;
+    gsize len;
+
+    while (text->len < BENCHMARK_BLOCK_SIZE)
+      g_string_append(text, samples[i][1]);
+
+    encoded = g_convert(text->str, text->len, samples[i][0], "UTF-8", NULL,
+                        &len, NULL);
+    g_assert(encoded != NULL);
+
+    g_ptr_array_add(corpus, g_bytes_new_take(encoded, len));
+    g_string_free(text, TRUE);
+  }
+
+  out = g_malloc(BENCHMARK_BLOCK_SIZE * 4);
+
+  g_test_timer_start();
+
+  for (j = 0; j < BENCHMARK_ITERATIONS; j++) {
+    for (i = 0; i < corpus->len; i++) {
+      PlumaSmartCharsetConverter *converter;
+      gsize bytes_read, bytes_written;
+      gsize len;
+      const gchar *data;
+
+      data = g_bytes_get_data(g_ptr_array_index(corpus, i), &len);
+
+      converter = pluma_smart_charset_converter_new(encs);
+      g_converter_convert(G_CONVERTER(converter), data, len, out,
+                          BENCHMARK_BLOCK_SIZE * 4, G_CONVERTER_NO_FLAGS,
+                          &bytes_read, &bytes_written, NULL);
+      g_object_unref(converter);
+    }
+  }
+
+  elapsed = g_test_timer_elapsed();
+
+  g_test_minimized_result(elapsed / (BENCHMARK_ITERATIONS * corpus->len),
+                          "guessing an encoding among %u candidates: %g s",
+                          G_N_ELEMENTS(candidates),
+                          elapsed / (BENCHMARK_ITERATIONS * corpus->len));
+
+  g_free(out);
+  g_ptr_array_unref(corpus);
+  g_slist_free(encs);
+}
+
+#define CONVERSION_BENCHMARK_SIZE (4 * 1024 * 1024)
+#define CONVERSION_BENCHMARK_ITERATIONS 10
+
+static gdouble time_conversion(GConverter *converter, const gchar *in,
+                               gsize len, gchar *out, gsize out_size) {
+  guint i;
+
+  g_test_timer_start();
+
+  for (i = 0; i < CONVERSION_BENCHMARK_ITERATIONS; i++) {
+    gsize nread = 0;
+
+    g_converter_reset(converter);
+
+    /* in blocks, as the streams do */
+    while (nread < len) {
+      gsize bytes_read, bytes_written;
+      GConverterResult res;
+      GError *err = NULL;
+
+      res = g_converter_convert(
+          converter, in + nread, MIN(len - nread, BENCHMARK_BLOCK_SIZE), out,
+          out_size, G_CONVERTER_NO_FLAGS, &bytes_read, &bytes_written, &err);
+      g_assert_no_error(err);
+      g_assert_cmpint(res, !=, G_CONVERTER_ERROR);
+
+      nread += bytes_read;
+    }
+  }
+
+  return g_test_timer_elapsed() / CONVERSION_BENCHMARK_ITERATIONS;
+}
+
+static void report_conversion(const gchar *what, const gchar *charset,
+                              gsize len, gdouble table, gdouble iconv) {
+  g_test_minimized_result(
+      table, "%s %s, table: %g s (%g MiB/s), iconv: %g s (%g MiB/s)", what,
+      charset, table, (len / (1024.0 * 1024.0)) / table, iconv,
+      (len / (1024.0 * 1024.0)) / iconv);
+}
+
+static void test_conversion_benchmark() {
+  const gchar *samples[][2] = {
+      {"ISO-8859-15", "The quick brown fox jumps over the lazy dog. "},
+      {"ISO-8859-15", "D\xc3\xa9j\xc3\xa0 vu, na\xc3\xafve caf\xc3\xa9 "},
+      {"WINDOWS-1251",
+       "\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82 "
+       "\xd0\xbc\xd0\xb8\xd1\x80 "},
+      {"KOI8-R",
+       "\xd0\x94\xd0\xbe\xd0\xbc \xd0\xb8 \xd1\x81\xd0\xb0\xd0\xb4 "}};
+  gchar *out;
+  gsize out_size;
+  guint i;
+
+  if (!g_test_perf()) {
+    g_test_skip("only run in performance mode");
+    return;
+  }
+
+  out_size = BENCHMARK_BLOCK_SIZE * 4;
+  out = g_malloc(out_size);
+
+  for (i = 0; i < G_N_ELEMENTS(samples); i++) {
+    const PlumaEncoding *enc = pluma_encoding_get_from_charset(samples[i][0]);
+    GConverter *table;
+    GConverter *iconv;
+    GString *text;
+    gchar *encoded;
+    gsize len;
+    gdouble table_time, iconv_time;
+
+    text = g_string_new(NULL);
+    while (text->len < CONVERSION_BENCHMARK_SIZE)
+      g_string_append(text, samples[i][1]);
+
+    encoded = g_convert(text->str, text->len, samples[i][0], "UTF-8", NULL,
+                        &len, NULL);
+    g_assert(encoded != NULL);
+
+    /* loading */
+    table = G_CONVERTER(pluma_single_byte_converter_new(enc, TRUE));
+    iconv = G_CONVERTER(g_charset_converter_new("UTF-8", samples[i][0], NULL));
+
+    table_time = time_conversion(table, encoded, len, out, out_size);
+    iconv_time = time_conversion(iconv, encoded, len, out, out_size);
+    report_conversion("decoding", samples[i][0], len, table_time, iconv_time);
+
+    g_object_unref(table);
+    g_object_unref(iconv);
+
+    /* saving */
+    table = G_CONVERTER(pluma_single_byte_converter_new(enc, FALSE));
+    iconv = G_CONVERTER(g_charset_converter_new(samples[i][0], "UTF-8", NULL));
+
+    table_time = time_conversion(table, text->str, text->len, out, out_size);
+    iconv_time = time_conversion(iconv, text->str, text->len, out, out_size);
+    report_conversion("encoding", samples[i][0], text->len, table_time,
+                      iconv_time);
+
+    g_object_unref(table);
+    g_object_unref(iconv);
+
+    g_free(encoded);
+    g_string_free(text, TRUE);
+  }
+
+  g_free(out);
+}
+
 int main(int argc, char *argv[]) {
   g_test_init(&argc, &argv, NULL);
 
@@ -304,6 +735,17 @@ int main(int argc, char *argv[]) {
   // g_test_add_func ("/smart-converter/xxx-xxx", test_xxx_xxx);
   g_test_add_func("/smart-converter/guessed", test_guessed);
   g_test_add_func("/smart-converter/empty", test_empty);
+  g_test_add_func("/smart-converter/utf8-evidence", test_utf8_evidence);
+  g_test_add_func("/smart-converter/utf16-byte-order", test_utf16_byte_order);
+  g_test_add_func("/smart-converter/single-byte-evidence",
+                  test_single_byte_evidence);
+  g_test_add_func("/smart-converter/single-byte-tables",
+                  test_single_byte_tables);
+  g_test_add_func("/smart-converter/single-byte-errors",
+                  test_single_byte_errors);
+  g_test_add_func("/smart-converter/guess-benchmark", test_guess_benchmark);
+  g_test_add_func("/smart-converter/conversion-benchmark",
+                  test_conversion_benchmark);
 
   return g_test_run();
 }